@@ -0,0 +1,538 @@
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include <imgui.h>
+#include <imgui_internal.h>
+#include <imgui_fft.h>
+#include <ThreadUtils.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define AUDIO_SCOPE_USE_SSE2
+#include <emmintrin.h>
+#endif
+#include "AudioScopeAnalyzer.h"
+
+using namespace std;
+
+namespace MEC
+{
+// Real fft with precomputed bit reversal and twiddle tables. The output is identical in layout, sign convention
+// and scale to 'ImGui::ImRFFT(data, N, true)': data[0] is DC, data[1] is Nyquist, followed by re/im pairs.
+class RealFftPlan
+{
+public:
+    void Prepare(int N)
+    {
+        if (N == m_N)
+            return;
+        m_N = N;
+        const int M = N >> 1;
+        m_bitrev.clear();
+        int j = 0;
+        for (int i = 0; i < M; i++)
+        {
+            if (j > i)
+            {
+                m_bitrev.push_back(i);
+                m_bitrev.push_back(j);
+            }
+            int m = M >> 1;
+            while (m >= 1 && j >= m)
+            {
+                j -= m;
+                m >>= 1;
+            }
+            j += m;
+        }
+        // butterfly twiddles of all the stages, (cos, cos) and (-sin, sin) for each, ready for complex multiply
+        m_wrdup.resize(M*2);
+        m_wisgn.resize(M*2);
+        m_stageOffset.clear();
+        int off = 0;
+        for (int L = 1; L < M; L <<= 1)
+        {
+            m_stageOffset.push_back(off);
+            for (int k = 0; k < L; k++)
+            {
+                const double theta = M_PI*k/L;
+                const float wr = (float)cos(theta), wi = (float)sin(theta);
+                m_wrdup[off+k*2] = wr; m_wrdup[off+k*2+1] = wr;
+                m_wisgn[off+k*2] = -wi; m_wisgn[off+k*2+1] = wi;
+            }
+            off += L*2;
+        }
+        const int Q = N >> 2;
+        m_postWr.resize(Q);
+        m_postWi.resize(Q);
+        for (int i = 0; i < Q; i++)
+        {
+            const double theta = 2.0*M_PI*i/N;
+            m_postWr[i] = (float)cos(theta);
+            m_postWi[i] = (float)sin(theta);
+        }
+        m_scale = 1.f/sqrtf((float)M);
+    }
+
+    void Forward(float* data) const
+    {
+        const int N = m_N;
+        const int M = N >> 1;
+        const int n = N;
+        for (size_t k = 0; k < m_bitrev.size(); k += 2)
+        {
+            const int a = m_bitrev[k]*2, b = m_bitrev[k+1]*2;
+            std::swap(data[a], data[b]);
+            std::swap(data[a+1], data[b+1]);
+        }
+
+        int stage = 0;
+        for (int L = 1; L < M; L <<= 1, stage++)
+        {
+            const int mmax = L*2;
+            const int istep = mmax*2;
+            const float* wrdup = m_wrdup.data()+m_stageOffset[stage];
+            const float* wisgn = m_wisgn.data()+m_stageOffset[stage];
+#ifdef AUDIO_SCOPE_USE_SSE2
+            if (L >= 2)
+            {
+                for (int g = 0; g < n; g += istep)
+                {
+                    float* pi = data+g;
+                    float* pj = pi+mmax;
+                    for (int m = 0; m < mmax; m += 4)
+                    {
+                        const __m128 b = _mm_loadu_ps(pj+m);
+                        const __m128 bswap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1));
+                        const __m128 t = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(wrdup+m), b), _mm_mul_ps(_mm_loadu_ps(wisgn+m), bswap));
+                        const __m128 a = _mm_loadu_ps(pi+m);
+                        _mm_storeu_ps(pj+m, _mm_sub_ps(a, t));
+                        _mm_storeu_ps(pi+m, _mm_add_ps(a, t));
+                    }
+                }
+                continue;
+            }
+#endif
+            for (int m = 0; m < mmax; m += 2)
+            {
+                const float wr = wrdup[m], wi = wisgn[m+1];
+                for (int i = m; i < n; i += istep)
+                {
+                    const int j = i+mmax;
+                    const float tempr = wr*data[j]-wi*data[j+1];
+                    const float tempi = wr*data[j+1]+wi*data[j];
+                    data[j] = data[i]-tempr;
+                    data[j+1] = data[i+1]-tempi;
+                    data[i] += tempr;
+                    data[i+1] += tempi;
+                }
+            }
+        }
+
+        int i = 0;
+#ifdef AUDIO_SCOPE_USE_SSE2
+        const __m128 scale = _mm_set1_ps(m_scale);
+        for (; i+4 <= n; i += 4)
+            _mm_storeu_ps(data+i, _mm_mul_ps(_mm_loadu_ps(data+i), scale));
+#endif
+        for (; i < n; i++)
+            data[i] *= m_scale;
+
+        // split the N/2 complex spectrum into the N point real spectrum
+        for (int k = 1; k < N >> 2; k++)
+        {
+            const int i1 = k+k, i2 = i1+1, i3 = N-i1, i4 = i3+1;
+            const float wr = m_postWr[k], wi = m_postWi[k];
+            const float h1r = 0.5f*(data[i1]+data[i3]);
+            const float h1i = 0.5f*(data[i2]-data[i4]);
+            const float h2r = 0.5f*(data[i2]+data[i4]);
+            const float h2i = -0.5f*(data[i1]-data[i3]);
+            data[i1] = h1r+wr*h2r-wi*h2i;
+            data[i2] = h1i+wr*h2i+wi*h2r;
+            data[i3] = h1r-wr*h2r+wi*h2i;
+            data[i4] = -h1i+wr*h2i+wi*h2r;
+        }
+        const float h1r = data[0];
+        data[0] = h1r+data[1];
+        data[1] = h1r-data[1];
+    }
+
+private:
+    int m_N {0};
+    vector<int> m_bitrev;
+    vector<int> m_stageOffset;
+    vector<float> m_wrdup;
+    vector<float> m_wisgn;
+    vector<float> m_postWr;
+    vector<float> m_postWi;
+    float m_scale {1.f};
+};
+
+class AudioScopeAnalyzer_Impl : public AudioScopeAnalyzer
+{
+public:
+    AudioScopeAnalyzer_Impl()
+    {
+        for (auto& slot : m_inputRing)
+            slot.tracks.resize(MAX_TRACKS);
+        for (int i = 0; i < 3; i++)
+            m_frames[i].trackLevels.reserve(MAX_TRACKS);
+        m_workTrackLevels.reserve(MAX_TRACKS);
+        m_analysisThread = thread(&AudioScopeAnalyzer_Impl::AnalysisProc, this);
+        SysUtils::SetThreadName(m_analysisThread, "AudioScope");
+    }
+
+    ~AudioScopeAnalyzer_Impl()
+    {
+        m_quit = true;
+        m_inputCv.notify_one();
+        if (m_analysisThread.joinable())
+            m_analysisThread.join();
+    }
+
+    bool PushFrames(const vector<MediaCore::CorrelativeFrame>& amats) override
+    {
+        if (amats.empty())
+            return false;
+        const auto head = m_inputHead.load(memory_order_relaxed);
+        if (head-m_inputTail.load(memory_order_acquire) >= INPUT_RING_SIZE)
+        {
+            m_droppedCount++;
+            return false;
+        }
+        auto& slot = m_inputRing[head%INPUT_RING_SIZE];
+        slot.master = amats[0].frame;
+        slot.trackCount = 0;
+        for (const auto& amat : amats)
+        {
+            if (amat.phase != MediaCore::CorrelativeFrame::PHASE_AFTER_TRANSITION || slot.trackCount >= MAX_TRACKS)
+                continue;
+            auto& track = slot.tracks[slot.trackCount++];
+            track.trackId = amat.trackId;
+            track.frame = amat.frame;
+        }
+        m_inputHead.store(head+1, memory_order_release);
+        m_inputCv.notify_one();
+        return true;
+    }
+
+    const ScopeFrame* AcquireLatestFrame() override
+    {
+        if ((m_latestIdx.load(memory_order_relaxed)&NEW_FRAME_BIT) == 0)
+            return nullptr;
+        m_frontIdx = m_latestIdx.exchange(m_frontIdx, memory_order_acq_rel)&~NEW_FRAME_BIT;
+        return &m_frames[m_frontIdx];
+    }
+
+    void SetVectorParams(float scale, int mode) override
+    {
+        m_vectorScale = scale;
+        m_vectorMode = mode;
+    }
+
+    void SetSpectrogramParams(float offset, float light) override
+    {
+        m_spectrogramOffset = offset;
+        m_spectrogramLight = light;
+    }
+
+    uint64_t GetDroppedBlockCount() const override
+    {
+        return m_droppedCount;
+    }
+
+private:
+    void AnalysisProc()
+    {
+        while (!m_quit)
+        {
+            const auto tail = m_inputTail.load(memory_order_relaxed);
+            if (tail == m_inputHead.load(memory_order_acquire))
+            {
+                unique_lock<mutex> lk(m_inputLock);
+                m_inputCv.wait_for(lk, chrono::milliseconds(10));
+                continue;
+            }
+            auto& slot = m_inputRing[tail%INPUT_RING_SIZE];
+            bool published = AnalyzeMaster(slot.master);
+            m_workTrackLevels.clear();
+            for (uint32_t i = 0; i < slot.trackCount; i++)
+                AnalyzeTrack(slot.tracks[i].trackId, slot.tracks[i].frame);
+            published |= !m_workTrackLevels.empty();
+            // release the pcm here, not on the audio thread when the slot is overwritten
+            slot.master.release();
+            for (uint32_t i = 0; i < slot.trackCount; i++)
+                slot.tracks[i].frame.release();
+            m_inputTail.store(tail+1, memory_order_release);
+            if (published)
+                Publish();
+        }
+    }
+
+    // Convert the first 'fftSize' samples of 'amat' to planar float in 'm_pcm'
+    bool LoadPcm(const ImGui::ImMat& amat, int& fftSize, int& channels)
+    {
+        if (amat.empty() || amat.w < 64)
+            return false;
+        if (amat.type != IM_DT_FLOAT32 && amat.type != IM_DT_INT16)
+            return false;
+        fftSize = amat.w > 256 ? 256 : amat.w > 128 ? 128 : 64;
+        channels = amat.c;
+        m_pcm.resize(fftSize*channels);
+        const bool isPacked = amat.elempack > 1 && amat.c > 1;
+        for (int ch = 0; ch < channels; ch++)
+        {
+            float* pDst = m_pcm.data()+fftSize*ch;
+            if (amat.type == IM_DT_FLOAT32)
+            {
+                const float* pSrc = (const float*)amat.data;
+                if (isPacked)
+                    for (int i = 0; i < fftSize; i++) pDst[i] = pSrc[i*channels+ch];
+                else
+                    memcpy(pDst, pSrc+amat.w*ch, fftSize*sizeof(float));
+            }
+            else
+            {
+                const int16_t* pSrc = (const int16_t*)amat.data;
+                if (isPacked)
+                    for (int i = 0; i < fftSize; i++) pDst[i] = (float)pSrc[i*channels+ch]/INT16_MAX;
+                else
+                    for (int i = 0; i < fftSize; i++) pDst[i] = (float)pSrc[amat.w*ch+i]/INT16_MAX;
+            }
+        }
+        return true;
+    }
+
+    bool AnalyzeMaster(const ImGui::ImMat& amat)
+    {
+        int fftSize, channels;
+        if (!LoadPcm(amat, fftSize, channels))
+            return false;
+        m_fftPlan.Prepare(fftSize);
+        const int bins = (fftSize>>1)+1;
+        if ((int)m_work.size() != channels)
+            m_work.resize(channels);
+        const float specOffset = m_spectrogramOffset;
+        const float specLight = m_spectrogramLight;
+        for (int ch = 0; ch < channels; ch++)
+        {
+            auto& cs = m_work[ch];
+            if (cs.wave.w != fftSize)
+            {
+                cs.wave.create_type(fftSize, IM_DT_FLOAT32);
+                cs.fft.create_type(fftSize, IM_DT_FLOAT32);
+                cs.db.create_type(bins, IM_DT_FLOAT32);
+                cs.dbShort.create_type(20, IM_DT_FLOAT32);
+                cs.dbLong.create_type(76, IM_DT_FLOAT32);
+                cs.spectrogram.create_type(bins, 256, 4, IM_DT_INT8);
+                cs.spectrogram.fill((int8_t)0);
+            }
+            const float* pPcm = m_pcm.data()+fftSize*ch;
+            memcpy(cs.wave.data, pPcm, fftSize*sizeof(float));
+            memcpy(cs.fft.data, pPcm, fftSize*sizeof(float));
+            m_fftPlan.Forward((float*)cs.fft.data);
+            cs.dbMaxIndex = ImGui::ImReComposeDB((float*)cs.fft.data, (float*)cs.db.data, fftSize, false);
+            ImGui::ImReComposeDBShort((float*)cs.fft.data, (float*)cs.dbShort.data, fftSize);
+            ImGui::ImReComposeDBLong((float*)cs.fft.data, (float*)cs.dbLong.data, fftSize);
+            cs.decibel = ImGui::ImDoDecibel((float*)cs.fft.data, fftSize);
+
+            auto& spec = cs.spectrogram;
+            const int rowBytes = spec.w*spec.c;
+            memmove(spec.data, (char*)spec.data+rowBytes, spec.total()-rowBytes);
+            uint32_t* lastLine = (uint32_t*)spec.row_c<uint8_t>(255);
+            const float* pDb = (const float*)cs.db.data;
+            for (int n = 0; n < spec.w; n++)
+            {
+                float value = pDb[n]*M_SQRT2+64+specOffset;
+                value = ImClamp(value, -64.f, 63.f);
+                float light = (value+64)/127.f;
+                value = (int)((value+64)+170)%255;
+                auto hue = value/255.f;
+                lastLine[n] = ImColor::HSV(hue, 1.0, light*specLight);
+            }
+        }
+        if (channels >= 2)
+            UpdateVectorScope(fftSize);
+        m_workChannelCount = channels;
+        return true;
+    }
+
+    void UpdateVectorScope(int samples)
+    {
+        auto& vec = m_workVector;
+        if (vec.empty())
+        {
+            vec.create_type(256, 256, 4, IM_DT_INT8);
+            vec.fill((int8_t)0);
+            vec.elempack = 4;
+        }
+        const float zoom = m_vectorScale;
+        const int mode = m_vectorMode;
+        const float hw = vec.w/2;
+        const float hh = vec.h/2;
+        // fade the previous points out
+        uint8_t* pPix = (uint8_t*)vec.data;
+        const size_t total = vec.total();
+        size_t k = 0;
+#ifdef AUDIO_SCOPE_USE_SSE2
+        const __m128i dec = _mm_set1_epi8(64);
+        for (; k+16 <= total; k += 16)
+            _mm_storeu_si128((__m128i*)(pPix+k), _mm_sub_epi8(_mm_loadu_si128((const __m128i*)(pPix+k)), dec));
+#endif
+        for (; k < total; k++)
+            pPix[k] -= 64;
+
+        const float* pS1 = (const float*)m_work[0].wave.data;
+        const float* pS2 = (const float*)m_work[1].wave.data;
+        for (int n = 0; n < samples; n++)
+        {
+            const float s1 = pS1[n];
+            const float s2 = pS2[n];
+            int x, y;
+            if (mode == LISSAJOUS)
+            {
+                x = ((s2-s1)*zoom/2+1)*hw;
+                y = (1.0-(s1+s2)*zoom/2)*hh;
+            }
+            else if (mode == LISSAJOUS_XY)
+            {
+                x = (s2*zoom+1)*hw;
+                y = (s1*zoom+1)*hh;
+            }
+            else
+            {
+                float sx, sy, cx, cy;
+                sx = s2*zoom;
+                sy = s1*zoom;
+                cx = sx*sqrtf(1-0.5*sy*sy);
+                cy = sy*sqrtf(1-0.5*sx*sx);
+                x = hw+hw*ImSign(cx+cy)*(cx-cy)*.7;
+                y = vec.h-vec.h*fabsf(cx+cy)*.7;
+            }
+            x = ImClamp(x, 0, vec.w-1);
+            y = ImClamp(y, 0, vec.h-1);
+            uint8_t r = ImClamp(vec.at<uint8_t>(x, y, 0)+30, 0, 255);
+            uint8_t g = ImClamp(vec.at<uint8_t>(x, y, 1)+50, 0, 255);
+            uint8_t b = ImClamp(vec.at<uint8_t>(x, y, 2)+30, 0, 255);
+            vec.set_pixel(x, y, ImPixel(r/255.0, g/255.0, b/255.0, 1.f));
+        }
+    }
+
+    void AnalyzeTrack(int64_t trackId, const ImGui::ImMat& amat)
+    {
+        int fftSize, channels;
+        if (!LoadPcm(amat, fftSize, channels))
+            return;
+        m_fftPlan.Prepare(fftSize);
+        m_trackFft.resize(fftSize);
+        TrackLevels levels;
+        levels.trackId = trackId;
+        levels.channels = channels < MAX_TRACK_METER_CHANNELS ? channels : MAX_TRACK_METER_CHANNELS;
+        for (int ch = 0; ch < levels.channels; ch++)
+        {
+            memcpy(m_trackFft.data(), m_pcm.data()+fftSize*ch, fftSize*sizeof(float));
+            m_fftPlan.Forward(m_trackFft.data());
+            levels.decibel[ch] = ImGui::ImDoDecibel(m_trackFft.data(), fftSize);
+        }
+        m_workTrackLevels.push_back(levels);
+    }
+
+    static void CopyMat(ImGui::ImMat& dst, const ImGui::ImMat& src)
+    {
+        if (src.empty())
+        {
+            dst.release();
+            return;
+        }
+        if (dst.w != src.w || dst.h != src.h || dst.c != src.c || dst.type != src.type)
+        {
+            if (src.dims == 1)
+                dst.create_type(src.w, src.type);
+            else
+                dst.create_type(src.w, src.h, src.c, src.type);
+            dst.elempack = src.elempack;
+        }
+        memcpy(dst.data, src.data, src.total()*src.elemsize);
+    }
+
+    void Publish()
+    {
+        auto& frame = m_frames[m_backIdx];
+        frame.channels.resize(m_workChannelCount);
+        for (int ch = 0; ch < m_workChannelCount; ch++)
+        {
+            auto& dst = frame.channels[ch];
+            const auto& src = m_work[ch];
+            CopyMat(dst.wave, src.wave);
+            CopyMat(dst.fft, src.fft);
+            CopyMat(dst.db, src.db);
+            CopyMat(dst.dbShort, src.dbShort);
+            CopyMat(dst.dbLong, src.dbLong);
+            CopyMat(dst.spectrogram, src.spectrogram);
+            dst.spectrogram.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+            dst.decibel = src.decibel;
+            dst.dbMaxIndex = src.dbMaxIndex;
+        }
+        CopyMat(frame.audioVector, m_workVector);
+        if (!frame.audioVector.empty())
+            frame.audioVector.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+        frame.trackLevels = m_workTrackLevels;
+        m_backIdx = m_latestIdx.exchange(m_backIdx|NEW_FRAME_BIT, memory_order_acq_rel)&~NEW_FRAME_BIT;
+    }
+
+private:
+    static constexpr uint32_t INPUT_RING_SIZE = 8;
+    static constexpr uint32_t MAX_TRACKS = 64;
+    static constexpr int NEW_FRAME_BIT = 0x4;
+
+    struct InputSlot
+    {
+        struct TrackFrame
+        {
+            int64_t trackId;
+            ImGui::ImMat frame;
+        };
+        ImGui::ImMat master;
+        vector<TrackFrame> tracks;
+        uint32_t trackCount {0};
+    };
+
+    // single producer (audio render thread), single consumer (analysis thread)
+    InputSlot m_inputRing[INPUT_RING_SIZE];
+    atomic<uint32_t> m_inputHead {0};
+    atomic<uint32_t> m_inputTail {0};
+    mutex m_inputLock;
+    condition_variable m_inputCv;
+    atomic<uint64_t> m_droppedCount {0};
+
+    // triple buffer, 'm_backIdx' is owned by the analysis thread and 'm_frontIdx' by the ui thread
+    ScopeFrame m_frames[3];
+    int m_backIdx {0};
+    atomic<int> m_latestIdx {1};
+    int m_frontIdx {2};
+
+    atomic<float> m_vectorScale {1.f};
+    atomic<int> m_vectorMode {LISSAJOUS};
+    atomic<float> m_spectrogramOffset {0.f};
+    atomic<float> m_spectrogramLight {1.f};
+
+    // working state of the analysis thread
+    RealFftPlan m_fftPlan;
+    vector<float> m_pcm;
+    vector<float> m_trackFft;
+    vector<ChannelScope> m_work;
+    int m_workChannelCount {0};
+    ImGui::ImMat m_workVector;
+    vector<TrackLevels> m_workTrackLevels;
+
+    thread m_analysisThread;
+    atomic_bool m_quit {false};
+};
+
+AudioScopeAnalyzer::Holder AudioScopeAnalyzer::CreateInstance()
+{
+    return AudioScopeAnalyzer::Holder(new AudioScopeAnalyzer_Impl());
+}
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <immat.h>
+#include "MediaData.h"
+
+enum AudioVectorScopeMode  : int
+{
+    LISSAJOUS,
+    LISSAJOUS_XY,
+    POLAR,
+    MODE_NB,
+};
+
+namespace MEC
+{
+    // Computes the meter, FFT, spectrogram and vector scope data of the preview audio on its own thread.
+    // The audio render thread only hands its pcm mats over, it never waits for the analysis or for the UI.
+    // Results are published through a triple buffer, so the UI always reads a complete frame without locking.
+    struct AudioScopeAnalyzer
+    {
+        using Holder = std::shared_ptr<AudioScopeAnalyzer>;
+        static Holder CreateInstance();
+
+        static constexpr int MAX_TRACK_METER_CHANNELS = 8;
+
+        struct ChannelScope
+        {
+            ImGui::ImMat wave;
+            ImGui::ImMat fft;           // packed real fft, same layout as 'ImGui::ImRFFT()'
+            ImGui::ImMat db;
+            ImGui::ImMat dbShort;
+            ImGui::ImMat dbLong;
+            ImGui::ImMat spectrogram;
+            float decibel {0};
+            int dbMaxIndex {-1};
+        };
+
+        struct TrackLevels
+        {
+            int64_t trackId;
+            int channels;
+            float decibel[MAX_TRACK_METER_CHANNELS];
+        };
+
+        struct ScopeFrame
+        {
+            std::vector<ChannelScope> channels;
+            ImGui::ImMat audioVector;
+            std::vector<TrackLevels> trackLevels;
+        };
+
+        // Called from the audio render thread. The block is dropped if the analysis thread is behind.
+        virtual bool PushFrames(const std::vector<MediaCore::CorrelativeFrame>& amats) = 0;
+        // Called from the UI thread. Return the newest frame if a new one has been published since the last call,
+        // otherwise nullptr. The returned frame stays valid and unchanged until the next call.
+        virtual const ScopeFrame* AcquireLatestFrame() = 0;
+
+        virtual void SetVectorParams(float scale, int mode) = 0;
+        virtual void SetSpectrogramParams(float offset, float light) = 0;
+        virtual uint64_t GetDroppedBlockCount() const = 0;
+    };
+}
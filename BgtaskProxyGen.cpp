@@ -0,0 +1,593 @@
+#include <iomanip>
+#include <cmath>
+#include <TimeUtils.h>
+#include <FileSystemUtils.h>
+#include <MediaParser.h>
+#include <MediaReader.h>
+#include <MediaEncoder.h>
+#include <imgui.h>
+#include "BackgroundTask.h"
+#include "MediaTimeline.h"
+
+
+namespace json = imgui_json;
+using namespace std;
+using namespace Logger;
+
+namespace MEC
+{
+class BgtaskProxyGen : public BackgroundTask
+{
+public:
+    BgtaskProxyGen(const string& name) : m_name(name)
+    {
+        m_pLogger = GetLogger(name);
+    }
+
+    ~BgtaskProxyGen()
+    {
+        ReleaseEncoder();
+    }
+
+    bool Initialize(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings)
+    {
+        string strAttrName;
+        // read 'task_dir'
+        strAttrName = "task_dir";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        {
+            m_strTaskDir = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << m_strTaskDir << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            strAttrName = "task_hash";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_number())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = (size_t)jnTask[strAttrName].get<json::number>();
+        }
+        else
+        {
+            strAttrName = "project_dir";
+            if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+            {
+                ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+                m_errMsg = oss.str();
+                return false;
+            }
+            string strAttrValue = jnTask[strAttrName].get<json::string>();
+            if (!SysUtils::IsDirectory(strAttrValue))
+            {
+                ostringstream oss; oss << "INVALID task json attribute '" << strAttrName << "'! '" << strAttrValue << "' is NOT a DIRECTORY.";
+                m_errMsg = oss.str();
+                return false;
+            }
+            m_szHash = SysUtils::GetTickHash();
+            ostringstream oss; oss << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash << dec;
+            const auto strWorkDirName = oss.str();
+            m_strTaskDir = SysUtils::JoinPath(strAttrValue, strWorkDirName);
+            if (!SysUtils::IsDirectory(m_strTaskDir))
+                SysUtils::CreateDirectoryAt(m_strTaskDir, true);
+        }
+        // read 'source_url'
+        strAttrName = "source_url";
+        if (!jnTask.contains(strAttrName) || !jnTask[strAttrName].is_string())
+        {
+            ostringstream oss; oss << "Task json must has a '" << strAttrName << "' attribute of 'string' type!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_strSrcUrl = jnTask[strAttrName].get<json::string>();
+        // read 'is_image_seq'
+        strAttrName = "is_image_seq";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean() && jnTask[strAttrName].get<json::boolean>())
+        {
+            m_errMsg = "Proxy generation does NOT support image-sequence source!";
+            return false;
+        }
+        if (!SysUtils::IsFile(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "INVALID task json attribute 'source_url'! '" << m_strSrcUrl << "' is NOT a FILE.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // read 'media_item_id'
+        strAttrName = "media_item_id";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_i64MediaItemId = jnTask[strAttrName].get<json::number>();
+        else
+            m_i64MediaItemId = -1;
+        // create MediaParser instance
+        auto hParser = MediaCore::MediaParser::CreateInstance();
+        if (!hParser)
+        {
+            m_errMsg = "FAILED to create MediaParser instance!";
+            return false;
+        }
+        if (!hParser->Open(m_strSrcUrl))
+        {
+            ostringstream oss; oss << "FAILED to open media parser for '" << m_strSrcUrl << "'! Error is '" << hParser->GetError() << "'.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_hParser = hParser;
+        m_pVidstm = hParser->GetBestVideoStream();
+        if (!m_pVidstm || m_pVidstm->isImage)
+        {
+            ostringstream oss; oss << "FAILED to find video stream in '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        if (hSettings)
+            m_hHwaMgr = hSettings->GetHwaccelManager();
+        if (!m_hHwaMgr)
+            m_hHwaMgr = MediaCore::HwaccelManager::GetDefaultInstance();
+        // read proxy parameters
+        strAttrName = "proxy_codec";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+            m_strProxyCodec = jnTask[strAttrName].get<json::string>();
+        if (m_strProxyCodec != "mjpeg" && m_strProxyCodec != "dnxhr_lb")
+        {
+            ostringstream oss; oss << "INVALID argument '" << strAttrName << "'! Only 'mjpeg' and 'dnxhr_lb' are supported, while the provided value is '"
+                    << m_strProxyCodec << "'.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        strAttrName = "proxy_height";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_number())
+            m_u32ProxyHeight = (uint32_t)jnTask[strAttrName].get<json::number>();
+        if (m_u32ProxyHeight < 64)
+        {
+            ostringstream oss; oss << "INVALID argument '" << strAttrName << "'! The value should NOT be less than 64, while the provided value is "
+                    << m_u32ProxyHeight << ".";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // the proxy keeps the aspect ratio of the source, and never be larger than it
+        const auto u32SrcWidth = m_pVidstm->width;
+        const auto u32SrcHeight = m_pVidstm->height;
+        m_u32OutHeight = m_u32ProxyHeight < u32SrcHeight ? m_u32ProxyHeight : u32SrcHeight;
+        m_u32OutWidth = (uint32_t)round((double)u32SrcWidth*m_u32OutHeight/u32SrcHeight);
+        m_u32OutWidth += m_u32OutWidth&0x1;
+        m_u32OutHeight += m_u32OutHeight&0x1;
+        m_tFrameRate = m_pVidstm->realFrameRate;
+        if (m_tFrameRate.num <= 0 || m_tFrameRate.den <= 0)
+            m_tFrameRate = m_pVidstm->avgFrameRate;
+        if (m_tFrameRate.num <= 0 || m_tFrameRate.den <= 0)
+        {
+            ostringstream oss; oss << "INVALID frame rate " << m_tFrameRate.num << "/" << m_tFrameRate.den << " of the video stream in '" << m_strSrcUrl << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_strOutputPath = SysUtils::JoinPath(m_strTaskDir, "Proxy.mov");
+
+        bool bFailed = false;
+        bool bDone = false;
+        strAttrName = "is_task_failed";
+        if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+            bFailed = jnTask[strAttrName].get<json::boolean>();
+        if (bFailed)
+        {
+            strAttrName = "error_message";
+            if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+                m_errMsg = jnTask[strAttrName].get<json::string>();
+            SetState(FAILED, true);
+        }
+        else
+        {
+            strAttrName = "is_task_done";
+            if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_boolean())
+                bDone = jnTask[strAttrName].get<json::boolean>();
+            if (bDone && SysUtils::IsFile(m_strOutputPath))
+                SetState(DONE, true);
+            else
+                bDone = false;
+        }
+        m_fProgress = bDone ? 1.f : 0.f;
+        ostringstream oss; oss << "##" << m_name << "-" << setw(16) << setfill('0') << hex << m_szHash << dec;
+        m_strTaskNameWithHash = oss.str();
+
+        m_bInited = true;
+        return true;
+    }
+
+    void SetCallbacks(Callbacks* pCb) override
+    {
+        m_pCb = pCb;
+    }
+
+    bool CanPause()
+    {
+        return m_eState == PROCESSING;
+    }
+
+    bool Pause() override
+    {
+        if (m_bPause)
+            return true;
+        m_bPauseCheckPointHit = false;
+        m_bPause = true;
+        return true;
+    }
+
+    bool IsPaused() const override
+    {
+        return m_bPause && m_bPauseCheckPointHit;
+    }
+
+    bool Resume() override
+    {
+        m_bPause = false;
+        return true;
+    }
+
+    bool DrawContent(const ImVec2& v2ViewSize) override
+    {
+        bool bRemoveThisTask = false;
+        ostringstream oss;
+        auto strLabel = m_strTaskNameWithHash;
+        ImGui::BeginChild(strLabel.c_str(), v2ViewSize, ImGuiChildFlags_Border|ImGuiChildFlags_AutoResizeY);
+        const ImColor tTaskTitleClr(KNOWNIMGUICOLOR_WHITESMOKE);
+        const auto v2TextPadding = ImGui::GetStyle().FramePadding;
+        const auto orgFontScale = ImGui::GetFont()->Scale;
+        ImGui::GetFont()->Scale = 1.2f;
+        ImGui::PushFont(ImGui::GetFont());
+        ImGui::TextColoredWithPadding(tTaskTitleClr, v2TextPadding, "%s", TASK_TYPE_NAME.c_str()); ImGui::SameLine();
+        ImGui::GetFont()->Scale = orgFontScale;
+        ImGui::PopFont();
+        auto v2AvailSize = ImGui::GetContentRegionAvail();
+        auto v2CurrPos = ImGui::GetCursorPos();
+        ImGui::SetCursorPos(v2CurrPos+ImVec2(v2AvailSize.x-30*2, 0));
+        oss.str(""); oss << (IsPaused() ? ICON_PLAY_FORWARD : ICON_PAUSE) << m_strTaskNameWithHash;
+        strLabel = oss.str();
+        bool bDisableThisWidget = !CanPause();
+        ImGui::BeginDisabled(bDisableThisWidget);
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            if (m_bPause)
+                Resume();
+            else
+                Pause();
+        } ImGui::SameLine();
+        ImGui::ShowTooltipOnHover(bDisableThisWidget
+                ? (IsWaiting() ? "Task hasn't started yet." : "Task is already stopped.")
+                : (m_bPause ? "Resume task" : "Pause task"));
+        ImGui::EndDisabled();
+        oss.str(""); oss << ICON_DELETE << m_strTaskNameWithHash;
+        strLabel = oss.str();
+        oss.str(""); oss << ICON_TRASH << " Task Deletion" << m_strTaskNameWithHash;
+        const auto strDelLabel = oss.str();
+        if (ImGui::Button(strLabel.c_str()))
+        {
+            ImGui::OpenPopup(strDelLabel.c_str());
+        }
+        ImGui::ShowTooltipOnHover("Delete this task.");
+        const ImColor tTagClr(KNOWNIMGUICOLOR_LIGHTGRAY);
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Source: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), v2TextPadding, "%s", SysUtils::ExtractFileName(m_strSrcUrl).c_str());
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Proxy: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(KNOWNIMGUICOLOR_LIGHTGREEN), v2TextPadding, "%ux%u %s", m_u32OutWidth, m_u32OutHeight,
+                m_strProxyCodec == "mjpeg" ? "MJPEG" : "DNxHR LB");
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "State: "); ImGui::SameLine(0, 10);
+        switch (m_eState)
+        {
+        case WAITING:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.1f), v2TextPadding, "Waiting");
+            break;
+        case PROCESSING:
+            if (m_bPause)
+                ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.1f), v2TextPadding, "Paused");
+            else
+                ImGui::TextColoredWithPadding(ImColor(0.3f, 0.3f, 0.85f), v2TextPadding, "Processing");
+            break;
+        case DONE:
+            ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "Done");
+            break;
+        case FAILED:
+            ImGui::TextColoredWithPadding(ImColor(0.85f, 0.3f, 0.3f), v2TextPadding, "FAILED");
+            break;
+        case CANCELLED:
+            ImGui::TextColoredWithPadding(ImColor(0.8f, 0.8f, 0.8f), v2TextPadding, "Cancelled");
+            break;
+        default:
+            ImGui::TextColoredWithPadding(ImColor(0.7f, 0.3f, 0.3f), v2TextPadding, "Unknown");
+        }
+        ImGui::TextColoredWithPadding(tTagClr, v2TextPadding, "Progress: "); ImGui::SameLine(0, 10);
+        ImGui::TextColoredWithPadding(ImColor(0.3f, 0.85f, 0.3f), v2TextPadding, "%.02f%%", m_fProgress*100);
+
+        if (ImGui::BeginPopupModal(strDelLabel.c_str(), nullptr, ImGuiWindowFlags_NoMove|ImGuiWindowFlags_NoResize|ImGuiWindowFlags_NoSavedSettings))
+        {
+            bool bClosePopup = false;
+            const ImColor tWarnMsgClr(KNOWNIMGUICOLOR_PALEVIOLETRED);
+            ImGui::TextColoredWithPadding(tWarnMsgClr, {10, 6}, "This task will be removed, the generated proxy is still used by the source media!");
+            if (ImGui::Button("  OK  "))
+            {
+                Cancel(); WaitDone();
+                bRemoveThisTask = true;
+                bClosePopup = true;
+            } ImGui::SameLine();
+            if (ImGui::Button("Cancel"))
+                bClosePopup = true;
+            if (bClosePopup)
+                ImGui::CloseCurrentPopup();
+            ImGui::EndPopup();
+        }
+
+        ImGui::EndChild();
+        return bRemoveThisTask;
+    }
+
+    void DrawContentCompact() override
+    {
+
+    }
+
+    bool SaveAsJson(json::value& jnTask) override
+    {
+        jnTask = json::value();
+        // save basic info
+        jnTask["type"] = "ProxyGen";
+        jnTask["name"] = m_name;
+        jnTask["task_hash"] = json::number(m_szHash);
+        jnTask["task_dir"] = m_strTaskDir;
+        jnTask["source_url"] = m_strSrcUrl;
+        jnTask["is_image_seq"] = false;
+        jnTask["media_item_id"] = json::number(m_i64MediaItemId);
+        // save proxy parameters
+        jnTask["proxy_codec"] = m_strProxyCodec;
+        jnTask["proxy_height"] = json::number(m_u32ProxyHeight);
+        // save task status
+        jnTask["is_task_done"] = IsDone();
+        jnTask["is_task_failed"] = IsFailed();
+        jnTask["error_message"] = m_errMsg;
+        return true;
+    }
+
+    string Save(const string& _strSavePath) override
+    {
+        json::value jnTask;
+        if (!SaveAsJson(jnTask))
+        {
+            m_pLogger->Log(Error) << "FAILED to save '" << m_name << "' as json!" << endl;
+            return "";
+        }
+        const auto strSavePath = _strSavePath.empty() ? SysUtils::JoinPath(m_strTaskDir, "task.json") : _strSavePath;
+        if (!jnTask.save(strSavePath))
+        {
+            m_pLogger->Log(Error) << "FAILED to save task json of '" << m_name << "' at location '" << strSavePath << "'!" << endl;
+            return "";
+        }
+        return strSavePath;
+    }
+
+    string GetTaskDir() const override
+    {
+        return m_strTaskDir;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+    void SetLogLevel(Logger::Level l) override
+    {
+        m_pLogger->SetShowLevels(l);
+    }
+
+public:
+    static const string TASK_TYPE_NAME;
+    static const string TASK_RESULT_META_NAME;
+
+protected:
+    bool _TaskProc () override
+    {
+        m_pLogger->Log(INFO) << "Start background task 'ProxyGen' for '" << m_strSrcUrl << "'." << endl;
+        if (!m_bInited)
+        {
+            ostringstream oss; oss << "Background task 'ProxyGen' with name '" << m_name << "' is NOT initialized!";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+
+        // the encoder can not append to an existing file, so an interrupted proxy is always generated from the beginning
+        auto hReader = MediaCore::MediaReader::CreateVideoInstance(m_name+"-rdr");
+        hReader->EnableHwAccel(true);
+        if (!hReader->Open(m_hParser))
+        {
+            ostringstream oss; oss << "FAILED to open MediaReader for '" << m_strSrcUrl << "'! Error is '" << hReader->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!hReader->ConfigVideoReader(m_u32OutWidth, m_u32OutHeight, IM_CF_RGBA, IM_DT_INT8, IM_INTERPOLATE_AREA, m_hHwaMgr)
+            || !hReader->Start())
+        {
+            ostringstream oss; oss << "FAILED to start MediaReader for '" << m_strSrcUrl << "'! Error is '" << hReader->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!SetupEncoder())
+            return false;
+
+        const int64_t i64SrcDuration = static_cast<int64_t>(m_pVidstm->duration*1000);
+        int64_t i64FrmIdx = 0;
+        while (!IsCancelled())
+        {
+            if (m_bPause)
+            {
+                m_bPauseCheckPointHit = true;
+                this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+                continue;
+            }
+
+            const int64_t i64ReadPos = round((double)i64FrmIdx*1000*m_tFrameRate.den/m_tFrameRate.num);
+            if (i64ReadPos >= i64SrcDuration)
+                break;
+            bool bEof = false;
+            auto hVfrm = hReader->ReadVideoFrame(i64ReadPos, bEof);
+            if (hVfrm)
+            {
+                bool consumed = false;
+                if (!m_hEncoder->EncodeVideoFrame(hVfrm, consumed))
+                {
+                    ostringstream oss; oss << "Background task 'ProxyGen' FAILED to encode video frame! pos=" << i64ReadPos
+                            << ", error is '" << m_hEncoder->GetError() << "'.";
+                    m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+                    return false;
+                }
+            }
+            i64FrmIdx++;
+            m_fProgress = (float)((double)i64ReadPos/i64SrcDuration);
+            if (bEof)
+                break;
+        }
+        hReader->Close();
+        if (IsCancelled())
+        {
+            ReleaseEncoder();
+            SysUtils::DeleteFileAt(m_strOutputPath);
+            m_pLogger->Log(INFO) << "Background task 'ProxyGen' for '" << m_strSrcUrl << "' is cancelled." << endl;
+            return true;
+        }
+        if (!m_hEncoder->FinishEncoding())
+        {
+            ostringstream oss; oss << "FAILED to 'Finish' MediaEncoder! Error is '" << m_hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        ReleaseEncoder();
+
+        // record the proxy as a META data of the source media, the timeline switches to it for preview
+        json::value jnMetaValue;
+        jnMetaValue["proxy_url"] = m_strOutputPath;
+        jnMetaValue["codec"] = m_strProxyCodec;
+        jnMetaValue["width"] = json::number(m_u32OutWidth);
+        jnMetaValue["height"] = json::number(m_u32OutHeight);
+        if (!m_pCb || !m_pCb->OnOutputMediaItemMetaData(m_strSrcUrl, TASK_RESULT_META_NAME, jnMetaValue))
+            m_pLogger->Log(WARN) << "FAILED to attach proxy '" << m_strOutputPath << "' to media item '" << m_strSrcUrl << "'." << endl;
+        m_fProgress = 1.f;
+        m_pLogger->Log(INFO) << "Quit background task 'ProxyGen' for '" << m_strSrcUrl << "'." << endl;
+        return true;
+    }
+
+    bool _AfterTaskProc() override
+    {
+        ReleaseEncoder();
+        return true;
+    }
+
+private:
+    bool SetupEncoder()
+    {
+        auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
+        if (!hEncoder->Open(m_strOutputPath))
+        {
+            ostringstream oss; oss << "FAILED to open MediaEncoder at location '" << m_strOutputPath << "'! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        // both codecs are intra-only, so any frame of the proxy can be decoded without its neighbours
+        string strCodecName, strInputPixfmt;
+        vector<MediaCore::MediaEncoder::Option> aExtraOpts;
+        uint64_t u64BitRate;
+        const double dFps = (double)m_tFrameRate.num/m_tFrameRate.den;
+        if (m_strProxyCodec == "dnxhr_lb")
+        {
+            strCodecName = "dnxhd";
+            strInputPixfmt = "yuv422p";
+            aExtraOpts.push_back({ "profile", MediaCore::Value("dnxhr_lb") });
+            u64BitRate = (uint64_t)(m_u32OutWidth*m_u32OutHeight*dFps*1.2);
+        }
+        else
+        {
+            strCodecName = "mjpeg";
+            strInputPixfmt = "yuvj420p";
+            u64BitRate = (uint64_t)(m_u32OutWidth*m_u32OutHeight*dFps*1.0);
+        }
+        if (!hEncoder->ConfigureVideoStream(strCodecName, strInputPixfmt, m_u32OutWidth, m_u32OutHeight, m_tFrameRate, u64BitRate, &aExtraOpts))
+        {
+            ostringstream oss; oss << "FAILED to configure MediaEncoder VIDEO stream! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        if (!hEncoder->Start())
+        {
+            ostringstream oss; oss << "FAILED to 'Start' MediaEncoder! Error is '" << hEncoder->GetError() << "'.";
+            m_errMsg = oss.str(); m_pLogger->Log(Error) << m_errMsg << endl;
+            return false;
+        }
+        m_hEncoder = hEncoder;
+        return true;
+    }
+
+    void ReleaseEncoder()
+    {
+        if (m_hEncoder)
+        {
+            if (!m_hEncoder->Close())
+                m_pLogger->Log(Error) << "In bg-task '" << m_name << "', FAILED to close the encoder! Error is '" << m_hEncoder->GetError() << "'." << endl;
+            m_hEncoder = nullptr;
+        }
+    }
+
+private:
+    string m_name;
+    size_t m_szHash;
+    string m_errMsg;
+    ALogger* m_pLogger;
+    Callbacks* m_pCb{nullptr};
+    bool m_bInited{false};
+    string m_strTaskDir;
+    string m_strSrcUrl;
+    int64_t m_i64MediaItemId;
+    MediaCore::MediaParser::Holder m_hParser;
+    const MediaCore::VideoStream* m_pVidstm{nullptr};
+    MediaCore::HwaccelManager::Holder m_hHwaMgr;
+    MediaCore::MediaEncoder::Holder m_hEncoder;
+    // proxy parameters
+    string m_strProxyCodec{"mjpeg"};
+    uint32_t m_u32ProxyHeight{540};
+    uint32_t m_u32OutWidth{0}, m_u32OutHeight{0};
+    MediaCore::Ratio m_tFrameRate;
+    string m_strOutputPath;
+    // task control
+    float m_fProgress{0.f};
+    bool m_bPause{false};
+    bool m_bPauseCheckPointHit{false};
+    // ui vars
+    string m_strTaskNameWithHash;
+};
+
+const string BgtaskProxyGen::TASK_TYPE_NAME = "Proxy Generation";
+const string BgtaskProxyGen::TASK_RESULT_META_NAME = "ProxyMedia";
+
+static const auto _BGTASK_PROXYGEN_DELETER = [] (BackgroundTask* p) {
+    BgtaskProxyGen* ptr = dynamic_cast<BgtaskProxyGen*>(p);
+    delete ptr;
+};
+
+BackgroundTask::Holder CreateBgtask_ProxyGen(const json::value& jnTask, MediaCore::SharedSettings::Holder hSettings, RenderUtils::TextureManager::Holder hTxMgr)
+{
+    string strTaskName;
+    string strAttrName = "name";
+    if (jnTask.contains(strAttrName) && jnTask[strAttrName].is_string())
+        strTaskName = jnTask["name"].get<json::string>();
+    else
+        strTaskName = "BgtskProxyGen";
+    auto p = new BgtaskProxyGen(strTaskName);
+    if (!p->Initialize(jnTask, hSettings))
+    {
+        Log(Error) << "FAILED to create new 'ProxyGen' background task! Error is '" << p->GetError() << "'." << endl;
+        delete p;
+        return nullptr;
+    }
+    p->Save("");
+    return BackgroundTask::Holder(p, _BGTASK_PROXYGEN_DELETER);
+}
+}
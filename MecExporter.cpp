@@ -0,0 +1,366 @@
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <imgui.h>
+#include <imgui_helper.h>
+#include <imgui_json.h>
+#if IMGUI_VULKAN_SHADER
+#include <ImVulkanShader.h>
+#endif
+#include <ThreadUtils.h>
+#include "MecProject.h"
+#include "MediaTimeline.h"
+#include "MediaEncoder.h"
+#include "HwaccelManager.h"
+#include "Logger.h"
+
+using namespace MediaTimeline;
+using namespace Logger;
+
+// Command line exporter, renders a .mep project to a media file without opening any window.
+//   mec_export [options] <project.mep> <output file>
+
+struct ExportOptions
+{
+    std::string projectPath;
+    std::string outputPath;
+    std::string pluginPath;
+    std::string videoCodec;         // encoder name, empty means the project saved one, or the first software encoder of the project codec type
+    std::string audioCodec;
+    uint32_t width {0};             // 0 means using the project settings
+    uint32_t height {0};
+    MediaCore::Ratio frameRate {0, 0};
+    int64_t videoBitrate {-1};      // -1 means the project saved one, or decided by the frame size and rate
+    int64_t audioBitrate {-1};      // -1 means the project saved one
+    int64_t startMs {-1};           // export range on the timeline, -1 means the whole timeline
+    int64_t endMs {-1};
+    int segments {-1};              // -1 means using the project settings
+    bool smartRender {false};
+    bool resumable {false};
+    bool normalizeLoudness {false};
+    bool noVideo {false};
+    bool noAudio {false};
+    bool quiet {false};
+};
+
+static void PrintUsage(const char* prog)
+{
+    std::cout << "Usage: " << prog << " [options] <project.mep> <output file>" << std::endl
+        << "  -p, --plugin_dir <dir>    blueprint plugin directory" << std::endl
+        << "  -v, --vcodec <name>       video encoder name, such as 'libx264'" << std::endl
+        << "  -a, --acodec <name>       audio encoder name, such as 'aac'" << std::endl
+        << "  -W, --width <pixels>      output video width" << std::endl
+        << "  -H, --height <pixels>     output video height" << std::endl
+        << "  -r, --fps <num/den>       output video frame rate" << std::endl
+        << "  -b, --vbitrate <bps>      output video bitrate" << std::endl
+        << "  -B, --abitrate <bps>      output audio bitrate" << std::endl
+        << "  -s, --start <ms>          export range start on the timeline" << std::endl
+        << "  -e, --end <ms>            export range end on the timeline" << std::endl
+        << "  -g, --segments <count>    encode video in parallel segments, 0 means decided by the cpu core count" << std::endl
+        << "  -c, --smart               copy the untouched source ranges without re-encoding" << std::endl
+        << "  -R, --resumable           keep the finished segments, running the same command again resumes the export" << std::endl
+        << "  -n, --normalize           normalize the audio loudness" << std::endl
+        << "  -V, --no-video            don't export video" << std::endl
+        << "  -A, --no-audio            don't export audio" << std::endl
+        << "  -q, --quiet               don't print the progress" << std::endl
+        << "  -h, --help                show this message" << std::endl;
+}
+
+static bool ParseOptions(int argc, char** argv, ExportOptions& opts)
+{
+    static struct option long_options[] = {
+        { "plugin_dir", required_argument, NULL, 'p' },
+        { "vcodec", required_argument, NULL, 'v' },
+        { "acodec", required_argument, NULL, 'a' },
+        { "width", required_argument, NULL, 'W' },
+        { "height", required_argument, NULL, 'H' },
+        { "fps", required_argument, NULL, 'r' },
+        { "vbitrate", required_argument, NULL, 'b' },
+        { "abitrate", required_argument, NULL, 'B' },
+        { "start", required_argument, NULL, 's' },
+        { "end", required_argument, NULL, 'e' },
+        { "segments", required_argument, NULL, 'g' },
+        { "smart", no_argument, NULL, 'c' },
+        { "resumable", no_argument, NULL, 'R' },
+        { "normalize", no_argument, NULL, 'n' },
+        { "no-video", no_argument, NULL, 'V' },
+        { "no-audio", no_argument, NULL, 'A' },
+        { "quiet", no_argument, NULL, 'q' },
+        { "help", no_argument, NULL, 'h' },
+        { 0, 0, 0, 0 }
+    };
+    int o = -1;
+    int option_index = 0;
+    while ((o = getopt_long(argc, argv, "p:v:a:W:H:r:b:B:s:e:g:cRnVAqh", long_options, &option_index)) != -1)
+    {
+        switch (o)
+        {
+            case 'p': opts.pluginPath = std::string(optarg); break;
+            case 'v': opts.videoCodec = std::string(optarg); break;
+            case 'a': opts.audioCodec = std::string(optarg); break;
+            case 'W': opts.width = atoi(optarg); break;
+            case 'H': opts.height = atoi(optarg); break;
+            case 'r':
+            {
+                int num = 0, den = 1;
+                if (sscanf(optarg, "%d/%d", &num, &den) < 1 || num <= 0 || den <= 0)
+                {
+                    std::cerr << "Invalid frame rate '" << optarg << "'!" << std::endl;
+                    return false;
+                }
+                opts.frameRate = MediaCore::Ratio(num, den);
+                break;
+            }
+            case 'b': opts.videoBitrate = atoll(optarg); break;
+            case 'B': opts.audioBitrate = atoll(optarg); break;
+            case 's': opts.startMs = atoll(optarg); break;
+            case 'e': opts.endMs = atoll(optarg); break;
+            case 'g': opts.segments = atoi(optarg); break;
+            case 'c': opts.smartRender = true; break;
+            case 'R': opts.resumable = true; break;
+            case 'n': opts.normalizeLoudness = true; break;
+            case 'V': opts.noVideo = true; break;
+            case 'A': opts.noAudio = true; break;
+            case 'q': opts.quiet = true; break;
+            default: return false;
+        }
+    }
+    if (argc-optind != 2)
+        return false;
+    opts.projectPath = argv[optind];
+    opts.outputPath = argv[optind+1];
+    return true;
+}
+
+static void LoadPlugins(const std::string& pluginPath)
+{
+    std::vector<std::string> plugin_paths;
+    plugin_paths.push_back(pluginPath);
+    int loadingIndex = 0;
+    std::string loadingMessage;
+    float loadingPercentage = 0;
+    int plugins = BluePrint::BluePrintUI::CheckPlugins(plugin_paths);
+    BluePrint::BluePrintUI::LoadPlugins(plugin_paths, loadingIndex, loadingMessage, loadingPercentage, plugins);
+}
+
+static TimeLine* LoadTimeline(const std::string& path, MEC::Project::Holder& hProject)
+{
+    MEC::Project::ErrorCode ec;
+    hProject = MEC::Project::OpenProjectFile(ec, path);
+    if (!hProject)
+    {
+        std::cerr << "FAILED to load mec project from '" << path << "'! Error code is " << (int)ec << "." << std::endl;
+        return nullptr;
+    }
+    const auto& jnProjContent = hProject->GetProjectContentJson();
+    if (!jnProjContent.contains("TimeLine") || !jnProjContent["TimeLine"].is_object())
+    {
+        std::cerr << "CANNOT find 'TimeLine' attribute in MEC project content json at '" << path << "'!" << std::endl;
+        return nullptr;
+    }
+
+    TimeLine* timeline = new TimeLine(true);
+    timeline->mhProject = hProject;
+    hProject->SetTimelineHandle(timeline);
+
+    // first load MediaBank, the clips on the timeline refer to these items
+    if (jnProjContent.contains("MediaBank") && jnProjContent["MediaBank"].is_array())
+    {
+        const auto& jnMediaBank = jnProjContent["MediaBank"].get<imgui_json::array>();
+        for (const auto& jnItem : jnMediaBank)
+        {
+            int64_t id = -1;
+            std::string name;
+            std::string itemPath;
+            uint32_t type = MEDIA_UNKNOWN;
+            if (jnItem.contains("id") && jnItem["id"].is_number())
+                id = jnItem["id"].get<imgui_json::number>();
+            if (jnItem.contains("name") && jnItem["name"].is_string())
+                name = jnItem["name"].get<imgui_json::string>();
+            if (jnItem.contains("path") && jnItem["path"].is_string())
+                itemPath = jnItem["path"].get<imgui_json::string>();
+            if (jnItem.contains("type") && jnItem["type"].is_number())
+                type = jnItem["type"].get<imgui_json::number>();
+
+            MediaItem* item = new MediaItem(name, itemPath, type, timeline);
+            if (id != -1) item->mID = id;
+            if (!item->Initialize())
+                std::cerr << "WARNING: media '" << itemPath << "' is NOT available!" << std::endl;
+            if (jnItem.contains("meta_data"))
+                item->mMetaData = jnItem["meta_data"];
+            timeline->media_items.push_back(item);
+        }
+    }
+
+    // second load TimeLine
+    timeline->Load(jnProjContent["TimeLine"]);
+    return timeline;
+}
+
+static std::string SelectEncoder(const std::string& codecType, const std::string& encoderName)
+{
+    if (!encoderName.empty())
+        return encoderName;
+    std::vector<MediaCore::MediaEncoder::Description> descList;
+    if (!MediaCore::MediaEncoder::FindEncoder(codecType, descList) || descList.empty())
+        return std::string();
+    // prefer the software encoder, the hardware ones may not be usable on a render server
+    for (auto& desc : descList)
+    {
+        if (!desc.isHardwareEncoder)
+            return desc.codecName;
+    }
+    return descList.front().codecName;
+}
+
+static int Export(TimeLine* timeline, const ExportOptions& opts)
+{
+    auto& hSettings = timeline->mhMediaSettings;
+    // start from the settings of the last export made by the editor, the options override them
+    TimeLine::VideoEncoderParams vidEncParams;
+    TimeLine::AudioEncoderParams audEncParams;
+    timeline->MakeEncoderParams(vidEncParams, audEncParams);
+    vidEncParams.encodeVideo = !opts.noVideo && timeline->bExportVideo;
+    if (vidEncParams.encodeVideo)
+    {
+        vidEncParams.codecName = SelectEncoder(timeline->mVideoCodec, !opts.videoCodec.empty() ? opts.videoCodec : vidEncParams.codecName);
+        if (vidEncParams.codecName.empty())
+        {
+            std::cerr << "CANNOT find any video encoder for '" << timeline->mVideoCodec << "'!" << std::endl;
+            return -1;
+        }
+        vidEncParams.width = opts.width > 0 ? opts.width : hSettings->VideoOutWidth();
+        vidEncParams.height = opts.height > 0 ? opts.height : hSettings->VideoOutHeight();
+        vidEncParams.frameRate = opts.frameRate.num > 0 ? opts.frameRate : hSettings->VideoOutFrameRate();
+        if (opts.videoBitrate > 0)
+            vidEncParams.bitRate = opts.videoBitrate;
+        else if (timeline->mVideoEncoder.empty())
+            vidEncParams.bitRate = (int64_t)vidEncParams.width * (int64_t)vidEncParams.height *
+                    (int64_t)vidEncParams.frameRate.num / (int64_t)vidEncParams.frameRate.den / 10;
+    }
+    audEncParams.encodeAudio = !opts.noAudio && timeline->bExportAudio;
+    if (audEncParams.encodeAudio)
+    {
+        audEncParams.codecName = SelectEncoder(timeline->mAudioCodec, !opts.audioCodec.empty() ? opts.audioCodec : audEncParams.codecName);
+        if (audEncParams.codecName.empty())
+        {
+            std::cerr << "CANNOT find any audio encoder for '" << timeline->mAudioCodec << "'!" << std::endl;
+            return -1;
+        }
+        audEncParams.channels = hSettings->AudioOutChannels();
+        audEncParams.sampleRate = hSettings->AudioOutSampleRate();
+        if (opts.audioBitrate > 0)
+            audEncParams.bitRate = opts.audioBitrate;
+    }
+
+    if (opts.startMs >= 0 || opts.endMs >= 0)
+    {
+        timeline->mark_in = opts.startMs >= 0 ? opts.startMs : 0;
+        timeline->mark_out = opts.endMs >= 0 ? opts.endMs : timeline->mEnd;
+        timeline->mEncodingInRange = true;
+    }
+    if (opts.segments >= 0)
+    {
+        timeline->bSegmentedExport = opts.segments != 1;
+        timeline->mExportSegmentCount = opts.segments;
+    }
+    if (opts.smartRender)
+        timeline->bSmartRender = true;
+    if (opts.resumable)
+        timeline->bResumableExport = true;
+    if (opts.normalizeLoudness)
+        timeline->bNormalizeLoudness = true;
+
+    std::string errMsg;
+    if (!timeline->ConfigEncoder(opts.outputPath, vidEncParams, audEncParams, errMsg))
+    {
+        std::cerr << "FAILED to configure the encoder! Error is '" << errMsg << "'." << std::endl;
+        return -1;
+    }
+    if (!opts.quiet)
+    {
+        std::cout << "Exporting '" << opts.projectPath << "' to '" << opts.outputPath << "'";
+        if (vidEncParams.encodeVideo)
+            std::cout << ", video " << vidEncParams.codecName << " " << vidEncParams.width << "x" << vidEncParams.height
+                << "@" << vidEncParams.frameRate.num << "/" << vidEncParams.frameRate.den;
+        if (audEncParams.encodeAudio)
+            std::cout << ", audio " << audEncParams.codecName << " " << audEncParams.sampleRate << "Hz " << audEncParams.channels << "ch";
+        std::cout << std::endl;
+    }
+
+    auto tpStart = std::chrono::steady_clock::now();
+    timeline->StartEncoding();
+    int lastPercent = -1;
+    while (timeline->mIsEncoding)
+    {
+        int percent = (int)(timeline->mEncodingProgress*100);
+        if (!opts.quiet && percent != lastPercent)
+        {
+            std::cout << "\rProgress: " << percent << "%" << std::flush;
+            lastPercent = percent;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    timeline->StopEncoding();
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now()-tpStart).count();
+    if (!timeline->mEncodeProcErrMsg.empty())
+    {
+        // end the progress line where the export stopped
+        if (!opts.quiet)
+            std::cout << std::endl;
+        std::cerr << "Export FAILED! Error is '" << timeline->mEncodeProcErrMsg << "'." << std::endl;
+        return -1;
+    }
+    if (!opts.quiet)
+    {
+        std::cout << "\rProgress: 100%" << std::endl;
+        std::cout << "Export done in " << (double)elapsed/1000 << " seconds." << std::endl;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    ExportOptions opts;
+    if (!ParseOptions(argc, argv, opts))
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    if (opts.pluginPath.empty())
+        opts.pluginPath = ImGuiHelper::path_parent(ImGuiHelper::exec_path()) + "plugins";
+
+    GetDefaultLogger()->SetShowLevels(Logger::WARN);
+    ImGui::CreateContext();
+#if IMGUI_VULKAN_SHADER
+    ImGui::ImVulkanShaderInit();
+#endif
+    auto hHwaMgr = MediaCore::HwaccelManager::GetDefaultInstance();
+    if (!hHwaMgr->Init())
+        std::cerr << "FAILED to init 'HwaccelManager' instance! Error is '" << hHwaMgr->GetError() << "'." << std::endl;
+    if (!MediaCore::InitializeSubtitleLibrary())
+        std::cerr << "FAILED to initialize the subtitle library!" << std::endl;
+    LoadPlugins(opts.pluginPath);
+
+    int ret = -1;
+    MEC::Project::Holder hProject;
+    TimeLine* timeline = LoadTimeline(opts.projectPath, hProject);
+    if (timeline)
+    {
+        ret = Export(timeline, opts);
+        delete timeline;
+    }
+    hProject = nullptr;
+
+    MediaCore::ReleaseSubtitleLibrary();
+    SysUtils::ThreadPoolExecutor::ReleaseDefaultInstance();
+#if IMGUI_VULKAN_SHADER
+    ImGui::ImVulkanShaderClear();
+#endif
+    ImGui::DestroyContext();
+    return ret;
+}
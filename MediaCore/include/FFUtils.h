@@ -140,6 +140,8 @@ public:
     bool SetOutColorSpace(AVColorSpace clrspc);
     bool SetOutColorRange(AVColorRange clrrng);
     bool SetResizeInterpolateMode(ImInterpolateMode interp);
+    // Number of threads used by swscale to convert the slices of one image, only takes effect with libswscale 6.1 and later.
+    bool SetSwsThreadCount(uint32_t count);
     bool ConvertImage(const ImGui::ImMat& inMat, AVFrame* avfrm, int64_t pts);
 
     uint32_t GetOutWidth() const { return m_outWidth; }
@@ -172,6 +174,7 @@ private:
     bool m_useVulkanComponents;
     SwsContext* m_swsCtx{nullptr};
     int m_swsFlags{0};
+    uint32_t m_swsThreads{1};
     int m_swsInWidth{0}, m_swsInHeight{0};
     AVPixelFormat m_swsInFormat{AV_PIX_FMT_NONE};
     bool m_passThrough{false};
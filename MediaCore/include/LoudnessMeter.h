@@ -0,0 +1,82 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "immat.h"
+#include "MediaCore.h"
+#include "MultiTrackAudioReader.h"
+#include "ThreadUtils.h"
+#include "Logger.h"
+
+namespace MediaCore
+{
+// Streaming loudness meter following ITU-R BS.1770-4 / EBU R128. Samples are K-weighted as they are pushed in,
+// so the measurement can be queried at any time (also from another thread) without re-scanning the audio.
+struct LoudnessMeter
+{
+    using Holder = std::shared_ptr<LoudnessMeter>;
+    static MEDIACORE_API Holder CreateInstance(uint32_t channels, uint32_t sampleRate);
+    static MEDIACORE_API Logger::ALogger* GetLogger();
+
+    // Loudness values are in LUFS and peak in dBTP. A value is -inf if there is not enough audio to measure it yet
+    // (400ms for momentary, 3s for short-term) or if all the gating blocks are below the absolute gate (-70 LUFS).
+    struct Measurement
+    {
+        double integrated;
+        double momentary;
+        double shortTerm;
+        double maxMomentary;
+        double maxShortTerm;
+        double truePeak;
+        int64_t sampleCount;
+    };
+
+    // 'amat' must be float32 pcm, planar or packed, with the same channel count as this meter.
+    virtual bool ProcessSamples(const ImGui::ImMat& amat) = 0;
+    virtual bool ProcessSamples(const float* const* planes, uint32_t sampleCount) = 0;
+    virtual void Reset() = 0;
+    virtual Measurement GetMeasurement() const = 0;
+    virtual uint32_t GetChannels() const = 0;
+    virtual uint32_t GetSampleRate() const = 0;
+
+    // Measure the mixed output of a MultiTrackAudioReader in [startPos, endPos) (millisecond). The reader is cloned when
+    // the task is created, so later edits don't affect the measurement. The mix is measured with 'outChannels' and
+    // 'outSampleRate', which should be the layout of the output being normalized; 0 means the reader's own setting.
+    // Enqueue it to a ThreadPoolExecutor; it is only bound by the mixing speed, so it runs much faster than real time.
+    struct AnalysisTask : public SysUtils::BaseAsyncTask
+    {
+        using Holder = std::shared_ptr<AnalysisTask>;
+        virtual float GetProgress() const = 0;
+        virtual Measurement GetMeasurement() const = 0;
+        virtual int64_t GetStartPos() const = 0;
+        virtual int64_t GetEndPos() const = 0;
+        virtual uint32_t GetChannels() const = 0;
+        virtual uint32_t GetSampleRate() const = 0;
+        virtual std::string GetError() const = 0;
+    };
+    static MEDIACORE_API AnalysisTask::Holder CreateAnalysisTask(MultiTrackAudioReader::Holder hReader, int64_t startPos = 0, int64_t endPos = -1,
+            uint32_t outChannels = 0, uint32_t outSampleRate = 0);
+
+    // Gain in dB to bring 'measurement' to 'targetLufs', reduced if necessary to keep the true peak under 'truePeakCeiling'.
+    static MEDIACORE_API double GetNormalizationGain(const Measurement& measurement, double targetLufs, double truePeakCeiling);
+
+    virtual std::string GetError() const = 0;
+};
+}
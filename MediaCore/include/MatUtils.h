@@ -1,5 +1,6 @@
 #pragma once
 #include <cstdint>
+#include <memory>
 #include "MediaCore.h"
 #include "AudioRender.h"
 #include "immat.h"
@@ -9,4 +10,27 @@ namespace MatUtils
     MEDIACORE_API void CopyAudioMatSamples(ImGui::ImMat& dstMat, const ImGui::ImMat& srcMat, uint32_t dstOffSmpCnt, uint32_t srcOffSmpCnt, uint32_t copySmpCnt = 0);
     MEDIACORE_API ImDataType PcmFormat2ImDataType(MediaCore::AudioRender::PcmFormat pcmFormat);
     MEDIACORE_API MediaCore::AudioRender::PcmFormat ImDataType2PcmFormat(ImDataType dataType);
-}
\ No newline at end of file
+
+    // An ImMat allocator that recycles audio buffers in power-of-two sized blocks. Once the working set
+    // of block sizes has been touched, allocating an audio mat only pops a block from a free list.
+    struct AudioBlockPool : public ImGui::Allocator
+    {
+        using Holder = std::shared_ptr<AudioBlockPool>;
+        static MEDIACORE_API Holder CreateInstance();
+        // The default pool is never destroyed, so mats allocated from it can safely outlive their producer.
+        static MEDIACORE_API AudioBlockPool* GetDefaultInstance();
+
+        struct Statistics
+        {
+            uint64_t heapAllocCount;    // blocks requested from the heap
+            uint64_t reuseCount;        // allocations served by a recycled block
+            uint32_t inUseBlockCount;
+            uint32_t freeBlockCount;
+            size_t pooledBytes;         // total size of the blocks owned by the pool
+        };
+
+        virtual void Reserve(size_t size, uint32_t count) = 0;
+        virtual void Trim() = 0;
+        virtual Statistics GetStatistics() const = 0;
+    };
+}
@@ -0,0 +1,55 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "immat.h"
+#include "MediaCore.h"
+#include "MediaInfo.h"
+#include "Overview.h"
+#include "Logger.h"
+
+namespace MediaCore
+{
+// On-disk cache of the analysis results of media files: the media info, the overview snapshots (stored as jpeg)
+// and the waveform. The entries are addressed by a key built from the path, size and modification time of the
+// file and a hash of its head and tail, so a modified file never hits the stale results.
+struct MediaAnalysisCache
+{
+    using Holder = std::shared_ptr<MediaAnalysisCache>;
+    static MEDIACORE_API Holder CreateInstance(const std::string& cacheDir);
+    static MEDIACORE_API Logger::ALogger* GetLogger();
+
+    // Return an empty string if 'url' is not a local file.
+    virtual std::string GetMediaKey(const std::string& url) = 0;
+
+    virtual MediaInfo::Holder LoadMediaInfo(const std::string& key, int& bestVidStmIdx, int& bestAudStmIdx) = 0;
+    virtual bool SaveMediaInfo(const std::string& key, MediaInfo::Holder hMediaInfo, int bestVidStmIdx, int bestAudStmIdx) = 0;
+    // Snapshots are stored separately for each snapshot size, count and color format.
+    virtual bool LoadSnapshots(const std::string& key, uint32_t width, uint32_t height, ImColorFormat clrfmt, uint32_t count, std::vector<ImGui::ImMat>& snapshots) = 0;
+    virtual bool SaveSnapshots(const std::string& key, uint32_t width, uint32_t height, ImColorFormat clrfmt, const std::vector<ImGui::ImMat>& snapshots) = 0;
+    // Waveforms are stored separately for each aggregation.
+    virtual Overview::Waveform::Holder LoadWaveform(const std::string& key, double aggregateSamples) = 0;
+    virtual bool SaveWaveform(const std::string& key, Overview::Waveform::Holder hWaveform) = 0;
+
+    virtual std::string GetCacheDir() const = 0;
+    virtual std::string GetError() const = 0;
+};
+}
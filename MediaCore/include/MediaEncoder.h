@@ -96,12 +96,19 @@ struct MediaEncoder
 
     virtual bool Open(const std::string& url) = 0;
     virtual bool Close() = 0;
+    // Two-pass video encoding, 'pass' is 1 or 2, 0 means single pass. In the first pass the encoder statistics are
+    // written to 'statsPath' and the video packets are discarded, the second pass reads them back for the rate control.
+    // Must be called after 'Open()' and before 'ConfigureVideoStream()'.
+    virtual bool SetVideoEncodingPass(int pass, const std::string& statsPath) = 0;
     virtual bool ConfigureVideoStream(const std::string& codecName,
             std::string& imageFormat, uint32_t width, uint32_t height,
             const Ratio& frameRate, uint64_t bitRate,
             std::vector<Option>* extraOpts = nullptr) = 0;
     virtual bool ConfigureAudioStream(const std::string& codecName,
             std::string& sampleFormat, uint32_t channels, uint32_t sampleRate, uint64_t bitRate) = 0;
+    // Set the number of threads converting the input images to the encoding pixel format, ahead of the video encoder.
+    // 0 means decided by the cpu core count. Must be called before 'Start()'.
+    virtual bool SetVideoConvertThreadCount(uint32_t count) = 0;
     virtual bool Start() = 0;
     virtual bool FinishEncoding() = 0;
     virtual bool EncodeVideoFrame(VideoFrame::Holder hVfrm, bool& consumed, bool wait = true) = 0;
@@ -109,6 +116,29 @@ struct MediaEncoder
     virtual bool EncodeAudioSamples(uint8_t* buf, uint32_t size, bool& consumed, bool wait = true) = 0;
     virtual bool EncodeAudioSamples(ImGui::ImMat& amat, bool& consumed, bool wait = true) = 0;
 
+    // Statistics of the frame queues and the waiting time of the encoding and muxing threads, in milliseconds.
+    // They are accumulated since 'Start()' and are complete after 'FinishEncoding()'.
+    struct PipelineStatistics
+    {
+        struct Queue
+        {
+            uint32_t capacity{0};
+            uint32_t maxDepth{0};
+            double avgDepth{0};
+            int64_t producerStallMs{0};  // time the caller of 'EncodeXXX()' is blocked because the queue is full
+            int64_t consumerStallMs{0};  // time the encoding thread is idle because the queue is empty
+        };
+        Queue videoFrameQ;
+        Queue audioFrameQ;
+        uint32_t videoConvertThreads{0};
+        int64_t videoConvertStallMs{0};  // time the video encoding thread waits for the conversion of the next frame
+        int64_t videoEncoderStallMs{0};  // time the video encoding thread waits for the muxing thread to drain the encoder
+        int64_t audioEncoderStallMs{0};
+        int64_t muxerStallMs{0};         // time the muxing thread waits for encoded packets
+        int64_t videoDuplicateFrames{0}; // frames identical to the previous one, which reuse its converted AVFrame
+    };
+    virtual PipelineStatistics GetPipelineStatistics() const = 0;
+
     virtual bool IsOpened() const = 0;
     virtual bool HasVideo() const = 0;
     virtual bool HasAudio() const = 0;
@@ -27,6 +27,8 @@
 
 namespace MediaCore
 {
+struct MediaAnalysisCache;
+
 struct MediaParser
 {
     using Holder = std::shared_ptr<MediaParser>;
@@ -61,6 +63,40 @@ struct MediaParser
     using SeekPointsHolder = std::shared_ptr<std::vector<int64_t>>;
     virtual SeekPointsHolder GetVideoSeekPoints(bool wait = true) = 0;
 
+    // A proxy is a low resolution version of this media with the same duration. It is used instead of this media
+    // when a clip is read with 'SharedSettings::IsVideoSrcUseProxy()' turned on. Set null to detach the proxy.
+    virtual void SetProxyParser(Holder hProxyParser) = 0;
+    virtual Holder GetProxyParser() const = 0;
+
+    // Reuse the media info analyzed in a previous session. Must be set before 'Open()'. An overview opened
+    // with this parser also loads and saves its snapshots and waveform in the same cache.
+    virtual void SetAnalysisCache(std::shared_ptr<MediaAnalysisCache> hCache) = 0;
+    virtual std::shared_ptr<MediaAnalysisCache> GetAnalysisCache() const = 0;
+
     virtual std::string GetError() const = 0;
+
+    // Open many media files and parse their media info with a bounded number of shared threads, instead of
+    // one parser thread per file. Results are returned in the order they are completed.
+    struct BatchProber
+    {
+        using Holder = std::shared_ptr<BatchProber>;
+
+        struct Result
+        {
+            std::string url;
+            MediaParser::Holder hParser;  // null if failed to open the media
+            std::string errMsg;
+        };
+
+        virtual void SetAnalysisCache(std::shared_ptr<MediaAnalysisCache> hCache) = 0;
+        virtual void Submit(const std::vector<std::string>& urls) = 0;
+        // Return false if there is no completed result yet, this call never blocks.
+        virtual bool PopResult(Result& result) = 0;
+        // Drop all the urls not probed yet and the results not popped yet.
+        virtual void Cancel() = 0;
+        virtual uint32_t GetPendingCount() const = 0;
+    };
+    // 'maxParallelism' as 0 means deciding it by the hardware concurrency.
+    static MEDIACORE_API BatchProber::Holder CreateBatchProber(uint32_t maxParallelism = 0);
 };
 }
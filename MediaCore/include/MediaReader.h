@@ -75,6 +75,10 @@ struct MediaReader
 
     virtual bool SetCacheDuration(double forwardDur, double backwardDur) = 0;
     virtual bool SetCacheFrames(bool readForward, uint32_t forwardFrames, uint32_t backwardFrames) = 0;
+    // Only supported by the image sequence reader, must be set before 'ConfigVideoReader()'. Decode 'workerCount'
+    // images in parallel (0 means decided by the hardware concurrency), and keep 'readaheadFrames' more frames
+    // decoded ahead of the cache range while reading continuously. The default is (0, 0), no readahead.
+    virtual bool SetImageDecodeParallelism(uint32_t workerCount, uint32_t readaheadFrames) = 0;
     virtual std::pair<double, double> GetCacheDuration() const = 0;
     virtual bool IsHwAccelEnabled() const = 0;
     virtual void EnableHwAccel(bool enable) = 0;
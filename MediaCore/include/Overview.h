@@ -31,6 +31,11 @@ struct Overview
     using Holder = std::shared_ptr<Overview>;
     static MEDIACORE_API Holder CreateInstance();
     static MEDIACORE_API Logger::ALogger* GetLogger();
+    // The generations of all the instances share a limited number of concurrent slots, the others wait until a slot
+    // is released. At most 'SetMaxConcurrentGenerationsPerDevice()' of them read from the same storage device.
+    // Set 0 to use the default values.
+    static MEDIACORE_API void SetMaxConcurrentGenerations(uint32_t count);
+    static MEDIACORE_API void SetMaxConcurrentGenerationsPerDevice(uint32_t count);
 
     virtual bool Open(const std::string& url, uint32_t snapshotCount = 20) = 0;
     virtual bool Open(MediaParser::Holder hParser, uint32_t snapshotCount = 20) = 0;
@@ -47,10 +52,45 @@ struct Overview
         std::vector<std::vector<float>> pcm;
         int64_t validSampleCount{0};
         bool parseDone{false};
+
+        // Multi-resolution min/max/rms of the audio, built along with 'pcm'. Level 0 aggregates at least
+        // PYRAMID_BASE_SAMPLES samples per entry, each following level aggregates twice as many as the previous one.
+        static constexpr double PYRAMID_BASE_SAMPLES = 256;
+        struct Level
+        {
+            double aggregateSamples;
+            double aggregateDuration;
+            std::vector<std::vector<float>> minPcm;
+            std::vector<std::vector<float>> maxPcm;
+            std::vector<std::vector<float>> rmsPcm;
+            int64_t validSampleCount{0};
+        };
+        std::vector<Level> levels;
+
+        // Return the index of the coarsest level that still has at least 'pixelsPerSecond' entries per second,
+        // or -1 if none is fine enough and 'pcm' should be used instead.
+        int SelectLevel(double pixelsPerSecond) const
+        {
+            int selected = -1;
+            for (int i = 0; i < (int)levels.size(); i++)
+            {
+                if (levels[i].aggregateDuration*pixelsPerSecond > 1.)
+                    break;
+                selected = i;
+            }
+            return selected;
+        }
     };
     virtual Waveform::Holder GetWaveform() const = 0;
     virtual bool SetSingleFramePixels(uint32_t pixels) = 0;
     virtual bool SetFixedAggregateSamples(double aggregateSamples) = 0;
+    // Take the key frame at or before each snapshot position instead of the exact frame. Only the key frames are
+    // decoded, which is much faster for long-GOP media. Must be enabled before 'Open()'.
+    virtual bool EnableKeyFrameOnly(bool enable) = 0;
+    virtual bool IsKeyFrameOnlyEnabled() const = 0;
+    // A waiting generation with larger priority gets the next free slot first, e.g. the media visible in the UI.
+    virtual void SetPriority(int priority) = 0;
+    virtual int GetPriority() const = 0;
 
     virtual bool IsOpened() const = 0;
     virtual bool IsDone() const = 0;
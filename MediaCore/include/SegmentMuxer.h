@@ -0,0 +1,70 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "MediaCore.h"
+#include "Logger.h"
+
+namespace MediaCore
+{
+// Join separately encoded media files into one output without re-encoding. The video streams of all the segments
+// must be encoded with the same codec parameters, each one starting with a key frame. For h264 and hevc, segments with
+// other parameter sets than the previous one get them in-band in their first packet. An optional audio file
+// is muxed along with the joined video. A segment can also be a range of a source media file, whose packets are
+// copied as they are, the range must start with the key frame of a closed GOP and end right before one.
+struct SegmentMuxer
+{
+    using Holder = std::shared_ptr<SegmentMuxer>;
+    static MEDIACORE_API Holder CreateInstance();
+    static MEDIACORE_API Logger::ALogger* GetLogger();
+
+    struct Segment
+    {
+        std::string path;
+        int64_t startTime;  // millisecond, position of this segment in the output
+        int64_t copyStart{-1};  // millisecond in the source media, only copy the packets in [copyStart, copyEnd) if >= 0
+        int64_t copyEnd{-1};
+    };
+
+    // Check if the video streams of the segments can be joined without re-encoding, and if every copied range starts
+    // and ends at the key frame of a closed GOP. The reason is returned by 'GetError()'.
+    virtual bool IsStreamCopyCompatible(const std::vector<Segment>& videoSegments) = 0;
+
+    struct VideoCodecInfo
+    {
+        std::string codecName;  // codec descriptor name, e.g. 'h264'
+        std::string profileName;  // e.g. 'High', empty if unknown
+        int level{-1};
+        std::string pixelFormat;
+    };
+    // The codec parameters of the video stream in 'url', which the re-encoded segments must follow to be joined with its copied ranges
+    virtual bool GetVideoCodecInfo(const std::string& url, VideoCodecInfo& codecInfo) = 0;
+    // Check if the key frame at 'keyFrameTime' (millisecond in the source media) starts a closed GOP. The leading frames of
+    // an open GOP refer to the previous GOP, they are lost if a copied range starts or ends at such a key frame.
+    virtual bool IsClosedGopAt(const std::string& url, int64_t keyFrameTime) = 0;
+
+    // Blocking call. Packets of the segments are shifted to their 'startTime' and interleaved with the audio packets.
+    virtual bool Mux(const std::string& outputUrl, const std::vector<Segment>& videoSegments, const std::string& audioPath = "") = 0;
+    virtual void Cancel() = 0;
+    virtual float GetProgress() const = 0;
+    virtual std::string GetError() const = 0;
+};
+}
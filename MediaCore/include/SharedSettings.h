@@ -25,11 +25,13 @@ struct SharedSettings
     virtual ImDataType VideoOutDataType() const = 0;
     virtual HwaccelManager::Holder GetHwaccelManager() const = 0;
     virtual bool IsVideoSrcKeepOriginalSize() const = 0;
+    virtual bool IsVideoSrcUseProxy() const = 0;
     virtual uint32_t AudioOutChannels() const = 0;
     virtual uint32_t AudioOutSampleRate() const = 0;
     virtual ImDataType AudioOutDataType() const = 0;
     virtual bool AudioOutIsPlanar() const = 0;
     virtual std::string AudioOutSampleFormatName() const = 0;
+    virtual std::string AudioResampleCacheDir() const = 0;
 
     virtual void SetVideoOutWidth(uint32_t width) = 0;
     virtual void SetVideoOutHeight(uint32_t height) = 0;
@@ -38,10 +40,14 @@ struct SharedSettings
     virtual void SetVideoOutDataType(ImDataType dataType) = 0;
     virtual void SetHwaccelManager(HwaccelManager::Holder hHwaMgr) = 0;
     virtual void SetVideoSrcKeepOriginalSize(bool enable) = 0;
+    // read the video of a clip from the proxy attached to its MediaParser, if there is one. Only meant for preview.
+    virtual void SetVideoSrcUseProxy(bool enable) = 0;
     virtual void SetAudioOutChannels(uint32_t channels) = 0;
     virtual void SetAudioOutSampleRate(uint32_t sampleRate) = 0;
     virtual void SetAudioOutDataType(ImDataType dataType) = 0;
     virtual void SetAudioOutIsPlanar(bool isPlanar) = 0;
+    // set a non-empty directory to cache the resampled float pcm of clips whose sample rate differs from the output
+    virtual void SetAudioResampleCacheDir(const std::string& dirPath) = 0;
 
     virtual void SyncVideoSettingsFrom(const SharedSettings* pSettings) = 0;
     virtual void SyncAudioSettingsFrom(const SharedSettings* pSettings) = 0;
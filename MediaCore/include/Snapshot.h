@@ -91,6 +91,10 @@ namespace Snapshot
         virtual bool SetOutColorFormat(ImColorFormat clrfmt) = 0;
         virtual bool SetResizeInterpolateMode(ImInterpolateMode interp) = 0;
         virtual bool SetOverview(Overview::Holder hOverview) = 0;
+        // Use the key frame of each GOP as all the snapshots within it, only the key frames are decoded.
+        // Must be enabled before 'Open()'.
+        virtual bool EnableKeyFrameOnly(bool enable) = 0;
+        virtual bool IsKeyFrameOnlyEnabled() const = 0;
 
         virtual MediaInfo::Holder GetMediaInfo() const = 0;
         virtual const VideoStream* GetVideoStream() const = 0;
@@ -19,6 +19,7 @@
 #include <functional>
 #include <cmath>
 #include "AudioClip.h"
+#include "AudioResampleCache.h"
 #include "MatUtils.h"
 #include "Logger.h"
 
@@ -60,12 +61,14 @@ public:
             oss << "AUD@" << fileName << "";
             loggerName = oss.str();
         }
+        m_readerLoggerName = loggerName;
+        m_hParser = hParser;
         m_hSettings = hSettings;
-        m_hReader = MediaReader::CreateInstance(loggerName);
-        if (!m_hReader->Open(hParser))
-            throw runtime_error(m_hReader->GetError());
-        if (!m_hReader->ConfigAudioReader(hSettings->AudioOutChannels(), hSettings->AudioOutSampleRate(), hSettings->AudioOutSampleFormatName()))
-            throw runtime_error(m_hReader->GetError());
+        m_outChannels = hSettings->AudioOutChannels();
+        m_outSampleRate = hSettings->AudioOutSampleRate();
+        m_isOutPlanar = hSettings->AudioOutIsPlanar();
+        m_blockPool = MatUtils::AudioBlockPool::GetDefaultInstance();
+        OpenReader();
         m_srcDuration = (int64_t)(m_hReader->GetAudioStream()->duration*1000);
         if (startOffset < 0)
             throw invalid_argument("Argument 'startOffset' can NOT be NEGATIVE!");
@@ -77,8 +80,7 @@ public:
         m_endOffset = endOffset;
         m_padding = (end-start)+startOffset+endOffset-m_srcDuration;
         m_totalSamples = Duration()*hSettings->AudioOutSampleRate()/1000;
-        if (!m_hReader->Start())
-            throw runtime_error(m_hReader->GetError());
+        SetupResampleCache(hSettings);
     }
 
     ~AudioClip_AudioImpl()
@@ -90,15 +92,20 @@ public:
     bool UpdateSettings(SharedSettings::Holder hSettings) override
     {
         m_totalSamples = Duration()*hSettings->AudioOutSampleRate()/1000;
-        if (!m_hReader->ChangeAudioOutputFormat(hSettings->AudioOutChannels(), hSettings->AudioOutSampleRate(), hSettings->AudioOutSampleFormatName()))
+        if (m_hReader && !m_hReader->ChangeAudioOutputFormat(hSettings->AudioOutChannels(), hSettings->AudioOutSampleRate(), hSettings->AudioOutSampleFormatName()))
             throw runtime_error(m_hReader->GetError());
         m_hSettings = hSettings;
+        m_outChannels = hSettings->AudioOutChannels();
+        m_outSampleRate = hSettings->AudioOutSampleRate();
+        m_isOutPlanar = hSettings->AudioOutIsPlanar();
+        m_pcmFrameSize = 0;
+        SetupResampleCache(hSettings);
         return true;
     }
 
     MediaParser::Holder GetMediaParser() const override
     {
-        return m_hReader->GetMediaParser();
+        return m_hParser;
     }
 
     int64_t Id() const override
@@ -138,23 +145,22 @@ public:
 
     int64_t ReadPos() const override
     {
-        return round((double)m_readSamples*1000/m_hReader->GetAudioOutSampleRate())+m_start;
+        return round((double)m_readSamples*1000/m_outSampleRate)+m_start;
     }
 
     uint32_t OutChannels() const override
     {
-        return m_hReader->GetAudioOutChannels();
+        return m_outChannels;
     }
 
     uint32_t OutSampleRate() const override
     {
-        return m_hReader->GetAudioOutSampleRate();
+        return m_outSampleRate;
     }
 
     uint32_t LeftSamples() const override
     {
-        bool isForward = m_hReader->IsDirectionForward();
-        if (isForward)
+        if (m_readForward)
             return m_totalSamples > m_readSamples ? (uint32_t)(m_totalSamples-m_readSamples) : 0;
         else
             return m_readSamples > m_totalSamples ? 0 : (m_readSamples >= 0 ? (uint32_t)m_readSamples : 0);
@@ -180,7 +186,7 @@ public:
         if (startOffset+m_endOffset >= m_srcDuration)
             throw invalid_argument("Argument 'startOffset/endOffset', clip duration is NOT LARGER than 0!");
         m_startOffset = startOffset;
-        const int64_t newTotalSamples = Duration()*m_hReader->GetAudioOutSampleRate()/1000;
+        const int64_t newTotalSamples = Duration()*m_outSampleRate/1000;
         m_readSamples += newTotalSamples-m_totalSamples;
         m_totalSamples = newTotalSamples;
     }
@@ -194,7 +200,7 @@ public:
         if (m_startOffset+endOffset >= m_srcDuration)
             throw invalid_argument("Argument 'startOffset/endOffset', clip duration is NOT LARGER than 0!");
         m_endOffset = endOffset;
-        m_totalSamples = Duration()*m_hReader->GetAudioOutSampleRate()/1000;
+        m_totalSamples = Duration()*m_outSampleRate/1000;
     }
 
     void SeekTo(int64_t pos) override
@@ -204,15 +210,25 @@ public:
             m_logger->Log(WARN) << "!! INVALID seek, pos=" << pos << " is out of the valid range [0, " << Duration() << "] !!" << endl;
             return;
         }
-        int64_t targetReadSamples = pos*m_hReader->GetAudioOutSampleRate()/1000;
+        int64_t targetReadSamples = pos*m_outSampleRate/1000;
         if (targetReadSamples == m_readSamples)
             return;
+        if (IsResampleCacheUsable())
+        {
+            // reading from the resample cache only needs a new offset, the reader is re-synced when it's used again
+            m_readSamples = targetReadSamples;
+            m_readerOutOfSync = true;
+            m_eof = false;
+            return;
+        }
 
         auto seekPos = pos+m_startOffset;
         if (seekPos > m_srcDuration) seekPos = m_srcDuration;
         m_logger->Log(DEBUG) << "-> AudClip.SeekTo(" << seekPos << ")" << endl;
+        EnsureReaderOpened();
         if (!m_hReader->SeekTo(seekPos))
             throw runtime_error(m_hReader->GetError());
+        m_readerOutOfSync = false;
         m_readSamples = targetReadSamples;
         m_eof = false;
     }
@@ -228,13 +244,17 @@ public:
         }
         if (readSamples > leftSamples)
             readSamples = leftSamples;
+        if (IsResampleCacheUsable())
+            return ReadAudioSamplesFromCache(readSamples, eof);
 
+        EnsureReaderOpened();
         uint32_t sampleRate = m_hReader->GetAudioOutSampleRate();
         int channels = m_hReader->GetAudioOutChannels();
         if (m_pcmFrameSize == 0)
             m_pcmFrameSize = m_hReader->GetAudioOutFrameSize();
 
         ImGui::ImMat amat;
+        amat.allocator = m_blockPool;
         int64_t expectedReadPos = (int64_t)((double)m_readSamples/sampleRate*1000)+m_startOffset;
         if (!m_initSeek)
         {
@@ -242,6 +262,11 @@ public:
                 m_hReader->SeekTo(expectedReadPos);
             m_initSeek = true;
         }
+        if (m_readerOutOfSync)
+        {
+            m_hReader->SeekTo(expectedReadPos);
+            m_readerOutOfSync = false;
+        }
         int64_t sourceReadPos = m_hReader->GetReadPos();
         bool readForward = m_hReader->IsDirectionForward();
         // if expected read position does not match the real read position, use silence or skip samples to compensate
@@ -275,7 +300,7 @@ public:
                 silenceSamples = diffSamples > readSamples ? readSamples : diffSamples;
                 size_t elemSize = m_pcmFrameSize/channels;
                 ImGui::ImMat silenceMat;
-                silenceMat.create((int)readSamples, 1, channels, elemSize);
+                silenceMat.create((int)readSamples, 1, channels, elemSize, m_blockPool);
                 memset(silenceMat.data, 0, silenceMat.total()*silenceMat.elemsize);
                 silenceMat.rate.num = m_hReader->GetAudioOutSampleRate();
                 silenceMat.rate.den = 1;
@@ -300,6 +325,7 @@ public:
             {
                 uint32_t toReadSamples = readSamples-silenceSamples;
                 ImGui::ImMat remainMat;
+                remainMat.allocator = m_blockPool;
                 if (!m_hReader->ReadAudioSamples(remainMat, toReadSamples, srcEof))
                     throw runtime_error(m_hReader->GetError());
                 m_logger->Log(WARN) << "--> Merge silence mat and read mat, silence samples=" << silenceSamples << ", src samples=" << remainMat.w << "." << endl;
@@ -336,7 +362,9 @@ public:
 
     void SetDirection(bool forward) override
     {
-        m_hReader->SetDirection(forward);
+        m_readForward = forward;
+        if (m_hReader)
+            m_hReader->SetDirection(forward);
     }
 
     void SetFilter(AudioFilter::Holder filter) override
@@ -362,13 +390,94 @@ public:
         m_logger->SetShowLevels(l);
     }
 
+private:
+    void OpenReader()
+    {
+        auto hReader = MediaReader::CreateInstance(m_readerLoggerName);
+        if (!hReader->Open(m_hParser))
+            throw runtime_error(hReader->GetError());
+        if (!hReader->ConfigAudioReader(m_hSettings->AudioOutChannels(), m_hSettings->AudioOutSampleRate(), m_hSettings->AudioOutSampleFormatName()))
+            throw runtime_error(hReader->GetError());
+        if (!m_readForward)
+            hReader->SetDirection(false);
+        if (!hReader->Start())
+            throw runtime_error(hReader->GetError());
+        m_hReader = hReader;
+    }
+
+    // The MediaReader is released while the samples are read from a complete resample cache,
+    // re-open it when the cache can not serve the reading (e.g. reading backward).
+    void EnsureReaderOpened()
+    {
+        if (m_hReader)
+            return;
+        m_logger->Log(DEBUG) << "Re-open MediaReader, the resample cache can not serve the reading." << endl;
+        OpenReader();
+        m_readerOutOfSync = true;
+        m_pcmFrameSize = 0;
+    }
+
+    void SetupResampleCache(SharedSettings::Holder hSettings)
+    {
+        m_hResmpCache = nullptr;
+        const auto cacheDir = hSettings->AudioResampleCacheDir();
+        if (cacheDir.empty() || hSettings->AudioOutDataType() != IM_DT_FLOAT32)
+            return;
+        auto pAudstm = m_hParser->GetBestAudioStream();
+        if (!pAudstm || pAudstm->sampleRate == hSettings->AudioOutSampleRate())
+            return;
+        m_hResmpCache = AudioResampleCache::GetInstance(cacheDir, m_hParser, hSettings->AudioOutChannels(), hSettings->AudioOutSampleRate());
+    }
+
+    bool IsResampleCacheUsable() const
+    {
+        // backward reading still goes through the MediaReader
+        return m_hResmpCache && m_hResmpCache->IsReady() && m_readForward;
+    }
+
+    ImGui::ImMat ReadAudioSamplesFromCache(uint32_t& readSamples, bool& eof)
+    {
+        if (m_hReader)
+        {
+            m_logger->Log(DEBUG) << "Release MediaReader, the samples are read from the complete resample cache." << endl;
+            m_hReader = nullptr;
+        }
+        const uint32_t sampleRate = m_hResmpCache->SampleRate();
+        ImGui::ImMat amat;
+        const int channels = (int)m_hResmpCache->Channels();
+        amat.create((int)readSamples, 1, channels, sizeof(float), m_blockPool);
+        amat.elempack = m_isOutPlanar ? 1 : channels;
+        const int64_t srcReadSamples = m_readSamples+m_startOffset*sampleRate/1000;
+        if (!m_hResmpCache->ReadSamples(amat, srcReadSamples))
+            throw runtime_error("FAILED to read samples from AudioResampleCache!");
+        amat.rate = { (int)sampleRate, 1 };
+        amat.flags |= IM_MAT_FLAGS_AUDIO_FRAME;
+        amat.time_stamp = (double)m_readSamples/sampleRate+(double)m_start/1000;
+        m_readSamples += readSamples;
+        m_readerOutOfSync = true;
+        if (LeftSamples() == 0)
+            m_eof = eof = true;
+        if (m_hFilter && readSamples > 0)
+            amat = m_hFilter->FilterPcm(amat, (int64_t)(amat.time_stamp*1000)-m_start, Duration());
+        return amat;
+    }
+
 private:
     ALogger* m_logger;
     int64_t m_id;
     int64_t m_trackId{-1};
     SharedSettings::Holder m_hSettings;
     MediaInfo::Holder m_hInfo;
+    MediaParser::Holder m_hParser;
     MediaReader::Holder m_hReader;
+    string m_readerLoggerName;
+    uint32_t m_outChannels;
+    uint32_t m_outSampleRate;
+    bool m_isOutPlanar;
+    bool m_readForward{true};
+    MatUtils::AudioBlockPool* m_blockPool;
+    AudioResampleCache::Holder m_hResmpCache;
+    bool m_readerOutOfSync{false};
     AudioFilter::Holder m_hFilter;
     int64_t m_srcDuration;
     int64_t m_start;
@@ -396,7 +505,7 @@ AudioClip::Holder AudioClip::CreateInstance(
 
 AudioClip::Holder AudioClip_AudioImpl::Clone(SharedSettings::Holder hSettings) const
 {
-    AudioClip_AudioImpl* newInstance = new AudioClip_AudioImpl(m_id, m_hReader->GetMediaParser(), hSettings, m_start, End(), m_startOffset, m_endOffset);
+    AudioClip_AudioImpl* newInstance = new AudioClip_AudioImpl(m_id, m_hParser, hSettings, m_start, End(), m_startOffset, m_endOffset);
     if (m_hFilter) newInstance->SetFilter(m_hFilter->Clone());
     return AudioClip::Holder(newInstance, AUDIO_CLIP_HOLDER_DELETER);
 }
@@ -553,7 +662,7 @@ public:
         if (eof1 && toReadSize1 < readSamples)
         {
             ImGui::ImMat temp;
-            temp.create_type(readSamples, 1, amat1.c, amat1.type);
+            temp.create_type(readSamples, 1, amat1.c, amat1.type, MatUtils::AudioBlockPool::GetDefaultInstance());
             memset(temp.data, 0, temp.total()*temp.elemsize);
             if (!amat1.empty() && amat1.w > 0)
                 MatUtils::CopyAudioMatSamples(temp, amat1, 0, 0);
@@ -569,7 +678,7 @@ public:
         if (eof2 && toReadSize2 < readSamples)
         {
             ImGui::ImMat temp;
-            temp.create_type(readSamples, 1, amat2.c, amat2.type);
+            temp.create_type(readSamples, 1, amat2.c, amat2.type, MatUtils::AudioBlockPool::GetDefaultInstance());
             memset(temp.data, 0, temp.total()*temp.elemsize);
             if (!amat2.empty() && amat2.w > 0)
                 MatUtils::CopyAudioMatSamples(temp, amat2, 0, 0);
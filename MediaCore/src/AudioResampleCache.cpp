@@ -0,0 +1,529 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <list>
+#include <condition_variable>
+#include <unordered_map>
+#include <functional>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <io.h>
+#include "mman_win.h"
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "AudioResampleCache.h"
+#include "MediaReader.h"
+#include "ThreadUtils.h"
+#include "FileSystemUtils.h"
+#include "MathUtils.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MediaCore
+{
+static const char CACHE_FILE_MAGIC[8] = { 'M', 'E', 'C', 'A', 'R', 'S', 'C', '1' };
+static const uint32_t CACHE_FILE_VERSION = 1;
+static const uint32_t CACHE_BLOCK_SAMPLES = 8192;
+static const uint32_t MAX_CACHE_BUILD_THREADS = 2;
+static const uint64_t MAX_CACHE_DIR_SIZE = 4ULL*1024*1024*1024;
+
+static void EvictCacheFiles(const string& cacheDir);
+
+#pragma pack(push, 1)
+struct AudioResampleCacheFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    uint32_t sampleRate;
+    uint32_t blockSamples;
+    int64_t totalSamples;
+    uint64_t srcFileSize;
+    int64_t srcModifyTime;
+    uint8_t reserved[16];
+};
+#pragma pack(pop)
+static_assert(sizeof(AudioResampleCacheFileHeader) == 64, "Size of 'AudioResampleCacheFileHeader' must be 64 bytes!");
+
+class AudioResampleCache_Impl : public AudioResampleCache
+{
+public:
+    AudioResampleCache_Impl(const string& filePath, MediaParser::Holder hParser, uint32_t channels, uint32_t sampleRate, uint64_t srcFileSize, int64_t srcMtime)
+        : m_filePath(filePath), m_hParser(hParser), m_channels(channels), m_sampleRate(sampleRate), m_srcFileSize(srcFileSize), m_srcMtime(srcMtime)
+    {
+        m_logger = AudioResampleCache::GetLogger();
+        auto pAudstm = hParser->GetBestAudioStream();
+        m_estimatedTotalSamples = pAudstm ? (int64_t)(pAudstm->duration*sampleRate) : 0;
+    }
+
+    ~AudioResampleCache_Impl()
+    {
+        UnmapCacheFile();
+    }
+
+    // Return false if there is no valid cache file, then the instance needs to be queued for building.
+    bool Init()
+    {
+        if (MapCacheFile())
+        {
+            m_logger->Log(DEBUG) << "Use existing audio resample cache '" << m_filePath << "'." << endl;
+            SysUtils::TouchFile(m_filePath);
+            return true;
+        }
+        return false;
+    }
+
+    // Build the cache file on a thread of the build pool. 'isCancelled' returns true when no clip uses this cache any more.
+    void BuildCache(const function<bool(void)>& isCancelled)
+    {
+        BuildCacheProc(isCancelled);
+        if (m_ready)
+            EvictCacheFiles(SysUtils::ExtractDirectoryPath(m_filePath));
+    }
+
+    bool IsReady() const override
+    {
+        return m_ready;
+    }
+
+    bool IsFailed() const override
+    {
+        return m_failed;
+    }
+
+    float GetBuildProgress() const override
+    {
+        if (m_ready)
+            return 1.f;
+        if (m_estimatedTotalSamples <= 0)
+            return 0.f;
+        float progress = (float)((double)m_builtSamples/m_estimatedTotalSamples);
+        return progress > 1.f ? 1.f : progress;
+    }
+
+    uint32_t Channels() const override
+    {
+        return m_channels;
+    }
+
+    uint32_t SampleRate() const override
+    {
+        return m_sampleRate;
+    }
+
+    int64_t TotalSamples() const override
+    {
+        return m_totalSamples;
+    }
+
+    string GetFilePath() const override
+    {
+        return m_filePath;
+    }
+
+    bool ReadSamples(ImGui::ImMat& amat, int64_t pos) override
+    {
+        if (!m_ready)
+            return false;
+        if (amat.empty() || amat.c != (int)m_channels || amat.elemsize != sizeof(float))
+            return false;
+
+        const bool isDstPlanar = amat.elempack == 1 || m_channels == 1;
+        const int64_t blockSize = (int64_t)CACHE_BLOCK_SAMPLES*m_channels;
+        const uint32_t dstLineSamples = (uint32_t)amat.w;
+        float* dstPtr = (float*)amat.data;
+        uint32_t dstOffset = 0;
+        while (dstOffset < dstLineSamples)
+        {
+            uint32_t copySamples;
+            if (pos < 0 || pos >= m_totalSamples)
+            {
+                // out of stream range, fill with silence
+                copySamples = dstLineSamples-dstOffset;
+                if (pos < 0 && -pos < (int64_t)copySamples)
+                    copySamples = (uint32_t)(-pos);
+                if (isDstPlanar)
+                {
+                    for (uint32_t i = 0; i < m_channels; i++)
+                        memset(dstPtr+i*dstLineSamples+dstOffset, 0, copySamples*sizeof(float));
+                }
+                else
+                {
+                    memset(dstPtr+dstOffset*m_channels, 0, copySamples*m_channels*sizeof(float));
+                }
+            }
+            else
+            {
+                const int64_t blockIndex = pos/CACHE_BLOCK_SAMPLES;
+                const uint32_t blockOffset = (uint32_t)(pos%CACHE_BLOCK_SAMPLES);
+                copySamples = CACHE_BLOCK_SAMPLES-blockOffset;
+                if (copySamples > dstLineSamples-dstOffset)
+                    copySamples = dstLineSamples-dstOffset;
+                if ((int64_t)copySamples > m_totalSamples-pos)
+                    copySamples = (uint32_t)(m_totalSamples-pos);
+                const float* srcBlock = m_pBlocks+blockIndex*blockSize+blockOffset;
+                if (isDstPlanar)
+                {
+                    for (uint32_t i = 0; i < m_channels; i++)
+                        memcpy(dstPtr+i*dstLineSamples+dstOffset, srcBlock+i*CACHE_BLOCK_SAMPLES, copySamples*sizeof(float));
+                }
+                else
+                {
+                    float* pDst = dstPtr+dstOffset*m_channels;
+                    for (uint32_t j = 0; j < copySamples; j++)
+                    {
+                        const float* pSrc = srcBlock+j;
+                        for (uint32_t i = 0; i < m_channels; i++)
+                        {
+                            *pDst++ = *pSrc;
+                            pSrc += CACHE_BLOCK_SAMPLES;
+                        }
+                    }
+                }
+            }
+            dstOffset += copySamples;
+            pos += copySamples;
+        }
+        return true;
+    }
+
+private:
+    bool MapCacheFile()
+    {
+        if (!SysUtils::IsFile(m_filePath))
+            return false;
+        int fd = open(m_filePath.c_str(), O_RDONLY);
+        if (fd == -1)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(AudioResampleCacheFileHeader))
+        {
+            close(fd);
+            return false;
+        }
+        void* pMapped = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (pMapped == MAP_FAILED)
+        {
+            m_logger->Log(WARN) << "FAILED to map audio resample cache file '" << m_filePath << "'!" << endl;
+            return false;
+        }
+        const AudioResampleCacheFileHeader* pHeader = (const AudioResampleCacheFileHeader*)pMapped;
+        const int64_t blockCount = (pHeader->totalSamples+CACHE_BLOCK_SAMPLES-1)/CACHE_BLOCK_SAMPLES;
+        const size_t expectedSize = sizeof(AudioResampleCacheFileHeader)+(size_t)blockCount*CACHE_BLOCK_SAMPLES*m_channels*sizeof(float);
+        if (memcmp(pHeader->magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) != 0 || pHeader->version != CACHE_FILE_VERSION
+            || pHeader->channels != m_channels || pHeader->sampleRate != m_sampleRate || pHeader->blockSamples != CACHE_BLOCK_SAMPLES
+            || pHeader->srcFileSize != m_srcFileSize || pHeader->srcModifyTime != m_srcMtime || (size_t)st.st_size != expectedSize)
+        {
+            m_logger->Log(DEBUG) << "Audio resample cache file '" << m_filePath << "' is OUTDATED or BROKEN." << endl;
+            munmap(pMapped, (size_t)st.st_size);
+            return false;
+        }
+        m_pMapped = pMapped;
+        m_mappedSize = (size_t)st.st_size;
+        m_pBlocks = (const float*)((const uint8_t*)pMapped+sizeof(AudioResampleCacheFileHeader));
+        m_totalSamples = pHeader->totalSamples;
+        m_builtSamples = m_totalSamples;
+        m_ready = true;
+        return true;
+    }
+
+    void UnmapCacheFile()
+    {
+        m_ready = false;
+        if (m_pMapped)
+        {
+            munmap(m_pMapped, m_mappedSize);
+            m_pMapped = nullptr;
+            m_pBlocks = nullptr;
+            m_mappedSize = 0;
+        }
+    }
+
+    void BuildCacheProc(const function<bool(void)>& isCancelled)
+    {
+        m_logger->Log(DEBUG) << "Enter BuildCacheProc() for '" << m_filePath << "'." << endl;
+        auto hReader = MediaReader::CreateInstance();
+        if (!hReader->Open(m_hParser) || !hReader->ConfigAudioReader(m_channels, m_sampleRate, "fltp") || !hReader->Start())
+        {
+            m_logger->Log(Error) << "FAILED to setup MediaReader for building audio resample cache! Error is '" << hReader->GetError() << "'." << endl;
+            m_failed = true;
+            return;
+        }
+        const string tmpFilePath = m_filePath+".tmp";
+        FILE* fp = fopen(tmpFilePath.c_str(), "wb");
+        if (!fp)
+        {
+            m_logger->Log(Error) << "FAILED to create audio resample cache file '" << tmpFilePath << "'!" << endl;
+            m_failed = true;
+            return;
+        }
+        AudioResampleCacheFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+        header.version = CACHE_FILE_VERSION;
+        header.channels = m_channels;
+        header.sampleRate = m_sampleRate;
+        header.blockSamples = CACHE_BLOCK_SAMPLES;
+        header.srcFileSize = m_srcFileSize;
+        header.srcModifyTime = m_srcMtime;
+        bool ioErr = fwrite(&header, sizeof(header), 1, fp) != 1;
+
+        vector<float> block((size_t)CACHE_BLOCK_SAMPLES*m_channels);
+        vector<float> readBuf((size_t)CACHE_BLOCK_SAMPLES*m_channels);
+        uint32_t blockFilled = 0;
+        int64_t totalSamples = 0;
+        bool eof = false;
+        bool cancelled = false;
+        while (!ioErr && !eof)
+        {
+            if (isCancelled())
+            {
+                cancelled = true;
+                break;
+            }
+            // planar data returned by MediaReader is laid out with the requested sample count as the line size
+            const uint32_t toReadSamples = CACHE_BLOCK_SAMPLES-blockFilled;
+            uint32_t readSize = toReadSamples*m_channels*sizeof(float);
+            int64_t pos;
+            if (!hReader->ReadAudioSamples((uint8_t*)readBuf.data(), readSize, pos, eof))
+            {
+                m_logger->Log(Error) << "FAILED to read audio samples for building audio resample cache! Error is '" << hReader->GetError() << "'." << endl;
+                ioErr = true;
+                break;
+            }
+            const uint32_t readSamples = readSize/(m_channels*sizeof(float));
+            if (readSamples == 0 && !eof)
+            {
+                this_thread::sleep_for(chrono::milliseconds(5));
+                continue;
+            }
+            for (uint32_t i = 0; i < m_channels; i++)
+                memcpy(block.data()+i*CACHE_BLOCK_SAMPLES+blockFilled, readBuf.data()+i*toReadSamples, readSamples*sizeof(float));
+            blockFilled += readSamples;
+            totalSamples += readSamples;
+            if (blockFilled >= CACHE_BLOCK_SAMPLES || (eof && blockFilled > 0))
+            {
+                if (blockFilled < CACHE_BLOCK_SAMPLES)
+                {
+                    for (uint32_t i = 0; i < m_channels; i++)
+                        memset(block.data()+i*CACHE_BLOCK_SAMPLES+blockFilled, 0, (CACHE_BLOCK_SAMPLES-blockFilled)*sizeof(float));
+                }
+                if (fwrite(block.data(), sizeof(float), block.size(), fp) != block.size())
+                    ioErr = true;
+                blockFilled = 0;
+            }
+            m_builtSamples = totalSamples;
+        }
+        hReader->Close();
+        if (!cancelled && !ioErr)
+        {
+            header.totalSamples = totalSamples;
+            ioErr = fseek(fp, 0, SEEK_SET) != 0 || fwrite(&header, sizeof(header), 1, fp) != 1;
+        }
+        fclose(fp);
+        if (cancelled || ioErr)
+        {
+            if (ioErr)
+            {
+                m_logger->Log(Error) << "FAILED to build audio resample cache file '" << m_filePath << "'!" << endl;
+                m_failed = true;
+            }
+            SysUtils::DeleteFileAt(tmpFilePath);
+            return;
+        }
+        if (SysUtils::IsFile(m_filePath))
+            SysUtils::DeleteFileAt(m_filePath);
+        if (!SysUtils::RenameFile(tmpFilePath, m_filePath) || !MapCacheFile())
+        {
+            m_logger->Log(Error) << "FAILED to finalize audio resample cache file '" << m_filePath << "'!" << endl;
+            m_failed = true;
+            return;
+        }
+        m_logger->Log(DEBUG) << "Leave BuildCacheProc(), " << totalSamples << " samples are cached into '" << m_filePath << "'." << endl;
+    }
+
+private:
+    ALogger* m_logger;
+    string m_filePath;
+    MediaParser::Holder m_hParser;
+    uint32_t m_channels;
+    uint32_t m_sampleRate;
+    uint64_t m_srcFileSize;
+    int64_t m_srcMtime;
+    int64_t m_estimatedTotalSamples;
+    atomic_bool m_ready{false};
+    atomic_bool m_failed{false};
+    atomic<int64_t> m_builtSamples{0};
+    void* m_pMapped{nullptr};
+    size_t m_mappedSize{0};
+    const float* m_pBlocks{nullptr};
+    int64_t m_totalSamples{0};
+};
+
+static mutex s_cacheRegistryLock;
+static unordered_map<string, weak_ptr<AudioResampleCache>> s_cacheRegistry;
+
+static void EvictCacheFiles(const string& cacheDir)
+{
+    vector<string> inUsePaths;
+    {
+        lock_guard<mutex> lk(s_cacheRegistryLock);
+        for (const auto& elem : s_cacheRegistry)
+        {
+            if (!elem.second.expired())
+                inUsePaths.push_back(elem.first);
+        }
+    }
+    SysUtils::TrimDirectory(cacheDir, MAX_CACHE_DIR_SIZE, ".arc", inUsePaths);
+}
+
+// Cache files are built by a small pool of threads shared by all the instances, so opening many sources with
+// a mismatched sample rate doesn't start a decoding thread for each of them.
+class AudioResampleCacheBuildPool
+{
+public:
+    ~AudioResampleCacheBuildPool()
+    {
+        {
+            lock_guard<mutex> lk(m_queueLock);
+            m_quit = true;
+        }
+        m_queueCv.notify_all();
+        for (auto& t : m_threads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    void Enqueue(AudioResampleCache::Holder hCache)
+    {
+        lock_guard<mutex> lk(m_queueLock);
+        m_queue.push_back(hCache);
+        if (m_threads.size() < MAX_CACHE_BUILD_THREADS && m_queue.size() > m_idleThreadCount)
+        {
+            m_threads.push_back(thread(&AudioResampleCacheBuildPool::BuildThreadProc, this));
+            SysUtils::SetThreadName(m_threads.back(), "AResmpCacheBld");
+        }
+        m_queueCv.notify_one();
+    }
+
+private:
+    void BuildThreadProc()
+    {
+        while (true)
+        {
+            AudioResampleCache::Holder hCache;
+            {
+                unique_lock<mutex> lk(m_queueLock);
+                m_idleThreadCount++;
+                m_queueCv.wait(lk, [this] { return m_quit || !m_queue.empty(); });
+                m_idleThreadCount--;
+                if (m_quit)
+                    break;
+                hCache = m_queue.front().lock();
+                m_queue.pop_front();
+            }
+            if (!hCache)
+                continue;
+            // the instance held here is the only reference left when all the clips using it have been released
+            auto isCancelled = [this, &hCache] () { return m_quit || hCache.use_count() <= 1; };
+            auto pCache = dynamic_cast<AudioResampleCache_Impl*>(hCache.get());
+            pCache->BuildCache(isCancelled);
+        }
+    }
+
+private:
+    mutex m_queueLock;
+    condition_variable m_queueCv;
+    list<weak_ptr<AudioResampleCache>> m_queue;
+    vector<thread> m_threads;
+    uint32_t m_idleThreadCount{0};
+    atomic_bool m_quit{false};
+};
+
+static AudioResampleCacheBuildPool s_buildPool;
+
+static const function<void(AudioResampleCache*)> AUDIO_RESAMPLE_CACHE_HOLDER_DELETER = [] (AudioResampleCache* p) {
+    AudioResampleCache_Impl* ptr = dynamic_cast<AudioResampleCache_Impl*>(p);
+    delete ptr;
+};
+
+AudioResampleCache::Holder AudioResampleCache::GetInstance(const string& cacheDir, MediaParser::Holder hParser, uint32_t channels, uint32_t sampleRate)
+{
+    if (cacheDir.empty() || !hParser || channels == 0 || sampleRate == 0)
+        return nullptr;
+    const auto url = hParser->GetUrl();
+    struct stat st;
+    if (hParser->IsImageSequence() || stat(url.c_str(), &st) != 0)
+        return nullptr;
+    if (!SysUtils::IsDirectory(cacheDir) && !SysUtils::CreateDirectoryAt(cacheDir, true))
+    {
+        GetLogger()->Log(WARN) << "FAILED to create audio resample cache directory '" << cacheDir << "'!" << endl;
+        return nullptr;
+    }
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << MathUtils::Fnv1aHash64(url) << dec << "_" << sampleRate << "_" << channels << ".arc";
+    const auto filePath = SysUtils::JoinPath(cacheDir, oss.str());
+
+    AudioResampleCache::Holder hCache;
+    {
+        lock_guard<mutex> lk(s_cacheRegistryLock);
+        auto iter = s_cacheRegistry.begin();
+        while (iter != s_cacheRegistry.end())
+        {
+            if (iter->second.expired())
+                iter = s_cacheRegistry.erase(iter);
+            else
+                iter++;
+        }
+        iter = s_cacheRegistry.find(filePath);
+        if (iter != s_cacheRegistry.end())
+        {
+            hCache = iter->second.lock();
+            if (hCache && !hCache->IsFailed())
+                return hCache;
+        }
+        auto pCache = new AudioResampleCache_Impl(filePath, hParser, channels, sampleRate, (uint64_t)st.st_size, (int64_t)st.st_mtime);
+        hCache = AudioResampleCache::Holder(pCache, AUDIO_RESAMPLE_CACHE_HOLDER_DELETER);
+        s_cacheRegistry[filePath] = hCache;
+        if (pCache->Init())
+            return hCache;
+    }
+    s_buildPool.Enqueue(hCache);
+    return hCache;
+}
+
+ALogger* AudioResampleCache::GetLogger()
+{
+    return Logger::GetLogger("AResmpCache");
+}
+}
@@ -0,0 +1,51 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <memory>
+#include <string>
+#include "immat.h"
+#include "MediaParser.h"
+#include "Logger.h"
+
+namespace MediaCore
+{
+// On-disk cache of an audio stream, resampled to a fixed sample rate and channel count and stored as
+// planar float pcm in fixed-size blocks. Once the cache file is complete it is memory-mapped, so reading
+// from any position is only a copy out of the mapping.
+struct AudioResampleCache
+{
+    using Holder = std::shared_ptr<AudioResampleCache>;
+    // Get the cache for the best audio stream of 'hParser'. Instances are shared by all the callers using
+    // the same source and output format. If there is no valid cache file under 'cacheDir', it is queued for
+    // building on a small pool of threads shared by all the instances, the building stops if the instance is
+    // released before it completes. The least recently used cache files are deleted when the total size of the
+    // directory exceeds its limit. Return nullptr if the source can not be cached (e.g. not a local file).
+    static Holder GetInstance(const std::string& cacheDir, MediaParser::Holder hParser, uint32_t channels, uint32_t sampleRate);
+    static Logger::ALogger* GetLogger();
+
+    virtual bool IsReady() const = 0;
+    virtual bool IsFailed() const = 0;
+    virtual float GetBuildProgress() const = 0;
+    virtual uint32_t Channels() const = 0;
+    virtual uint32_t SampleRate() const = 0;
+    virtual int64_t TotalSamples() const = 0;
+    virtual std::string GetFilePath() const = 0;
+    // Fill the float mat 'amat' (planar or packed) with the samples starting from 'pos', samples out of the stream range are zero.
+    virtual bool ReadSamples(ImGui::ImMat& amat, int64_t pos) = 0;
+};
+}
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include "AudioTrack.h"
 #include "FFUtils.h"
+#include "MatUtils.h"
 #include "DebugHelper.h"
 extern "C"
 {
@@ -58,6 +59,8 @@ public:
         m_pcmSizePerSec = m_frameSize*m_outSampleRate;
         m_hSettings = hSettings;
         m_readClipIter = m_clips.begin();
+        m_blockPool = MatUtils::AudioBlockPool::GetDefaultInstance();
+        ResizeChannelPtrArrays();
     }
 
     Holder Clone(SharedSettings::Holder hSettings) override;
@@ -85,6 +88,7 @@ public:
         m_frameSize = m_outChannels*m_bytesPerSample;
         m_pcmSizePerSec = m_frameSize*m_outSampleRate;
         m_hSettings = hSettings;
+        ResizeChannelPtrArrays();
         for (auto& hClip : m_clips)
             hClip->UpdateSettings(hSettings);
         return true;
@@ -256,12 +260,12 @@ public:
         lock_guard<recursive_mutex> lk(m_apiLock);
         pos = (double)m_readSamples/m_outSampleRate;
         uint32_t readSamples = 0, toReadSamples = size/m_frameSize;
-        unique_ptr<uint8_t*[]> planbuf(new uint8_t* [m_outChannels]);
+        uint8_t** planbuf = m_planPtrs.data();
         for (int i = 0; i < m_outChannels; i++)
             planbuf[i] = buf+i*toReadSamples*m_bytesPerSample;
         if (m_overlaps.empty())
         {
-            readSamples = ReadClipData(planbuf.get(), toReadSamples);
+            readSamples = ReadClipData(planbuf, toReadSamples);
             size = readSamples*m_frameSize;
             return;
         }
@@ -279,7 +283,7 @@ public:
                     toReadSamples2 = (ovlp->Start()-readPosBegin)*m_outSampleRate/1000;
                     if (toReadSamples2 > toReadSamples-readSamples)
                         toReadSamples2 = toReadSamples-readSamples;
-                    readSamples2 = ReadClipData(planbuf.get(), toReadSamples2);
+                    readSamples2 = ReadClipData(planbuf, toReadSamples2);
                     readSamples += readSamples2;
                     if (m_isPlanar)
                     {
@@ -299,7 +303,7 @@ public:
                 ImGui::ImMat amat = ovlp->ReadAudioSamples(toReadSamples2, eof);
                 if (!amat.empty())
                 {
-                    CopyMatData(planbuf.get(), 0, amat);
+                    CopyMatData(planbuf, 0, amat);
                     readSamples += amat.w;
                     if (m_isPlanar)
                     {
@@ -322,7 +326,7 @@ public:
             if (readSamples < toReadSamples)
             {
                 toReadSamples2 = toReadSamples-readSamples;
-                readSamples2 = ReadClipData(planbuf.get(), toReadSamples2);
+                readSamples2 = ReadClipData(planbuf, toReadSamples2);
                 readSamples += readSamples2;
             }
         }
@@ -339,7 +343,7 @@ public:
                     toReadSamples2 = (readPosBegin-ovlp->End())*m_outSampleRate/1000;
                     if (toReadSamples2 > toReadSamples-readSamples)
                         toReadSamples2 = toReadSamples-readSamples;
-                    readSamples2 = ReadClipData(planbuf.get(), toReadSamples2);
+                    readSamples2 = ReadClipData(planbuf, toReadSamples2);
                     readSamples += readSamples2;
                     if (m_isPlanar)
                     {
@@ -359,7 +363,7 @@ public:
                 ImGui::ImMat amat = ovlp->ReadAudioSamples(toReadSamples2, eof);
                 if (!amat.empty())
                 {
-                    CopyMatData(planbuf.get(), 0, amat);
+                    CopyMatData(planbuf, 0, amat);
                     readSamples += amat.w;
                     if (m_isPlanar)
                     {
@@ -383,7 +387,7 @@ public:
             if (readSamples < toReadSamples)
             {
                 toReadSamples2 = toReadSamples-readSamples;
-                readSamples2 = ReadClipData(planbuf.get(), toReadSamples2);
+                readSamples2 = ReadClipData(planbuf, toReadSamples2);
                 readSamples += readSamples2;
             }
         }
@@ -394,21 +398,25 @@ public:
     {
         lock_guard<recursive_mutex> lk(m_apiLock);
         ImGui::ImMat amat;
-        amat.create((int)readSamples, 1, (int)OutChannels(), (size_t)m_bytesPerSample);
+        amat.create((int)readSamples, 1, (int)OutChannels(), (size_t)m_bytesPerSample, m_blockPool);
         uint32_t bufSize = amat.total()*amat.elemsize;
         while (m_cachedSamples-m_readCacheOffsetSamples < readSamples)
         {
+            // the read buffer may be cached by the effect filter in pass-through mode, so use a separate block from the output mat
+            ImGui::ImMat rdmat;
+            rdmat.create((int)readSamples, 1, (int)OutChannels(), (size_t)m_bytesPerSample, m_blockPool);
             double pos = 0;
             uint32_t readSize = bufSize;
-            ReadAudioSamples((uint8_t*)amat.data, readSize, pos);
-            amat.elempack = 1;
-            amat.rate = { (int)OutSampleRate(), 1 };
+            ReadAudioSamples((uint8_t*)rdmat.data, readSize, pos);
+            rdmat.elempack = 1;
+            rdmat.rate = { (int)OutSampleRate(), 1 };
+            rdmat.time_stamp = pos;
             amat.time_stamp = pos;
             if (readSize < bufSize)
             {
                 if (m_isPlanar)
                 {
-                    uint8_t* bufPtr = (uint8_t*)amat.data+readSize/m_outChannels;
+                    uint8_t* bufPtr = (uint8_t*)rdmat.data+readSize/m_outChannels;
                     int lineSize = readSamples*m_bytesPerSample;
                     int sizeToZero = (bufSize-readSize)/m_outChannels;
                     for (int i = 0; i < m_outChannels; i++)
@@ -419,14 +427,14 @@ public:
                 }
                 else
                 {
-                    uint8_t* bufPtr = (uint8_t*)amat.data+readSize;
+                    uint8_t* bufPtr = (uint8_t*)rdmat.data+readSize;
                     memset(bufPtr, 0, bufSize-readSize);
                 }
             }
 
             // apply audio effect(s)
             list<ImGui::ImMat> aeOutMats;
-            if (!m_aeFilter->ProcessData(amat, aeOutMats))
+            if (!m_aeFilter->ProcessData(rdmat, aeOutMats))
             {
                 m_logger->Log(Error) << "ID#" << m_id << " FAILED to invoke AudioEffectFilter::ProcessData()! Error is '" << m_aeFilter->GetError() << "'." << endl;
             }
@@ -436,14 +444,14 @@ public:
                 auto& m = *iter++;
                 if (!m.empty() && m.w > 0)
                 {
-                    m_cachedMats.push_back(m);
+                    PushCachedMat(m);
                     m_cachedSamples += (uint32_t)m.w;
-                }                         
+                }
             }
         }
 
         uint32_t copiedSamples = 0;
-        unique_ptr<uint8_t*[]> dstbufs(new uint8_t* [m_outChannels]);
+        uint8_t** dstbufs = m_dstPtrs.data();
         if (m_isPlanar)
         {
             int dstLineSize = readSamples*m_bytesPerSample;
@@ -454,10 +462,10 @@ public:
         {
             dstbufs[0] = (uint8_t*)amat.data;
         }
+        const uint8_t** srcbufs = (const uint8_t**)m_srcPtrs.data();
         while (copiedSamples < readSamples)
         {
             auto& srcmat = m_cachedMats.front();
-            unique_ptr<const uint8_t*[]> srcbufs(new const uint8_t* [m_outChannels]);
             if (m_isPlanar)
             {
                 int srcLineSize = srcmat.w*m_bytesPerSample;
@@ -472,17 +480,19 @@ public:
             if (toCopySamples > (uint32_t)srcmat.w-m_readCacheOffsetSamples)
                 toCopySamples = (uint32_t)srcmat.w-m_readCacheOffsetSamples;
             uint32_t copied = FFUtils::CopyPcmDataEx((uint8_t)m_outChannels, m_bytesPerSample, toCopySamples,
-                m_isPlanar, dstbufs.get(), copiedSamples, m_isPlanar, srcbufs.get(), m_readCacheOffsetSamples);
+                m_isPlanar, dstbufs, copiedSamples, m_isPlanar, srcbufs, m_readCacheOffsetSamples);
             copiedSamples += copied;
             m_readCacheOffsetSamples += copied;
             if (m_readCacheOffsetSamples >= (uint32_t)srcmat.w)
             {
                 m_cachedSamples -= (uint32_t)srcmat.w;
-                m_cachedMats.pop_front();
+                PopCachedMat();
                 m_readCacheOffsetSamples = 0;
             }
         }
 
+        amat.elempack = 1;
+        amat.rate = { (int)OutSampleRate(), 1 };
         return amat;
     }
 
@@ -934,7 +944,7 @@ private:
             }
             else
             {
-                unique_ptr<uint8_t*[]> dstlinebuf(new uint8_t* [m_outChannels]);
+                uint8_t** dstlinebuf = m_linePtrs.data();
                 for (int i = 0; i < m_outChannels; i++)
                     dstlinebuf[i] = dstbuf[i]+dstOffset;
                 uint8_t* srcptr = (uint8_t*)srcmat.data;
@@ -954,7 +964,7 @@ private:
             if (srcmat.elempack == 1 && m_outChannels != 1)
             {
                 uint8_t* dstptr = dstbuf[0]+dstOffset;
-                unique_ptr<uint8_t*[]> srclinebuf(new uint8_t* [m_outChannels]);
+                uint8_t** srclinebuf = m_linePtrs.data();
                 for (int i = 0; i < m_outChannels; i++)
                     srclinebuf[i] = (uint8_t*)srcmat.data+i*srcmat.w*m_bytesPerSample;
                 for (int j = 0; j < srcmat.w; j++)
@@ -974,6 +984,34 @@ private:
         }
     }
 
+    void ResizeChannelPtrArrays()
+    {
+        m_planPtrs.resize(m_outChannels);
+        m_srcPtrs.resize(m_outChannels);
+        m_dstPtrs.resize(m_outChannels);
+        m_linePtrs.resize(m_outChannels);
+    }
+
+    // recycle the list nodes of 'm_cachedMats' through 'm_spareCacheNodes', avoiding node allocation on every read
+    void PushCachedMat(const ImGui::ImMat& m)
+    {
+        if (m_spareCacheNodes.empty())
+        {
+            m_cachedMats.push_back(m);
+        }
+        else
+        {
+            m_cachedMats.splice(m_cachedMats.end(), m_spareCacheNodes, m_spareCacheNodes.begin());
+            m_cachedMats.back() = m;
+        }
+    }
+
+    void PopCachedMat()
+    {
+        m_cachedMats.front().release();
+        m_spareCacheNodes.splice(m_spareCacheNodes.end(), m_cachedMats, m_cachedMats.begin());
+    }
+
 private:
     ALogger* m_logger;
     int64_t m_id;
@@ -993,11 +1031,17 @@ private:
     int64_t m_readSamples{0};
     int64_t m_duration{0};
     list<ImGui::ImMat> m_cachedMats;
+    list<ImGui::ImMat> m_spareCacheNodes;
     int64_t m_cachedSamples{0};
     uint32_t m_readCacheOffsetSamples{0};
     bool m_readForward{true};
     bool m_isPlanar{true};
     AudioEffectFilter::Holder m_aeFilter;
+    MatUtils::AudioBlockPool* m_blockPool;
+    vector<uint8_t*> m_planPtrs;
+    vector<uint8_t*> m_srcPtrs;
+    vector<uint8_t*> m_dstPtrs;
+    vector<uint8_t*> m_linePtrs;
 };
 
 static const function<void(AudioTrack*)> AUDIO_TRACK_HOLDER_DELETER = [] (AudioTrack* p) {
@@ -0,0 +1,241 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+
+namespace MediaCore
+{
+// A counter which can be waited for its change. Used to wake up a pipeline stage when the stage it depends on
+// made progress, instead of polling with sleeps. The mutex is only taken when there is someone waiting.
+class PipelineEvent
+{
+public:
+    uint64_t Generation() const { return m_generation.load(); }
+
+    void Notify()
+    {
+        m_generation++;
+        if (m_waiters.load() > 0)
+        {
+            std::lock_guard<std::mutex> lk(m_waitLock);
+            m_waitCv.notify_all();
+        }
+    }
+
+    // Block until the generation differs from 'generation' or 'abort()' returns true.
+    // Return the time spent in waiting, in microseconds.
+    template <typename Pred>
+    int64_t WaitChange(uint64_t generation, Pred abort)
+    {
+        if (m_generation.load() != generation || abort())
+            return 0;
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lk(m_waitLock);
+            m_waiters++;
+            m_waitCv.wait(lk, [&] { return m_generation.load() != generation || abort(); });
+            m_waiters--;
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-t0).count();
+    }
+
+private:
+    std::atomic<uint64_t> m_generation{0};
+    std::atomic<int32_t> m_waiters{0};
+    std::mutex m_waitLock;
+    std::condition_variable m_waitCv;
+};
+
+// Single-producer single-consumer ring buffer with a fixed capacity. 'TryPush()' and 'TryPop()' never block,
+// 'WaitPush()' and 'WaitPop()' block on a condition variable until there is space or data. The depth and the
+// time the producer or the consumer has been blocked are accumulated as statistics.
+template <typename T>
+class BoundedQueue
+{
+public:
+    struct Statistics
+    {
+        uint32_t capacity{0};
+        uint32_t maxDepth{0};
+        double avgDepth{0};         // sampled at each push
+        int64_t pushCount{0};
+        int64_t pushStallUs{0};     // time the producer waited for free space
+        int64_t popStallUs{0};      // time the consumer waited for data
+    };
+
+    explicit BoundedQueue(uint32_t capacity = 2) { Reset(capacity); }
+
+    // Not thread-safe, only call it when neither the producer nor the consumer is running.
+    void Reset(uint32_t capacity)
+    {
+        if (capacity < 1)
+            capacity = 1;
+        m_slots.clear();
+        m_slots.resize(capacity+1);
+        m_head.store(0);
+        m_tail.store(0);
+        m_depthSum = 0;
+        m_maxDepth = 0;
+        m_pushCount = 0;
+        m_pushStallUs = 0;
+        m_popStallUs = 0;
+    }
+
+    uint32_t Capacity() const { return (uint32_t)m_slots.size()-1; }
+    uint32_t Size() const
+    {
+        const auto tail = m_tail.load(std::memory_order_acquire);
+        const auto head = m_head.load(std::memory_order_acquire);
+        return (uint32_t)(tail >= head ? tail-head : tail+m_slots.size()-head);
+    }
+    bool Empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+    bool Full() const { return Next(m_tail.load(std::memory_order_acquire)) == m_head.load(std::memory_order_acquire); }
+
+    bool TryPush(const T& item)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        const auto next = Next(tail);
+        if (next == m_head.load(std::memory_order_acquire))
+            return false;
+        m_slots[tail] = item;
+        m_tail.store(next, std::memory_order_release);
+        UpdateDepthStats();
+        WakeUp();
+        return true;
+    }
+
+    bool TryPop(T& item)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        item = std::move(m_slots[head]);
+        m_slots[head] = T();
+        m_head.store(Next(head), std::memory_order_release);
+        WakeUp();
+        return true;
+    }
+
+    // Block until 'item' is pushed, or 'abort()' returns true. Return false if aborted.
+    template <typename Pred>
+    bool WaitPush(const T& item, Pred abort)
+    {
+        while (!TryPush(item))
+        {
+            if (abort())
+                return false;
+            m_pushStallUs += Wait([this, &abort] { return !Full() || abort(); });
+        }
+        return true;
+    }
+
+    // Block until an item is popped, or 'stop()' returns true and the queue is empty. Return false if nothing is popped.
+    template <typename Pred>
+    bool WaitPop(T& item, Pred stop)
+    {
+        while (!TryPop(item))
+        {
+            if (stop())
+                return TryPop(item);  // the last items may be pushed right before the stop condition is set
+            m_popStallUs += Wait([this, &stop] { return !Empty() || stop(); });
+        }
+        return true;
+    }
+
+    // Wake up the blocked producer and consumer to re-check their abort conditions.
+    void NotifyAll()
+    {
+        std::lock_guard<std::mutex> lk(m_waitLock);
+        m_waitCv.notify_all();
+    }
+
+    void Clear()
+    {
+        T item;
+        while (TryPop(item));
+    }
+
+    // Can be called from any thread while the queue is in use
+    Statistics GetStatistics() const
+    {
+        Statistics stats;
+        stats.capacity = Capacity();
+        stats.maxDepth = m_maxDepth.load();
+        stats.pushCount = m_pushCount.load();
+        stats.pushStallUs = m_pushStallUs.load();
+        stats.popStallUs = m_popStallUs.load();
+        stats.avgDepth = stats.pushCount > 0 ? (double)m_depthSum.load()/stats.pushCount : 0;
+        return stats;
+    }
+
+private:
+    size_t Next(size_t idx) const { return idx+1 < m_slots.size() ? idx+1 : 0; }
+
+    void UpdateDepthStats()
+    {
+        // only the producer updates them, the atomics are for the readers of the statistics
+        const auto depth = Size();
+        if (depth > m_maxDepth.load(std::memory_order_relaxed))
+            m_maxDepth.store(depth, std::memory_order_relaxed);
+        m_depthSum.fetch_add(depth, std::memory_order_relaxed);
+        m_pushCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void WakeUp()
+    {
+        // order the index update before reading the waiter count, pairs with the increment in 'Wait()'
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_waiters.load() > 0)
+        {
+            std::lock_guard<std::mutex> lk(m_waitLock);
+            m_waitCv.notify_all();
+        }
+    }
+
+    template <typename Pred>
+    int64_t Wait(Pred ready)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        {
+            std::unique_lock<std::mutex> lk(m_waitLock);
+            m_waiters++;
+            m_waitCv.wait(lk, ready);
+            m_waiters--;
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-t0).count();
+    }
+
+private:
+    std::vector<T> m_slots;
+    std::atomic<size_t> m_head{0};
+    std::atomic<size_t> m_tail{0};
+    std::atomic<int32_t> m_waiters{0};
+    std::mutex m_waitLock;
+    std::condition_variable m_waitCv;
+    std::atomic<int64_t> m_depthSum{0};
+    std::atomic<uint32_t> m_maxDepth{0};
+    std::atomic<int64_t> m_pushCount{0};
+    std::atomic<int64_t> m_pushStallUs{0};
+    std::atomic<int64_t> m_popStallUs{0};
+};
+}
@@ -1298,6 +1298,22 @@ bool ImMatToAVFrameConverter::SetResizeInterpolateMode(ImInterpolateMode interp)
     return true;
 }
 
+bool ImMatToAVFrameConverter::SetSwsThreadCount(uint32_t count)
+{
+    if (count < 1)
+        count = 1;
+    if (m_swsThreads == count)
+        return true;
+    m_swsThreads = count;
+
+    if (m_swsCtx)
+    {
+        sws_freeContext(m_swsCtx);
+        m_swsCtx = nullptr;
+    }
+    return true;
+}
+
 bool ImMatToAVFrameConverter::ConvertImage(const ImGui::ImMat& vmat, AVFrame* avfrm, int64_t pts)
 {
     ImGui::ImMat inMat = vmat;
@@ -1399,7 +1415,31 @@ bool ImMatToAVFrameConverter::ConvertImage(const ImGui::ImMat& vmat, AVFrame* av
             sws_freeContext(m_swsCtx);
             m_swsCtx = nullptr;
         }
-        m_swsCtx = sws_getContext(inMat.w, inMat.h, cvtPixfmt, outWidth, outHeight, m_outPixfmt, m_swsFlags, nullptr, nullptr, nullptr);
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+        if (m_swsThreads > 1)
+        {
+            // slice threading is only available through the AVOptions of the context
+            m_swsCtx = sws_alloc_context();
+            if (m_swsCtx)
+            {
+                av_opt_set_int(m_swsCtx, "srcw", inMat.w, 0);
+                av_opt_set_int(m_swsCtx, "srch", inMat.h, 0);
+                av_opt_set_int(m_swsCtx, "src_format", cvtPixfmt, 0);
+                av_opt_set_int(m_swsCtx, "dstw", outWidth, 0);
+                av_opt_set_int(m_swsCtx, "dsth", outHeight, 0);
+                av_opt_set_int(m_swsCtx, "dst_format", m_outPixfmt, 0);
+                av_opt_set_int(m_swsCtx, "sws_flags", m_swsFlags, 0);
+                av_opt_set_int(m_swsCtx, "threads", m_swsThreads, 0);
+                if (sws_init_context(m_swsCtx, nullptr, nullptr) < 0)
+                {
+                    sws_freeContext(m_swsCtx);
+                    m_swsCtx = nullptr;
+                }
+            }
+        }
+#endif
+        if (!m_swsCtx)
+            m_swsCtx = sws_getContext(inMat.w, inMat.h, cvtPixfmt, outWidth, outHeight, m_outPixfmt, m_swsFlags, nullptr, nullptr, nullptr);
         if (!m_swsCtx)
         {
             ostringstream oss;
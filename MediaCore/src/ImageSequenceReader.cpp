@@ -22,6 +22,11 @@
 #include <functional>
 #include <list>
 #include <algorithm>
+#include <fcntl.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
 #include "MediaReader.h"
 #include "FFUtils.h"
 #include "ThreadUtils.h"
@@ -37,6 +42,10 @@ using namespace Logger;
 
 namespace MediaCore
 {
+// the default count of the image decoding workers is half of the hardware concurrency, within this range
+static const uint32_t MIN_DEFAULT_DECODE_WORKERS = 4;
+static const uint32_t MAX_DEFAULT_DECODE_WORKERS = 16;
+
 class ImageSequenceReader_Impl : public MediaReader
 {
 public:
@@ -113,8 +122,7 @@ public:
         m_outClrFmt = outClrfmt;
         m_outDtype = outDtype;
         m_interpMode = rszInterp;
-        for (auto i = 0; i < m_decWorkerCount; i++)
-            m_decCtxs.push_back(DecodeImageContext::Holder(new DecodeImageContext(this)));
+        CreateDecodeContexts();
 
         m_configured = true;
         return true;
@@ -140,8 +148,7 @@ public:
         m_outClrFmt = outClrfmt;
         m_outDtype = outDtype;
         m_interpMode = rszInterp;
-        for (auto i = 0; i < m_decWorkerCount; i++)
-            m_decCtxs.push_back(DecodeImageContext::Holder(new DecodeImageContext(this)));
+        CreateDecodeContexts();
 
         m_configured = true;
         return true;
@@ -525,6 +532,19 @@ public:
         return true;
     }
 
+    bool SetImageDecodeParallelism(uint32_t workerCount, uint32_t readaheadFrames) override
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (m_configured)
+        {
+            m_errMsg = "Can NOT change the decode parallelism after the 'ImageSequenceReader' is configured!";
+            return false;
+        }
+        m_decWorkerCount = workerCount;
+        m_readaheadFrames = (int32_t)readaheadFrames;
+        return true;
+    }
+
     pair<double, double> GetCacheDuration() const override
     {
         throw runtime_error("This interface is NOT SUPPORTED by ImageSequenceReader!");
@@ -1018,6 +1038,7 @@ private:
         bool decodeStarted{false};
         bool decodeFailed{false};
         bool discarded{false};
+        bool filePrefetched{false};
         string imageFilePath;
     };
 
@@ -1027,7 +1048,10 @@ private:
     {
         lock_guard<mutex> _lk(m_cacheRangeLock);
         m_readPts = readPts;
-        const auto cacheFrameCount = m_bInSeekingMode ? pair<int32_t, int32_t>(0, 0) : m_cacheFrameCount;
+        auto cacheFrameCount = m_bInSeekingMode ? pair<int32_t, int32_t>(0, 0) : m_cacheFrameCount;
+        // read ahead only for the continuous reading, a reader configured with zero cache is used for random access
+        if (!m_bInSeekingMode && (cacheFrameCount.first > 0 || cacheFrameCount.second > 0))
+            cacheFrameCount.second += m_readaheadFrames;
         if (m_readForward)
         {
             m_cacheRange.first = readPts-cacheFrameCount.first*m_vidfrmIntvPts;
@@ -1055,6 +1079,46 @@ private:
         return av_rescale_q_rnd(pts, m_vidTimeBase, MILLISEC_TIMEBASE, AV_ROUND_DOWN);
     }
 
+    void CreateDecodeContexts()
+    {
+        if (m_decWorkerCount == 0)
+        {
+            m_decWorkerCount = thread::hardware_concurrency()/2;
+            if (m_decWorkerCount < MIN_DEFAULT_DECODE_WORKERS)
+                m_decWorkerCount = MIN_DEFAULT_DECODE_WORKERS;
+            else if (m_decWorkerCount > MAX_DEFAULT_DECODE_WORKERS)
+                m_decWorkerCount = MAX_DEFAULT_DECODE_WORKERS;
+        }
+        m_decCtxs.clear();
+        for (uint32_t i = 0; i < m_decWorkerCount; i++)
+            m_decCtxs.push_back(DecodeImageContext::Holder(new DecodeImageContext(this)));
+        m_logger->Log(DEBUG) << "Created " << m_decWorkerCount << " image decoding workers, readahead " << m_readaheadFrames << " frames." << endl;
+    }
+
+    // Hint the OS to load the image file into the page cache, so opening it by a decoding worker later won't wait on the disk.
+    void PrefetchImageFile(const string& filePath)
+    {
+#if !defined(_WIN32)
+        int fd = open(filePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return;
+#if defined(POSIX_FADV_WILLNEED)
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+#elif defined(F_RDADVISE)
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            struct radvisory ra;
+            ra.ra_offset = 0;
+            ra.ra_count = st.st_size > INT32_MAX ? INT32_MAX : (int)st.st_size;
+            fcntl(fd, F_RDADVISE, &ra);
+        }
+#endif
+        close(fd);
+#endif
+    }
+
     void StartAllThreads()
     {
         string fileName = SysUtils::ExtractFileName(m_hParser->GetUrl());
@@ -1238,6 +1302,7 @@ private:
                     }
                     pVfrm->imageFilePath = m_hFileIter->JoinBaseDirPath(filePath);
                 }
+                bool decodeStarted = false;
                 for (auto& hDecCtx : m_decCtxs)
                 {
                     if (!hDecCtx->isBusy)
@@ -1251,10 +1316,18 @@ private:
                         pVfrm->hDecCtx = hDecCtx;
                         m_logger->Log(DEBUG) << "-> StartDecode[idx=" << fileIndex << ", pos=" << pVfrm->pos << "]: '" << pVfrm->imageFilePath << "'" << endl;
                         hDecCtx->StartDecode(hVfrm);
+                        decodeStarted = true;
                         idleLoop = false;
                         break;
                     }
                 }
+                // all the workers are busy, warm up the file of this frame for the next free one
+                if (!decodeStarted && !pVfrm->filePrefetched)
+                {
+                    PrefetchImageFile(pVfrm->imageFilePath);
+                    pVfrm->filePrefetched = true;
+                    idleLoop = false;
+                }
             }
 
             if (idleLoop)
@@ -1413,7 +1486,8 @@ private:
     VideoFrame::Holder m_hSeekingFlash;
 
     list<DecodeImageContext::Holder> m_decCtxs;
-    uint8_t m_decWorkerCount{4};
+    uint32_t m_decWorkerCount{0};
+    int32_t m_readaheadFrames{0};
     bool m_vidPreferUseHw{true};
     FFUtils::OpenVideoDecoderOptions m_viddecOpenOpts;
     AVHWDeviceType m_vidUseHwType{AV_HWDEVICE_TYPE_NONE};
@@ -0,0 +1,617 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <sstream>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LOUDNESS_METER_USE_SSE2
+#include <emmintrin.h>
+#endif
+#include "LoudnessMeter.h"
+
+using namespace std;
+using namespace Logger;
+
+namespace MediaCore
+{
+static const double ABSOLUTE_GATE_LUFS = -70.;
+static const double RELATIVE_GATE_LU = -10.;
+static const uint32_t MOMENTARY_SUBBLOCKS = 4;      // 400ms window, 100ms hop
+static const uint32_t SHORTTERM_SUBBLOCKS = 30;     // 3s window
+static const uint32_t TRUEPEAK_TAPS = 12;
+static const uint32_t TRUEPEAK_PHASES = 4;
+static const double DENORMAL_THRESHOLD = 1e-30;
+
+// The 48-tap interpolation filter from ITU-R BS.1770-4 Annex 2, split into its 4 phases for 4x oversampling.
+static const float TRUEPEAK_COEFFS[TRUEPEAK_PHASES][TRUEPEAK_TAPS] = {
+    {  0.0017089843750f,  0.0109863281250f, -0.0196533203125f,  0.0332031250000f, -0.0594482421875f,  0.1373291015625f,
+       0.9721679687500f, -0.1022949218750f,  0.0476074218750f, -0.0266113281250f,  0.0148925781250f, -0.0083007812500f },
+    { -0.0291748046875f,  0.0292968750000f, -0.0517578125000f,  0.0891113281250f, -0.1665039062500f,  0.4650878906250f,
+       0.7797851562500f, -0.2003173828125f,  0.1015625000000f, -0.0582275390625f,  0.0330810546875f, -0.0189208984375f },
+    { -0.0189208984375f,  0.0330810546875f, -0.0582275390625f,  0.1015625000000f, -0.2003173828125f,  0.7797851562500f,
+       0.4650878906250f, -0.1665039062500f,  0.0891113281250f, -0.0517578125000f,  0.0292968750000f, -0.0291748046875f },
+    { -0.0083007812500f,  0.0148925781250f, -0.0266113281250f,  0.0476074218750f, -0.1022949218750f,  0.9721679687500f,
+       0.1373291015625f, -0.0594482421875f,  0.0332031250000f, -0.0196533203125f,  0.0109863281250f,  0.0017089843750f },
+};
+
+static inline double EnergyToLufs(double energy)
+{
+    return energy > 0 ? -0.691+10.*log10(energy) : -numeric_limits<double>::infinity();
+}
+
+static inline double LufsToEnergy(double lufs)
+{
+    return pow(10., (lufs+0.691)/10.);
+}
+
+static inline double AmplitudeToDb(double amp)
+{
+    return amp > 0 ? 20.*log10(amp) : -numeric_limits<double>::infinity();
+}
+
+class LoudnessMeter_Impl : public LoudnessMeter
+{
+public:
+    LoudnessMeter_Impl(uint32_t channels, uint32_t sampleRate)
+        : m_channels(channels), m_sampleRate(sampleRate)
+    {
+        m_logger = LoudnessMeter::GetLogger();
+        SetupKWeightingFilter();
+        m_chWeights.assign(m_channels, 1.);
+        // BS.1770 weights for 5.1 in ffmpeg channel order (FL FR FC LFE BL BR): LFE is ignored, surrounds are +1.5dB
+        if (m_channels == 6)
+        {
+            m_chWeights[3] = 0.;
+            m_chWeights[4] = m_chWeights[5] = 1.41;
+        }
+        // filter states are stored in channel pairs, so the vectorized loop never needs a tail
+        const uint32_t paddedChannels = (m_channels+1)&~1u;
+        for (auto& z : m_filterStates)
+            z.assign(paddedChannels, 0.);
+        m_sumSquares.assign(paddedChannels, 0.);
+        m_tpHistory.assign(m_channels*TRUEPEAK_TAPS*2, 0.f);
+        m_tpHistoryPos.assign(m_channels, 0);
+        for (uint32_t t = 0; t < TRUEPEAK_TAPS; t++)
+            for (uint32_t p = 0; p < TRUEPEAK_PHASES; p++)
+                m_tpCoeffsT[t*TRUEPEAK_PHASES+p] = TRUEPEAK_COEFFS[p][TRUEPEAK_TAPS-1-t];
+        m_subblockSamples = (m_sampleRate+5)/10;
+        m_subblockEnergies.assign(SHORTTERM_SUBBLOCKS, 0.);
+        m_chPtrs.resize(m_channels);
+        Reset();
+    }
+
+    LoudnessMeter_Impl(const LoudnessMeter_Impl&) = delete;
+    LoudnessMeter_Impl(LoudnessMeter_Impl&&) = delete;
+    LoudnessMeter_Impl& operator=(const LoudnessMeter_Impl&) = delete;
+
+    bool ProcessSamples(const ImGui::ImMat& amat) override
+    {
+        if (amat.empty())
+            return true;
+        if (amat.type != IM_DT_FLOAT32)
+        {
+            m_errMsg = "Only float32 pcm is supported by LoudnessMeter!";
+            return false;
+        }
+        if ((uint32_t)amat.c != m_channels)
+        {
+            ostringstream oss; oss << "Channel count of the input mat (" << amat.c << ") does NOT MATCH the meter (" << m_channels << ")!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        const bool isPlanar = amat.elempack == 1 || amat.c == 1;
+        const float* data = (const float*)amat.data;
+        for (uint32_t ch = 0; ch < m_channels; ch++)
+            m_chPtrs[ch] = isPlanar ? data+ch*amat.w : data+ch;
+        Process(m_chPtrs.data(), isPlanar ? 1 : m_channels, amat.w);
+        return true;
+    }
+
+    bool ProcessSamples(const float* const* planes, uint32_t sampleCount) override
+    {
+        if (!planes)
+        {
+            m_errMsg = "Argument 'planes' is NULL!";
+            return false;
+        }
+        Process(planes, 1, sampleCount);
+        return true;
+    }
+
+    void Reset() override
+    {
+        for (auto& z : m_filterStates)
+            fill(z.begin(), z.end(), 0.);
+        fill(m_sumSquares.begin(), m_sumSquares.end(), 0.);
+        fill(m_tpHistory.begin(), m_tpHistory.end(), 0.f);
+        fill(m_tpHistoryPos.begin(), m_tpHistoryPos.end(), 0);
+        m_subblockPos = 0;
+
+        lock_guard<mutex> lk(m_measureLock);
+        fill(m_subblockEnergies.begin(), m_subblockEnergies.end(), 0.);
+        m_subblockCount = 0;
+        m_gatingBlocks.clear();
+        m_momentary = m_shortTerm = -numeric_limits<double>::infinity();
+        m_maxMomentary = m_maxShortTerm = -numeric_limits<double>::infinity();
+        m_truePeak = 0.;
+        m_sampleCount = 0;
+    }
+
+    Measurement GetMeasurement() const override
+    {
+        lock_guard<mutex> lk(m_measureLock);
+        Measurement m;
+        m.integrated = CalcIntegratedLoudness();
+        m.momentary = m_momentary;
+        m.shortTerm = m_shortTerm;
+        m.maxMomentary = m_maxMomentary;
+        m.maxShortTerm = m_maxShortTerm;
+        m.truePeak = AmplitudeToDb(m_truePeak);
+        m.sampleCount = m_sampleCount;
+        return m;
+    }
+
+    uint32_t GetChannels() const override
+    {
+        return m_channels;
+    }
+
+    uint32_t GetSampleRate() const override
+    {
+        return m_sampleRate;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+private:
+    void SetupKWeightingFilter()
+    {
+        // stage 1, high-shelf 'pre-filter' (coefficients derived for any sample rate, matching BS.1770 at 48kHz)
+        double f0 = 1681.974450955533;
+        const double G = 3.999843853973347;
+        double Q = 0.7071752369554196;
+        double K = tan(M_PI*f0/m_sampleRate);
+        const double Vh = pow(10., G/20.);
+        const double Vb = pow(Vh, 0.4996667741545416);
+        double a0 = 1.+K/Q+K*K;
+        m_b1[0] = (Vh+Vb*K/Q+K*K)/a0;
+        m_b1[1] = 2.*(K*K-Vh)/a0;
+        m_b1[2] = (Vh-Vb*K/Q+K*K)/a0;
+        m_a1[0] = 2.*(K*K-1.)/a0;
+        m_a1[1] = (1.-K/Q+K*K)/a0;
+        // stage 2, 'RLB' high-pass
+        f0 = 38.13547087602444;
+        Q = 0.5003270373238773;
+        K = tan(M_PI*f0/m_sampleRate);
+        a0 = 1.+K/Q+K*K;
+        m_b2[0] = 1.;
+        m_b2[1] = -2.;
+        m_b2[2] = 1.;
+        m_a2[0] = 2.*(K*K-1.)/a0;
+        m_a2[1] = (1.-K/Q+K*K)/a0;
+    }
+
+    void Process(const float* const* chPtrs, uint32_t stride, uint32_t sampleCount)
+    {
+        uint32_t offset = 0;
+        while (offset < sampleCount)
+        {
+            const uint32_t count = min(sampleCount-offset, m_subblockSamples-m_subblockPos);
+            KWeightAndAccumulate(chPtrs, stride, offset, count);
+            const float peak = MeasureTruePeak(chPtrs, stride, offset, count);
+            offset += count;
+            m_subblockPos += count;
+            {
+                lock_guard<mutex> lk(m_measureLock);
+                if (peak > m_truePeak)
+                    m_truePeak = peak;
+                m_sampleCount += count;
+            }
+            if (m_subblockPos >= m_subblockSamples)
+                FinishSubblock();
+        }
+    }
+
+#ifdef LOUDNESS_METER_USE_SSE2
+    // Two channels are filtered in the lanes of one register, in double precision since the high-pass pole is very close to 1.
+    void KWeightAndAccumulate(const float* const* chPtrs, uint32_t stride, uint32_t offset, uint32_t count)
+    {
+        const __m128d b10 = _mm_set1_pd(m_b1[0]), b11 = _mm_set1_pd(m_b1[1]), b12 = _mm_set1_pd(m_b1[2]);
+        const __m128d a11 = _mm_set1_pd(m_a1[0]), a12 = _mm_set1_pd(m_a1[1]);
+        const __m128d a21 = _mm_set1_pd(m_a2[0]), a22 = _mm_set1_pd(m_a2[1]);
+        for (uint32_t ch = 0; ch < m_channels; ch += 2)
+        {
+            const float* p0 = chPtrs[ch]+offset*stride;
+            const float* p1 = ch+1 < m_channels ? chPtrs[ch+1]+offset*stride : nullptr;
+            __m128d z11 = _mm_loadu_pd(&m_filterStates[0][ch]);
+            __m128d z12 = _mm_loadu_pd(&m_filterStates[1][ch]);
+            __m128d z21 = _mm_loadu_pd(&m_filterStates[2][ch]);
+            __m128d z22 = _mm_loadu_pd(&m_filterStates[3][ch]);
+            __m128d acc = _mm_loadu_pd(&m_sumSquares[ch]);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const size_t idx = (size_t)i*stride;
+                const __m128d x = _mm_set_pd(p1 ? p1[idx] : 0., p0[idx]);
+                const __m128d y1 = _mm_add_pd(_mm_mul_pd(b10, x), z11);
+                z11 = _mm_add_pd(_mm_sub_pd(_mm_mul_pd(b11, x), _mm_mul_pd(a11, y1)), z12);
+                z12 = _mm_sub_pd(_mm_mul_pd(b12, x), _mm_mul_pd(a12, y1));
+                // the RLB numerator is (1, -2, 1)
+                const __m128d y2 = _mm_add_pd(y1, z21);
+                z21 = _mm_sub_pd(_mm_sub_pd(_mm_sub_pd(z22, y1), y1), _mm_mul_pd(a21, y2));
+                z22 = _mm_sub_pd(y1, _mm_mul_pd(a22, y2));
+                acc = _mm_add_pd(acc, _mm_mul_pd(y2, y2));
+            }
+            _mm_storeu_pd(&m_filterStates[0][ch], z11);
+            _mm_storeu_pd(&m_filterStates[1][ch], z12);
+            _mm_storeu_pd(&m_filterStates[2][ch], z21);
+            _mm_storeu_pd(&m_filterStates[3][ch], z22);
+            _mm_storeu_pd(&m_sumSquares[ch], acc);
+        }
+    }
+
+    float MeasureTruePeak(const float* const* chPtrs, uint32_t stride, uint32_t offset, uint32_t count)
+    {
+        __m128 coeffs[TRUEPEAK_TAPS];
+        for (uint32_t t = 0; t < TRUEPEAK_TAPS; t++)
+            coeffs[t] = _mm_loadu_ps(&m_tpCoeffsT[t*TRUEPEAK_PHASES]);
+        const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 peak = _mm_setzero_ps();
+        for (uint32_t ch = 0; ch < m_channels; ch++)
+        {
+            const float* p = chPtrs[ch]+offset*stride;
+            float* hist = &m_tpHistory[ch*TRUEPEAK_TAPS*2];
+            uint32_t pos = m_tpHistoryPos[ch];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const float x = p[(size_t)i*stride];
+                hist[pos] = hist[pos+TRUEPEAK_TAPS] = x;
+                pos = pos+1 < TRUEPEAK_TAPS ? pos+1 : 0;
+                const float* w = hist+pos;
+                // 4 interpolated samples per input sample, one per lane
+                __m128 acc = _mm_mul_ps(_mm_set1_ps(w[0]), coeffs[0]);
+                for (uint32_t t = 1; t < TRUEPEAK_TAPS; t++)
+                    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(w[t]), coeffs[t]));
+                peak = _mm_max_ps(peak, _mm_and_ps(acc, absMask));
+                peak = _mm_max_ps(peak, _mm_and_ps(_mm_set1_ps(x), absMask));
+            }
+            m_tpHistoryPos[ch] = pos;
+        }
+        float lanes[4];
+        _mm_storeu_ps(lanes, peak);
+        return max(max(lanes[0], lanes[1]), max(lanes[2], lanes[3]));
+    }
+#else
+    void KWeightAndAccumulate(const float* const* chPtrs, uint32_t stride, uint32_t offset, uint32_t count)
+    {
+        for (uint32_t ch = 0; ch < m_channels; ch++)
+        {
+            const float* p = chPtrs[ch]+offset*stride;
+            double z11 = m_filterStates[0][ch], z12 = m_filterStates[1][ch];
+            double z21 = m_filterStates[2][ch], z22 = m_filterStates[3][ch];
+            double acc = m_sumSquares[ch];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const double x = p[(size_t)i*stride];
+                const double y1 = m_b1[0]*x+z11;
+                z11 = m_b1[1]*x-m_a1[0]*y1+z12;
+                z12 = m_b1[2]*x-m_a1[1]*y1;
+                const double y2 = y1+z21;
+                z21 = z22-2.*y1-m_a2[0]*y2;
+                z22 = y1-m_a2[1]*y2;
+                acc += y2*y2;
+            }
+            m_filterStates[0][ch] = z11; m_filterStates[1][ch] = z12;
+            m_filterStates[2][ch] = z21; m_filterStates[3][ch] = z22;
+            m_sumSquares[ch] = acc;
+        }
+    }
+
+    float MeasureTruePeak(const float* const* chPtrs, uint32_t stride, uint32_t offset, uint32_t count)
+    {
+        float peak = 0.f;
+        for (uint32_t ch = 0; ch < m_channels; ch++)
+        {
+            const float* p = chPtrs[ch]+offset*stride;
+            float* hist = &m_tpHistory[ch*TRUEPEAK_TAPS*2];
+            uint32_t pos = m_tpHistoryPos[ch];
+            for (uint32_t i = 0; i < count; i++)
+            {
+                const float x = p[(size_t)i*stride];
+                hist[pos] = hist[pos+TRUEPEAK_TAPS] = x;
+                pos = pos+1 < TRUEPEAK_TAPS ? pos+1 : 0;
+                const float* w = hist+pos;
+                float acc[TRUEPEAK_PHASES] = {0};
+                for (uint32_t t = 0; t < TRUEPEAK_TAPS; t++)
+                    for (uint32_t ph = 0; ph < TRUEPEAK_PHASES; ph++)
+                        acc[ph] += w[t]*m_tpCoeffsT[t*TRUEPEAK_PHASES+ph];
+                for (uint32_t ph = 0; ph < TRUEPEAK_PHASES; ph++)
+                    peak = max(peak, fabs(acc[ph]));
+                peak = max(peak, fabs(x));
+            }
+            m_tpHistoryPos[ch] = pos;
+        }
+        return peak;
+    }
+#endif
+
+    void FinishSubblock()
+    {
+        double energy = 0.;
+        for (uint32_t ch = 0; ch < m_channels; ch++)
+        {
+            energy += m_chWeights[ch]*m_sumSquares[ch];
+            m_sumSquares[ch] = 0.;
+        }
+        energy /= m_subblockSamples;
+        m_subblockPos = 0;
+        // keep the recursive filters out of the denormal range during long silence
+        for (auto& z : m_filterStates)
+            for (auto& v : z)
+                if (fabs(v) < DENORMAL_THRESHOLD)
+                    v = 0.;
+
+        lock_guard<mutex> lk(m_measureLock);
+        m_subblockEnergies[m_subblockCount%SHORTTERM_SUBBLOCKS] = energy;
+        m_subblockCount++;
+        if (m_subblockCount >= MOMENTARY_SUBBLOCKS)
+        {
+            const double blockEnergy = AverageLastSubblocks(MOMENTARY_SUBBLOCKS);
+            m_momentary = EnergyToLufs(blockEnergy);
+            if (m_momentary > m_maxMomentary)
+                m_maxMomentary = m_momentary;
+            if (m_momentary > ABSOLUTE_GATE_LUFS)
+                m_gatingBlocks.push_back(blockEnergy);
+        }
+        if (m_subblockCount >= SHORTTERM_SUBBLOCKS)
+        {
+            m_shortTerm = EnergyToLufs(AverageLastSubblocks(SHORTTERM_SUBBLOCKS));
+            if (m_shortTerm > m_maxShortTerm)
+                m_maxShortTerm = m_shortTerm;
+        }
+    }
+
+    double AverageLastSubblocks(uint32_t count) const
+    {
+        double sum = 0.;
+        for (uint32_t i = 1; i <= count; i++)
+            sum += m_subblockEnergies[(m_subblockCount-i)%SHORTTERM_SUBBLOCKS];
+        return sum/count;
+    }
+
+    double CalcIntegratedLoudness() const
+    {
+        // blocks under the absolute gate are never stored, so only the relative gate is left to apply
+        if (m_gatingBlocks.empty())
+            return -numeric_limits<double>::infinity();
+        double sum = 0.;
+        for (auto e : m_gatingBlocks)
+            sum += e;
+        const double relativeGate = LufsToEnergy(EnergyToLufs(sum/m_gatingBlocks.size())+RELATIVE_GATE_LU);
+        sum = 0.;
+        size_t count = 0;
+        for (auto e : m_gatingBlocks)
+        {
+            if (e > relativeGate)
+            {
+                sum += e;
+                count++;
+            }
+        }
+        return count > 0 ? EnergyToLufs(sum/count) : -numeric_limits<double>::infinity();
+    }
+
+private:
+    ALogger* m_logger;
+    string m_errMsg;
+    uint32_t m_channels;
+    uint32_t m_sampleRate;
+    vector<double> m_chWeights;
+    vector<const float*> m_chPtrs;
+    // K-weighting, two cascaded biquads in transposed direct form II
+    double m_b1[3], m_a1[2];
+    double m_b2[3], m_a2[2];
+    vector<double> m_filterStates[4];
+    vector<double> m_sumSquares;
+    uint32_t m_subblockSamples;
+    uint32_t m_subblockPos{0};
+    // true peak
+    float m_tpCoeffsT[TRUEPEAK_TAPS*TRUEPEAK_PHASES];
+    vector<float> m_tpHistory;
+    vector<uint32_t> m_tpHistoryPos;
+    // measurement state, shared with the querying thread
+    mutable mutex m_measureLock;
+    vector<double> m_subblockEnergies;
+    uint64_t m_subblockCount{0};
+    vector<double> m_gatingBlocks;
+    double m_momentary, m_shortTerm;
+    double m_maxMomentary, m_maxShortTerm;
+    float m_truePeak{0.f};
+    int64_t m_sampleCount{0};
+};
+
+static const auto LOUDNESS_METER_HOLDER_DELETER = [] (LoudnessMeter* p) {
+    LoudnessMeter_Impl* ptr = dynamic_cast<LoudnessMeter_Impl*>(p);
+    delete ptr;
+};
+
+LoudnessMeter::Holder LoudnessMeter::CreateInstance(uint32_t channels, uint32_t sampleRate)
+{
+    if (channels == 0 || sampleRate == 0)
+    {
+        GetLogger()->Log(Error) << "INVALID arguments for LoudnessMeter::CreateInstance(), channels=" << channels << ", sampleRate=" << sampleRate << "." << endl;
+        return nullptr;
+    }
+    return LoudnessMeter::Holder(new LoudnessMeter_Impl(channels, sampleRate), LOUDNESS_METER_HOLDER_DELETER);
+}
+
+ALogger* LoudnessMeter::GetLogger()
+{
+    return Logger::GetLogger("LoudMeter");
+}
+
+double LoudnessMeter::GetNormalizationGain(const Measurement& measurement, double targetLufs, double truePeakCeiling)
+{
+    if (!isfinite(measurement.integrated))
+        return 0.;
+    double gain = targetLufs-measurement.integrated;
+    if (isfinite(measurement.truePeak) && measurement.truePeak+gain > truePeakCeiling)
+        gain = truePeakCeiling-measurement.truePeak;
+    return gain;
+}
+
+class LoudnessAnalysisTask_Impl : public LoudnessMeter::AnalysisTask
+{
+public:
+    LoudnessAnalysisTask_Impl(int64_t startPos, int64_t endPos)
+        : m_startPos(startPos), m_endPos(endPos)
+    {
+        m_logger = LoudnessMeter::GetLogger();
+    }
+
+    ~LoudnessAnalysisTask_Impl()
+    {
+        if (m_hReader)
+            m_hReader->Close();
+    }
+
+    bool Init(MultiTrackAudioReader::Holder hSrcReader, uint32_t outChannels, uint32_t outSampleRate)
+    {
+        auto hSettings = hSrcReader->GetSharedSettings();
+        m_channels = outChannels > 0 ? outChannels : hSettings->AudioOutChannels();
+        m_sampleRate = outSampleRate > 0 ? outSampleRate : hSettings->AudioOutSampleRate();
+        m_hReader = hSrcReader->CloneAndConfigure(m_channels, m_sampleRate, "fltp", 4096);
+        if (!m_hReader)
+        {
+            m_errMsg = "FAILED to clone the MultiTrackAudioReader for loudness analysis! Error is '"+hSrcReader->GetError()+"'.";
+            return false;
+        }
+        // the requested range is kept for 'GetStartPos()/GetEndPos()', so callers can match it against their own
+        const int64_t dur = m_hReader->Duration();
+        m_readStartPos = m_startPos < 0 ? 0 : m_startPos;
+        m_readEndPos = m_endPos < 0 || m_endPos > dur ? dur : m_endPos;
+        m_hMeter = LoudnessMeter::CreateInstance(m_channels, m_sampleRate);
+        return (bool)m_hMeter;
+    }
+
+    float GetProgress() const override
+    {
+        return m_progress;
+    }
+
+    LoudnessMeter::Measurement GetMeasurement() const override
+    {
+        return m_hMeter->GetMeasurement();
+    }
+
+    int64_t GetStartPos() const override
+    {
+        return m_startPos;
+    }
+
+    int64_t GetEndPos() const override
+    {
+        return m_endPos;
+    }
+
+    uint32_t GetChannels() const override
+    {
+        return m_channels;
+    }
+
+    uint32_t GetSampleRate() const override
+    {
+        return m_sampleRate;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+protected:
+    bool _TaskProc() override
+    {
+        m_logger->Log(DEBUG) << "Start loudness analysis in range [" << m_readStartPos << ", " << m_readEndPos << ")." << endl;
+        if (m_readStartPos > 0 && !m_hReader->SeekTo(m_readStartPos))
+        {
+            m_errMsg = "FAILED to seek the audio reader! Error is '"+m_hReader->GetError()+"'.";
+            return false;
+        }
+        const int64_t totalSamples = (m_readEndPos-m_readStartPos)*m_sampleRate/1000;
+        int64_t readSamples = 0;
+        vector<const float*> planes(m_channels);
+        ImGui::ImMat amat;
+        bool eof = false;
+        while (!IsCancelled() && readSamples < totalSamples && !eof)
+        {
+            if (!m_hReader->ReadAudioSamples(amat, eof))
+            {
+                m_errMsg = "FAILED to read audio samples! Error is '"+m_hReader->GetError()+"'.";
+                m_logger->Log(Error) << m_errMsg << endl;
+                return false;
+            }
+            if (amat.empty())
+                continue;
+            const uint32_t sampleCount = (uint32_t)min((int64_t)amat.w, totalSamples-readSamples);
+            for (uint32_t ch = 0; ch < m_channels; ch++)
+                planes[ch] = (const float*)amat.data+ch*amat.w;
+            m_hMeter->ProcessSamples(planes.data(), sampleCount);
+            readSamples += sampleCount;
+            m_progress = (float)((double)readSamples/totalSamples);
+        }
+        m_hReader->Close();
+        m_hReader = nullptr;
+        const auto m = m_hMeter->GetMeasurement();
+        m_logger->Log(DEBUG) << "Loudness analysis finished: integrated=" << m.integrated << " LUFS, true-peak=" << m.truePeak << " dBTP." << endl;
+        return true;
+    }
+
+private:
+    ALogger* m_logger;
+    string m_errMsg;
+    int64_t m_startPos, m_endPos;
+    int64_t m_readStartPos{0}, m_readEndPos{0};
+    uint32_t m_channels{0}, m_sampleRate{0};
+    MultiTrackAudioReader::Holder m_hReader;
+    LoudnessMeter::Holder m_hMeter;
+    atomic<float> m_progress{0.f};
+};
+
+LoudnessMeter::AnalysisTask::Holder LoudnessMeter::CreateAnalysisTask(MultiTrackAudioReader::Holder hReader, int64_t startPos, int64_t endPos,
+        uint32_t outChannels, uint32_t outSampleRate)
+{
+    if (!hReader)
+        return nullptr;
+    auto pTask = new LoudnessAnalysisTask_Impl(startPos, endPos);
+    AnalysisTask::Holder hTask(pTask);
+    if (!pTask->Init(hReader, outChannels, outSampleRate))
+    {
+        GetLogger()->Log(Error) << pTask->GetError() << endl;
+        return nullptr;
+    }
+    return hTask;
+}
+}
@@ -1,5 +1,8 @@
 #include <cassert>
 #include <cstring>
+#include <mutex>
+#include <vector>
+#include <functional>
 #include "MatUtils.h"
 #include "Logger.h"
 
@@ -41,7 +44,7 @@ void CopyAudioMatSamples(ImGui::ImMat& dstMat, const ImGui::ImMat& srcMat, uint3
         int dstW = (int)(dstOffSmpCnt+copySmpCnt);
         int dstH = srcMat.h;
         int dstC = srcMat.c;
-        dstMat.create_type(dstW, dstH, dstC, srcMat.type);
+        dstMat.create_type(dstW, dstH, dstC, srcMat.type, srcMat.allocator);
         assert("Failed to create 'dstMat'!" && !dstMat.empty());
         memset(dstMat.data, 0, dstMat.total()*dstMat.elemsize);
         dstMat.flags |= IM_MAT_FLAGS_AUDIO_FRAME;
@@ -122,4 +125,191 @@ MediaCore::AudioRender::PcmFormat ImDataType2PcmFormat(ImDataType dataType)
     }
     return pcmFormat;
 }
+
+///////////////////////////////////////////////////////////////////////////////////////////
+// AudioBlockPool
+///////////////////////////////////////////////////////////////////////////////////////////
+class AudioBlockPool_Impl : public AudioBlockPool
+{
+public:
+    AudioBlockPool_Impl()
+        : m_freeLists(MAX_SIZE_CLASS-MIN_SIZE_CLASS+1)
+    {}
+
+    ~AudioBlockPool_Impl()
+    {
+        Trim();
+    }
+
+    void* fastMalloc(size_t size, ImDataDevice device) override
+    {
+        if (device != IM_DD_CPU)
+            return nullptr;
+        const uint32_t sizeClass = GetSizeClass(size);
+        if (sizeClass > MAX_SIZE_CLASS)
+        {
+            // too large to be pooled, serve it directly from the heap
+            uint8_t* base = (uint8_t*)Im_FastMalloc(size+BLOCK_HEADER_SIZE);
+            if (!base)
+                return nullptr;
+            *(uint32_t*)base = NOT_POOLED;
+            lock_guard<mutex> lk(m_poolLock);
+            m_heapAllocCount++;
+            return base+BLOCK_HEADER_SIZE;
+        }
+
+        auto& freeList = m_freeLists[sizeClass-MIN_SIZE_CLASS];
+        {
+            lock_guard<mutex> lk(m_poolLock);
+            if (!freeList.empty())
+            {
+                uint8_t* base = freeList.back();
+                freeList.pop_back();
+                m_freeBlockCount--;
+                m_inUseBlockCount++;
+                m_reuseCount++;
+                return base+BLOCK_HEADER_SIZE;
+            }
+        }
+        uint8_t* base = AllocBlock(sizeClass);
+        if (!base)
+            return nullptr;
+        lock_guard<mutex> lk(m_poolLock);
+        m_inUseBlockCount++;
+        return base+BLOCK_HEADER_SIZE;
+    }
+
+    void* fastMalloc(int w, int h, int c, size_t elemsize, int elempack, ImDataDevice device) override
+    {
+        return fastMalloc((size_t)w*h*c*elemsize, device);
+    }
+
+    void fastFree(void* ptr, ImDataDevice device) override
+    {
+        if (!ptr)
+            return;
+        uint8_t* base = (uint8_t*)ptr-BLOCK_HEADER_SIZE;
+        const uint32_t sizeClass = *(uint32_t*)base;
+        if (sizeClass == NOT_POOLED)
+        {
+            Im_FastFree(base);
+            return;
+        }
+        assert("Invalid audio block header!" && sizeClass >= MIN_SIZE_CLASS && sizeClass <= MAX_SIZE_CLASS);
+        lock_guard<mutex> lk(m_poolLock);
+        m_freeLists[sizeClass-MIN_SIZE_CLASS].push_back(base);
+        m_inUseBlockCount--;
+        m_freeBlockCount++;
+    }
+
+    int flush(void* ptr, ImDataDevice device) override
+    {
+        return 0;
+    }
+
+    int invalidate(void* ptr, ImDataDevice device) override
+    {
+        return 0;
+    }
+
+    void Reserve(size_t size, uint32_t count) override
+    {
+        const uint32_t sizeClass = GetSizeClass(size);
+        if (sizeClass > MAX_SIZE_CLASS)
+            return;
+        auto& freeList = m_freeLists[sizeClass-MIN_SIZE_CLASS];
+        while (true)
+        {
+            {
+                lock_guard<mutex> lk(m_poolLock);
+                if (freeList.size() >= count)
+                    break;
+            }
+            uint8_t* base = AllocBlock(sizeClass);
+            if (!base)
+                break;
+            lock_guard<mutex> lk(m_poolLock);
+            freeList.push_back(base);
+            m_freeBlockCount++;
+        }
+    }
+
+    void Trim() override
+    {
+        lock_guard<mutex> lk(m_poolLock);
+        for (uint32_t i = 0; i < m_freeLists.size(); i++)
+        {
+            auto& freeList = m_freeLists[i];
+            for (auto base : freeList)
+                Im_FastFree(base);
+            m_pooledBytes -= freeList.size()*((size_t)1<<(i+MIN_SIZE_CLASS));
+            m_freeBlockCount -= (uint32_t)freeList.size();
+            freeList.clear();
+            freeList.shrink_to_fit();
+        }
+    }
+
+    Statistics GetStatistics() const override
+    {
+        lock_guard<mutex> lk(m_poolLock);
+        return { m_heapAllocCount, m_reuseCount, m_inUseBlockCount, m_freeBlockCount, m_pooledBytes };
+    }
+
+private:
+    static uint32_t GetSizeClass(size_t size)
+    {
+        uint32_t sizeClass = MIN_SIZE_CLASS;
+        while (sizeClass <= MAX_SIZE_CLASS && ((size_t)1<<sizeClass) < size)
+            sizeClass++;
+        return sizeClass;
+    }
+
+    uint8_t* AllocBlock(uint32_t sizeClass)
+    {
+        const size_t blockSize = (size_t)1<<sizeClass;
+        uint8_t* base = (uint8_t*)Im_FastMalloc(blockSize+BLOCK_HEADER_SIZE);
+        if (!base)
+            return nullptr;
+        *(uint32_t*)base = sizeClass;
+        lock_guard<mutex> lk(m_poolLock);
+        m_heapAllocCount++;
+        m_pooledBytes += blockSize;
+        // grow the free list capacity now, so releasing this block later never reallocates
+        auto& freeList = m_freeLists[sizeClass-MIN_SIZE_CLASS];
+        if (freeList.capacity() < m_freeBlockCount+m_inUseBlockCount+1)
+            freeList.reserve(m_freeBlockCount+m_inUseBlockCount+1);
+        return base;
+    }
+
+private:
+    static constexpr uint32_t MIN_SIZE_CLASS = 12;  // 4KB
+    static constexpr uint32_t MAX_SIZE_CLASS = 24;  // 16MB
+    static constexpr uint32_t NOT_POOLED = 0xffffffff;
+    // keep the returned pointer aligned as Im_FastMalloc() does
+    static constexpr size_t BLOCK_HEADER_SIZE = IM_MALLOC_ALIGN < 16 ? 16 : IM_MALLOC_ALIGN;
+
+    mutable mutex m_poolLock;
+    vector<vector<uint8_t*>> m_freeLists;
+    uint64_t m_heapAllocCount{0};
+    uint64_t m_reuseCount{0};
+    uint32_t m_inUseBlockCount{0};
+    uint32_t m_freeBlockCount{0};
+    size_t m_pooledBytes{0};
+};
+
+static const function<void(AudioBlockPool*)> AUDIO_BLOCK_POOL_HOLDER_DELETER = [] (AudioBlockPool* p) {
+    AudioBlockPool_Impl* ptr = dynamic_cast<AudioBlockPool_Impl*>(p);
+    delete ptr;
+};
+
+AudioBlockPool::Holder AudioBlockPool::CreateInstance()
+{
+    return AudioBlockPool::Holder(new AudioBlockPool_Impl(), AUDIO_BLOCK_POOL_HOLDER_DELETER);
+}
+
+AudioBlockPool* AudioBlockPool::GetDefaultInstance()
+{
+    static AudioBlockPool* s_defaultPool = new AudioBlockPool_Impl();
+    return s_defaultPool;
+}
 }
\ No newline at end of file
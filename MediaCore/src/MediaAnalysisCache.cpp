@@ -0,0 +1,724 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <sys/stat.h>
+#include "MediaAnalysisCache.h"
+#include "FFUtils.h"
+#include "FileSystemUtils.h"
+#include "MathUtils.h"
+#include "imgui_json.h"
+extern "C"
+{
+    #include "libavcodec/avcodec.h"
+    #include "libavutil/opt.h"
+}
+
+using namespace std;
+using namespace Logger;
+
+namespace MediaCore
+{
+static const char SNAPSHOT_FILE_MAGIC[8] = { 'M', 'E', 'C', 'A', 'S', 'S', 'C', '1' };
+static const char WAVEFORM_FILE_MAGIC[8] = { 'M', 'E', 'C', 'A', 'W', 'F', 'C', '1' };
+static const uint32_t CACHE_FILE_VERSION = 1;
+static const uint32_t MEDIA_INFO_VERSION = 1;
+// bytes read from the head and the tail of a file to identify its content
+static const size_t PARTIAL_HASH_BYTES = 64*1024;
+static const int SNAPSHOT_JPEG_QSCALE = 4;
+// the least recently used cache files are removed when the directory grows over this size
+static const uint64_t MAX_CACHE_DIR_SIZE = 2ULL*1024*1024*1024;
+
+#pragma pack(push, 1)
+struct SnapshotCacheFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t width;
+    uint32_t height;
+    int32_t colorFormat;
+    uint32_t count;
+    uint8_t reserved[8];
+};
+
+struct WaveformCacheFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t channels;
+    double aggregateSamples;
+    double aggregateDuration;
+    float minSample;
+    float maxSample;
+    int64_t sampleCount;
+    uint32_t levelCount;
+    uint8_t reserved[12];
+};
+
+struct WaveformLevelHeader
+{
+    double aggregateSamples;
+    double aggregateDuration;
+    int64_t sampleCount;
+};
+#pragma pack(pop)
+
+static imgui_json::value RatioToJson(const Ratio& r)
+{
+    imgui_json::value jnRatio;
+    jnRatio["num"] = imgui_json::number(r.num);
+    jnRatio["den"] = imgui_json::number(r.den);
+    return jnRatio;
+}
+
+static Ratio RatioFromJson(const imgui_json::value& jnRatio)
+{
+    Ratio r;
+    if (jnRatio.contains("num") && jnRatio["num"].is_number())
+        r.num = (int32_t)jnRatio["num"].get<imgui_json::number>();
+    if (jnRatio.contains("den") && jnRatio["den"].is_number())
+        r.den = (int32_t)jnRatio["den"].get<imgui_json::number>();
+    return r;
+}
+
+static double GetJsonNumber(const imgui_json::value& jnObj, const string& name, double defaultVal = 0)
+{
+    if (jnObj.contains(name) && jnObj[name].is_number())
+        return jnObj[name].get<imgui_json::number>();
+    return defaultVal;
+}
+
+static string GetJsonString(const imgui_json::value& jnObj, const string& name)
+{
+    if (jnObj.contains(name) && jnObj[name].is_string())
+        return jnObj[name].get<imgui_json::string>();
+    return "";
+}
+
+static bool GetJsonBoolean(const imgui_json::value& jnObj, const string& name)
+{
+    if (jnObj.contains(name) && jnObj[name].is_boolean())
+        return jnObj[name].get<imgui_json::boolean>();
+    return false;
+}
+
+class MediaAnalysisCache_Impl : public MediaAnalysisCache
+{
+public:
+    MediaAnalysisCache_Impl(const string& cacheDir) : m_cacheDir(cacheDir)
+    {
+        m_logger = MediaAnalysisCache::GetLogger();
+    }
+
+    MediaAnalysisCache_Impl(const MediaAnalysisCache_Impl&) = delete;
+    MediaAnalysisCache_Impl(MediaAnalysisCache_Impl&&) = delete;
+    MediaAnalysisCache_Impl& operator=(const MediaAnalysisCache_Impl&) = delete;
+
+    virtual ~MediaAnalysisCache_Impl() {}
+
+    string GetMediaKey(const string& url) override
+    {
+        struct stat st;
+        if (url.empty() || !SysUtils::IsFile(url) || stat(url.c_str(), &st) != 0)
+            return "";
+        {
+            lock_guard<mutex> lk(m_keyTableLock);
+            auto iter = m_keyTable.find(url);
+            if (iter != m_keyTable.end() && iter->second.fileSize == (uint64_t)st.st_size && iter->second.modifyTime == (int64_t)st.st_mtime)
+                return iter->second.key;
+        }
+
+        FILE* fp = fopen(url.c_str(), "rb");
+        if (!fp)
+            return "";
+        vector<char> partialData(PARTIAL_HASH_BYTES*2);
+        size_t readSize = fread(partialData.data(), 1, PARTIAL_HASH_BYTES, fp);
+        if ((uint64_t)st.st_size > PARTIAL_HASH_BYTES*2 && fseek(fp, -(long)PARTIAL_HASH_BYTES, SEEK_END) == 0)
+            readSize += fread(partialData.data()+readSize, 1, PARTIAL_HASH_BYTES, fp);
+        fclose(fp);
+        ostringstream oss;
+        oss << url << "|" << (uint64_t)st.st_size << "|" << (int64_t)st.st_mtime << "|";
+        string content = oss.str();
+        content.append(partialData.data(), readSize);
+        oss.str("");
+        oss << hex << setw(16) << setfill('0') << MathUtils::Fnv1aHash64(content);
+        const auto key = oss.str();
+
+        lock_guard<mutex> lk(m_keyTableLock);
+        m_keyTable[url] = { (uint64_t)st.st_size, (int64_t)st.st_mtime, key };
+        return key;
+    }
+
+    MediaInfo::Holder LoadMediaInfo(const string& key, int& bestVidStmIdx, int& bestAudStmIdx) override
+    {
+        if (key.empty())
+            return nullptr;
+        const auto filePath = SysUtils::JoinPath(m_cacheDir, key+".minfo");
+        if (!SysUtils::IsFile(filePath))
+            return nullptr;
+        auto res = imgui_json::value::load(filePath);
+        if (!res.second)
+            return nullptr;
+        const auto& jnInfo = res.first;
+        if ((uint32_t)GetJsonNumber(jnInfo, "version") != MEDIA_INFO_VERSION || !jnInfo.contains("streams") || !jnInfo["streams"].is_array())
+            return nullptr;
+
+        MediaInfo::Holder hMediaInfo(new MediaInfo());
+        hMediaInfo->startTime = GetJsonNumber(jnInfo, "start_time");
+        hMediaInfo->duration = GetJsonNumber(jnInfo, "duration", -1);
+        hMediaInfo->isComplete = GetJsonBoolean(jnInfo, "is_complete");
+        const auto& jnStreams = jnInfo["streams"].get<imgui_json::array>();
+        for (auto& jnStream : jnStreams)
+        {
+            Stream::Holder hStream;
+            const auto type = (MediaType)(int)GetJsonNumber(jnStream, "type");
+            if (type == MediaType::VIDEO)
+            {
+                auto pVidstm = new VideoStream();
+                hStream = Stream::Holder(pVidstm);
+                pVidstm->width = (uint32_t)GetJsonNumber(jnStream, "width");
+                pVidstm->height = (uint32_t)GetJsonNumber(jnStream, "height");
+                pVidstm->rawWidth = (uint32_t)GetJsonNumber(jnStream, "raw_width");
+                pVidstm->rawHeight = (uint32_t)GetJsonNumber(jnStream, "raw_height");
+                pVidstm->format = GetJsonString(jnStream, "format");
+                pVidstm->codec = GetJsonString(jnStream, "codec");
+                if (jnStream.contains("sample_aspect_ratio")) pVidstm->sampleAspectRatio = RatioFromJson(jnStream["sample_aspect_ratio"]);
+                if (jnStream.contains("avg_frame_rate")) pVidstm->avgFrameRate = RatioFromJson(jnStream["avg_frame_rate"]);
+                if (jnStream.contains("real_frame_rate")) pVidstm->realFrameRate = RatioFromJson(jnStream["real_frame_rate"]);
+                pVidstm->frameNum = (uint64_t)GetJsonNumber(jnStream, "frame_num");
+                pVidstm->isImage = GetJsonBoolean(jnStream, "is_image");
+                pVidstm->isHdr = GetJsonBoolean(jnStream, "is_hdr");
+                pVidstm->bitDepth = (uint8_t)GetJsonNumber(jnStream, "bit_depth");
+                pVidstm->displayRotation = GetJsonNumber(jnStream, "display_rotation");
+            }
+            else if (type == MediaType::AUDIO)
+            {
+                auto pAudstm = new AudioStream();
+                hStream = Stream::Holder(pAudstm);
+                pAudstm->channels = (uint32_t)GetJsonNumber(jnStream, "channels");
+                pAudstm->sampleRate = (uint32_t)GetJsonNumber(jnStream, "sample_rate");
+                pAudstm->format = GetJsonString(jnStream, "format");
+                pAudstm->codec = GetJsonString(jnStream, "codec");
+                pAudstm->bitDepth = (uint8_t)GetJsonNumber(jnStream, "bit_depth");
+            }
+            else if (type == MediaType::SUBTITLE)
+            {
+                hStream = Stream::Holder(new SubtitleStream());
+            }
+            else
+            {
+                hStream = Stream::Holder(new Stream());
+            }
+            hStream->bitRate = (uint64_t)GetJsonNumber(jnStream, "bit_rate");
+            hStream->startTime = GetJsonNumber(jnStream, "start_time");
+            hStream->duration = GetJsonNumber(jnStream, "duration");
+            if (jnStream.contains("timebase")) hStream->timebase = RatioFromJson(jnStream["timebase"]);
+            hStream->startPts = (int64_t)GetJsonNumber(jnStream, "start_pts");
+            hMediaInfo->streams.push_back(hStream);
+        }
+        bestVidStmIdx = (int)GetJsonNumber(jnInfo, "best_video_stream", -1);
+        bestAudStmIdx = (int)GetJsonNumber(jnInfo, "best_audio_stream", -1);
+        if (bestVidStmIdx >= (int)hMediaInfo->streams.size() || bestAudStmIdx >= (int)hMediaInfo->streams.size())
+            return nullptr;
+        SysUtils::TouchFile(filePath);
+        return hMediaInfo;
+    }
+
+    bool SaveMediaInfo(const string& key, MediaInfo::Holder hMediaInfo, int bestVidStmIdx, int bestAudStmIdx) override
+    {
+        if (key.empty() || !hMediaInfo)
+        {
+            m_errMsg = "INVALID argument! 'key' is empty or 'hMediaInfo' is null.";
+            return false;
+        }
+        imgui_json::value jnInfo;
+        jnInfo["version"] = imgui_json::number(MEDIA_INFO_VERSION);
+        jnInfo["start_time"] = imgui_json::number(hMediaInfo->startTime);
+        jnInfo["duration"] = imgui_json::number(hMediaInfo->duration);
+        jnInfo["is_complete"] = imgui_json::boolean(hMediaInfo->isComplete);
+        jnInfo["best_video_stream"] = imgui_json::number(bestVidStmIdx);
+        jnInfo["best_audio_stream"] = imgui_json::number(bestAudStmIdx);
+        imgui_json::array jnStreams;
+        for (auto& hStream : hMediaInfo->streams)
+        {
+            imgui_json::value jnStream;
+            jnStream["type"] = imgui_json::number((int)hStream->type);
+            jnStream["bit_rate"] = imgui_json::number(hStream->bitRate);
+            jnStream["start_time"] = imgui_json::number(hStream->startTime);
+            jnStream["duration"] = imgui_json::number(hStream->duration);
+            jnStream["timebase"] = RatioToJson(hStream->timebase);
+            jnStream["start_pts"] = imgui_json::number(hStream->startPts);
+            if (hStream->type == MediaType::VIDEO)
+            {
+                auto pVidstm = dynamic_cast<VideoStream*>(hStream.get());
+                jnStream["width"] = imgui_json::number(pVidstm->width);
+                jnStream["height"] = imgui_json::number(pVidstm->height);
+                jnStream["raw_width"] = imgui_json::number(pVidstm->rawWidth);
+                jnStream["raw_height"] = imgui_json::number(pVidstm->rawHeight);
+                jnStream["format"] = imgui_json::string(pVidstm->format);
+                jnStream["codec"] = imgui_json::string(pVidstm->codec);
+                jnStream["sample_aspect_ratio"] = RatioToJson(pVidstm->sampleAspectRatio);
+                jnStream["avg_frame_rate"] = RatioToJson(pVidstm->avgFrameRate);
+                jnStream["real_frame_rate"] = RatioToJson(pVidstm->realFrameRate);
+                jnStream["frame_num"] = imgui_json::number(pVidstm->frameNum);
+                jnStream["is_image"] = imgui_json::boolean(pVidstm->isImage);
+                jnStream["is_hdr"] = imgui_json::boolean(pVidstm->isHdr);
+                jnStream["bit_depth"] = imgui_json::number(pVidstm->bitDepth);
+                jnStream["display_rotation"] = imgui_json::number(pVidstm->displayRotation);
+            }
+            else if (hStream->type == MediaType::AUDIO)
+            {
+                auto pAudstm = dynamic_cast<AudioStream*>(hStream.get());
+                jnStream["channels"] = imgui_json::number(pAudstm->channels);
+                jnStream["sample_rate"] = imgui_json::number(pAudstm->sampleRate);
+                jnStream["format"] = imgui_json::string(pAudstm->format);
+                jnStream["codec"] = imgui_json::string(pAudstm->codec);
+                jnStream["bit_depth"] = imgui_json::number(pAudstm->bitDepth);
+            }
+            jnStreams.push_back(jnStream);
+        }
+        jnInfo["streams"] = jnStreams;
+
+        lock_guard<mutex> lk(m_ioLock);
+        if (!PrepareCacheDir())
+            return false;
+        const auto filePath = SysUtils::JoinPath(m_cacheDir, key+".minfo");
+        const auto tmpFilePath = filePath+".tmp";
+        if (!jnInfo.save(tmpFilePath))
+        {
+            ostringstream oss; oss << "FAILED to save media info cache file '" << tmpFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return FinalizeCacheFile(tmpFilePath, filePath);
+    }
+
+    bool LoadSnapshots(const string& key, uint32_t width, uint32_t height, ImColorFormat clrfmt, uint32_t count, vector<ImGui::ImMat>& snapshots) override
+    {
+        if (key.empty())
+            return false;
+        const auto filePath = GetSnapshotFilePath(key, width, height, count);
+        FILE* fp = fopen(filePath.c_str(), "rb");
+        if (!fp)
+            return false;
+        SnapshotCacheFileHeader header;
+        if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(SNAPSHOT_FILE_MAGIC)) != 0
+            || header.version != CACHE_FILE_VERSION || header.width != width || header.height != height
+            || header.colorFormat != (int32_t)clrfmt || header.count != count)
+        {
+            fclose(fp);
+            m_logger->Log(DEBUG) << "Snapshot cache file '" << filePath << "' is OUTDATED or BROKEN." << endl;
+            return false;
+        }
+
+        AVCodecPtr pCodec = avcodec_find_decoder(AV_CODEC_ID_MJPEG);
+        AVCodecContext* pDecCtx = pCodec ? avcodec_alloc_context3(pCodec) : nullptr;
+        if (!pDecCtx || avcodec_open2(pDecCtx, pCodec, nullptr) < 0)
+        {
+            if (pDecCtx)
+                avcodec_free_context(&pDecCtx);
+            fclose(fp);
+            m_errMsg = "FAILED to open the mjpeg decoder!";
+            return false;
+        }
+        AVFrameToImMatConverter frmCvt;
+        frmCvt.SetOutSize(width, height);
+        frmCvt.SetOutColorFormat(clrfmt);
+        vector<ImGui::ImMat> loadedSnapshots;
+        vector<uint8_t> jpegData;
+        bool success = true;
+        for (uint32_t i = 0; i < count && success; i++)
+        {
+            double timestamp;
+            uint32_t dataSize;
+            if (fread(&timestamp, sizeof(timestamp), 1, fp) != 1 || fread(&dataSize, sizeof(dataSize), 1, fp) != 1)
+            {
+                success = false;
+                break;
+            }
+            ImGui::ImMat snapshot;
+            if (dataSize > 0)
+            {
+                jpegData.resize(dataSize+AV_INPUT_BUFFER_PADDING_SIZE, 0);
+                if (fread(jpegData.data(), 1, dataSize, fp) != dataSize || !DecodeJpeg(pDecCtx, frmCvt, jpegData.data(), dataSize, timestamp, snapshot))
+                {
+                    success = false;
+                    break;
+                }
+            }
+            snapshot.time_stamp = timestamp;
+            loadedSnapshots.push_back(snapshot);
+        }
+        avcodec_free_context(&pDecCtx);
+        fclose(fp);
+        if (!success)
+        {
+            m_logger->Log(WARN) << "FAILED to load snapshots from cache file '" << filePath << "'." << endl;
+            return false;
+        }
+        snapshots = std::move(loadedSnapshots);
+        SysUtils::TouchFile(filePath);
+        return true;
+    }
+
+    bool SaveSnapshots(const string& key, uint32_t width, uint32_t height, ImColorFormat clrfmt, const vector<ImGui::ImMat>& snapshots) override
+    {
+        if (key.empty())
+        {
+            m_errMsg = "INVALID argument! 'key' is empty.";
+            return false;
+        }
+        AVCodecPtr pCodec = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+        if (!pCodec)
+        {
+            m_errMsg = "Can NOT find the mjpeg encoder!";
+            return false;
+        }
+        // the snapshots may be vulkan mats, the converter downloads them to the cpu memory
+        ImMatToAVFrameConverter frmCvt;
+        frmCvt.SetOutPixelFormat(AV_PIX_FMT_YUV420P);
+        frmCvt.SetOutColorRange(AVCOL_RANGE_JPEG);
+        vector<vector<uint8_t>> encodedSnapshots(snapshots.size());
+        for (size_t i = 0; i < snapshots.size(); i++)
+        {
+            if (!snapshots[i].empty() && !EncodeJpeg(pCodec, frmCvt, snapshots[i], encodedSnapshots[i]))
+                return false;
+        }
+
+        lock_guard<mutex> lk(m_ioLock);
+        if (!PrepareCacheDir())
+            return false;
+        const auto filePath = GetSnapshotFilePath(key, width, height, snapshots.size());
+        const auto tmpFilePath = filePath+".tmp";
+        FILE* fp = fopen(tmpFilePath.c_str(), "wb");
+        if (!fp)
+        {
+            ostringstream oss; oss << "FAILED to create snapshot cache file '" << tmpFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        SnapshotCacheFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, SNAPSHOT_FILE_MAGIC, sizeof(SNAPSHOT_FILE_MAGIC));
+        header.version = CACHE_FILE_VERSION;
+        header.width = width;
+        header.height = height;
+        header.colorFormat = (int32_t)clrfmt;
+        header.count = (uint32_t)snapshots.size();
+        bool ioErr = fwrite(&header, sizeof(header), 1, fp) != 1;
+        for (size_t i = 0; i < snapshots.size() && !ioErr; i++)
+        {
+            const double timestamp = snapshots[i].time_stamp;
+            const uint32_t dataSize = (uint32_t)encodedSnapshots[i].size();
+            ioErr = fwrite(&timestamp, sizeof(timestamp), 1, fp) != 1 || fwrite(&dataSize, sizeof(dataSize), 1, fp) != 1
+                || (dataSize > 0 && fwrite(encodedSnapshots[i].data(), 1, dataSize, fp) != dataSize);
+        }
+        fclose(fp);
+        if (ioErr)
+        {
+            SysUtils::DeleteFileAt(tmpFilePath);
+            ostringstream oss; oss << "FAILED to write snapshot cache file '" << tmpFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return FinalizeCacheFile(tmpFilePath, filePath);
+    }
+
+    Overview::Waveform::Holder LoadWaveform(const string& key, double aggregateSamples) override
+    {
+        if (key.empty())
+            return nullptr;
+        const auto filePath = GetWaveformFilePath(key, aggregateSamples);
+        struct stat st;
+        if (stat(filePath.c_str(), &st) != 0)
+            return nullptr;
+        FILE* fp = fopen(filePath.c_str(), "rb");
+        if (!fp)
+            return nullptr;
+        // the sample counts are checked against the remaining file size before any buffer is allocated with them
+        int64_t remainBytes = (int64_t)st.st_size-(int64_t)sizeof(WaveformCacheFileHeader);
+        WaveformCacheFileHeader header;
+        if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, WAVEFORM_FILE_MAGIC, sizeof(WAVEFORM_FILE_MAGIC)) != 0
+            || header.version != CACHE_FILE_VERSION || header.aggregateSamples != aggregateSamples
+            || header.channels == 0 || header.channels > 2 || header.sampleCount < 0
+            || header.sampleCount > remainBytes/(int64_t)(sizeof(float)*header.channels))
+        {
+            fclose(fp);
+            m_logger->Log(DEBUG) << "Waveform cache file '" << filePath << "' is OUTDATED or BROKEN." << endl;
+            return nullptr;
+        }
+        Overview::Waveform::Holder hWaveform(new Overview::Waveform);
+        hWaveform->aggregateSamples = header.aggregateSamples;
+        hWaveform->aggregateDuration = header.aggregateDuration;
+        hWaveform->minSample = header.minSample;
+        hWaveform->maxSample = header.maxSample;
+        hWaveform->validSampleCount = header.sampleCount;
+        hWaveform->pcm.resize(header.channels);
+        remainBytes -= header.sampleCount*(int64_t)(sizeof(float)*header.channels);
+        bool success = true;
+        for (auto& chpcm : hWaveform->pcm)
+            success = success && ReadFloats(fp, chpcm, header.sampleCount);
+        for (uint32_t i = 0; i < header.levelCount && success; i++)
+        {
+            WaveformLevelHeader levelHeader;
+            remainBytes -= (int64_t)sizeof(levelHeader);
+            if (remainBytes < 0 || fread(&levelHeader, sizeof(levelHeader), 1, fp) != 1 || levelHeader.sampleCount < 0
+                || levelHeader.sampleCount > remainBytes/(int64_t)(sizeof(float)*3*header.channels))
+            {
+                success = false;
+                break;
+            }
+            Overview::Waveform::Level level;
+            level.aggregateSamples = levelHeader.aggregateSamples;
+            level.aggregateDuration = levelHeader.aggregateDuration;
+            level.validSampleCount = levelHeader.sampleCount;
+            remainBytes -= levelHeader.sampleCount*(int64_t)(sizeof(float)*3*header.channels);
+            level.minPcm.resize(header.channels);
+            level.maxPcm.resize(header.channels);
+            level.rmsPcm.resize(header.channels);
+            for (uint32_t ch = 0; ch < header.channels; ch++)
+            {
+                success = success && ReadFloats(fp, level.minPcm[ch], levelHeader.sampleCount)
+                    && ReadFloats(fp, level.maxPcm[ch], levelHeader.sampleCount) && ReadFloats(fp, level.rmsPcm[ch], levelHeader.sampleCount);
+            }
+            hWaveform->levels.push_back(std::move(level));
+        }
+        fclose(fp);
+        if (!success)
+        {
+            m_logger->Log(WARN) << "FAILED to load waveform from cache file '" << filePath << "'." << endl;
+            return nullptr;
+        }
+        hWaveform->parseDone = true;
+        SysUtils::TouchFile(filePath);
+        return hWaveform;
+    }
+
+    bool SaveWaveform(const string& key, Overview::Waveform::Holder hWaveform) override
+    {
+        if (key.empty() || !hWaveform || hWaveform->pcm.empty())
+        {
+            m_errMsg = "INVALID argument! 'key' is empty or 'hWaveform' is null.";
+            return false;
+        }
+        lock_guard<mutex> lk(m_ioLock);
+        if (!PrepareCacheDir())
+            return false;
+        const auto filePath = GetWaveformFilePath(key, hWaveform->aggregateSamples);
+        const auto tmpFilePath = filePath+".tmp";
+        FILE* fp = fopen(tmpFilePath.c_str(), "wb");
+        if (!fp)
+        {
+            ostringstream oss; oss << "FAILED to create waveform cache file '" << tmpFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        WaveformCacheFileHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, WAVEFORM_FILE_MAGIC, sizeof(WAVEFORM_FILE_MAGIC));
+        header.version = CACHE_FILE_VERSION;
+        header.channels = (uint32_t)hWaveform->pcm.size();
+        header.aggregateSamples = hWaveform->aggregateSamples;
+        header.aggregateDuration = hWaveform->aggregateDuration;
+        header.minSample = hWaveform->minSample;
+        header.maxSample = hWaveform->maxSample;
+        header.sampleCount = (int64_t)hWaveform->pcm[0].size();
+        header.levelCount = (uint32_t)hWaveform->levels.size();
+        bool ioErr = fwrite(&header, sizeof(header), 1, fp) != 1;
+        for (auto& chpcm : hWaveform->pcm)
+            ioErr = ioErr || !WriteFloats(fp, chpcm, header.sampleCount);
+        for (auto& level : hWaveform->levels)
+        {
+            WaveformLevelHeader levelHeader;
+            levelHeader.aggregateSamples = level.aggregateSamples;
+            levelHeader.aggregateDuration = level.aggregateDuration;
+            levelHeader.sampleCount = level.minPcm.empty() ? 0 : (int64_t)level.minPcm[0].size();
+            ioErr = ioErr || fwrite(&levelHeader, sizeof(levelHeader), 1, fp) != 1;
+            for (uint32_t ch = 0; ch < header.channels; ch++)
+            {
+                ioErr = ioErr || !WriteFloats(fp, level.minPcm[ch], levelHeader.sampleCount)
+                    || !WriteFloats(fp, level.maxPcm[ch], levelHeader.sampleCount) || !WriteFloats(fp, level.rmsPcm[ch], levelHeader.sampleCount);
+            }
+        }
+        fclose(fp);
+        if (ioErr)
+        {
+            SysUtils::DeleteFileAt(tmpFilePath);
+            ostringstream oss; oss << "FAILED to write waveform cache file '" << tmpFilePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return FinalizeCacheFile(tmpFilePath, filePath);
+    }
+
+    string GetCacheDir() const override
+    {
+        return m_cacheDir;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+private:
+    string GetSnapshotFilePath(const string& key, uint32_t width, uint32_t height, size_t count) const
+    {
+        ostringstream oss;
+        oss << key << "_" << width << "x" << height << "_" << count << ".snap";
+        return SysUtils::JoinPath(m_cacheDir, oss.str());
+    }
+
+    string GetWaveformFilePath(const string& key, double aggregateSamples) const
+    {
+        ostringstream oss;
+        oss << key << "_" << fixed << setprecision(3) << aggregateSamples << ".wave";
+        return SysUtils::JoinPath(m_cacheDir, oss.str());
+    }
+
+    bool PrepareCacheDir()
+    {
+        if (!SysUtils::IsDirectory(m_cacheDir) && !SysUtils::CreateDirectoryAt(m_cacheDir, true))
+        {
+            ostringstream oss; oss << "FAILED to create media analysis cache directory '" << m_cacheDir << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    bool FinalizeCacheFile(const string& tmpFilePath, const string& filePath)
+    {
+        if (SysUtils::IsFile(filePath))
+            SysUtils::DeleteFileAt(filePath);
+        if (!SysUtils::RenameFile(tmpFilePath, filePath))
+        {
+            SysUtils::DeleteFileAt(tmpFilePath);
+            ostringstream oss; oss << "FAILED to finalize cache file '" << filePath << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        // evict the least recently used cache files, loading a cache file touches it
+        SysUtils::TrimDirectory(m_cacheDir, MAX_CACHE_DIR_SIZE, "", {filePath});
+        return true;
+    }
+
+    static bool ReadFloats(FILE* fp, vector<float>& data, int64_t count)
+    {
+        data.resize((size_t)count);
+        return count == 0 || fread(data.data(), sizeof(float), (size_t)count, fp) == (size_t)count;
+    }
+
+    static bool WriteFloats(FILE* fp, const vector<float>& data, int64_t count)
+    {
+        if ((int64_t)data.size() < count)
+            return false;
+        return count == 0 || fwrite(data.data(), sizeof(float), (size_t)count, fp) == (size_t)count;
+    }
+
+    bool EncodeJpeg(AVCodecPtr pCodec, ImMatToAVFrameConverter& frmCvt, const ImGui::ImMat& img, vector<uint8_t>& jpegData)
+    {
+        auto hFrame = AllocSelfFreeAVFramePtr();
+        if (!hFrame || !frmCvt.ConvertImage(img, hFrame.get(), 0))
+        {
+            m_errMsg = "FAILED to convert the snapshot to AVFrame! "+frmCvt.GetError();
+            return false;
+        }
+        AVCodecContext* pEncCtx = avcodec_alloc_context3(pCodec);
+        if (!pEncCtx)
+        {
+            m_errMsg = "FAILED to allocate AVCodecContext for the mjpeg encoder!";
+            return false;
+        }
+        pEncCtx->width = hFrame->width;
+        pEncCtx->height = hFrame->height;
+        pEncCtx->pix_fmt = (AVPixelFormat)hFrame->format;
+        pEncCtx->color_range = AVCOL_RANGE_JPEG;
+        pEncCtx->time_base = { 1, 25 };
+        pEncCtx->flags |= AV_CODEC_FLAG_QSCALE;
+        pEncCtx->global_quality = FF_QP2LAMBDA*SNAPSHOT_JPEG_QSCALE;
+        pEncCtx->strict_std_compliance = FF_COMPLIANCE_UNOFFICIAL;
+        hFrame->quality = pEncCtx->global_quality;
+        bool success = false;
+        if (avcodec_open2(pEncCtx, pCodec, nullptr) >= 0 && avcodec_send_frame(pEncCtx, hFrame.get()) >= 0 && avcodec_send_frame(pEncCtx, nullptr) >= 0)
+        {
+            auto hPacket = AllocSelfFreeAVPacketPtr();
+            if (hPacket && avcodec_receive_packet(pEncCtx, hPacket.get()) >= 0)
+            {
+                jpegData.assign(hPacket->data, hPacket->data+hPacket->size);
+                success = true;
+            }
+        }
+        avcodec_free_context(&pEncCtx);
+        if (!success)
+            m_errMsg = "FAILED to encode the snapshot as jpeg!";
+        return success;
+    }
+
+    bool DecodeJpeg(AVCodecContext* pDecCtx, AVFrameToImMatConverter& frmCvt, uint8_t* pData, uint32_t dataSize, double timestamp, ImGui::ImMat& img)
+    {
+        auto hPacket = AllocSelfFreeAVPacketPtr();
+        auto hFrame = AllocSelfFreeAVFramePtr();
+        if (!hPacket || !hFrame)
+            return false;
+        hPacket->data = pData;
+        hPacket->size = (int)dataSize;
+        if (avcodec_send_packet(pDecCtx, hPacket.get()) < 0 || avcodec_receive_frame(pDecCtx, hFrame.get()) < 0)
+            return false;
+        return frmCvt.ConvertImage(hFrame.get(), img, timestamp);
+    }
+
+private:
+    struct MediaKeyRecord
+    {
+        uint64_t fileSize;
+        int64_t modifyTime;
+        string key;
+    };
+
+    ALogger* m_logger;
+    string m_cacheDir;
+    unordered_map<string, MediaKeyRecord> m_keyTable;
+    mutex m_keyTableLock;
+    mutex m_ioLock;
+    string m_errMsg;
+};
+
+static const auto MEDIA_ANALYSIS_CACHE_HOLDER_DELETER = [] (MediaAnalysisCache* p) {
+    MediaAnalysisCache_Impl* ptr = dynamic_cast<MediaAnalysisCache_Impl*>(p);
+    delete ptr;
+};
+
+MediaAnalysisCache::Holder MediaAnalysisCache::CreateInstance(const string& cacheDir)
+{
+    if (cacheDir.empty())
+        return nullptr;
+    return MediaAnalysisCache::Holder(new MediaAnalysisCache_Impl(cacheDir), MEDIA_ANALYSIS_CACHE_HOLDER_DELETER);
+}
+
+ALogger* MediaAnalysisCache::GetLogger()
+{
+    return Logger::GetLogger("MAnlysCache");
+}
+}
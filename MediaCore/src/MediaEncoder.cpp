@@ -16,15 +16,19 @@
 */
 
 #include <mutex>
+#include <atomic>
 #include <thread>
 #include <chrono>
 #include <sstream>
 #include <list>
+#include <deque>
+#include <fstream>
 #include <algorithm>
 #include "MediaEncoder.h"
 #include "FFUtils.h"
 #include "FileSystemUtils.h"
 #include "ThreadUtils.h"
+#include "BoundedQueue.h"
 extern "C"
 {
     #include "libavutil/avutil.h"
@@ -94,6 +98,9 @@ public:
 
         CloseVideoComponents();
         CloseAudioComponents();
+        m_vidEncPass = 0;
+        m_vidStatsPath.clear();
+        m_vidStatsIn.clear();
 
         m_muxEof = false;
         m_started = false;
@@ -102,6 +109,37 @@ public:
         return success;
     }
 
+    bool SetVideoEncodingPass(int pass, const string& statsPath) override
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (HasVideo())
+        {
+            m_errMsg = "Encoding pass must be set before the video stream is configured!";
+            return false;
+        }
+        if (pass < 0 || pass > 2 || (pass > 0 && statsPath.empty()))
+        {
+            ostringstream oss; oss << "INVALID arguments for 'SetVideoEncodingPass()', pass=" << pass << ", statsPath='" << statsPath << "'.";
+            m_errMsg = oss.str();
+            return false;
+        }
+        m_vidEncPass = pass;
+        m_vidStatsPath = statsPath;
+        m_vidStatsIn.clear();
+        if (pass == 2)
+        {
+            ifstream ifs(statsPath, ios::in|ios::binary);
+            if (!ifs.is_open())
+            {
+                m_errMsg = "FAILED to open the first pass statistics file '" + statsPath + "'!";
+                return false;
+            }
+            ostringstream oss; oss << ifs.rdbuf();
+            m_vidStatsIn = oss.str();
+        }
+        return true;
+    }
+
     bool ConfigureVideoStream(const std::string& codecName,
             string& imageFormat, uint32_t width, uint32_t height,
             const Ratio& frameRate, uint64_t bitRate,
@@ -160,6 +198,18 @@ public:
         return m_audStmIdx < 0 ? false : true;
     }
 
+    bool SetVideoConvertThreadCount(uint32_t count) override
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (m_started)
+        {
+            m_errMsg = "This MediaEncoder already started!";
+            return false;
+        }
+        m_vcvtThreadCount = count;
+        return true;
+    }
+
     bool Start() override
     {
         if (!m_opened)
@@ -189,6 +239,16 @@ public:
             m_errMsg = FFapiFailureMessage("avformat_write_header", fferr);
             return false;
         }
+        if (HasVideo() && m_vidEncPass == 1 && !m_vidStatsByEncoder)
+        {
+            // like x264, the statistics go to a temporary file which is renamed when the encoding is finished
+            m_vidStatsFile = fopen((m_vidStatsPath+".temp").c_str(), "wb");
+            if (!m_vidStatsFile)
+            {
+                m_errMsg = "FAILED to create the first pass statistics file '" + m_vidStatsPath + "'!";
+                return false;
+            }
+        }
 
         StartAllThreads();
         m_started = true;
@@ -213,11 +273,38 @@ public:
             m_vidinpEof = true;
         if (HasAudio())
             m_audinpEof = true;
+        m_vfrmQ.NotifyAll();
+        m_audfrmQ.NotifyAll();
         while (!m_muxEof)
-            this_thread::sleep_for(chrono::milliseconds(5));
+        {
+            const auto generation = m_pktRecvEvent.Generation();
+            m_pktRecvEvent.WaitChange(generation, [this] { return m_muxEof.load(); });
+        }
+        auto stats = GetPipelineStatistics();
+        m_logger->Log(DEBUG) << "Encoding pipeline statistics: video frame queue max/avg depth " << stats.videoFrameQ.maxDepth << "/" << stats.videoFrameQ.avgDepth
+                << " (capacity " << stats.videoFrameQ.capacity << "), producer/consumer stall " << stats.videoFrameQ.producerStallMs << "/" << stats.videoFrameQ.consumerStallMs << "ms; "
+                << "audio frame queue max/avg depth " << stats.audioFrameQ.maxDepth << "/" << stats.audioFrameQ.avgDepth
+                << " (capacity " << stats.audioFrameQ.capacity << "), producer/consumer stall " << stats.audioFrameQ.producerStallMs << "/" << stats.audioFrameQ.consumerStallMs << "ms; "
+                << stats.videoConvertThreads << " video conversion thread(s) stall " << stats.videoConvertStallMs << "ms, "
+                << "video/audio encoder stall " << stats.videoEncoderStallMs << "/" << stats.audioEncoderStallMs << "ms, muxer stall " << stats.muxerStallMs << "ms, "
+                << stats.videoDuplicateFrames << " duplicate video frame(s)." << endl;
 
-        bool success = true;
+        // an error in the pipeline is already in 'm_errMsg'
+        bool success = !m_encErr;
         int fferr;
+        if (m_vidStatsFile)
+        {
+            fclose(m_vidStatsFile);
+            m_vidStatsFile = nullptr;
+            const string tempPath = m_vidStatsPath+".temp";
+            if (!m_videncEof)
+                remove(tempPath.c_str());
+            else if (rename(tempPath.c_str(), m_vidStatsPath.c_str()) != 0)
+            {
+                m_errMsg = "FAILED to rename the first pass statistics file to '" + m_vidStatsPath + "'!";
+                success = false;
+            }
+        }
         if (m_avfmtCtx)
         {
             fferr = av_write_trailer(m_avfmtCtx);
@@ -267,21 +354,24 @@ public:
         if (!hVfrm)
         {
             m_vidinpEof = true;
+            m_vfrmQ.NotifyAll();
             return true;
         }
 
-        while (wait && m_vfrmQ.size() >= m_vmatQMaxSize && !m_quit)
-            this_thread::sleep_for(chrono::milliseconds(5));
-        if (m_quit)
-            return false;
-        if (m_vfrmQ.size() >= m_vmatQMaxSize)
-            return true;
-
+        if (wait)
         {
-            lock_guard<mutex> lk(m_vmatQLock);
-            m_vfrmQ.push_back(hVfrm);
+            if (!m_vfrmQ.WaitPush(hVfrm, [this] { return m_quit.load() || m_encErr.load(); }))
+            {
+                if (!m_encErr)
+                    m_errMsg = "Encoding is stopped!";
+                return false;
+            }
             consumed = true;
         }
+        else
+        {
+            consumed = m_vfrmQ.TryPush(hVfrm);
+        }
         return true;
     }
 
@@ -328,26 +418,33 @@ public:
             {
                 uint32_t bufoffset = m_audencfrmSmpOffset*m_audinpFrameSize;
                 memset(m_audencfrm->data[0]+bufoffset, 0, m_audencfrm->linesize[0]-bufoffset);
+                if (!m_audfrmQ.WaitPush(m_audencfrm, [this] { return m_quit.load() || m_encErr.load(); }))
                 {
-                    lock_guard<mutex> lk(m_audfrmQLock);
-                    m_audfrmQ.push_back(m_audencfrm);
+                    if (!m_encErr)
+                        m_errMsg = "Encoding is stopped!";
+                    return false;
                 }
                 m_audencfrm = nullptr;
             }
             m_audinpEof = true;
+            m_audfrmQ.NotifyAll();
             return true;
         }
 
-        if (m_audfrmQ.size() >= m_audfrmQMaxSize)
-        {
-            if (!wait)
+        uint32_t inpSamples = (uint32_t)(size/m_audinpFrameSize);
+        // when 'wait' is false, the input is only taken if the queue has room for all the frames completed by it.
+        // this thread is the only producer, so the pushes below won't block then. an input producing more frames
+        // than the queue capacity is taken when the queue is empty.
+        if (!wait)
+        {
+            const int64_t outSamples = m_swrCtx ? swr_get_out_samples(m_swrCtx, inpSamples) : inpSamples;
+            uint32_t frameCount = (uint32_t)((m_audencfrmSmpOffset+max(outSamples, (int64_t)0))/m_audencFrameSamples);
+            const auto capacity = m_audfrmQ.Capacity();
+            if (frameCount > capacity)
+                frameCount = capacity;
+            if (capacity-m_audfrmQ.Size() < frameCount)
                 return true;
-            while (m_audfrmQ.size() >= m_audfrmQMaxSize && !m_quit)
-                this_thread::sleep_for(chrono::milliseconds(5));
-            if (m_quit)
-                return false;
         }
-        uint32_t inpSamples = (uint32_t)(size/m_audinpFrameSize);
         if (inpSamples*m_audinpFrameSize != size)
         {
             m_logger->Log(WARN) << "Input audio data size " << size << " is NOT an integral multiply of input-frame-size " << m_audinpFrameSize << "!" << endl;
@@ -413,16 +510,20 @@ public:
 
             if (m_audencfrmSmpOffset >= m_audencfrm->nb_samples)
             {
-                lock_guard<mutex> lk(m_audfrmQLock);
-                m_audfrmQ.push_back(m_audencfrm);
+                if (!m_audfrmQ.WaitPush(m_audencfrm, [this] { return m_quit.load() || m_encErr.load(); }))
+                    break;
                 m_audfrmPts += m_audencfrm->nb_samples;
                 m_audencfrm = nullptr;
                 m_audencfrmSmpOffset = 0;
             }
         }
         consumed = true;
-        if (m_quit)
+        if (m_quit || m_encErr)
+        {
+            if (!m_encErr)
+                m_errMsg = "Encoding is stopped!";
             return false;
+        }
 
         return true;
     }
@@ -662,6 +763,7 @@ private:
             m_videncPixfmt = pHwFrmCtx->sw_format;
         }
         m_videnc = (AVCodec *)m_videncCtx->codec;
+        m_vidStatsByEncoder = string(m_videnc->name) == "libx264" || string(m_videnc->name) == "libx265";
         m_logger->Log(DEBUG) << "Choose to use video encoder '" << m_videnc->name << "'." << endl;
         m_logger->Log(DEBUG) << "Choose to use encoding pixel-format '" << av_get_pix_fmt_name(m_videncPixfmt) << "'." << endl;
 
@@ -682,9 +784,10 @@ private:
             return false;
         }
 
-        m_vmatQMaxSize = (uint32_t)(((double)m_videncCtx->framerate.num/m_videncCtx->framerate.den)*m_dataQCacheDur);
-        if (m_vmatQMaxSize < 2)
-            m_vmatQMaxSize = 2;
+        uint32_t vfrmQMaxSize = (uint32_t)(((double)m_videncCtx->framerate.num/m_videncCtx->framerate.den)*m_dataQCacheDur);
+        if (vfrmQMaxSize < 2)
+            vfrmQMaxSize = 2;
+        m_vfrmQ.Reset(vfrmQMaxSize);
 
         m_vidAvStm = avformat_new_stream(m_avfmtCtx, m_videnc);
         if (!m_vidAvStm)
@@ -869,6 +972,11 @@ private:
 
         if (bGlobalHeader)
             (*ppVidencCtx)->flags |= AV_CODEC_FLAG_GLOBAL_HEADER; 
+        if (m_vidEncPass > 0 && !SetupTwoPassEncoding(videnc, *ppVidencCtx, &encOpts))
+        {
+            av_dict_free(&encOpts);
+            return false;
+        }
         fferr = avcodec_open2(*ppVidencCtx, videnc, &encOpts);
         if (fferr < 0)
         {
@@ -880,6 +988,45 @@ private:
         return true;
     }
 
+    bool SetupTwoPassEncoding(AVCodecPtr videnc, AVCodecContext* pVidencCtx, AVDictionary** ppEncOpts)
+    {
+        if (videnc->capabilities&AV_CODEC_CAP_HARDWARE)
+        {
+            ostringstream oss; oss << "Hardware encoder '" << videnc->name << "' does NOT support two-pass encoding!";
+            m_errMsg = oss.str();
+            m_logger->Log(DEBUG) << m_errMsg << endl;
+            return false;
+        }
+        pVidencCtx->flags |= m_vidEncPass == 1 ? AV_CODEC_FLAG_PASS1 : AV_CODEC_FLAG_PASS2;
+        const string encName(videnc->name);
+        if (encName == "libx264")
+        {
+            // x264 reads and writes the statistics file by itself
+            av_dict_set(ppEncOpts, "stats", m_vidStatsPath.c_str(), 0);
+        }
+        else if (encName == "libx265")
+        {
+            ostringstream oss;
+            auto pEntry = av_dict_get(*ppEncOpts, "x265-params", nullptr, 0);
+            if (pEntry && pEntry->value[0])
+                oss << pEntry->value << ":";
+            oss << "pass=" << m_vidEncPass << ":stats='" << m_vidStatsPath << "'";
+            av_dict_set(ppEncOpts, "x265-params", oss.str().c_str(), 0);
+        }
+        else if (m_vidEncPass == 2)
+        {
+            // owned by this encoder, 'avcodec_free_context()' doesn't release it
+            pVidencCtx->stats_in = (char*)m_vidStatsIn.c_str();
+        }
+        return true;
+    }
+
+    void WriteFirstPassStats()
+    {
+        if (m_vidStatsFile && m_videncCtx->stats_out)
+            fprintf(m_vidStatsFile, "%s", m_videncCtx->stats_out);
+    }
+
     void CloseVideoComponents()
     {
         if (m_videncCtx)
@@ -887,6 +1034,13 @@ private:
             avcodec_free_context(&m_videncCtx);
             m_videncCtx = nullptr;
         }
+        if (m_vidStatsFile)
+        {
+            // encoding is not finished, the statistics are incomplete
+            fclose(m_vidStatsFile);
+            m_vidStatsFile = nullptr;
+            remove((m_vidStatsPath+".temp").c_str());
+        }
         m_videnc = nullptr;
         m_videncPixfmt = AV_PIX_FMT_NONE;
         m_vidAvStm = nullptr;
@@ -968,9 +1122,10 @@ private:
         m_audinpFrameSize = av_get_bytes_per_sample(m_audinpSmpfmt)*channels;
         m_audencFrameSize = av_get_bytes_per_sample(m_audencSmpfmt)*channels;
 
-        m_audfrmQMaxSize = (uint32_t)(m_dataQCacheDur*sampleRate/m_audencFrameSamples);
-        if (m_audfrmQMaxSize < 2)
-            m_audfrmQMaxSize = 2;
+        uint32_t audfrmQMaxSize = (uint32_t)(m_dataQCacheDur*sampleRate/m_audencFrameSamples);
+        if (audfrmQMaxSize < 2)
+            audfrmQMaxSize = 2;
+        m_audfrmQ.Reset(audfrmQMaxSize);
 
         m_audAvStm = avformat_new_stream(m_avfmtCtx, m_audenc);
         if (!m_audAvStm)
@@ -1043,8 +1198,13 @@ private:
         string fileName = SysUtils::ExtractFileName(m_avfmtCtx->url);
         ostringstream thnOss;
         m_quit = false;
+        m_videncStallUs = m_audencStallUs = m_muxStallUs = 0;
+        m_vcvtLastMat.release();
+        m_prevEncfrm = nullptr;
+        m_vidDupFrameCount = 0;
         if (HasVideo())
         {
+            StartVideoConvertThreads();
             m_videncThread = thread(&MediaEncoder_Impl::VideoEncodingThreadProc, this);
             thnOss << "EncVenc-" << fileName;
             SysUtils::SetThreadName(m_videncThread, thnOss.str());
@@ -1060,9 +1220,36 @@ private:
         SysUtils::SetThreadName(m_muxThread, thnOss.str());
     }
 
+    // Stop the pipeline on an error in one of the threads. The other threads and the producers blocked in
+    // 'EncodeVideoFrame()' or 'EncodeAudioSamples()' are woken up, the api calls return this error.
+    void SetEncodingError(const string& errMsg)
+    {
+        m_errMsg = errMsg;
+        m_logger->Log(Error) << errMsg << endl;
+        m_encErr = true;
+        m_vfrmQ.NotifyAll();
+        m_audfrmQ.NotifyAll();
+        m_encSentEvent.Notify();
+        m_pktRecvEvent.Notify();
+        m_vcvtDoneEvent.Notify();
+    }
+
     void TerminateAllThreads()
     {
         m_quit = true;
+        m_vfrmQ.NotifyAll();
+        m_audfrmQ.NotifyAll();
+        m_encSentEvent.Notify();
+        m_pktRecvEvent.Notify();
+        m_vcvtDoneEvent.Notify();
+        for (auto& hInputQ : m_vcvtInputQs)
+            hInputQ->NotifyAll();
+        for (auto& t : m_vcvtThreads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+        m_vcvtThreads.clear();
         if (m_videncThread.joinable())
             m_videncThread.join();
         if (m_audencThread.joinable())
@@ -1073,76 +1260,248 @@ private:
 
     void FlushAllQueues()
     {
-        m_vfrmQ.clear();
-        m_audfrmQ.clear();
+        m_vfrmQ.Clear();
+        m_audfrmQ.Clear();
+        m_vcvtInputQs.clear();
+        m_vcvtCvters.clear();
+        m_vcvtLastMat.release();
+        m_prevEncfrm = nullptr;
     }
 
-    SelfFreeAVFramePtr ConvertImMatToAVFrame(ImGui::ImMat& vmat)
+    // Return nullptr for an empty 'vmat', or on failure with the reason in 'errMsg'
+    SelfFreeAVFramePtr ConvertImMatToAVFrame(ImMatToAVFrameConverter& cvter, ImGui::ImMat& vmat, string& errMsg)
     {
         if (vmat.empty())
             return nullptr;
         SelfFreeAVFramePtr vfrm = AllocSelfFreeAVFramePtr();
         if (!vfrm)
         {
-            m_logger->Log(Error) << "FAILED to allocate new 'SelfFreeAVFramePtr'!";
+            errMsg = "FAILED to allocate new 'SelfFreeAVFramePtr'!";
             return nullptr;
         }
         int64_t pts = av_rescale_q((int64_t)(vmat.time_stamp*1000), MILLISEC_TIMEBASE, m_videncCtx->time_base);
-        m_imgCvter.ConvertImage(vmat, vfrm.get(), pts);
+        if (!cvter.ConvertImage(vmat, vfrm.get(), pts))
+        {
+            errMsg = "FAILED to convert ImMat to AVFrame! Error is '" + cvter.GetError() + "'.";
+            return nullptr;
+        }
         return vfrm;
     }
 
+    // Video frames are converted to the encoding pixel format by 'm_vcvtThreads' ahead of the encoder. The encoding
+    // thread hands out the frames round-robin and takes the results back in the input order, which is the pts order.
+    struct VideoConvertJob
+    {
+        using Holder = shared_ptr<VideoConvertJob>;
+        VideoFrame::Holder hVfrm;
+        SelfFreeAVFramePtr encfrm;
+        atomic_bool done{false};
+        bool duplicated{false};     // same content as the previous frame, not converted
+        string errMsg;              // the conversion failed, it stops the encoding
+        ImGui::ImMat prevMat;       // the image of the previous frame, released once it is compared
+    };
+
+    void StartVideoConvertThreads()
+    {
+        uint32_t threadCount = m_vcvtThreadCount;
+        const uint32_t cpuCores = thread::hardware_concurrency();
+        if (threadCount == 0)
+        {
+            // leave most of the cores to the encoder itself
+            threadCount = cpuCores/4;
+            if (threadCount < 1)
+                threadCount = 1;
+            else if (threadCount > 4)
+                threadCount = 4;
+        }
+        // with a single conversion thread, let swscale split the image into slices instead
+        uint32_t swsThreads = threadCount > 1 ? 1 : cpuCores/4;
+        if (swsThreads > 4)
+            swsThreads = 4;
+
+        string fileName = SysUtils::ExtractFileName(m_avfmtCtx->url);
+        m_vcvtInputQs.clear();
+        m_vcvtCvters.clear();
+        m_vcvtNextThread = 0;
+        m_vcvtStallUs = 0;
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            unique_ptr<ImMatToAVFrameConverter> hCvter(new ImMatToAVFrameConverter());
+            hCvter->SetUseVulkanConverter(true);
+            hCvter->SetOutSize(m_videncCtx->width, m_videncCtx->height);
+            hCvter->SetOutPixelFormat(m_videncPixfmt);
+            hCvter->SetSwsThreadCount(swsThreads);
+            m_vcvtCvters.push_back(move(hCvter));
+            m_vcvtInputQs.push_back(unique_ptr<BoundedQueue<VideoConvertJob::Holder>>(new BoundedQueue<VideoConvertJob::Holder>(2)));
+        }
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            m_vcvtThreads.push_back(thread(&MediaEncoder_Impl::VideoConvertThreadProc, this, i));
+            ostringstream thnOss; thnOss << "EncVcvt" << i << "-" << fileName;
+            SysUtils::SetThreadName(m_vcvtThreads.back(), thnOss.str());
+        }
+        m_logger->Log(DEBUG) << "Use " << threadCount << " video conversion thread(s), with " << swsThreads << " swscale slice thread(s) each." << endl;
+    }
+
+    void VideoConvertThreadProc(uint32_t index)
+    {
+        m_logger->Log(DEBUG) << "Enter VideoConvertThreadProc(" << index << ")..." << endl;
+        auto& inputQ = *m_vcvtInputQs[index];
+        auto& cvter = *m_vcvtCvters[index];
+        VideoConvertJob::Holder hJob;
+        while (!m_quit && inputQ.WaitPop(hJob, [this] { return m_quit.load(); }))
+        {
+            ConvertVideoJob(cvter, hJob);
+            hJob = nullptr;
+        }
+        m_logger->Log(DEBUG) << "Leave VideoConvertThreadProc(" << index << ")." << endl;
+    }
+
+    // Only cpu images are compared, a gpu image is always converted
+    static bool IsSameImageContent(const ImGui::ImMat& mat1, const ImGui::ImMat& mat2)
+    {
+        if (mat1.empty() || mat2.empty() || mat1.device != IM_DD_CPU || mat2.device != IM_DD_CPU)
+            return false;
+        if (mat1.w != mat2.w || mat1.h != mat2.h || mat1.c != mat2.c || mat1.cstep != mat2.cstep || mat1.elemsize != mat2.elemsize ||
+            mat1.type != mat2.type || mat1.color_format != mat2.color_format || mat1.color_space != mat2.color_space ||
+            mat1.color_range != mat2.color_range)
+            return false;
+        return mat1.data == mat2.data || memcmp(mat1.data, mat2.data, mat1.total()*mat1.elemsize) == 0;
+    }
+
+    // Freeze frames, still images and static titles produce runs of identical frames. Such a frame skips the
+    // conversion and the encoder gets a new reference of the previous converted AVFrame. The conversion threads
+    // compare each image with the previous one, which is held by the job until then. The comparison returns at
+    // the first different byte, so changing frames cost little.
+    void ConvertVideoJob(ImMatToAVFrameConverter& cvter, VideoConvertJob::Holder hJob)
+    {
+        auto& vmat = *((ImGui::ImMat*)hJob->hVfrm->GetNativeData().pData);
+        hJob->duplicated = IsSameImageContent(hJob->prevMat, vmat);
+        hJob->prevMat.release();
+        if (!hJob->duplicated)
+            hJob->encfrm = ConvertImMatToAVFrame(cvter, vmat, hJob->errMsg);
+        hJob->done = true;
+        m_vcvtDoneEvent.Notify();
+    }
+
+    void SubmitVideoFrame(VideoFrame::Holder hVfrm, deque<VideoConvertJob::Holder>& pendingJobs)
+    {
+        VideoConvertJob::Holder hJob(new VideoConvertJob());
+        hJob->hVfrm = hVfrm;
+        auto tNatvieData = hVfrm->GetNativeData();
+        if (tNatvieData.eType == VideoFrame::NativeData::MAT)
+        {
+            hJob->prevMat = m_vcvtLastMat;
+            m_vcvtLastMat = *((ImGui::ImMat*)tNatvieData.pData);
+            if (!m_vcvtInputQs.empty())
+            {
+                auto& inputQ = *m_vcvtInputQs[m_vcvtNextThread];
+                m_vcvtNextThread = (m_vcvtNextThread+1)%m_vcvtInputQs.size();
+                if (!inputQ.WaitPush(hJob, [this] { return m_quit.load(); }))
+                    return;
+            }
+            else
+            {
+                ConvertVideoJob(m_imgCvter, hJob);
+            }
+        }
+        else
+        {
+            m_vcvtLastMat.release();
+            if (tNatvieData.eType == VideoFrame::NativeData::AVFRAME)
+                hJob->encfrm = CloneSelfFreeAVFramePtr((const AVFrame*)tNatvieData.pData);
+            else if (tNatvieData.eType == VideoFrame::NativeData::AVFRAME_HOLDER)
+                hJob->encfrm = *((SelfFreeAVFramePtr*)tNatvieData.pData);
+            else
+                hJob->errMsg = "UNSUPPORTED 'VideoFrame::NativeData::Type' " + to_string((int)tNatvieData.eType) + "!";
+            hJob->done = true;
+        }
+        pendingJobs.push_back(hJob);
+    }
+
     void VideoEncodingThreadProc()
     {
         m_logger->Log(DEBUG) << "Enter VideoEncodingThreadProc()..." << endl;
 
         VideoFrame::Holder hVfrm;
         SelfFreeAVFramePtr encfrm;
+        deque<VideoConvertJob::Holder> pendingJobs;
+        const size_t maxPendingJobs = m_vcvtInputQs.empty() ? 1 : m_vcvtInputQs.size()*2;
         m_vidNullFrameSent = false;
-        while (!m_quit)
+        const auto stopWaiting = [this] { return m_quit.load() || m_muxEof.load() || m_encErr.load(); };
+        while (!m_quit && !m_encErr)
         {
-            bool idleLoop = true;
             int fferr;
 
             if (!encfrm)
             {
-                if (!m_vfrmQ.empty())
+                // keep the conversion threads busy
+                while (pendingJobs.size() < maxPendingJobs && m_vfrmQ.TryPop(hVfrm))
+                    SubmitVideoFrame(hVfrm, pendingJobs);
+                if (pendingJobs.empty() && m_vfrmQ.WaitPop(hVfrm, [this] { return m_quit.load() || m_vidinpEof.load() || m_encErr.load(); }))
+                    SubmitVideoFrame(hVfrm, pendingJobs);
+
+                if (!pendingJobs.empty())
                 {
+                    auto hJob = pendingJobs.front();
+                    if (!hJob->done)
                     {
-                        lock_guard<mutex> lk(m_vmatQLock);
-                        hVfrm = m_vfrmQ.front();
-                        m_vfrmQ.pop_front();
+                        const auto generation = m_vcvtDoneEvent.Generation();
+                        m_vcvtStallUs += m_vcvtDoneEvent.WaitChange(generation, [this, &hJob] { return m_quit.load() || m_encErr.load() || hJob->done.load(); });
+                        continue;
+                    }
+                    pendingJobs.pop_front();
+                    hVfrm = hJob->hVfrm;
+                    if (hJob->duplicated)
+                    {
+                        auto& vmat = *((ImGui::ImMat*)hVfrm->GetNativeData().pData);
+                        if (m_prevEncfrm)
+                        {
+                            encfrm = CloneSelfFreeAVFramePtr(m_prevEncfrm.get());
+                            if (encfrm)
+                            {
+                                encfrm->pts = av_rescale_q((int64_t)(vmat.time_stamp*1000), MILLISEC_TIMEBASE, m_videncCtx->time_base);
+                                m_vidDupFrameCount++;
+                            }
+                        }
+                        else
+                        {
+                            // the previous frame failed to convert
+                            encfrm = ConvertImMatToAVFrame(m_imgCvter, vmat, hJob->errMsg);
+                            m_prevEncfrm = encfrm;
+                        }
                     }
-                    auto tNatvieData = hVfrm->GetNativeData();
-                    if (tNatvieData.eType == VideoFrame::NativeData::AVFRAME)
-                        encfrm = CloneSelfFreeAVFramePtr((const AVFrame*)tNatvieData.pData);
-                    else if (tNatvieData.eType == VideoFrame::NativeData::AVFRAME_HOLDER)
-                        encfrm = *((SelfFreeAVFramePtr*)tNatvieData.pData);
-                    else if (tNatvieData.eType == VideoFrame::NativeData::MAT)
-                        encfrm = ConvertImMatToAVFrame(*((ImGui::ImMat*)tNatvieData.pData));
                     else
-                        m_logger->Log(Error) << "UNSUPPORTED 'VideoFrame::NativeData::Type' " << (int)tNatvieData.eType << "!" << endl;
+                    {
+                        encfrm = hJob->encfrm;
+                        m_prevEncfrm = encfrm;
+                    }
+                    if (!hJob->errMsg.empty())
+                    {
+                        SetEncodingError(hJob->errMsg);
+                        break;
+                    }
                     if (encfrm && encfrm->format != m_videncPixfmt)
                     {
                         ostringstream oss; oss << "INVALID encoding AVFrame pixel format, input frame has format " << encfrm->format << "(" << av_get_pix_fmt_name((AVPixelFormat)encfrm->format)
                                 << "), while the required input format is " << m_videncPixfmt << "(" << av_get_pix_fmt_name(m_videncPixfmt) << ")!";
-                        m_errMsg = oss.str();
-                        throw runtime_error(m_errMsg);
+                        SetEncodingError(oss.str());
+                        break;
                     }
-                    if (m_videncCtx->hw_frames_ctx && m_videncCtx->pix_fmt != (AVPixelFormat)encfrm->format)
+                    if (encfrm && m_videncCtx->hw_frames_ctx && m_videncCtx->pix_fmt != (AVPixelFormat)encfrm->format)
                     {
                         SelfFreeAVFramePtr hwfrm = AllocSelfFreeAVFramePtr();
                         if ((fferr = av_hwframe_get_buffer(m_videncCtx->hw_frames_ctx, hwfrm.get(), 0)) < 0)
                         {
                             stringstream oss; oss << "FAILED to allocate buffer for hardware frame, av_hwframe_get_buffer() returns " << fferr << "!";
-                            m_errMsg = oss.str();
-                            throw runtime_error(m_errMsg);
+                            SetEncodingError(oss.str());
+                            break;
                         }
                         if ((fferr = av_hwframe_transfer_data(hwfrm.get(), encfrm.get(), 0)) < 0)
                         {
                             stringstream oss; oss << "FAILED to transfer data to hardware frame, av_hwframe_transfer_data() returns " << fferr << "!";
-                            m_errMsg = oss.str();
-                            throw runtime_error(m_errMsg);
+                            SetEncodingError(oss.str());
+                            break;
                         }
                         av_frame_copy_props(hwfrm.get(), encfrm.get());
                         encfrm = hwfrm;
@@ -1150,23 +1509,27 @@ private:
                 }
                 else if (m_vidinpEof)
                 {
+                    const auto generation = m_pktRecvEvent.Generation();
                     {
                         lock_guard<mutex> lk(m_videncLock);
-                        avcodec_send_frame(m_videncCtx, NULL);
-                        m_vidNullFrameSent = true;
+                        fferr = avcodec_send_frame(m_videncCtx, NULL);
                         // m_logger->Log(DEBUG) << "--> SEND NULL video frame!! fferr=" << fferr << endl;
                     }
                     if (fferr == 0)
                     {
+                        m_vidNullFrameSent = true;
+                        m_encSentEvent.Notify();
                         m_logger->Log(DEBUG) << "Sent encode video EOF." << endl;
                         break;
                     }
-                    else if (fferr != AVERROR(EAGAIN))
+                    else if (fferr == AVERROR(EAGAIN))
+                    {
+                        m_videncStallUs += m_pktRecvEvent.WaitChange(generation, stopWaiting);
+                    }
+                    else
                     {
                         ostringstream oss; oss << "Video encoder ERROR! avcodec_send_frame(EOF) returns " << fferr << ".";
-                        m_errMsg = oss.str();
-                        m_logger->Log(Error) << m_errMsg << endl;
-                        m_encErr = true;
+                        SetEncodingError(oss.str());
                         break;
                     }
                 }
@@ -1174,6 +1537,8 @@ private:
 
             if (encfrm)
             {
+                // read the generation before sending, so a packet received in between won't be missed
+                const auto generation = m_pktRecvEvent.Generation();
                 {
                     lock_guard<mutex> lk(m_videncLock);
                     fferr = avcodec_send_frame(m_videncCtx, encfrm.get());
@@ -1186,23 +1551,20 @@ private:
                     //     << "(" << encfrm->pts << ")." << endl;
                     encfrm = nullptr;
                     hVfrm = nullptr;
-                    idleLoop = false;
+                    m_encSentEvent.Notify();
+                }
+                else if (fferr == AVERROR(EAGAIN))
+                {
+                    // the encoder is full, wait for the muxing thread to take out some packets
+                    m_videncStallUs += m_pktRecvEvent.WaitChange(generation, stopWaiting);
                 }
                 else
                 {
-                    if (fferr != AVERROR(EAGAIN))
-                    {
-                        ostringstream oss; oss << "Video encoder ERROR! avcodec_send_frame() returns " << fferr << ".";
-                        m_errMsg = oss.str();
-                        m_logger->Log(Error) << m_errMsg << endl;
-                        m_encErr = true;
-                        break;
-                    }
+                    ostringstream oss; oss << "Video encoder ERROR! avcodec_send_frame() returns " << fferr << ".";
+                    SetEncodingError(oss.str());
+                    break;
                 }
             }
-
-            if (idleLoop)
-                this_thread::sleep_for(chrono::milliseconds(2));
         }
 
         m_logger->Log(DEBUG) << "Leave VideoEncodingThreadProc()." << endl;
@@ -1214,38 +1576,36 @@ private:
 
         SelfFreeAVFramePtr encfrm;
         m_audNullFrameSent = false;
-        while (!m_quit)
+        const auto stopWaiting = [this] { return m_quit.load() || m_muxEof.load() || m_encErr.load(); };
+        while (!m_quit && !m_encErr)
         {
-            bool idleLoop = true;
             int fferr;
 
             if (!encfrm)
             {
-                if (!m_audfrmQ.empty())
-                {
-                    lock_guard<mutex> lk(m_audfrmQLock);
-                    encfrm = m_audfrmQ.front();
-                    m_audfrmQ.pop_front();
-                }
-                else if (m_audinpEof)
+                if (!m_audfrmQ.WaitPop(encfrm, [this] { return m_quit.load() || m_audinpEof.load() || m_encErr.load(); }) && m_audinpEof)
                 {
+                    const auto generation = m_pktRecvEvent.Generation();
                     {
                         lock_guard<mutex> lk(m_audencLock);
                         fferr = avcodec_send_frame(m_audencCtx, NULL);
-                        m_audNullFrameSent = true;
                         // m_logger->Log(DEBUG) << "================> SEND NULL audio frame!! fferr=" << fferr << endl;
                     }
                     if (fferr == 0)
                     {
+                        m_audNullFrameSent = true;
+                        m_encSentEvent.Notify();
                         m_logger->Log(DEBUG) << "Sent encode audio EOF." << endl;
                         break;
                     }
-                    else if (fferr != AVERROR(EAGAIN))
+                    else if (fferr == AVERROR(EAGAIN))
+                    {
+                        m_audencStallUs += m_pktRecvEvent.WaitChange(generation, stopWaiting);
+                    }
+                    else
                     {
                         ostringstream oss; oss << "Audio encoder ERROR! avcodec_send_frame(EOF) returns " << fferr << ".";
-                        m_errMsg = oss.str();
-                        m_logger->Log(Error) << m_errMsg << endl;
-                        m_encErr = true;
+                        SetEncodingError(oss.str());
                         break;
                     }
                 }
@@ -1253,7 +1613,7 @@ private:
 
             if (encfrm)
             {
-                int fferr;
+                const auto generation = m_pktRecvEvent.Generation();
                 {
                     lock_guard<mutex> lk(m_audencLock);
                     fferr = avcodec_send_frame(m_audencCtx, encfrm.get());
@@ -1265,20 +1625,19 @@ private:
                     //     << MillisecToString(av_rescale_q(encfrm->pts, m_audencCtx->time_base, MILLISEC_TIMEBASE))
                     //     << "(" << encfrm->pts << ")." << endl;
                     encfrm = nullptr;
-                    idleLoop = false;
+                    m_encSentEvent.Notify();
                 }
-                else if (fferr != AVERROR(EAGAIN))
+                else if (fferr == AVERROR(EAGAIN))
+                {
+                    m_audencStallUs += m_pktRecvEvent.WaitChange(generation, stopWaiting);
+                }
+                else
                 {
                     ostringstream oss; oss << "Audio encoder ERROR! avcodec_send_frame() returns " << fferr << ".";
-                    m_errMsg = oss.str();
-                    m_logger->Log(Error) << m_errMsg << endl;
-                    m_encErr = true;
+                    SetEncodingError(oss.str());
                     break;
                 }
             }
-
-            if (idleLoop)
-                this_thread::sleep_for(chrono::milliseconds(2));
         }
 
         m_logger->Log(DEBUG) << "Leave AudioEncodingThreadProc()." << endl;
@@ -1291,10 +1650,12 @@ private:
         AVPacket avpkt{0};
         bool avpktLoaded = false;
         int64_t vidposMts{0}, audposMts{0};
-        while (!m_quit)
+        while (!m_quit && !m_encErr)
         {
             bool idleLoop = true;
             int fferr;
+            // read the generation before receiving, so a frame sent in between won't be missed
+            const auto generation = m_encSentEvent.Generation();
 
             // bool toRecvVidpkt = !m_videncEof && !avpktLoaded && (vidposMts <= audposMts || m_audencEof);
             // m_logger->Log(DEBUG) << "toRecvVidpkt=" << toRecvVidpkt << ", m_videncEof=" << m_videncEof << ", avpktLoaded=" << avpktLoaded << ", vidposMts=" << vidposMts << ", audposMts=" << audposMts << ", m_audencEof=" << m_audencEof << endl;
@@ -1313,15 +1674,26 @@ private:
                     idleLoop = false;
                     vidposMts = av_rescale_q(avpkt.pts, m_vidAvStm->time_base, MILLISEC_TIMEBASE);
                     m_logger->Log(DEBUG) << "Got VIDEO packet at " << MillisecToString(vidposMts) << "(" << avpkt.pts << ")." << endl;
+                    m_pktRecvEvent.Notify();
+                    if (m_vidEncPass == 1)
+                    {
+                        // only the statistics are needed from the first pass
+                        WriteFirstPassStats();
+                        av_packet_unref(&avpkt);
+                        avpktLoaded = false;
+                    }
                 }
                 else if (fferr == AVERROR_EOF)
                 {
+                    if (m_vidEncPass == 1)
+                        WriteFirstPassStats();
                     m_videncEof = true;
                     idleLoop = false;
                 }
                 else if (fferr != AVERROR(EAGAIN))
                 {
-                    m_logger->Log(Error) << "In muxing thread, video 'avcodec_receive_packet' FAILED with return code " << fferr << "!" << endl;
+                    ostringstream oss; oss << "In muxing thread, video 'avcodec_receive_packet' FAILED with return code " << fferr << "!";
+                    SetEncodingError(oss.str());
                     break;
                 }
                 else if (m_vidNullFrameSent)
@@ -1349,6 +1721,7 @@ private:
                     idleLoop = false;
                     audposMts = av_rescale_q(avpkt.pts, m_audAvStm->time_base, MILLISEC_TIMEBASE);
                     m_logger->Log(DEBUG) << "Got AUDIO packet at " << MillisecToString(audposMts) << "(" << avpkt.pts << ")." << endl;
+                    m_pktRecvEvent.Notify();
                 }
                 else if (fferr == AVERROR_EOF)
                 {
@@ -1357,7 +1730,8 @@ private:
                 }
                 else if (fferr != AVERROR(EAGAIN))
                 {
-                    m_logger->Log(Error) << "In muxing thread, audio 'avcodec_receive_packet' FAILED with return code " << fferr << "!" << endl;
+                    ostringstream oss; oss << "In muxing thread, audio 'avcodec_receive_packet' FAILED with return code " << fferr << "!";
+                    SetEncodingError(oss.str());
                     break;
                 }
                 else if (m_audNullFrameSent)
@@ -1379,7 +1753,8 @@ private:
                 }
                 else
                 {
-                    m_logger->Log(Error) << "'av_interleaved_write_frame' FAILED with return code " << fferr << "!" << endl;
+                    ostringstream oss; oss << "'av_interleaved_write_frame' FAILED with return code " << fferr << "!";
+                    SetEncodingError(oss.str());
                     break;
                 }
             }
@@ -1388,20 +1763,46 @@ private:
                 break;
             }
 
+            // nothing can be done until an encoding thread sends a new frame
             if (idleLoop)
-                this_thread::sleep_for(chrono::milliseconds(1));
+                m_muxStallUs += m_encSentEvent.WaitChange(generation, [this] { return m_quit.load() || m_encErr.load(); });
         }
 
         m_muxEof = true;
+        m_pktRecvEvent.Notify();
         m_logger->Log(DEBUG) << "Leave MuxingThreadProc()." << endl;
     }
 
+    PipelineStatistics GetPipelineStatistics() const override
+    {
+        PipelineStatistics stats;
+        const auto vfrmQStats = m_vfrmQ.GetStatistics();
+        stats.videoFrameQ.capacity = vfrmQStats.capacity;
+        stats.videoFrameQ.maxDepth = vfrmQStats.maxDepth;
+        stats.videoFrameQ.avgDepth = vfrmQStats.avgDepth;
+        stats.videoFrameQ.producerStallMs = vfrmQStats.pushStallUs/1000;
+        stats.videoFrameQ.consumerStallMs = vfrmQStats.popStallUs/1000;
+        const auto audfrmQStats = m_audfrmQ.GetStatistics();
+        stats.audioFrameQ.capacity = audfrmQStats.capacity;
+        stats.audioFrameQ.maxDepth = audfrmQStats.maxDepth;
+        stats.audioFrameQ.avgDepth = audfrmQStats.avgDepth;
+        stats.audioFrameQ.producerStallMs = audfrmQStats.pushStallUs/1000;
+        stats.audioFrameQ.consumerStallMs = audfrmQStats.popStallUs/1000;
+        stats.videoConvertThreads = (uint32_t)m_vcvtCvters.size();
+        stats.videoConvertStallMs = m_vcvtStallUs/1000;
+        stats.videoEncoderStallMs = m_videncStallUs/1000;
+        stats.audioEncoderStallMs = m_audencStallUs/1000;
+        stats.muxerStallMs = m_muxStallUs/1000;
+        stats.videoDuplicateFrames = m_vidDupFrameCount;
+        return stats;
+    }
+
 private:
     string m_errMsg;
     ALogger* m_logger;
     recursive_mutex m_apiLock;
     bool m_vidPreferUseHw{true};
-    bool m_quit{false};
+    atomic_bool m_quit{false};
     bool m_opened{false};
     bool m_started{false};
 
@@ -1429,32 +1830,49 @@ private:
     SwrContext* m_swrCtx{nullptr};
 
     ImMatToAVFrameConverter m_imgCvter;
+    // two-pass encoding
+    int m_vidEncPass{0};
+    string m_vidStatsPath;
+    string m_vidStatsIn;
+    bool m_vidStatsByEncoder{false};
+    FILE* m_vidStatsFile{nullptr};
+    // video conversion threads
+    uint32_t m_vcvtThreadCount{0};
+    vector<thread> m_vcvtThreads;
+    vector<unique_ptr<ImMatToAVFrameConverter>> m_vcvtCvters;
+    vector<unique_ptr<BoundedQueue<VideoConvertJob::Holder>>> m_vcvtInputQs;
+    size_t m_vcvtNextThread{0};
+    PipelineEvent m_vcvtDoneEvent;
+    atomic<int64_t> m_vcvtStallUs{0};
+    // duplicate frame detection
+    ImGui::ImMat m_vcvtLastMat;
+    SelfFreeAVFramePtr m_prevEncfrm;
+    atomic<int64_t> m_vidDupFrameCount{0};
 
     double m_dataQCacheDur{0.02};
+    // the encoding threads notify 'm_encSentEvent' after a frame is sent to the encoder, the muxing thread
+    // notifies 'm_pktRecvEvent' after a packet is received from the encoder, so none of them has to poll.
+    PipelineEvent m_encSentEvent;
+    PipelineEvent m_pktRecvEvent;
     // video encoding thread
     thread m_videncThread;
-    list<VideoFrame::Holder> m_vfrmQ;
-    uint32_t m_vmatQMaxSize;
-    mutex m_vmatQLock;
-    bool m_vidinpEof{false};
-    bool m_vidNullFrameSent{false};
-    bool m_videncEof{false};
+    BoundedQueue<VideoFrame::Holder> m_vfrmQ;
+    atomic_bool m_vidinpEof{false};
+    atomic_bool m_vidNullFrameSent{false};
+    atomic_bool m_videncEof{false};
+    atomic<int64_t> m_videncStallUs{0};
     // audio encoding thread
     thread m_audencThread;
-    list<SelfFreeAVFramePtr> m_audfrmQ;
-    uint32_t m_audfrmQMaxSize;
-    mutex m_audfrmQLock;
-    bool m_audinpEof{false};
-    bool m_audNullFrameSent{false};
-    bool m_audencEof{false};
+    BoundedQueue<SelfFreeAVFramePtr> m_audfrmQ;
+    atomic_bool m_audinpEof{false};
+    atomic_bool m_audNullFrameSent{false};
+    atomic_bool m_audencEof{false};
+    atomic<int64_t> m_audencStallUs{0};
     // muxing thread
     thread m_muxThread;
-    list<AVPacket*> m_vidpktQ;
-    mutex m_vidpktQLock;
-    list<AVPacket*> m_audpktQ;
-    mutex m_audpktQLock;
-    bool m_muxEof{false};
-    bool m_encErr{false};
+    atomic_bool m_muxEof{false};
+    atomic_bool m_encErr{false};
+    atomic<int64_t> m_muxStallUs{0};
 };
 
 static const auto MEDIA_ENCODER_HOLDER_DELETER = [] (MediaEncoder* p) {
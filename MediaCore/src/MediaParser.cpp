@@ -26,6 +26,7 @@
 #include <sstream>
 #include "ThreadUtils.h"
 #include "MediaParser.h"
+#include "MediaAnalysisCache.h"
 #include "FFUtils.h"
 extern "C"
 {
@@ -49,13 +50,19 @@ using std::placeholders::_1;
 
 namespace MediaCore
 {
+// the key frames of media without index are scanned by at most this many threads, each on a time range which
+// contains at least this many seek point steps
+static const uint32_t MAX_SEEK_POINTS_SCAN_THREADS = 4;
+static const int64_t MIN_SEEK_POINTS_PER_SCAN_SEGMENT = 16;
+// a batch prober created with the default parallelism uses at most this many threads
+static const uint32_t MAX_DEFAULT_BATCH_PROBE_THREADS = 8;
+
 class MediaParser_Impl : public MediaParser
 {
 public:
     MediaParser_Impl()
     {
         m_logger = MediaParser::GetLogger();
-        m_taskThread = thread(&MediaParser_Impl::TaskThreadProc, this);
     }
 
     MediaParser_Impl(const MediaParser_Impl&) = delete;
@@ -76,6 +83,30 @@ public:
     }
 
     bool Open(const string& url) override
+    {
+        return OpenMedia(url, false);
+    }
+
+    // Open the media and parse its media info on the calling thread.
+    bool OpenAndProbe(const string& url)
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (!OpenMedia(url, true))
+            return false;
+        TaskHolder hTask;
+        {
+            lock_guard<mutex> lk(m_taskTableLock);
+            hTask = m_taskTable[MEDIA_INFO];
+        }
+        if (hTask && hTask->failed)
+        {
+            m_errMsg = hTask->errMsg;
+            return false;
+        }
+        return true;
+    }
+
+    bool OpenMedia(const string& url, bool probeInPlace)
     {
         lock_guard<recursive_mutex> lk(m_apiLock);
 
@@ -97,16 +128,36 @@ public:
 
         TaskHolder hTask(new ParseTask());
         hTask->taskProc = bind(&MediaParser_Impl::ParseGeneralMediaInfo, this, _1);
+        auto hAnaCache = GetAnalysisCache();
+        m_mediaKey = hAnaCache ? hAnaCache->GetMediaKey(url) : "";
+        if (!m_mediaKey.empty())
+        {
+            int bestVidStmIdx, bestAudStmIdx;
+            auto hMediaInfo = hAnaCache->LoadMediaInfo(m_mediaKey, bestVidStmIdx, bestAudStmIdx);
+            if (hMediaInfo)
+            {
+                // the stream info will be probed later, only when the seek points are required
+                hMediaInfo->url = url;
+                m_hMediaInfo = hMediaInfo;
+                m_bestVidStmIdx = bestVidStmIdx;
+                m_bestAudStmIdx = bestAudStmIdx;
+                m_streamInfoProbed = false;
+                hTask->success = true;
+                m_logger->Log(DEBUG) << "Load media info of '" << url << "' from the analysis cache." << endl;
+            }
+        }
         {
             lock_guard<mutex> lk(m_taskTableLock);
             m_taskTable[MEDIA_INFO] = hTask;
         }
+        m_opened = true;
+        if (!hTask->success)
         {
-            lock_guard<mutex> lk(m_pendingTaskQLock);
-            m_pendingTaskQ.push_back(hTask);
+            if (probeInPlace)
+                RunTaskInPlace(hTask);
+            else
+                EnqueueTask(hTask);
         }
-
-        m_opened = true;
         return true;
     }
 
@@ -132,6 +183,9 @@ public:
         m_hFileIter->SetRecursive(includeSubDir);
         m_hFileIter->StartParsing();
         m_url = dirPath;
+        // set before the task is queued, the task thread reads them
+        m_imgsqFrameRate = frameRate;
+        m_isImageSequence = true;
 
         TaskHolder hTask(new ParseTask());
         hTask->taskProc = bind(&MediaParser_Impl::ParseGeneralMediaInfo, this, _1);
@@ -139,13 +193,8 @@ public:
             lock_guard<mutex> lk(m_taskTableLock);
             m_taskTable[MEDIA_INFO] = hTask;
         }
-        {
-            lock_guard<mutex> lk(m_pendingTaskQLock);
-            m_pendingTaskQ.push_back(hTask);
-        }
+        EnqueueTask(hTask);
 
-        m_imgsqFrameRate = frameRate;
-        m_isImageSequence = true;
         m_opened = true;
         return true;
     }
@@ -172,6 +221,9 @@ public:
 
         m_hMediaInfo = nullptr;
         m_hVidSeekPoints = nullptr;
+        m_bestVidStmIdx = m_bestAudStmIdx = -1;
+        m_streamInfoProbed = true;
+        m_mediaKey = "";
 
         m_url = "";
         m_errMsg = "";
@@ -215,10 +267,7 @@ public:
             }
         }
         if (hTask)
-        {
-            lock_guard<mutex> lk(m_pendingTaskQLock);
-            m_pendingTaskQ.push_back(hTask);
-        }
+            EnqueueTask(hTask);
         return true;
     }
 
@@ -311,6 +360,30 @@ public:
         return m_hFileIter;
     }
 
+    void SetProxyParser(MediaParser::Holder hProxyParser) override
+    {
+        lock_guard<mutex> lk(m_proxyLock);
+        m_hProxyParser = hProxyParser;
+    }
+
+    MediaParser::Holder GetProxyParser() const override
+    {
+        lock_guard<mutex> lk(m_proxyLock);
+        return m_hProxyParser;
+    }
+
+    void SetAnalysisCache(MediaAnalysisCache::Holder hCache) override
+    {
+        lock_guard<mutex> lk(m_anaCacheLock);
+        m_hAnaCache = hCache;
+    }
+
+    MediaAnalysisCache::Holder GetAnalysisCache() const override
+    {
+        lock_guard<mutex> lk(m_anaCacheLock);
+        return m_hAnaCache;
+    }
+
     string GetError() const override
     {
         return m_errMsg;
@@ -339,6 +412,40 @@ private:
         return oss.str();
     }
 
+    void EnqueueTask(TaskHolder hTask)
+    {
+        lock_guard<mutex> lk(m_pendingTaskQLock);
+        m_pendingTaskQ.push_back(hTask);
+        // the task thread is started only when there is something to parse in the background
+        if (!m_taskThread.joinable())
+        {
+            m_taskThread = thread(&MediaParser_Impl::TaskThreadProc, this);
+            ostringstream thnOss;
+            if (m_isImageSequence)
+                thnOss << "PsrTskIs-" << m_hFileIter->GetBaseDirPath();
+            else
+                thnOss << "PsrTsk-" << SysUtils::ExtractFileName(m_url);
+            SysUtils::SetThreadName(m_taskThread, thnOss.str());
+        }
+    }
+
+    void RunTaskInPlace(TaskHolder hTask)
+    {
+        {
+            lock_guard<mutex> lk(m_pendingTaskQLock);
+            m_currTask = hTask;
+        }
+        if (!hTask->taskProc(hTask))
+            hTask->failed = true;
+        else if (!hTask->cancel)
+            hTask->success = true;
+        {
+            lock_guard<mutex> lk(m_pendingTaskQLock);
+            m_currTask = nullptr;
+        }
+        m_taskDoneCv.notify_all();
+    }
+
     void TaskThreadProc()
     {
         while (!m_quitTaskThread)
@@ -386,54 +493,24 @@ private:
 
     bool ParseMediaInfoFromFile(TaskHolder hTask)
     {
-        string fileName = SysUtils::ExtractFileName(m_url);
-        ostringstream thnOss;
-        thnOss << "PsrTsk-" << fileName;
-        SysUtils::SetThreadName(m_taskThread, thnOss.str());
-
-        int fferr = 0;
-        fferr = av_opt_set_int(m_avfmtCtx, "probesize", 5000, 0);
-        if (fferr < 0)
-            m_logger->Log(Error) << "FAILED to set option 'probesize' to m_avfmtCtx! fferr=" << fferr << "." << endl;
-        fferr = avformat_find_stream_info(m_avfmtCtx, nullptr);
-        if (fferr < 0)
-        {
-            hTask->errMsg = FFapiFailureMessage("avformat_find_stream_info", fferr);
+        MediaInfo::Holder hMediaInfo;
+        if (!ProbeStreamInfo(hMediaInfo, hTask->errMsg))
             return false;
-        }
-
-        m_hMediaInfo = GenerateMediaInfoByAVFormatContext(m_avfmtCtx);
-        if (!m_hMediaInfo->isComplete)
-        {
-            m_logger->Log(INFO) << "MediaInfo is NOT COMPLETE. Try to parse the media again with LARGER probe size." << endl;
-            AVFormatContext* avfmtCtx = nullptr;
-            fferr = avformat_open_input(&avfmtCtx, m_url.c_str(), nullptr, nullptr);
-            if (fferr < 0)
-            {
-                m_logger->Log(WARN) << "FAILED to open media '" << m_url << "' again!" << endl;
-            }
-            else
-            {
-                m_logger->Log(INFO) << "Increase 'probesize' to 5000000." << endl;
-                av_opt_set_int(avfmtCtx, "probesize", 5000000, 0);
-                fferr = avformat_find_stream_info(avfmtCtx, nullptr);
-                if (fferr < 0)
-                {
-                    avformat_close_input(&avfmtCtx);
-                    hTask->errMsg = FFapiFailureMessage("avformat_find_stream_info", fferr);
-                    return false;
-                }
-                m_hMediaInfo = GenerateMediaInfoByAVFormatContext(avfmtCtx);
-
-                lock_guard<recursive_mutex> lk(m_apiLock);
-                avformat_close_input(&m_avfmtCtx);
-                m_avfmtCtx = avfmtCtx;
-            }
-        }
+        m_hMediaInfo = hMediaInfo;
         m_bestVidStmIdx = av_find_best_stream(m_avfmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
         m_bestAudStmIdx = av_find_best_stream(m_avfmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
 
-        // pre-decode mjpeg and parse exif metadata
+        ParseMjpegDisplayRotation();
+        m_logger->Log(INFO) << "Parse general media info of media '" << m_url << "' done." << endl;
+        auto hAnaCache = GetAnalysisCache();
+        if (hAnaCache && !m_mediaKey.empty() && !hAnaCache->SaveMediaInfo(m_mediaKey, m_hMediaInfo, m_bestVidStmIdx, m_bestAudStmIdx))
+            m_logger->Log(WARN) << "FAILED to save media info of '" << m_url << "' into the analysis cache! Error is '" << hAnaCache->GetError() << "'." << endl;
+        return true;
+    }
+
+    // Pre-decode mjpeg and parse exif metadata, the display rotation is only available in the decoded frame
+    void ParseMjpegDisplayRotation()
+    {
         if (m_bestVidStmIdx >= 0 && m_avfmtCtx->streams[m_bestVidStmIdx]->codecpar->codec_id == AV_CODEC_ID_MJPEG)
         {
             FFUtils::OpenVideoDecoderOptions tVidDecOpenOpts;
@@ -464,17 +541,57 @@ private:
                 }
             }
         }
-        m_logger->Log(INFO) << "Parse general media info of media '" << m_url << "' done." << endl;
+    }
+
+    // Find the stream info with a small probe size first. If the media info is not complete, 'm_avfmtCtx' is replaced
+    // by a new one probed with a larger size. Also called when the media info is loaded from the analysis cache, so
+    // 'm_avfmtCtx' is prepared the same way on both paths.
+    bool ProbeStreamInfo(MediaInfo::Holder& hMediaInfo, string& errMsg)
+    {
+        int fferr = av_opt_set_int(m_avfmtCtx, "probesize", 5000, 0);
+        if (fferr < 0)
+            m_logger->Log(Error) << "FAILED to set option 'probesize' to m_avfmtCtx! fferr=" << fferr << "." << endl;
+        fferr = avformat_find_stream_info(m_avfmtCtx, nullptr);
+        if (fferr < 0)
+        {
+            errMsg = FFapiFailureMessage("avformat_find_stream_info", fferr);
+            return false;
+        }
+
+        hMediaInfo = GenerateMediaInfoByAVFormatContext(m_avfmtCtx);
+        if (!hMediaInfo->isComplete)
+        {
+            m_logger->Log(INFO) << "MediaInfo is NOT COMPLETE. Try to parse the media again with LARGER probe size." << endl;
+            AVFormatContext* avfmtCtx = nullptr;
+            fferr = avformat_open_input(&avfmtCtx, m_url.c_str(), nullptr, nullptr);
+            if (fferr < 0)
+            {
+                m_logger->Log(WARN) << "FAILED to open media '" << m_url << "' again!" << endl;
+            }
+            else
+            {
+                m_logger->Log(INFO) << "Increase 'probesize' to 5000000." << endl;
+                av_opt_set_int(avfmtCtx, "probesize", 5000000, 0);
+                fferr = avformat_find_stream_info(avfmtCtx, nullptr);
+                if (fferr < 0)
+                {
+                    avformat_close_input(&avfmtCtx);
+                    errMsg = FFapiFailureMessage("avformat_find_stream_info", fferr);
+                    return false;
+                }
+                hMediaInfo = GenerateMediaInfoByAVFormatContext(avfmtCtx);
+
+                lock_guard<recursive_mutex> lk(m_apiLock);
+                avformat_close_input(&m_avfmtCtx);
+                m_avfmtCtx = avfmtCtx;
+            }
+        }
+        m_streamInfoProbed = true;
         return true;
     }
 
     bool ParseMediaInfoFromImageSequence(TaskHolder hTask)
     {
-        string dirPath = m_hFileIter->GetBaseDirPath();
-        ostringstream thnOss;
-        thnOss << "PsrTskIs-" << dirPath;
-        SysUtils::SetThreadName(m_taskThread, thnOss.str());
-
         m_hMediaInfo = MediaInfo::Holder(new MediaInfo());
         m_hMediaInfo->url = m_url;
         auto filePath = m_hFileIter->GetQuickSample();
@@ -526,65 +643,283 @@ private:
             hTask->errMsg = "No video stream found!";
             return false;
         }
+        if (!m_streamInfoProbed)
+        {
+            // media info was loaded from the analysis cache, the stream info is still required to read the packets
+            MediaInfo::Holder hMediaInfo;
+            if (!ProbeStreamInfo(hMediaInfo, hTask->errMsg))
+                return false;
+            if (hMediaInfo->streams.size() != m_hMediaInfo->streams.size())
+            {
+                m_logger->Log(WARN) << "Cached media info of '" << m_url << "' does NOT match the probed streams, use the probed one." << endl;
+                hMediaInfo->url = m_url;
+                m_hMediaInfo = hMediaInfo;
+                m_bestVidStmIdx = av_find_best_stream(m_avfmtCtx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+                m_bestAudStmIdx = av_find_best_stream(m_avfmtCtx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+                ParseMjpegDisplayRotation();
+            }
+        }
 
-        // find the 1st key frame pts
         int vidstmidx = m_bestVidStmIdx;
         AVStream* vidStream = m_avfmtCtx->streams[vidstmidx];
-        int fferr;
-        fferr = avformat_seek_file(m_avfmtCtx, vidstmidx, INT64_MIN, vidStream->start_time, vidStream->start_time, 0);
-        if (fferr < 0)
+        int64_t ptsStep = av_rescale_q((int64_t)(m_minSpIntervalSec*1000000), MICROSEC_TIMEBASE, vidStream->time_base);
+        list<int64_t> vidSeekPoints;
+        if (ReadSeekPointsFromIndex(vidstmidx, ptsStep, vidSeekPoints))
         {
-            hTask->errMsg = FFapiFailureMessage("avformat_seek_file", fferr);
+            m_logger->Log(DEBUG) << "Seek points of media '" << m_url << "' are read from the container index." << endl;
+        }
+        else
+        {
+            vidSeekPoints.clear();
+            if (!ScanSeekPointsInParallel(hTask, vidstmidx, ptsStep, vidSeekPoints))
+                return false;
+        }
+        if (hTask->cancel)
+            return false;
+
+        SeekPointsHolder hSeekPoints(new vector<int64_t>());
+        hSeekPoints->reserve(vidSeekPoints.size());
+        for (int64_t pts : vidSeekPoints)
+            hSeekPoints->push_back(pts);
+        m_hVidSeekPoints = hSeekPoints;
+        m_logger->Log(INFO) << "Parse video seek points of media '" << m_url << "' done. " << vidSeekPoints.size() << " seek points are found." << endl;
+        return true;
+    }
+
+    // Read the key frames from the container index, e.g. the 'stss' atom of MP4/MOV or the cues of MKV. The index
+    // timestamps of some formats are dts, so they are converted to pts with the offset measured on the first and the
+    // last key frame. The index is not used if these two offsets don't agree. For the formats other than MP4/MOV, the
+    // index may only hold the packets read while probing, it is used only if its last key frame reaches the end.
+    bool ReadSeekPointsFromIndex(int stmIdx, int64_t ptsStep, list<int64_t>& seekPoints)
+    {
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(58, 78, 100)
+        AVStream* avStream = m_avfmtCtx->streams[stmIdx];
+        const int entryCnt = avformat_index_get_entries_count(avStream);
+        if (entryCnt <= 0)
+            return false;
+        vector<int64_t> keyTimestamps;
+        for (int i = 0; i < entryCnt; i++)
+        {
+            const AVIndexEntry* pEntry = avformat_index_get_entry(avStream, i);
+            if (pEntry && (pEntry->flags&AVINDEX_KEYFRAME) != 0 && (pEntry->flags&AVINDEX_DISCARD_FRAME) == 0)
+                keyTimestamps.push_back(pEntry->timestamp);
+        }
+        if (keyTimestamps.empty())
+            return false;
+        sort(keyTimestamps.begin(), keyTimestamps.end());
+        if (!IsIndexComplete(avStream, keyTimestamps, ptsStep))
+        {
+            m_logger->Log(DEBUG) << "Index of media '" << m_url << "' is NOT COMPLETE, fall back to packet scanning." << endl;
             return false;
         }
 
-        list<int64_t> vidSeekPoints;
-        int64_t lastKeyPts;
-        int64_t searchStart;
-        int64_t searchEnd = vidStream->start_time+vidStream->duration;
-        int64_t ptsStep = av_rescale_q((int64_t)(m_minSpIntervalSec*1000000), MICROSEC_TIMEBASE, vidStream->time_base);
+        int64_t ptsOffset0, ptsOffset1;
+        if (!MeasureIndexPtsOffset(stmIdx, keyTimestamps.front(), ptsOffset0) ||
+            !MeasureIndexPtsOffset(stmIdx, keyTimestamps.back(), ptsOffset1))
+            return false;
+        if (ptsOffset0 != ptsOffset1)
+        {
+            m_logger->Log(DEBUG) << "Index pts offsets of media '" << m_url << "' don't agree (" << ptsOffset0 << " vs " << ptsOffset1
+                    << "), fall back to packet scanning." << endl;
+            return false;
+        }
+        for (int64_t ts : keyTimestamps)
+        {
+            const int64_t pts = ts+ptsOffset0;
+            if (seekPoints.empty() || pts >= seekPoints.back()+ptsStep)
+                seekPoints.push_back(pts);
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool IsIndexComplete(const AVStream* avStream, const vector<int64_t>& keyTimestamps, int64_t ptsStep)
+    {
+        // the index must reach the end of the stream, even for mov, whose fragments after the 1st one are only
+        // indexed as they are read, unless the file has an 'mfra' box
+        int64_t startTime = avStream->start_time != AV_NOPTS_VALUE ? avStream->start_time : 0;
+        int64_t duration = avStream->duration;
+        if (duration == AV_NOPTS_VALUE || duration <= 0)
+        {
+            if (m_avfmtCtx->duration == AV_NOPTS_VALUE || m_avfmtCtx->duration <= 0)
+                return false;
+            duration = av_rescale_q(m_avfmtCtx->duration, av_make_q(1, AV_TIME_BASE), avStream->time_base);
+        }
+        // allow the last GOP to be as long as the longest one in the index
+        int64_t tolerance = max(ptsStep, av_rescale_q(1, av_make_q(1, 1), avStream->time_base));
+        for (size_t i = 1; i < keyTimestamps.size(); i++)
+            tolerance = max(tolerance, keyTimestamps[i]-keyTimestamps[i-1]);
+        return keyTimestamps.back() >= startTime+duration-tolerance;
+    }
+
+    bool MeasureIndexPtsOffset(int stmIdx, int64_t indexTs, int64_t& ptsOffset)
+    {
+        int fferr = avformat_seek_file(m_avfmtCtx, stmIdx, INT64_MIN, indexTs, indexTs, 0);
+        if (fferr < 0)
+            return false;
         AVPacket avpkt = {0};
+        bool found = false;
         do {
             fferr = av_read_frame(m_avfmtCtx, &avpkt);
             if (fferr == 0)
             {
-                if (avpkt.stream_index == vidstmidx)
+                if (avpkt.stream_index == stmIdx)
                 {
-                    lastKeyPts = avpkt.pts;
-                    vidSeekPoints.push_back(lastKeyPts);
-                    searchStart = lastKeyPts+ptsStep;
+                    found = (avpkt.flags&AV_PKT_FLAG_KEY) != 0 && avpkt.pts != AV_NOPTS_VALUE;
+                    ptsOffset = avpkt.pts-indexTs;
                     av_packet_unref(&avpkt);
                     break;
                 }
                 av_packet_unref(&avpkt);
             }
-        } while (fferr >= 0 && !hTask->cancel);
-        if (vidSeekPoints.empty())
+        } while (fferr >= 0);
+        return found;
+    }
+
+    // Scan the key frames by seeking forward with the step of 'ptsStep'. The file is split into time ranges which are
+    // scanned in parallel, each on its own AVFormatContext.
+    bool ScanSeekPointsInParallel(TaskHolder hTask, int stmIdx, int64_t ptsStep, list<int64_t>& seekPoints)
+    {
+        AVStream* vidStream = m_avfmtCtx->streams[stmIdx];
+        const int64_t rangeStart = vidStream->start_time != AV_NOPTS_VALUE ? vidStream->start_time : 0;
+        const int64_t rangeEnd = rangeStart+vidStream->duration;
+        uint32_t segCnt = thread::hardware_concurrency();
+        if (segCnt > MAX_SEEK_POINTS_SCAN_THREADS) segCnt = MAX_SEEK_POINTS_SCAN_THREADS;
+        const int64_t minSegLen = ptsStep*MIN_SEEK_POINTS_PER_SCAN_SEGMENT;
+        if (vidStream->duration <= 0 || minSegLen <= 0)
+            segCnt = 1;
+        else if ((int64_t)segCnt*minSegLen > vidStream->duration)
+            segCnt = (uint32_t)(vidStream->duration/minSegLen);
+        if (segCnt < 1) segCnt = 1;
+
+        vector<list<int64_t>> segSeekPoints(segCnt);
+        vector<string> segErrMsgs(segCnt);
+        vector<int> segResults(segCnt, 0);
+        vector<thread> scanThreads;
+        const int64_t segLen = segCnt > 1 ? vidStream->duration/segCnt : INT64_MAX;
+        for (uint32_t i = 1; i < segCnt; i++)
+        {
+            const int64_t segStart = rangeStart+segLen*i;
+            const int64_t segEnd = i == segCnt-1 ? INT64_MAX : segStart+segLen;
+            scanThreads.push_back(thread([this, hTask, i, segStart, segEnd, ptsStep, vidStream, &segSeekPoints, &segErrMsgs, &segResults] () {
+                AVFormatContext* avfmtCtx = nullptr;
+                int fferr = avformat_open_input(&avfmtCtx, m_url.c_str(), nullptr, nullptr);
+                if (fferr < 0)
+                {
+                    segErrMsgs[i] = FFapiFailureMessage("avformat_open_input", fferr);
+                    return;
+                }
+                int segStmIdx = FindSameStream(avfmtCtx, vidStream);
+                if (segStmIdx < 0 && avformat_find_stream_info(avfmtCtx, nullptr) >= 0)
+                    segStmIdx = FindSameStream(avfmtCtx, vidStream);
+                if (segStmIdx < 0)
+                    segErrMsgs[i] = "Can NOT find the same video stream in the new AVFormatContext!";
+                else
+                    segResults[i] = ScanSeekPoints(hTask, avfmtCtx, segStmIdx, segStart, segEnd, ptsStep, segSeekPoints[i], segErrMsgs[i]);
+                avformat_close_input(&avfmtCtx);
+            }));
+        }
+        segResults[0] = ScanSeekPoints(hTask, m_avfmtCtx, stmIdx, INT64_MIN, segCnt > 1 ? rangeStart+segLen : INT64_MAX, ptsStep, segSeekPoints[0], segErrMsgs[0]);
+        for (auto& t : scanThreads)
+            t.join();
+
+        for (uint32_t i = 0; i < segCnt; i++)
+        {
+            if (!segResults[i])
+            {
+                hTask->errMsg = segErrMsgs[i];
+                return false;
+            }
+            for (int64_t pts : segSeekPoints[i])
+            {
+                if (seekPoints.empty() || pts >= seekPoints.back()+ptsStep)
+                    seekPoints.push_back(pts);
+            }
+        }
+        if (seekPoints.empty())
         {
             hTask->errMsg = "No key-frame is found!";
             return false;
         }
+        return true;
+    }
+
+    int FindSameStream(AVFormatContext* avfmtCtx, AVStream* avStream)
+    {
+        for (int i = 0; i < (int)avfmtCtx->nb_streams; i++)
+        {
+            AVStream* pStm = avfmtCtx->streams[i];
+            if (pStm->id == avStream->id && pStm->codecpar->codec_type == avStream->codecpar->codec_type && (i == avStream->index || avStream->id != 0))
+                return i;
+        }
+        return -1;
+    }
+
+    // Collect the key frames whose pts are in range ['rangeStart', 'rangeEnd'). 'rangeStart' as INT64_MIN means to begin
+    // from the 1st key frame of the stream.
+    bool ScanSeekPoints(TaskHolder hTask, AVFormatContext* avfmtCtx, int stmIdx, int64_t rangeStart, int64_t rangeEnd,
+            int64_t ptsStep, list<int64_t>& seekPoints, string& errMsg)
+    {
+        AVStream* vidStream = avfmtCtx->streams[stmIdx];
+        int fferr;
+        int64_t lastKeyPts;
+        int64_t searchStart = rangeStart;
+        int64_t searchEnd = vidStream->start_time+vidStream->duration;
+        if (searchEnd > rangeEnd) searchEnd = rangeEnd;
+        if (rangeStart == INT64_MIN)
+        {
+            // find the 1st key frame pts
+            fferr = avformat_seek_file(avfmtCtx, stmIdx, INT64_MIN, vidStream->start_time, vidStream->start_time, 0);
+            if (fferr < 0)
+            {
+                errMsg = FFapiFailureMessage("avformat_seek_file", fferr);
+                return false;
+            }
+            AVPacket avpkt = {0};
+            do {
+                fferr = av_read_frame(avfmtCtx, &avpkt);
+                if (fferr == 0)
+                {
+                    if (avpkt.stream_index == stmIdx)
+                    {
+                        lastKeyPts = avpkt.pts;
+                        seekPoints.push_back(lastKeyPts);
+                        searchStart = lastKeyPts+ptsStep;
+                        av_packet_unref(&avpkt);
+                        break;
+                    }
+                    av_packet_unref(&avpkt);
+                }
+            } while (fferr >= 0 && !hTask->cancel);
+            if (seekPoints.empty())
+            {
+                errMsg = "No key-frame is found!";
+                return false;
+            }
+            if (searchStart < vidStream->start_time) searchStart = vidStream->start_time;
+        }
 
         // find the following key frames
-        if (searchStart < vidStream->start_time) searchStart = vidStream->start_time;
-        while (!hTask->cancel)
+        while (!hTask->cancel && searchStart < rangeEnd)
         {
-            fferr = avformat_seek_file(m_avfmtCtx, vidstmidx, searchStart, searchStart, INT64_MAX, 0);
+            fferr = avformat_seek_file(avfmtCtx, stmIdx, searchStart, searchStart, INT64_MAX, 0);
             if (fferr < 0)
             {
                 if (fferr != AVERROR(EPERM))
                 {
-                    hTask->errMsg = FFapiFailureMessage("avformat_seek_file", fferr);
+                    errMsg = FFapiFailureMessage("avformat_seek_file", fferr);
                     return false;
                 }
                 break;
             }
             AVPacket avpkt = {0};
             do {
-                fferr = av_read_frame(m_avfmtCtx, &avpkt);
+                fferr = av_read_frame(avfmtCtx, &avpkt);
                 if (fferr == 0)
                 {
-                    if (avpkt.stream_index == vidstmidx)
+                    if (avpkt.stream_index == stmIdx)
                     {
                         if (avpkt.pts >= searchStart)
                         {
@@ -607,13 +942,15 @@ private:
             } while (fferr >= 0 && !hTask->cancel);
             if (fferr == 0)
             {
-                vidSeekPoints.push_back(lastKeyPts);
+                if (lastKeyPts >= rangeEnd)
+                    break;
+                seekPoints.push_back(lastKeyPts);
             }
             else if (fferr != AVERROR(EAGAIN))
             {
                 if (fferr != AVERROR_EOF)
                 {
-                    hTask->errMsg = FFapiFailureMessage("av_read_frame", fferr);
+                    errMsg = FFapiFailureMessage("av_read_frame", fferr);
                     return false;
                 }
                 break;
@@ -624,13 +961,6 @@ private:
                 break;
             }
         }
-
-        SeekPointsHolder hSeekPoints(new vector<int64_t>());
-        hSeekPoints->reserve(vidSeekPoints.size());
-        for (int64_t pts : vidSeekPoints)
-            hSeekPoints->push_back(pts);
-        m_hVidSeekPoints = hSeekPoints;
-        m_logger->Log(INFO) << "Parse video seek points of media '" << m_url << "' done. " << vidSeekPoints.size() << " seek points are found." << endl;
         return true;
     }
 
@@ -691,6 +1021,13 @@ private:
     string m_url;
     AVFormatContext* m_avfmtCtx{nullptr};
 
+    MediaParser::Holder m_hProxyParser;
+    mutable mutex m_proxyLock;
+    MediaAnalysisCache::Holder m_hAnaCache;
+    mutable mutex m_anaCacheLock;
+    string m_mediaKey;
+    bool m_streamInfoProbed{true};
+
     string m_errMsg;
 };
 
@@ -699,6 +1036,151 @@ static const auto MEDIA_PARSER_HOLDER_DELETER = [] (MediaParser* p) {
     delete ptr;
 };
 
+class MediaParserBatchProber_Impl : public MediaParser::BatchProber
+{
+public:
+    MediaParserBatchProber_Impl(uint32_t maxParallelism)
+    {
+        m_logger = MediaParser::GetLogger();
+        if (maxParallelism == 0)
+        {
+            const uint32_t hwThreads = thread::hardware_concurrency();
+            maxParallelism = hwThreads > 2 ? hwThreads/2 : 1;
+            if (maxParallelism > MAX_DEFAULT_BATCH_PROBE_THREADS)
+                maxParallelism = MAX_DEFAULT_BATCH_PROBE_THREADS;
+        }
+        m_maxParallelism = maxParallelism;
+    }
+
+    ~MediaParserBatchProber_Impl()
+    {
+        {
+            lock_guard<mutex> lk(m_urlQLock);
+            m_quit = true;
+        }
+        m_urlQCv.notify_all();
+        for (auto& t : m_probeThreads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+    }
+
+    void SetAnalysisCache(MediaAnalysisCache::Holder hCache) override
+    {
+        lock_guard<mutex> lk(m_urlQLock);
+        m_hAnaCache = hCache;
+    }
+
+    void Submit(const vector<string>& urls) override
+    {
+        {
+            lock_guard<mutex> lk(m_urlQLock);
+            for (auto& url : urls)
+                m_urlQ.push_back({url, m_batchGeneration});
+            // the probing threads are created on demand and then kept for the following batches
+            while (m_probeThreads.size() < m_maxParallelism && m_probeThreads.size() < m_urlQ.size()+m_probingCnt)
+            {
+                m_probeThreads.push_back(thread(&MediaParserBatchProber_Impl::ProbeThreadProc, this));
+                SysUtils::SetThreadName(m_probeThreads.back(), "PsrBatchProbe");
+            }
+        }
+        m_urlQCv.notify_all();
+    }
+
+    bool PopResult(Result& result) override
+    {
+        lock_guard<mutex> lk(m_resultQLock);
+        if (m_resultQ.empty())
+            return false;
+        result = m_resultQ.front();
+        m_resultQ.pop_front();
+        return true;
+    }
+
+    void Cancel() override
+    {
+        {
+            lock_guard<mutex> lk(m_urlQLock);
+            m_urlQ.clear();
+            m_batchGeneration++;
+        }
+        lock_guard<mutex> lk(m_resultQLock);
+        m_resultQ.clear();
+    }
+
+    uint32_t GetPendingCount() const override
+    {
+        lock_guard<mutex> lk(m_urlQLock);
+        return m_urlQ.size()+m_probingCnt;
+    }
+
+private:
+    void ProbeThreadProc()
+    {
+        while (true)
+        {
+            pair<string, uint32_t> urlEntry;
+            MediaAnalysisCache::Holder hAnaCache;
+            {
+                unique_lock<mutex> lk(m_urlQLock);
+                m_urlQCv.wait(lk, [this] { return m_quit || !m_urlQ.empty(); });
+                if (m_quit)
+                    break;
+                urlEntry = m_urlQ.front();
+                m_urlQ.pop_front();
+                hAnaCache = m_hAnaCache;
+                m_probingCnt++;
+            }
+
+            Result result;
+            result.url = urlEntry.first;
+            auto hParser = MediaParser::CreateInstance();
+            hParser->SetAnalysisCache(hAnaCache);
+            auto pParser = dynamic_cast<MediaParser_Impl*>(hParser.get());
+            if (pParser->OpenAndProbe(urlEntry.first))
+                result.hParser = hParser;
+            else
+            {
+                result.errMsg = hParser->GetError();
+                m_logger->Log(WARN) << "FAILED to probe media '" << urlEntry.first << "'! Error is '" << result.errMsg << "'." << endl;
+            }
+
+            {
+                lock_guard<mutex> lk(m_urlQLock);
+                m_probingCnt--;
+                // drop the result of a canceled batch
+                if (urlEntry.second != m_batchGeneration)
+                    continue;
+            }
+            lock_guard<mutex> lk(m_resultQLock);
+            m_resultQ.push_back(std::move(result));
+        }
+    }
+
+private:
+    ALogger* m_logger;
+    uint32_t m_maxParallelism;
+    list<thread> m_probeThreads;
+    list<pair<string, uint32_t>> m_urlQ;
+    mutable mutex m_urlQLock;
+    condition_variable m_urlQCv;
+    uint32_t m_probingCnt{0};
+    uint32_t m_batchGeneration{0};
+    bool m_quit{false};
+    MediaAnalysisCache::Holder m_hAnaCache;
+    list<Result> m_resultQ;
+    mutex m_resultQLock;
+};
+
+MediaParser::BatchProber::Holder MediaParser::CreateBatchProber(uint32_t maxParallelism)
+{
+    return MediaParser::BatchProber::Holder(new MediaParserBatchProber_Impl(maxParallelism), [] (MediaParser::BatchProber* p) {
+        MediaParserBatchProber_Impl* ptr = dynamic_cast<MediaParserBatchProber_Impl*>(p);
+        delete ptr;
+    });
+}
+
 MediaParser::Holder MediaParser::CreateInstance()
 {
     return MediaParser::Holder(new MediaParser_Impl(), MEDIA_PARSER_HOLDER_DELETER);
@@ -727,7 +727,8 @@ public:
 #endif
         uint32_t outFrmSize = GetAudioOutFrameSize();
         size_t elemSize = (size_t)(outFrmSize/outCh);
-        m.create((int)readSamples, (int)1, outCh, elemSize);
+        // keep the allocator preset on 'm', so callers can read into pooled buffers
+        m.create((int)readSamples, (int)1, outCh, elemSize, m.allocator);
         if (!m.data)
         {
             ostringstream oss;
@@ -790,6 +791,11 @@ public:
         throw runtime_error("This interface is NOT SUPPORTED by 'MediaReader_Impl'!");
     }
 
+    bool SetImageDecodeParallelism(uint32_t workerCount, uint32_t readaheadFrames) override
+    {
+        throw runtime_error("This interface is NOT SUPPORTED by 'MediaReader_Impl'!");
+    }
+
     int64_t GetReadPos() const override
     {
         return m_cacheWnd.readPos;
@@ -25,6 +25,7 @@
 #include "AudioTrack.h"
 #include "MultiTrackAudioReader.h"
 #include "FFUtils.h"
+#include "MatUtils.h"
 #include "ThreadUtils.h"
 #include "DebugHelper.h"
 extern "C"
@@ -955,7 +956,7 @@ private:
                     {
                         ImGui::ImMat amat;
                         const int outChannels = m_outChannels;
-                        amat.create_type((int)m_outSamplesPerFrame, 1, outChannels, m_mixOutDataType);
+                        amat.create_type((int)m_outSamplesPerFrame, 1, outChannels, m_mixOutDataType, MatUtils::AudioBlockPool::GetDefaultInstance());
                         if (amat.w == outfrm->nb_samples)
                         {
                             uint8_t** ppDstBufPtrs = new uint8_t*[outChannels];
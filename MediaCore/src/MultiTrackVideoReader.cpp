@@ -675,9 +675,11 @@ public:
         lock(m_apiLock, m_trackLock);
         lock_guard<recursive_mutex> lk0(m_apiLock, adopt_lock);
         lock_guard<recursive_mutex> lk1(m_trackLock, adopt_lock);
-        if (hSettings->VideoOutWidth() == m_hSettings->VideoOutWidth() && hSettings->VideoOutHeight() == m_hSettings->VideoOutHeight()
+        // passing in the settings of this reader itself forces the clips to re-apply them, e.g. after a proxy is attached
+        if (hSettings != m_hSettings
+            && hSettings->VideoOutWidth() == m_hSettings->VideoOutWidth() && hSettings->VideoOutHeight() == m_hSettings->VideoOutHeight()
             && hSettings->VideoOutFrameRate() == m_hSettings->VideoOutFrameRate() && hSettings->VideoOutColorFormat() == m_hSettings->VideoOutColorFormat()
-            && hSettings->VideoOutDataType() == m_hSettings->VideoOutDataType())
+            && hSettings->VideoOutDataType() == m_hSettings->VideoOutDataType() && hSettings->IsVideoSrcUseProxy() == m_hSettings->IsVideoSrcUseProxy())
             return true;
         if (hSettings->VideoOutFrameRate() != m_hSettings->VideoOutFrameRate())
         {
@@ -699,6 +701,7 @@ public:
         for (auto& hTrack : m_tracks)
             hTrack->UpdateSettings(hSettings);
         m_hSettings->SyncVideoSettingsFrom(hSettings.get());
+        m_hSettings->SetVideoSrcUseProxy(hSettings->IsVideoSrcUseProxy());
         SeekToByIdx(m_readFrameIdx, true);
         StartMixingThread();
         return true;
@@ -20,8 +20,14 @@
 #include <algorithm>
 #include <list>
 #include <cmath>
+#include <cfloat>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <sys/stat.h>
 #include "Overview.h"
 #include "MediaReader.h"
+#include "MediaAnalysisCache.h"
 #include "HwaccelManager.h"
 #include "FFUtils.h"
 #include "ThreadUtils.h"
@@ -32,6 +38,7 @@ extern "C"
     #include "libavutil/avstring.h"
     #include "libavutil/pixdesc.h"
     #include "libavutil/display.h"
+    #include "libavutil/opt.h"
     #include "libavformat/avformat.h"
     #include "libavcodec/avcodec.h"
     #include "libavdevice/avdevice.h"
@@ -47,8 +54,236 @@ using namespace Logger;
 
 namespace MediaCore
 {
+// Fill the 'levels' of a waveform from the pcm samples in one pass. The level 0 entries are aggregated from the
+// samples, and every two entries of a level are merged into one entry of the next level as soon as they are ready.
+class WaveformPyramidBuilder
+{
+public:
+    static void AllocateLevels(Overview::Waveform* pWaveform, double sampleRate, double duration)
+    {
+        const double baseSamples = Overview::Waveform::PYRAMID_BASE_SAMPLES;
+        double aggregateSamples = pWaveform->aggregateSamples > baseSamples ? pWaveform->aggregateSamples : baseSamples;
+        int64_t levelSize = (int64_t)ceil(duration*sampleRate/aggregateSamples);
+        const auto channels = pWaveform->pcm.size();
+        pWaveform->levels.clear();
+        while (levelSize > 0)
+        {
+            Overview::Waveform::Level level;
+            level.aggregateSamples = aggregateSamples;
+            level.aggregateDuration = aggregateSamples/sampleRate;
+            level.minPcm.resize(channels, vector<float>(levelSize, 0));
+            level.maxPcm.resize(channels, vector<float>(levelSize, 0));
+            level.rmsPcm.resize(channels, vector<float>(levelSize, 0));
+            pWaveform->levels.push_back(std::move(level));
+            if (levelSize == 1)
+                break;
+            levelSize = (levelSize+1)/2;
+            aggregateSamples *= 2;
+        }
+    }
+
+    WaveformPyramidBuilder(Overview::Waveform* pWaveform) : m_pWaveform(pWaveform)
+    {
+        const auto levelCount = pWaveform->levels.size();
+        m_chStates.resize(pWaveform->pcm.size());
+        for (auto& st : m_chStates)
+        {
+            st.written.resize(levelCount, 0);
+            st.pending.resize(levelCount);
+        }
+    }
+
+    void AddSamples(uint32_t ch, const float* pSamples, int sampleCount)
+    {
+        if (ch >= m_chStates.size() || m_pWaveform->levels.empty())
+            return;
+        auto& st = m_chStates[ch];
+        const double aggregateSamples = m_pWaveform->levels[0].aggregateSamples;
+        for (int i = 0; i < sampleCount; i++)
+        {
+            const float val = pSamples[i];
+            if (st.minVal > val) st.minVal = val;
+            if (st.maxVal < val) st.maxVal = val;
+            st.sqSum += (double)val*val;
+            st.count++;
+            st.step++;
+            if (st.step >= aggregateSamples)
+            {
+                st.step -= aggregateSamples;
+                EmitBaseEntry(ch);
+            }
+        }
+    }
+
+    // Publish the number of entries available in all the channels of each level
+    void UpdateValidCounts()
+    {
+        for (size_t i = 0; i < m_pWaveform->levels.size(); i++)
+        {
+            int64_t validCount = INT64_MAX;
+            for (auto& st : m_chStates)
+                if (validCount > st.written[i]) validCount = st.written[i];
+            m_pWaveform->levels[i].validSampleCount = m_chStates.empty() ? 0 : validCount;
+        }
+    }
+
+    // Add an entry of level 0 aggregated elsewhere, the entries must be added in order
+    void AddBaseEntry(uint32_t ch, float minVal, float maxVal, float rms)
+    {
+        if (ch >= m_chStates.size() || m_pWaveform->levels.empty())
+            return;
+        PushEntry(ch, 0, minVal, maxVal, rms);
+    }
+
+    // Flush the partially aggregated entries at the end of the stream
+    void Finish()
+    {
+        for (uint32_t ch = 0; ch < m_chStates.size(); ch++)
+        {
+            auto& st = m_chStates[ch];
+            if (st.count > 0)
+                EmitBaseEntry(ch);
+            for (size_t i = 0; i+1 < st.pending.size(); i++)
+            {
+                auto& p = st.pending[i];
+                if (p.valid)
+                {
+                    p.valid = false;
+                    PushEntry(ch, i+1, p.minVal, p.maxVal, p.rms);
+                }
+            }
+        }
+        UpdateValidCounts();
+    }
+
+private:
+    void EmitBaseEntry(uint32_t ch)
+    {
+        auto& st = m_chStates[ch];
+        PushEntry(ch, 0, st.minVal, st.maxVal, (float)sqrt(st.sqSum/st.count));
+        st.minVal = FLT_MAX; st.maxVal = -FLT_MAX;
+        st.sqSum = 0; st.count = 0;
+    }
+
+    void PushEntry(uint32_t ch, size_t levelIdx, float minVal, float maxVal, float rms)
+    {
+        auto& st = m_chStates[ch];
+        auto& levels = m_pWaveform->levels;
+        while (levelIdx < levels.size())
+        {
+            auto& level = levels[levelIdx];
+            auto& written = st.written[levelIdx];
+            if (written >= (int64_t)level.minPcm[ch].size())
+                return;
+            level.minPcm[ch][written] = minVal;
+            level.maxPcm[ch][written] = maxVal;
+            level.rmsPcm[ch][written] = rms;
+            written++;
+
+            auto& p = st.pending[levelIdx];
+            if (!p.valid)
+            {
+                p.minVal = minVal; p.maxVal = maxVal; p.rms = rms;
+                p.valid = true;
+                return;
+            }
+            p.valid = false;
+            minVal = p.minVal < minVal ? p.minVal : minVal;
+            maxVal = p.maxVal > maxVal ? p.maxVal : maxVal;
+            rms = sqrt((p.rms*p.rms+rms*rms)/2);
+            levelIdx++;
+        }
+    }
+
+private:
+    struct PendingEntry
+    {
+        float minVal, maxVal, rms;
+        bool valid{false};
+    };
+    struct ChannelState
+    {
+        double step{0};
+        float minVal{FLT_MAX}, maxVal{-FLT_MAX};
+        double sqSum{0};
+        int64_t count{0};
+        vector<int64_t> written;
+        vector<PendingEntry> pending;
+    };
+    Overview::Waveform* m_pWaveform;
+    vector<ChannelState> m_chStates;
+};
+
+class Overview_Impl;
+
+static const uint32_t DEFAULT_GENERATIONS_PER_DEVICE = 2;
+// Audio longer than two of these ranges has its waveform decoded in parallel, by ranges of at least this duration
+static const double MIN_WAVEFORM_RANGE_DURATION = 60.;
+static const uint32_t MAX_WAVEFORM_RANGE_THREADS = 4;
+// seek a bit earlier than the start of a range, so the decoder is settled when reaching the range
+static const double WAVEFORM_RANGE_PREROLL = 0.5;
+// a range landing after its start seeks again from farther before it, the last retry decodes from the beginning
+static const int MAX_WAVEFORM_RANGE_SEEK_RETRIES = 3;
+
+// Admit the snapshot and waveform generations of all the Overview instances into a bounded number of slots, so
+// importing many media doesn't start the decoding threads of all of them at once. Waiting generations start by
+// priority then in submission order, and only a limited number of them read from the same storage device.
+class OverviewGenScheduler
+{
+public:
+    static OverviewGenScheduler& GetInstance()
+    {
+        static OverviewGenScheduler s_instance;
+        return s_instance;
+    }
+
+    // 'slotCount' is the number of demuxers the generation runs at the same time
+    void Submit(Overview_Impl* pOvw, const string& url, uint32_t slotCount = 1);
+    // Remove a waiting or running generation, the slot it occupied is given to a waiting one
+    void Release(Overview_Impl* pOvw);
+
+    void SetMaxConcurrentCount(uint32_t count)
+    {
+        lock_guard<mutex> lk(m_lock);
+        m_maxConcurrentCount = count > 0 ? count : GetDefaultConcurrentCount();
+        AdmitWaitingTasks();
+    }
+
+    void SetMaxConcurrentCountPerDevice(uint32_t count)
+    {
+        lock_guard<mutex> lk(m_lock);
+        m_maxCountPerDevice = count > 0 ? count : DEFAULT_GENERATIONS_PER_DEVICE;
+        AdmitWaitingTasks();
+    }
+
+private:
+    OverviewGenScheduler() : m_maxConcurrentCount(GetDefaultConcurrentCount()) {}
+
+    static uint32_t GetDefaultConcurrentCount()
+    {
+        const auto hwThreads = thread::hardware_concurrency();
+        return hwThreads > 4 ? hwThreads/2 : 2;
+    }
+
+    void AdmitWaitingTasks();
+
+private:
+    struct GenTask
+    {
+        Overview_Impl* pOvw;
+        int64_t deviceId;
+        uint32_t slotCount;
+    };
+    mutex m_lock;
+    list<GenTask> m_waitingTasks;
+    list<GenTask> m_runningTasks;
+    uint32_t m_maxConcurrentCount;
+    uint32_t m_maxCountPerDevice{DEFAULT_GENERATIONS_PER_DEVICE};
+};
+
 class Overview_Impl : public Overview
 {
+    friend class OverviewGenScheduler;
 public:
     Overview_Impl()
     {
@@ -85,7 +320,8 @@ public:
             m_ssCount = m_vidFrmCnt;
         m_ssIntvMts = (double)m_vidDurMts/m_ssCount;
 
-        BuildSnapshots();
+        if (!LoadFromAnalysisCache())
+            BuildSnapshots();
         m_opened = true;
         return true;
     }
@@ -111,7 +347,8 @@ public:
         m_ssCount = snapshotCount;
         m_ssIntvMts = (double)m_vidDurMts/m_ssCount;
 
-        BuildSnapshots();
+        if (!LoadFromAnalysisCache())
+            BuildSnapshots();
         m_opened = true;
         return true;
     }
@@ -173,6 +410,33 @@ public:
         return true;
     }
 
+    bool EnableKeyFrameOnly(bool enable) override
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (IsOpened())
+        {
+            m_errMsg = "Key-frame-only mode can only be changed before 'Open()'!";
+            return false;
+        }
+        m_keyFrameOnly = enable;
+        return true;
+    }
+
+    bool IsKeyFrameOnlyEnabled() const override
+    {
+        return m_keyFrameOnly;
+    }
+
+    void SetPriority(int priority) override
+    {
+        m_priority = priority;
+    }
+
+    int GetPriority() const override
+    {
+        return m_priority;
+    }
+
     bool IsOpened() const override
     {
         return m_opened;
@@ -414,6 +678,21 @@ private:
         return oss.str();
     }
 
+    // The demuxers of these formats seek by an index or by the sample positions in the stream. The others, e.g.
+    // VBR MP3 without TOC or ADTS, estimate the position from the bitrate and can land away from the target.
+    static bool IsAudioSeekExact(const AVFormatContext* avfmtCtx, int audStmIdx)
+    {
+        if (!avfmtCtx->iformat || !avfmtCtx->iformat->name)
+            return false;
+        const string fmtName = avfmtCtx->iformat->name;
+        const auto codecId = avfmtCtx->streams[audStmIdx]->codecpar->codec_id;
+        const bool isPcm = codecId >= AV_CODEC_ID_PCM_S16LE && codecId < AV_CODEC_ID_ADPCM_IMA_QT;
+        if (fmtName == "wav" || fmtName == "w64" || fmtName == "aiff")
+            return isPcm;
+        return fmtName.find("mov") != string::npos || fmtName.find("matroska") != string::npos || fmtName == "flac"
+                || fmtName == "ogg" || fmtName == "caf";
+    }
+
     bool OpenMedia(MediaParser::Holder hParser)
     {
         if (!hParser->IsImageSequence())
@@ -436,6 +715,10 @@ private:
                 m_errMsg = oss.str();
                 return false;
             }
+            m_audExactSeek = m_audStmIdx >= 0 && IsAudioSeekExact(m_avfmtCtx, m_audStmIdx);
+            // the generation may wait for a while before it's scheduled, 'Prepare()' opens the media again
+            avformat_close_input(&m_avfmtCtx);
+            m_avfmtCtx = nullptr;
         }
         else
         {
@@ -507,6 +790,7 @@ private:
                 hWaveform->pcm.resize(1);
             for (auto& chpcm : hWaveform->pcm)
                 chpcm.resize(waveformSamples, 0);
+            WaveformPyramidBuilder::AllocateLevels(hWaveform.get(), audStream->sampleRate, audStream->duration);
             m_hWaveform = hWaveform;
         }
 
@@ -543,6 +827,16 @@ private:
         if (!m_hParser->IsImageSequence())
         {
             int fferr;
+            if (!m_avfmtCtx)
+            {
+                fferr = avformat_open_input(&m_avfmtCtx, m_hParser->GetUrl().c_str(), nullptr, nullptr);
+                if (fferr < 0)
+                {
+                    m_avfmtCtx = nullptr;
+                    m_errMsg = FFapiFailureMessage("avformat_open_input", fferr);
+                    return false;
+                }
+            }
             fferr = avformat_find_stream_info(m_avfmtCtx, nullptr);
             if (fferr < 0)
             {
@@ -562,6 +856,8 @@ private:
                 {
                     m_viddecCtx = res.decCtx;
                     m_viddecDevType = res.hwDevType;
+                    if (m_keyFrameOnly)
+                        m_viddecCtx->skip_frame = AVDISCARD_NONKEY;
                     if (m_viddecDevType != AV_HWDEVICE_TYPE_NONE)
                         m_viddecOpenOpts.hHwaMgr->IncreaseDecoderInstanceCount(av_hwdevice_get_type_name(m_viddecDevType));
 #if DONOT_CACHE_HWAVFRAME
@@ -720,6 +1016,59 @@ private:
         return true;
     }
 
+    bool LoadFromAnalysisCache()
+    {
+        auto hAnaCache = m_hParser->GetAnalysisCache();
+        if (!hAnaCache || m_hParser->IsImageSequence())
+            return false;
+        const auto mediaKey = hAnaCache->GetMediaKey(m_hParser->GetUrl());
+        if (mediaKey.empty())
+            return false;
+        vector<ImGui::ImMat> snapshots;
+        if (HasVideo() && !hAnaCache->LoadSnapshots(mediaKey, m_frmCvt.GetOutWidth(), m_frmCvt.GetOutHeight(), m_frmCvt.GetOutColorFormat(), m_ssCount, snapshots))
+            return false;
+        Waveform::Holder hWaveform;
+        if (HasAudio() && !(hWaveform = hAnaCache->LoadWaveform(mediaKey, m_hWaveform->aggregateSamples)))
+            return false;
+
+        m_snapshots.clear();
+        for (uint32_t i = 0; i < snapshots.size(); i++)
+        {
+            Snapshot ss;
+            ss.index = i;
+            ss.img = snapshots[i];
+            m_snapshots.push_back(ss);
+        }
+        if (hWaveform)
+            m_hWaveform = hWaveform;
+        m_genSsEof = m_genWfEof = true;
+        m_logger->Log(DEBUG) << "Load overview of '" << m_hParser->GetUrl() << "' from the analysis cache." << endl;
+        return true;
+    }
+
+    void SaveToAnalysisCache()
+    {
+        auto hAnaCache = m_hParser->GetAnalysisCache();
+        if (!hAnaCache || m_hParser->IsImageSequence())
+            return;
+        const auto mediaKey = hAnaCache->GetMediaKey(m_hParser->GetUrl());
+        if (mediaKey.empty())
+            return;
+        if (m_decodeVideo)
+        {
+            vector<ImGui::ImMat> snapshots;
+            GetSnapshots(snapshots);
+            auto iter = find_if(snapshots.begin(), snapshots.end(), [] (const ImGui::ImMat& m) { return m.empty(); });
+            if (iter == snapshots.end() && !hAnaCache->SaveSnapshots(mediaKey, m_frmCvt.GetOutWidth(), m_frmCvt.GetOutHeight(), m_frmCvt.GetOutColorFormat(), snapshots))
+                m_logger->Log(WARN) << "FAILED to save snapshots into the analysis cache! Error is '" << hAnaCache->GetError() << "'." << endl;
+        }
+        if (m_decodeAudio && m_hWaveform && m_hWaveform->parseDone)
+        {
+            if (!hAnaCache->SaveWaveform(mediaKey, m_hWaveform))
+                m_logger->Log(WARN) << "FAILED to save waveform into the analysis cache! Error is '" << hAnaCache->GetError() << "'." << endl;
+        }
+    }
+
     void BuildSnapshots()
     {
         m_snapshots.clear();
@@ -730,7 +1079,9 @@ private:
             ss.img.time_stamp = (m_ssIntvMts*i+m_vidStartMts)/1000.;
             m_snapshots.push_back(ss);
         }
-        StartAllThreads();
+        // each parallel waveform range opens its own demuxer, they are counted as the extra slots of this generation
+        m_wfRangeCount = HasAudio() ? CalcWaveformRangeCount() : 1;
+        OverviewGenScheduler::GetInstance().Submit(this, m_hParser->GetUrl(), m_wfRangeCount);
     }
 
     void StartAllThreads()
@@ -761,7 +1112,15 @@ private:
                 startReleaseResourceThread = false;
             }
         }
-        if (HasAudio())
+        if (HasAudio() && m_wfRangeCount > 1 && CalcWaveformRangeCount() > 1)
+        {
+            // no shared demuxing and decoding threads, each range has its own demuxer and decoder
+            m_demuxAudEof = m_auddecEof = true;
+            m_genWfThread = thread(&Overview_Impl::GenWaveformParallelThreadProc, this);
+            thnOss.str(""); thnOss << "OvwGwf-" << fileName;
+            SysUtils::SetThreadName(m_genWfThread, thnOss.str());
+        }
+        else if (HasAudio())
         {
             m_demuxAudThread = thread(&Overview_Impl::DemuxAudioThreadProc, this);
             thnOss.str(""); thnOss << "OvwAdmx-" << fileName;
@@ -779,6 +1138,7 @@ private:
 
     void WaitAllThreadsQuit(bool callFromReleaseProc = false)
     {
+        OverviewGenScheduler::GetInstance().Release(this);
         m_quit = true;
         if (!callFromReleaseProc && m_releaseThread.joinable())
         {
@@ -854,6 +1214,7 @@ private:
         if (!m_prepared && !Prepare())
         {
             m_logger->Log(Error) << "Prepare() FAILED for url '" << m_hParser->GetUrl() << "'! Error is '" << m_errMsg << "'." << endl;
+            m_quit = true;
             return;
         }
         if (!m_decodeVideo)
@@ -882,10 +1243,13 @@ private:
                 {
                     int64_t seekTargetPts = ss.ssFrmPts != INT64_MIN ? ss.ssFrmPts :
                         av_rescale_q((int64_t)(m_ssIntvMts*ss.index+m_vidStartMts), MILLISEC_TIMEBASE, m_vidAvStm->time_base);
-                    fferr = avformat_seek_file(m_avfmtCtx, m_vidStmIdx, INT64_MIN, seekTargetPts, seekTargetPts, 0);
+                    if (m_keyFrameOnly)
+                        fferr = av_seek_frame(m_avfmtCtx, m_vidStmIdx, seekTargetPts, AVSEEK_FLAG_BACKWARD);
+                    else
+                        fferr = avformat_seek_file(m_avfmtCtx, m_vidStmIdx, INT64_MIN, seekTargetPts, seekTargetPts, 0);
                     if (fferr < 0)
                     {
-                        m_logger->Log(Error) << "avformat_seek_file() FAILED for seeking to pts(" << seekTargetPts << ")! fferr = " << fferr << "!" << endl;
+                        m_logger->Log(Error) << (m_keyFrameOnly ? "av_seek_frame()" : "avformat_seek_file()") << " FAILED for seeking to pts(" << seekTargetPts << ")! fferr = " << fferr << "!" << endl;
                         break;
                     }
                 }
@@ -900,8 +1264,14 @@ private:
                         int fferr = av_read_frame(m_avfmtCtx, &avpkt);
                         if (fferr == 0)
                         {
-                            avpktLoaded = true;
                             idleLoop = idleLoop2 = false;
+                            if (m_keyFrameOnly && (avpkt.stream_index != m_vidStmIdx || (avpkt.flags&AV_PKT_FLAG_KEY) == 0))
+                            {
+                                // only the key frame at or before the seek position is used as the snapshot
+                                av_packet_unref(&avpkt);
+                                continue;
+                            }
+                            avpktLoaded = true;
                             ss.ssFrmPts = avpkt.pts;
                             auto iter2 = iter;
                             if (avpkt.stream_index == m_vidStmIdx && iter2 != m_snapshots.begin())
@@ -949,7 +1319,7 @@ private:
                                 av_packet_unref(&avpkt);
                                 avpktLoaded = false;
                                 idleLoop = idleLoop2 = false;
-                                if (enqpkt->pts > m_vidAvStm->start_time)
+                                if (m_keyFrameOnly || enqpkt->pts > m_vidAvStm->start_time)
                                     enqDone = true;
                             }
                         }
@@ -1276,6 +1646,8 @@ private:
         const auto outClrfmt = m_frmCvt.GetOutColorFormat();
         const auto outDtype = m_frmCvt.GetOutDataType();
         const auto rszInterp = m_frmCvt.GetResizeInterpolateMode();
+        // one image at a time per context, the parallelism comes from the contexts themselves
+        hImgsqReader->SetImageDecodeParallelism(1, 0);
         if (!hImgsqReader->ConfigVideoReader(outW, outH, outClrfmt, outDtype, rszInterp, HwaccelManager::GetDefaultInstance()))
         {
             ostringstream oss; oss << "FAILED to configure image-sequence reader! Error is '" << hImgsqReader->GetError() << "'.";
@@ -1302,6 +1674,7 @@ private:
         if (!m_prepared && !Prepare())
         {
             m_logger->Log(Error) << "Prepare() FAILED for url '" << m_hParser->GetUrl() << "'! Error is '" << m_errMsg << "'." << endl;
+            OverviewGenScheduler::GetInstance().Release(this);
             return;
         }
 
@@ -1395,6 +1768,7 @@ private:
 
         imgsqDecCtxList.clear();
         m_genSsEof = true;
+        OverviewGenScheduler::GetInstance().Release(this);
         m_logger->Log(DEBUG) << "Leave GenerateSsByImgsqThreadProc()." << endl;
     }
 
@@ -1405,6 +1779,7 @@ private:
         if (!HasVideo() && !m_prepared && !Prepare())
         {
             m_logger->Log(Error) << "Prepare() FAILED! Error is '" << m_errMsg << "'." << endl;
+            m_quit = true;
             return;
         }
         else
@@ -1621,6 +1996,7 @@ private:
         float minSmp{1.f}, maxSmp{-1.f};
         if (m_hWaveform->pcm.size() > 1)
             wf2 = &m_hWaveform->pcm[1];
+        WaveformPyramidBuilder pyramidBuilder(m_hWaveform.get());
         while (!m_quit && wfIdx < wfSize)
         {
             bool idleLoop = true;
@@ -1741,6 +2117,12 @@ private:
                         }
                     }
                 }
+                pyramidBuilder.AddSamples(0, (const float*)dstfrm->data[0], dstfrm->nb_samples);
+                if (ch2ptr)
+                    pyramidBuilder.AddSamples(1, (const float*)dstfrm->data[1], dstfrm->nb_samples);
+                else if (wf2)
+                    pyramidBuilder.AddSamples(1, (const float*)dstfrm->data[0], dstfrm->nb_samples);
+                pyramidBuilder.UpdateValidCounts();
                 wfStep = currWfStep;
                 wfIdx = currWfIdx;
                 m_hWaveform->maxSample = maxSmp;
@@ -1758,11 +2140,576 @@ private:
             if (idleLoop)
                 this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
         }
+        if (!m_quit)
+            pyramidBuilder.Finish();
         m_hWaveform->parseDone = true;
         m_genWfEof = true;
         m_logger->Log(DEBUG) << "Leave GenWaveformThreadProc(), " << wfIdx << " samples generated." << endl;
     }
 
+    // Min/max/rms of the samples aggregated into one waveform entry
+    struct WaveformAccum
+    {
+        int64_t idx{-1};
+        float minVal{FLT_MAX}, maxVal{-FLT_MAX};
+        double sqSum{0};
+        int64_t count{0};
+
+        void Reset(int64_t _idx)
+        {
+            idx = _idx;
+            minVal = FLT_MAX; maxVal = -FLT_MAX;
+            sqSum = 0; count = 0;
+        }
+
+        void Add(float val)
+        {
+            if (minVal > val) minVal = val;
+            if (maxVal < val) maxVal = val;
+            sqSum += (double)val*val;
+            count++;
+        }
+
+        void Merge(const WaveformAccum& other)
+        {
+            if (minVal > other.minVal) minVal = other.minVal;
+            if (maxVal < other.maxVal) maxVal = other.maxVal;
+            sqSum += other.sqSum;
+            count += other.count;
+        }
+
+        bool IsValid() const { return idx >= 0 && count > 0; }
+    };
+
+    // A time range of the audio decoded by its own demuxer and decoder. The entries at the two edges of a range are
+    // only partially aggregated by it, they are kept in 'heads' and 'tails' and merged with the adjacent ranges.
+    // Index 0 of the arrays is for 'pcm', index 1 is for the level 0 of the pyramid.
+    struct WaveformRange
+    {
+        int64_t startSample;
+        int64_t endSample;
+        vector<WaveformAccum> heads[2];
+        vector<WaveformAccum> tails[2];
+        atomic<int64_t> writtenEnd[2];  // entries between the head and this index are all written
+        atomic_bool headReady{false};
+        atomic_bool done{false};
+        atomic_bool failed{false};      // valid when 'done' is true, the entries of the range are incomplete
+        atomic_bool abort{false};       // stop decoding, the merged waveform is given up
+        float minSample{1.f}, maxSample{-1.f};
+        mutex statLock;
+    };
+
+    uint32_t CalcWaveformRangeCount()
+    {
+        // the ranges must start exactly where they are seeked to
+        if (m_audStmIdx < 0 || !m_audExactSeek)
+            return 1;
+        auto pAudstm = dynamic_cast<AudioStream*>(m_hMediaInfo->streams[m_audStmIdx].get());
+        if (!pAudstm || pAudstm->duration < MIN_WAVEFORM_RANGE_DURATION*2)
+            return 1;
+        uint32_t rangeCount = (uint32_t)(pAudstm->duration/MIN_WAVEFORM_RANGE_DURATION);
+        if (rangeCount > MAX_WAVEFORM_RANGE_THREADS)
+            rangeCount = MAX_WAVEFORM_RANGE_THREADS;
+        const uint32_t hwThreads = thread::hardware_concurrency();
+        if (hwThreads > 0 && rangeCount > hwThreads)
+            rangeCount = hwThreads;
+        return rangeCount > 1 ? rangeCount : 1;
+    }
+
+    void WriteWaveformEntry(int kind, uint32_t ch, const WaveformAccum& acc)
+    {
+        if (!acc.IsValid())
+            return;
+        if (kind == 0)
+        {
+            auto& wf = m_hWaveform->pcm[ch];
+            if (acc.idx < (int64_t)wf.size())
+                wf[acc.idx] = abs(acc.maxVal) > abs(acc.minVal) ? acc.maxVal : acc.minVal;
+        }
+        else
+        {
+            auto& level = m_hWaveform->levels[0];
+            if (acc.idx < (int64_t)level.minPcm[ch].size())
+            {
+                level.minPcm[ch][acc.idx] = acc.minVal;
+                level.maxPcm[ch][acc.idx] = acc.maxVal;
+                level.rmsPcm[ch][acc.idx] = (float)sqrt(acc.sqSum/acc.count);
+            }
+        }
+    }
+
+    void UpdateRangeStats(WaveformRange* pRange, const WaveformAccum& acc)
+    {
+        lock_guard<mutex> lk(pRange->statLock);
+        if (pRange->minSample > acc.minVal) pRange->minSample = acc.minVal;
+        if (pRange->maxSample < acc.maxVal) pRange->maxSample = acc.maxVal;
+    }
+
+    // Aggregate 'count' samples starting at the global sample index 'firstSample' into the entries of one channel.
+    void AggregateRangeSamples(WaveformRange* pRange, int kind, uint32_t ch, const float* pSamples, int64_t firstSample, int count,
+            WaveformAccum& acc, bool& headSet)
+    {
+        const double aggregateSamples = kind == 0 ? m_hWaveform->aggregateSamples : m_hWaveform->levels[0].aggregateSamples;
+        int64_t nextEntryStart = acc.idx >= 0 ? (int64_t)ceil((acc.idx+1)*aggregateSamples) : -1;
+        int64_t n = firstSample;
+        for (int i = 0; i < count; i++, n++)
+        {
+            if (n >= nextEntryStart)
+            {
+                if (acc.IsValid())
+                {
+                    if (kind == 0)
+                        UpdateRangeStats(pRange, acc);
+                    if (!headSet)
+                    {
+                        pRange->heads[kind][ch] = acc;
+                        headSet = true;
+                    }
+                    else
+                    {
+                        WriteWaveformEntry(kind, ch, acc);
+                    }
+                }
+                const int64_t idx = (int64_t)(n/aggregateSamples);
+                acc.Reset(idx);
+                nextEntryStart = (int64_t)ceil((idx+1)*aggregateSamples);
+            }
+            acc.Add(pSamples[i]);
+        }
+    }
+
+    void DecodeWaveformRangeProc(WaveformRange* pRange)
+    {
+        const uint32_t channels = m_hWaveform->pcm.size();
+        const int kinds = m_hWaveform->levels.empty() ? 1 : 2;
+        const int sampleRate = m_audAvStm->codecpar->sample_rate;
+        const AVRational audTimeBase = m_audAvStm->time_base;
+        const int64_t stmStartPts = m_audAvStm->start_time != AV_NOPTS_VALUE ? m_audAvStm->start_time : 0;
+        vector<WaveformAccum> accs[2] = { vector<WaveformAccum>(channels), vector<WaveformAccum>(channels) };
+        vector<bool> headSets[2] = { vector<bool>(channels, false), vector<bool>(channels, false) };
+
+        AVFormatContext* avfmtCtx = nullptr;
+        AVCodecContext* auddecCtx = nullptr;
+        SwrContext* swrCtx = nullptr;
+        bool failed = false;
+        int fferr = avformat_open_input(&avfmtCtx, m_hParser->GetUrl().c_str(), nullptr, nullptr);
+        if (fferr < 0)
+        {
+            m_logger->Log(Error) << "'avformat_open_input' FAILED with return code " << fferr << "! Quit waveform range decoding." << endl;
+            avfmtCtx = nullptr;
+            failed = true;
+        }
+        if (!failed)
+        {
+            auddecCtx = avcodec_alloc_context3(m_auddec);
+            if (!auddecCtx || avcodec_parameters_to_context(auddecCtx, m_audAvStm->codecpar) < 0 || (fferr = avcodec_open2(auddecCtx, m_auddec, nullptr)) < 0)
+            {
+                m_logger->Log(Error) << "FAILED to open audio decoder for waveform range decoding! fferr=" << fferr << "." << endl;
+                failed = true;
+            }
+        }
+        if (!failed && !m_swrPassThrough)
+        {
+            swrCtx = swr_alloc();
+            if (!swrCtx || (fferr = av_opt_copy(swrCtx, m_swrCtx)) < 0 || (fferr = swr_init(swrCtx)) < 0)
+            {
+                m_logger->Log(Error) << "FAILED to create 'SwrContext' for waveform range decoding! fferr=" << fferr << "." << endl;
+                failed = true;
+            }
+        }
+        auto seekToRange = [&] (double preroll) {
+            double seekTs = (double)pRange->startSample/sampleRate-preroll;
+            if (seekTs < 0) seekTs = 0;
+            const int64_t seekPts = av_rescale_q((int64_t)(seekTs*AV_TIME_BASE), AV_TIME_BASE_Q, audTimeBase)+stmStartPts;
+            fferr = av_seek_frame(avfmtCtx, m_audStmIdx, seekPts, AVSEEK_FLAG_BACKWARD);
+            if (fferr < 0)
+            {
+                m_logger->Log(Error) << "'av_seek_frame' FAILED to seek to " << seekTs << "s for waveform range decoding! fferr=" << fferr << "." << endl;
+                return false;
+            }
+            return true;
+        };
+        if (!failed && pRange->startSample > 0 && !seekToRange(WAVEFORM_RANGE_PREROLL))
+            failed = true;
+
+        auto ptrPkt = AllocSelfFreeAVPacketPtr();
+        auto ptrFrm = AllocSelfFreeAVFramePtr();
+        vector<vector<float>> cvtBufs;
+        int64_t nextSample = -1;
+        int seekRetries = 0;
+        bool nullpktSent = false;
+        bool rangeEnd = false;
+        while (!m_quit && !pRange->abort && !failed && !rangeEnd)
+        {
+            fferr = avcodec_receive_frame(auddecCtx, ptrFrm.get());
+            if (fferr == 0)
+            {
+                if (nextSample < 0)
+                {
+                    // the samples are counted continuously from the 1st frame, the 1st range starts from the 1st sample
+                    int64_t pts = ptrFrm->best_effort_timestamp != AV_NOPTS_VALUE ? ptrFrm->best_effort_timestamp : ptrFrm->pts;
+                    if (pRange->startSample == 0)
+                        nextSample = 0;
+                    else if (pts != AV_NOPTS_VALUE)
+                        nextSample = av_rescale_q(pts-stmStartPts, audTimeBase, {1, sampleRate});
+                    else
+                    {
+                        m_logger->Log(Error) << "Decoded audio frame has NO timestamp! Quit waveform range decoding." << endl;
+                        failed = true;
+                        break;
+                    }
+                    if (nextSample > pRange->startSample && seekRetries < MAX_WAVEFORM_RANGE_SEEK_RETRIES)
+                    {
+                        // landed after the range start, the samples in between would be missing from the waveform
+                        seekRetries++;
+                        const double preroll = seekRetries < MAX_WAVEFORM_RANGE_SEEK_RETRIES ?
+                                WAVEFORM_RANGE_PREROLL*(4<<seekRetries) : (double)pRange->startSample/sampleRate;
+                        m_logger->Log(DEBUG) << "Waveform range starting at sample " << pRange->startSample << " landed at sample " << nextSample
+                                << ", seek again with preroll " << preroll << "s." << endl;
+                        av_frame_unref(ptrFrm.get());
+                        avcodec_flush_buffers(auddecCtx);
+                        if (swrCtx)
+                            swr_init(swrCtx);
+                        nextSample = -1;
+                        nullpktSent = false;
+                        if (!seekToRange(preroll))
+                        {
+                            failed = true;
+                            break;
+                        }
+                        continue;
+                    }
+                }
+
+                const float* chptrs[2] = { nullptr, nullptr };
+                int sampleCount = ptrFrm->nb_samples;
+                int dstCh;
+                if (swrCtx)
+                {
+#if !defined(FF_API_OLD_CHANNEL_LAYOUT) && (LIBAVUTIL_VERSION_MAJOR < 58)
+                    dstCh = m_swrOutChannels;
+#else
+                    dstCh = m_swrOutChlyt.nb_channels;
+#endif
+                    const int outSamples = swr_get_out_samples(swrCtx, ptrFrm->nb_samples);
+                    cvtBufs.resize(dstCh);
+                    uint8_t* outPtrs[8] = { nullptr };
+                    for (int i = 0; i < dstCh && i < 8; i++)
+                    {
+                        if ((int)cvtBufs[i].size() < outSamples)
+                            cvtBufs[i].resize(outSamples);
+                        outPtrs[i] = (uint8_t*)cvtBufs[i].data();
+                    }
+                    sampleCount = swr_convert(swrCtx, outPtrs, outSamples, (const uint8_t**)ptrFrm->extended_data, ptrFrm->nb_samples);
+                    if (sampleCount < 0)
+                    {
+                        m_logger->Log(Error) << "swr_convert(DecodeWaveformRangeProc) FAILED with return code " << sampleCount << endl;
+                        failed = true;
+                        break;
+                    }
+                    chptrs[0] = cvtBufs[0].data();
+                    if (dstCh > 1) chptrs[1] = cvtBufs[1].data();
+                }
+                else
+                {
+#if !defined(FF_API_OLD_CHANNEL_LAYOUT) && (LIBAVUTIL_VERSION_MAJOR < 58)
+                    dstCh = ptrFrm->channels;
+#else
+                    dstCh = ptrFrm->ch_layout.nb_channels;
+#endif
+                    chptrs[0] = (const float*)ptrFrm->data[0];
+                    if (dstCh > 1) chptrs[1] = (const float*)ptrFrm->data[1];
+                }
+
+                // only the samples in [startSample, endSample) belong to this range
+                int64_t skipCount = pRange->startSample-nextSample;
+                if (skipCount < 0) skipCount = 0;
+                int64_t takeEnd = pRange->endSample-nextSample;
+                if (takeEnd >= sampleCount)
+                    takeEnd = sampleCount;
+                else
+                    rangeEnd = true;
+                if (takeEnd > skipCount)
+                {
+                    const int64_t firstSample = nextSample+skipCount;
+                    const int count = (int)(takeEnd-skipCount);
+                    for (int k = 0; k < kinds; k++)
+                    {
+                        for (uint32_t ch = 0; ch < channels; ch++)
+                        {
+                            // the pyramid uses the 1st channel for the 2nd one if the output is mono, while 'pcm' leaves it empty
+                            const float* pSamples = ch > 0 && !chptrs[1] ? (k == 0 ? nullptr : chptrs[0]) : chptrs[ch];
+                            if (!pSamples)
+                                continue;
+                            bool headSet = headSets[k][ch];
+                            AggregateRangeSamples(pRange, k, ch, pSamples+skipCount, firstSample, count, accs[k][ch], headSet);
+                            headSets[k][ch] = headSet;
+                        }
+                        pRange->writtenEnd[k] = accs[k][0].idx;
+                    }
+                    bool headReady = true;
+                    for (int k = 0; k < kinds; k++)
+                        headReady &= (bool)headSets[k][0];
+                    if (headReady && !pRange->headReady)
+                        pRange->headReady = true;
+                }
+                nextSample += sampleCount;
+                av_frame_unref(ptrFrm.get());
+                continue;
+            }
+            else if (fferr == AVERROR_EOF)
+            {
+                break;
+            }
+            else if (fferr != AVERROR(EAGAIN))
+            {
+                m_logger->Log(Error) << "FAILED to invoke 'avcodec_receive_frame'(DecodeWaveformRangeProc)! return code is " << fferr << "." << endl;
+                failed = true;
+                break;
+            }
+            if (nullpktSent)
+                break;
+
+            fferr = av_read_frame(avfmtCtx, ptrPkt.get());
+            if (fferr == 0)
+            {
+                if (ptrPkt->stream_index == m_audStmIdx)
+                {
+                    fferr = avcodec_send_packet(auddecCtx, ptrPkt.get());
+                    if (fferr < 0)
+                        m_logger->Log(WARN) << "FAILED to invoke 'avcodec_send_packet'(DecodeWaveformRangeProc)! return code is " << fferr << "." << endl;
+                }
+                av_packet_unref(ptrPkt.get());
+            }
+            else
+            {
+                if (fferr != AVERROR_EOF)
+                    m_logger->Log(Error) << "Demuxer ERROR! 'av_read_frame(DecodeWaveformRangeProc)' returns " << fferr << "." << endl;
+                avcodec_send_packet(auddecCtx, nullptr);
+                nullpktSent = true;
+            }
+        }
+
+        // the entry in aggregation at the end is shared with the next range
+        for (int k = 0; k < kinds; k++)
+        {
+            for (uint32_t ch = 0; ch < channels; ch++)
+            {
+                const auto& acc = accs[k][ch];
+                if (!acc.IsValid())
+                    continue;
+                if (k == 0)
+                    UpdateRangeStats(pRange, acc);
+                pRange->tails[k][ch] = acc;
+            }
+            if (accs[k][0].idx >= 0)
+                pRange->writtenEnd[k] = accs[k][0].idx;
+        }
+        pRange->failed = failed;
+        pRange->done = true;
+
+        if (swrCtx)
+            swr_free(&swrCtx);
+        if (auddecCtx)
+            avcodec_free_context(&auddecCtx);
+        if (avfmtCtx)
+            avformat_close_input(&avfmtCtx);
+    }
+
+    // Generate the waveform of a long audio by decoding several time ranges in parallel
+    void GenWaveformParallelThreadProc()
+    {
+        m_logger->Log(DEBUG) << "Enter GenWaveformParallelThreadProc()..." << endl;
+
+        if (!HasVideo() && !m_prepared && !Prepare())
+        {
+            m_logger->Log(Error) << "Prepare() FAILED! Error is '" << m_errMsg << "'." << endl;
+            m_quit = true;
+            return;
+        }
+        while (!m_prepared && !m_quit)
+            this_thread::sleep_for(chrono::milliseconds(5));
+        if (m_quit)
+            return;
+        if (!m_decodeAudio)
+        {
+            m_hWaveform->parseDone = true;
+            m_genWfEof = true;
+            return;
+        }
+
+        bool succeeded = GenWaveformByRanges(m_wfRangeCount);
+        if (!succeeded && !m_quit)
+        {
+            // a range which can't be decoded from its seek point, decode the whole stream in order instead
+            m_logger->Log(WARN) << "Parallel waveform decoding FAILED, fall back to sequential decoding." << endl;
+            m_hWaveform->validSampleCount = 0;
+            succeeded = GenWaveformByRanges(1);
+        }
+        // an incomplete waveform must not be taken as parsed, nor saved into the analysis cache
+        if (succeeded)
+            m_hWaveform->parseDone = true;
+        m_genWfEof = true;
+        m_logger->Log(DEBUG) << "Leave GenWaveformParallelThreadProc(), " << m_hWaveform->validSampleCount << " samples generated." << endl;
+    }
+
+    // Decode the audio stream in 'rangeCount' ranges, each by its own demuxer and decoder, and merge the entries
+    // in order as the ranges progress. 'validSampleCount' is updated to the end of the contiguous part. Return
+    // false if quit or any of the ranges failed, in which case the waveform is incomplete.
+    bool GenWaveformByRanges(uint32_t rangeCount)
+    {
+        const uint32_t channels = m_hWaveform->pcm.size();
+        const int kinds = m_hWaveform->levels.empty() ? 1 : 2;
+        const int64_t entryCounts[2] = { (int64_t)m_hWaveform->pcm[0].size(), kinds > 1 ? (int64_t)m_hWaveform->levels[0].minPcm[0].size() : 0 };
+        auto pAudstm = dynamic_cast<AudioStream*>(m_hMediaInfo->streams[m_audStmIdx].get());
+        const int64_t totalSamples = (int64_t)ceil(pAudstm->duration*m_audAvStm->codecpar->sample_rate);
+        vector<unique_ptr<WaveformRange>> ranges;
+        for (uint32_t i = 0; i < rangeCount; i++)
+        {
+            unique_ptr<WaveformRange> hRange(new WaveformRange());
+            hRange->startSample = totalSamples*i/rangeCount;
+            hRange->endSample = i+1 < rangeCount ? totalSamples*(i+1)/rangeCount : INT64_MAX;
+            for (int k = 0; k < 2; k++)
+            {
+                hRange->heads[k].resize(channels);
+                hRange->tails[k].resize(channels);
+                hRange->writtenEnd[k] = 0;
+            }
+            ranges.push_back(std::move(hRange));
+        }
+        const string fileName = SysUtils::ExtractFileName(m_hParser->GetUrl());
+        vector<thread> rangeThreads;
+        for (uint32_t i = 0; i < ranges.size(); i++)
+        {
+            rangeThreads.push_back(thread(&Overview_Impl::DecodeWaveformRangeProc, this, ranges[i].get()));
+            ostringstream thnOss; thnOss << "OvwGwf" << i << "-" << fileName;
+            SysUtils::SetThreadName(rangeThreads.back(), thnOss.str());
+        }
+
+        WaveformPyramidBuilder pyramidBuilder(m_hWaveform.get());
+        // the entry at the end of the merged ranges, which may still be shared with the next range
+        vector<WaveformAccum> carries[2] = { vector<WaveformAccum>(channels), vector<WaveformAccum>(channels) };
+        auto pushToCarry = [&] (int k, uint32_t ch, const WaveformAccum& acc) {
+            if (!acc.IsValid())
+                return;
+            auto& carry = carries[k][ch];
+            if (carry.IsValid() && carry.idx == acc.idx)
+            {
+                carry.Merge(acc);
+            }
+            else
+            {
+                WriteWaveformEntry(k, ch, carry);
+                carry = acc;
+            }
+        };
+        int64_t validEnds[2] = {0, 0};
+        int64_t pyramidFedEnd = 0;
+        auto publish = [&] () {
+            if (kinds > 1)
+            {
+                const auto& baseLevel = m_hWaveform->levels[0];
+                const int64_t pyramidEnd = validEnds[1] < entryCounts[1] ? validEnds[1] : entryCounts[1];
+                for (; pyramidFedEnd < pyramidEnd; pyramidFedEnd++)
+                {
+                    for (uint32_t ch = 0; ch < channels; ch++)
+                        pyramidBuilder.AddBaseEntry(ch, baseLevel.minPcm[ch][pyramidFedEnd], baseLevel.maxPcm[ch][pyramidFedEnd], baseLevel.rmsPcm[ch][pyramidFedEnd]);
+                }
+                pyramidBuilder.UpdateValidCounts();
+            }
+            float minSmp{1.f}, maxSmp{-1.f};
+            for (auto& hRange : ranges)
+            {
+                lock_guard<mutex> lk(hRange->statLock);
+                if (minSmp > hRange->minSample) minSmp = hRange->minSample;
+                if (maxSmp < hRange->maxSample) maxSmp = hRange->maxSample;
+            }
+            m_hWaveform->maxSample = maxSmp;
+            m_hWaveform->minSample = minSmp;
+            m_hWaveform->validSampleCount = validEnds[0] < entryCounts[0] ? validEnds[0] : entryCounts[0];
+        };
+
+        size_t currRange = 0;
+        bool headMerged = false;
+        bool rangeFailed = false;
+        while (!m_quit && currRange < ranges.size())
+        {
+            bool idleLoop = true;
+            auto& range = *ranges[currRange];
+            if (range.done && range.failed)
+            {
+                // the entries after this point can't be merged, leave them to the caller
+                m_logger->Log(WARN) << "Waveform range " << currRange << " starting at sample " << range.startSample << " FAILED to decode." << endl;
+                rangeFailed = true;
+                break;
+            }
+            if (!headMerged && (range.headReady || range.done))
+            {
+                // a head is never the last entry of its range, so it's complete after merging with the previous tail
+                for (int k = 0; k < kinds; k++)
+                {
+                    for (uint32_t ch = 0; ch < channels; ch++)
+                    {
+                        const auto& head = range.heads[k][ch];
+                        if (!head.IsValid())
+                            continue;
+                        pushToCarry(k, ch, head);
+                        WriteWaveformEntry(k, ch, carries[k][ch]);
+                        carries[k][ch].Reset(-1);
+                    }
+                    if (range.heads[k][0].IsValid())
+                        validEnds[k] = range.heads[k][0].idx+1;
+                }
+                headMerged = true;
+                idleLoop = false;
+            }
+            if (headMerged)
+            {
+                const bool rangeDone = range.done;
+                for (int k = 0; k < kinds; k++)
+                {
+                    const int64_t writtenEnd = range.writtenEnd[k];
+                    if (validEnds[k] < writtenEnd)
+                        validEnds[k] = writtenEnd;
+                }
+                if (rangeDone)
+                {
+                    for (int k = 0; k < kinds; k++)
+                        for (uint32_t ch = 0; ch < channels; ch++)
+                            pushToCarry(k, ch, range.tails[k][ch]);
+                    currRange++;
+                    headMerged = false;
+                    idleLoop = false;
+                }
+            }
+            publish();
+
+            if (idleLoop)
+                this_thread::sleep_for(chrono::milliseconds(THREAD_IDLE_TIME));
+        }
+        if (rangeFailed)
+        {
+            for (auto& hRange : ranges)
+                hRange->abort = true;
+        }
+        for (auto& t : rangeThreads)
+        {
+            if (t.joinable())
+                t.join();
+        }
+        if (m_quit || rangeFailed)
+            return false;
+        for (int k = 0; k < kinds; k++)
+        {
+            for (uint32_t ch = 0; ch < channels; ch++)
+                WriteWaveformEntry(k, ch, carries[k][ch]);
+            validEnds[k] = entryCounts[k];
+        }
+        publish();
+        pyramidBuilder.Finish();
+        return true;
+    }
+
     void ReleaseResources(bool callFromReleaseProc = false)
     {
         WaitAllThreadsQuit(callFromReleaseProc);
@@ -1836,9 +2783,12 @@ private:
                 return;
             }
             lock_guard<recursive_mutex> lk(m_apiLock, adopt_lock);
+            SaveToAnalysisCache();
             m_logger->Log(DEBUG) << "AUTO RELEASE decoding resources." << endl;
             ReleaseResources(true);
         }
+        // give the slot to the waiting generations also when the preparation failed
+        OverviewGenScheduler::GetInstance().Release(this);
     }
 
 private:
@@ -1912,11 +2862,14 @@ private:
     thread m_genWfThread;
     bool m_swrPassThrough{false};
     bool m_genWfEof{false};
+    uint32_t m_wfRangeCount{1};
+    bool m_audExactSeek{false};
     // thread to release computer resources after all snapshots are finished
     thread m_releaseThread;
 
     recursive_mutex m_apiLock;
     bool m_quit{false};
+    atomic<int> m_priority{0};
 
     // video snapshots
     vector<Snapshot> m_snapshots;
@@ -1935,6 +2888,7 @@ private:
     uint32_t m_singleFramePixels{200};
     double m_minAggregateSamples{5};
     double m_fixedAggregateSamples{0};
+    bool m_keyFrameOnly{false};
 
     // AVFrame -> ImMat
     bool m_useRszFactor{false};
@@ -1944,6 +2898,62 @@ private:
     AVFrameToImMatConverter m_frmCvt;
 };
 
+void OverviewGenScheduler::Submit(Overview_Impl* pOvw, const string& url, uint32_t slotCount)
+{
+    struct stat st;
+    const int64_t deviceId = stat(url.c_str(), &st) == 0 ? (int64_t)st.st_dev : -1;
+    lock_guard<mutex> lk(m_lock);
+    m_waitingTasks.push_back({pOvw, deviceId, slotCount > 0 ? slotCount : 1});
+    AdmitWaitingTasks();
+}
+
+void OverviewGenScheduler::Release(Overview_Impl* pOvw)
+{
+    lock_guard<mutex> lk(m_lock);
+    auto isTarget = [pOvw] (const GenTask& t) { return t.pOvw == pOvw; };
+    m_waitingTasks.remove_if(isTarget);
+    const auto runningCount = m_runningTasks.size();
+    m_runningTasks.remove_if(isTarget);
+    if (m_runningTasks.size() < runningCount)
+        AdmitWaitingTasks();
+}
+
+void OverviewGenScheduler::AdmitWaitingTasks()
+{
+    while (!m_waitingTasks.empty())
+    {
+        uint32_t runningSlots = 0;
+        for (auto& t : m_runningTasks)
+            runningSlots += t.slotCount;
+        if (runningSlots >= m_maxConcurrentCount)
+            break;
+        auto selIter = m_waitingTasks.end();
+        for (auto iter = m_waitingTasks.begin(); iter != m_waitingTasks.end(); iter++)
+        {
+            // a generation needing more slots than the limit is still admitted when nothing else is running
+            if (runningSlots > 0 && runningSlots+iter->slotCount > m_maxConcurrentCount)
+                continue;
+            const auto deviceId = iter->deviceId;
+            uint32_t deviceSlots = 0;
+            for (auto& t : m_runningTasks)
+            {
+                if (t.deviceId == deviceId)
+                    deviceSlots += t.slotCount;
+            }
+            if (deviceId >= 0 && deviceSlots > 0 && deviceSlots+iter->slotCount > m_maxCountPerDevice)
+                continue;
+            if (selIter == m_waitingTasks.end() || iter->pOvw->GetPriority() > selIter->pOvw->GetPriority())
+                selIter = iter;
+        }
+        if (selIter == m_waitingTasks.end())
+            break;
+        auto task = *selIter;
+        m_waitingTasks.erase(selIter);
+        m_runningTasks.push_back(task);
+        task.pOvw->StartAllThreads();
+    }
+}
+
 static const auto OVERVIEW_HOLDER_DELETER = [] (Overview* p) {
     Overview_Impl* ptr = dynamic_cast<Overview_Impl*>(p);
     ptr->Close();
@@ -1959,4 +2969,14 @@ ALogger* Overview::GetLogger()
 {
     return Logger::GetLogger("MOverview");
 }
+
+void Overview::SetMaxConcurrentGenerations(uint32_t count)
+{
+    OverviewGenScheduler::GetInstance().SetMaxConcurrentCount(count);
+}
+
+void Overview::SetMaxConcurrentGenerationsPerDevice(uint32_t count)
+{
+    OverviewGenScheduler::GetInstance().SetMaxConcurrentCountPerDevice(count);
+}
 }
@@ -0,0 +1,724 @@
+/*
+    Copyright (c) 2023-2024 CodeWin
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <atomic>
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include "SegmentMuxer.h"
+#include "FFUtils.h"
+extern "C"
+{
+    #include "libavutil/avutil.h"
+    #include "libavformat/avformat.h"
+    #include "libavcodec/avcodec.h"
+    #include "libavutil/pixdesc.h"
+}
+
+using namespace std;
+using namespace Logger;
+
+namespace MediaCore
+{
+// packets checked after a key frame for the leading frames of an open GOP
+static const int MAX_GOP_CHECK_PACKETS = 32;
+
+class SegmentMuxer_Impl : public SegmentMuxer
+{
+public:
+    SegmentMuxer_Impl()
+    {
+        m_logger = SegmentMuxer::GetLogger();
+    }
+
+    SegmentMuxer_Impl(const SegmentMuxer_Impl&) = delete;
+    SegmentMuxer_Impl(SegmentMuxer_Impl&&) = delete;
+    SegmentMuxer_Impl& operator=(const SegmentMuxer_Impl&) = delete;
+
+    virtual ~SegmentMuxer_Impl()
+    {
+        ReleaseResources();
+    }
+
+    bool Mux(const string& outputUrl, const vector<Segment>& videoSegments, const string& audioPath) override
+    {
+        ReleaseResources();
+        m_cancel = false;
+        m_progress = 0;
+        if (videoSegments.empty() && audioPath.empty())
+        {
+            m_errMsg = "No input to mux!";
+            return false;
+        }
+        bool success = Mux_Internal(outputUrl, videoSegments, audioPath);
+        ReleaseResources();
+        if (success)
+            m_progress = 1;
+        return success;
+    }
+
+    bool IsStreamCopyCompatible(const vector<Segment>& videoSegments) override
+    {
+        ReleaseResources();
+        bool compatible = OpenSegmentInputs(videoSegments) && CheckCodecParameters() && CheckCopyRangeBoundaries();
+        ReleaseResources();
+        return compatible;
+    }
+
+    bool GetVideoCodecInfo(const string& url, VideoCodecInfo& codecInfo) override
+    {
+        Input input;
+        bool success = OpenInput(url, AVMEDIA_TYPE_VIDEO, input);
+        if (success)
+        {
+            const AVCodecParameters* par = input.avfmtCtx->streams[input.stmIdx]->codecpar;
+            codecInfo.codecName = avcodec_get_name(par->codec_id);
+            const char* profileName = avcodec_profile_name(par->codec_id, par->profile);
+            codecInfo.profileName = profileName ? string(profileName) : string();
+            codecInfo.level = par->level;
+            const char* pixfmtName = av_get_pix_fmt_name((AVPixelFormat)par->format);
+            codecInfo.pixelFormat = pixfmtName ? string(pixfmtName) : string();
+        }
+        if (input.avfmtCtx)
+            avformat_close_input(&input.avfmtCtx);
+        return success;
+    }
+
+    bool IsClosedGopAt(const string& url, int64_t keyFrameTime) override
+    {
+        Input input;
+        bool closed = false;
+        if (OpenInput(url, AVMEDIA_TYPE_VIDEO, input))
+        {
+            const AVStream* inStm = input.avfmtCtx->streams[input.stmIdx];
+            const int64_t stmStartTs = inStm->start_time != AV_NOPTS_VALUE ? inStm->start_time : 0;
+            closed = IsClosedGop(input, stmStartTs+av_rescale_q(keyFrameTime, MILLISEC_TIMEBASE, inStm->time_base));
+        }
+        if (input.avfmtCtx)
+            avformat_close_input(&input.avfmtCtx);
+        return closed;
+    }
+
+    void Cancel() override
+    {
+        m_cancel = true;
+    }
+
+    float GetProgress() const override
+    {
+        return m_progress;
+    }
+
+    string GetError() const override
+    {
+        return m_errMsg;
+    }
+
+private:
+    struct Input
+    {
+        AVFormatContext* avfmtCtx{nullptr};
+        int stmIdx{-1};
+        int64_t tsOffset{0};  // in the output stream time base
+        bool isCopyRange{false};
+        int64_t copyStartTs{0};  // in the input stream time base
+        int64_t copyEndTs{INT64_MAX};
+        AVPacket* firstPkt{nullptr};  // the first video packet, read ahead to find the reorder delay of the segment
+        int64_t dtsDelay{0};  // pts-dts of the first packet, in the input stream time base
+        int64_t dtsShift{0};  // in the output stream time base
+        vector<uint8_t> inbandHeaders;  // parameter sets put in front of the first packet, if they differ from the previous segment
+    };
+
+    string FFapiFailureMessage(const string& apiName, int fferr)
+    {
+        ostringstream oss;
+        oss << "FF api '" << apiName << "' returns error! fferr=" << fferr << ".";
+        return oss.str();
+    }
+
+    bool OpenInput(const string& path, AVMediaType mediaType, Input& input)
+    {
+        int fferr = avformat_open_input(&input.avfmtCtx, path.c_str(), nullptr, nullptr);
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("avformat_open_input", fferr)+" Url is '"+path+"'.";
+            return false;
+        }
+        fferr = avformat_find_stream_info(input.avfmtCtx, nullptr);
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("avformat_find_stream_info", fferr)+" Url is '"+path+"'.";
+            return false;
+        }
+        input.stmIdx = av_find_best_stream(input.avfmtCtx, mediaType, -1, -1, nullptr, 0);
+        if (input.stmIdx < 0)
+        {
+            ostringstream oss;
+            oss << "CANNOT find " << av_get_media_type_string(mediaType) << " stream in '" << path << "'!";
+            m_errMsg = oss.str();
+            return false;
+        }
+        return true;
+    }
+
+    bool OpenSegmentInputs(const vector<Segment>& videoSegments)
+    {
+        m_segInputs.resize(videoSegments.size());
+        for (size_t i = 0; i < videoSegments.size(); i++)
+        {
+            const auto& seg = videoSegments[i];
+            auto& input = m_segInputs[i];
+            if (!OpenInput(seg.path, AVMEDIA_TYPE_VIDEO, input))
+                return false;
+            if (seg.copyStart < 0)
+                continue;
+            const AVStream* inStm = input.avfmtCtx->streams[input.stmIdx];
+            const int64_t stmStartTs = inStm->start_time != AV_NOPTS_VALUE ? inStm->start_time : 0;
+            input.isCopyRange = true;
+            input.copyStartTs = stmStartTs+av_rescale_q(seg.copyStart, MILLISEC_TIMEBASE, inStm->time_base);
+            if (seg.copyEnd >= 0)
+                input.copyEndTs = stmStartTs+av_rescale_q(seg.copyEnd, MILLISEC_TIMEBASE, inStm->time_base);
+            int fferr = av_seek_frame(input.avfmtCtx, input.stmIdx, input.copyStartTs, AVSEEK_FLAG_BACKWARD);
+            if (fferr < 0)
+            {
+                m_errMsg = FFapiFailureMessage("av_seek_frame", fferr)+" Url is '"+seg.path+"'.";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool IsSameExtradata(const AVCodecParameters* par1, const AVCodecParameters* par2)
+    {
+        return par1->extradata_size == par2->extradata_size &&
+                (par1->extradata_size == 0 || memcmp(par1->extradata, par2->extradata, par1->extradata_size) == 0);
+    }
+
+    // Convert the parameter sets in the extradata of h264 or hevc into the packet format of the stream. For 'avcC' and
+    // 'hvcC' the nal units are prefixed by their length in 'nalLenSize' bytes, for annex b the extradata is used as is,
+    // and 'nalLenSize' is 0. Return false for other codecs or a malformed extradata.
+    static bool ExtradataToInbandHeaders(const AVCodecParameters* par, vector<uint8_t>& headers, int& nalLenSize)
+    {
+        const uint8_t* p = par->extradata;
+        const uint8_t* end = p+par->extradata_size;
+        headers.clear();
+        if ((par->codec_id != AV_CODEC_ID_H264 && par->codec_id != AV_CODEC_ID_HEVC) || par->extradata_size < 4)
+            return false;
+        if (p[0] != 1)
+        {
+            // annex b, starts with a start code
+            if (!(p[0] == 0 && p[1] == 0 && (p[2] == 1 || (p[2] == 0 && p[3] == 1))))
+                return false;
+            headers.assign(p, end);
+            nalLenSize = 0;
+            return true;
+        }
+        auto appendNalus = [&] (int count) {
+            for (int i = 0; i < count; i++)
+            {
+                if (end-p < 2)
+                    return false;
+                const int size = (p[0]<<8)|p[1];
+                p += 2;
+                if (end-p < size)
+                    return false;
+                for (int j = nalLenSize-1; j >= 0; j--)
+                    headers.push_back((uint8_t)(size>>(j*8)));
+                headers.insert(headers.end(), p, p+size);
+                p += size;
+            }
+            return true;
+        };
+        if (par->codec_id == AV_CODEC_ID_H264)
+        {
+            // avcC: 5 bytes header, the sps list and the pps list
+            if (par->extradata_size < 7)
+                return false;
+            nalLenSize = (p[4]&0x3)+1;
+            const int spsCount = p[5]&0x1f;
+            p += 6;
+            if (!appendNalus(spsCount) || p >= end)
+                return false;
+            const int ppsCount = *p++;
+            return appendNalus(ppsCount);
+        }
+        // hvcC: 22 bytes header, then the arrays of vps, sps, pps and sei
+        if (par->extradata_size < 23)
+            return false;
+        nalLenSize = (p[21]&0x3)+1;
+        const int arrayCount = p[22];
+        p += 23;
+        for (int i = 0; i < arrayCount; i++)
+        {
+            if (end-p < 3)
+                return false;
+            const int naluCount = (p[1]<<8)|p[2];
+            p += 3;
+            if (!appendNalus(naluCount))
+                return false;
+        }
+        return true;
+    }
+
+    // Packets of different segments can only be put into one stream if they are decodable with the same codec parameters.
+    // The sources and the re-encoded segments rarely have identical h264/hevc extradata even with the same profile and
+    // level, their parameter sets are put in-band at the segment start instead, where the decoder takes them over.
+    bool CheckCodecParameters()
+    {
+        if (m_segInputs.size() < 2)
+            return true;
+        const AVCodecParameters* refpar = m_segInputs[0].avfmtCtx->streams[m_segInputs[0].stmIdx]->codecpar;
+        vector<uint8_t> refHeaders;
+        int refNalLenSize = -1;
+        for (size_t i = 1; i < m_segInputs.size(); i++)
+        {
+            auto& input = m_segInputs[i];
+            const AVCodecParameters* par = input.avfmtCtx->streams[input.stmIdx]->codecpar;
+            const AVCodecParameters* prevpar = m_segInputs[i-1].avfmtCtx->streams[m_segInputs[i-1].stmIdx]->codecpar;
+            input.inbandHeaders.clear();
+            ostringstream oss;
+            if (par->codec_id != refpar->codec_id)
+                oss << "codec '" << avcodec_get_name(par->codec_id) << "' is different from '" << avcodec_get_name(refpar->codec_id) << "'";
+            else if (par->width != refpar->width || par->height != refpar->height)
+                oss << "size " << par->width << "x" << par->height << " is different from " << refpar->width << "x" << refpar->height;
+            else if (par->format != refpar->format)
+                oss << "pixel format " << par->format << " is different from " << refpar->format;
+            else if (par->profile != refpar->profile)
+                oss << "profile " << par->profile << " is different from " << refpar->profile;
+            else if (!IsSameExtradata(par, prevpar))
+            {
+                // the packets of all the segments must use the same nal unit format as the stream extradata
+                int nalLenSize = -1;
+                if (refNalLenSize < 0 && !ExtradataToInbandHeaders(refpar, refHeaders, refNalLenSize))
+                    oss << "codec extradata is different, and the parameter sets of codec '" << avcodec_get_name(par->codec_id) << "' can't be put in-band";
+                else if (!ExtradataToInbandHeaders(par, input.inbandHeaders, nalLenSize))
+                    oss << "codec extradata is different, and it CANNOT be parsed";
+                else if (nalLenSize != refNalLenSize)
+                    oss << "nal unit length size " << nalLenSize << " is different from " << refNalLenSize;
+            }
+            if (!oss.str().empty())
+            {
+                m_errMsg = "Video of segment #"+to_string(i)+" '"+m_segInputs[i].avfmtCtx->url+"' is NOT compatible with segment #0, "+oss.str()+".";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Find the key frame at 'keyTs' and check the packets following it in decoding order. In an open GOP the leading
+    // frames are presented before the key frame, they show up right after it, no later than the reorder depth.
+    bool IsClosedGop(Input& input, int64_t keyTs)
+    {
+        const AVStream* inStm = input.avfmtCtx->streams[input.stmIdx];
+        int fferr = av_seek_frame(input.avfmtCtx, input.stmIdx, keyTs, AVSEEK_FLAG_BACKWARD);
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("av_seek_frame", fferr)+" Url is '"+input.avfmtCtx->url+"'.";
+            return false;
+        }
+        // the key frame times are in millisecond, the exact pts can be up to 1 millisecond before
+        const int64_t tolerance = av_rescale_q(1, MILLISEC_TIMEBASE, inStm->time_base);
+        AVPacket* pkt = av_packet_alloc();
+        int64_t keyPts = AV_NOPTS_VALUE;
+        int checkedPkts = 0;
+        bool closed = true;
+        while (av_read_frame(input.avfmtCtx, pkt) >= 0)
+        {
+            if (pkt->stream_index != input.stmIdx)
+            {
+                av_packet_unref(pkt);
+                continue;
+            }
+            const bool isKey = (pkt->flags&AV_PKT_FLAG_KEY) != 0;
+            const int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            av_packet_unref(pkt);
+            if (keyPts == AV_NOPTS_VALUE)
+            {
+                if (isKey && pts != AV_NOPTS_VALUE && pts >= keyTs-tolerance)
+                    keyPts = pts;
+                continue;
+            }
+            if (isKey || ++checkedPkts > MAX_GOP_CHECK_PACKETS)
+                break;
+            if (pts != AV_NOPTS_VALUE && pts < keyPts)
+            {
+                closed = false;
+                break;
+            }
+        }
+        av_packet_free(&pkt);
+        if (keyPts == AV_NOPTS_VALUE)
+        {
+            m_errMsg = "CANNOT find the key frame at "+to_string(keyTs)+" in '"+input.avfmtCtx->url+"'!";
+            return false;
+        }
+        if (!closed)
+            m_errMsg = "The GOP at "+to_string(keyTs)+" in '"+string(input.avfmtCtx->url)+"' is open.";
+        return closed;
+    }
+
+    // A copied range is cut by the presentation time, so it must not start or end with an open GOP
+    bool CheckCopyRangeBoundaries()
+    {
+        for (auto& input : m_segInputs)
+        {
+            if (!input.isCopyRange)
+                continue;
+            if (!IsClosedGop(input, input.copyStartTs) ||
+                (input.copyEndTs != INT64_MAX && !IsClosedGop(input, input.copyEndTs)))
+                return false;
+        }
+        return true;
+    }
+
+    AVStream* AddOutputStream(const Input& input)
+    {
+        const AVStream* inStm = input.avfmtCtx->streams[input.stmIdx];
+        AVStream* outStm = avformat_new_stream(m_outAvfmtCtx, nullptr);
+        if (!outStm)
+        {
+            m_errMsg = "FAILED to create new stream by 'avformat_new_stream'!";
+            return nullptr;
+        }
+        int fferr = avcodec_parameters_copy(outStm->codecpar, inStm->codecpar);
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("avcodec_parameters_copy", fferr);
+            return nullptr;
+        }
+        outStm->codecpar->codec_tag = 0;
+        outStm->time_base = inStm->time_base;
+        outStm->avg_frame_rate = inStm->avg_frame_rate;
+        outStm->r_frame_rate = inStm->r_frame_rate;
+        return outStm;
+    }
+
+    // Read the next packet of the selected stream into 'pkt', in the input time base. Return false on eof.
+    bool ReadRawPacket(Input& input, AVPacket* pkt)
+    {
+        while (true)
+        {
+            int fferr = av_read_frame(input.avfmtCtx, pkt);
+            if (fferr < 0)
+            {
+                if (fferr != AVERROR_EOF)
+                    m_logger->Log(WARN) << "'av_read_frame' returns " << fferr << " on '" << input.avfmtCtx->url << "', treat it as eof." << endl;
+                return false;
+            }
+            if (pkt->stream_index == input.stmIdx)
+            {
+                if (!input.isCopyRange)
+                    break;
+                // the range ends at a key frame, packets decoded before it but presented after the range are dropped
+                const int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+                if (pts >= input.copyEndTs && (pkt->flags&AV_PKT_FLAG_KEY) != 0)
+                {
+                    av_packet_unref(pkt);
+                    return false;
+                }
+                if (pts >= input.copyStartTs && pts < input.copyEndTs)
+                    break;
+            }
+            av_packet_unref(pkt);
+        }
+        return true;
+    }
+
+    // Read the first video packet of each segment ahead, its pts-dts is the initial dts delay caused by frame reordering
+    void ReadFirstVideoPackets()
+    {
+        for (auto& input : m_segInputs)
+        {
+            input.firstPkt = av_packet_alloc();
+            if (!ReadRawPacket(input, input.firstPkt))
+            {
+                av_packet_free(&input.firstPkt);
+                continue;
+            }
+            if (input.firstPkt->pts != AV_NOPTS_VALUE && input.firstPkt->dts != AV_NOPTS_VALUE && input.firstPkt->pts > input.firstPkt->dts)
+                input.dtsDelay = input.firstPkt->pts-input.firstPkt->dts;
+        }
+    }
+
+    // Read the next packet of the selected stream into 'pkt', in the output time base. Return false on eof.
+    bool ReadPacket(Input& input, AVPacket* pkt, AVStream* outStm)
+    {
+        if (input.firstPkt)
+        {
+            av_packet_move_ref(pkt, input.firstPkt);
+            av_packet_free(&input.firstPkt);
+        }
+        else if (!ReadRawPacket(input, pkt))
+        {
+            return false;
+        }
+        av_packet_rescale_ts(pkt, input.avfmtCtx->streams[input.stmIdx]->time_base, outStm->time_base);
+        if (pkt->pts != AV_NOPTS_VALUE)
+            pkt->pts += input.tsOffset;
+        if (pkt->dts != AV_NOPTS_VALUE)
+            pkt->dts += input.tsOffset;
+        pkt->stream_index = outStm->index;
+        pkt->pos = -1;
+        return true;
+    }
+
+    bool PrependToPacket(AVPacket* pkt, const vector<uint8_t>& data)
+    {
+        AVPacket* newpkt = av_packet_alloc();
+        if (!newpkt || av_new_packet(newpkt, (int)data.size()+pkt->size) < 0 || av_packet_copy_props(newpkt, pkt) < 0)
+        {
+            av_packet_free(&newpkt);
+            return false;
+        }
+        memcpy(newpkt->data, data.data(), data.size());
+        memcpy(newpkt->data+data.size(), pkt->data, pkt->size);
+        av_packet_unref(pkt);
+        av_packet_move_ref(pkt, newpkt);
+        av_packet_free(&newpkt);
+        return true;
+    }
+
+    // Read the next video packet, moving on to the next segment when the current one is finished
+    bool ReadVideoPacket(AVPacket* pkt)
+    {
+        while (m_currSegIdx < m_segInputs.size())
+        {
+            auto& input = m_segInputs[m_currSegIdx];
+            if (ReadPacket(input, pkt, m_vidOutStm))
+            {
+                if (!input.inbandHeaders.empty())
+                {
+                    if (!PrependToPacket(pkt, input.inbandHeaders))
+                        m_logger->Log(WARN) << "FAILED to put the parameter sets of segment #" << m_currSegIdx << " in-band!" << endl;
+                    input.inbandHeaders.clear();
+                }
+                // all the segments share the largest reorder delay, so the dts of a segment never overlaps the tail
+                // of the previous one. Only dts is moved, pts stays where the segment presents its frames.
+                if (pkt->dts != AV_NOPTS_VALUE)
+                {
+                    pkt->dts -= input.dtsShift;
+                    if (m_lastVidDts != AV_NOPTS_VALUE && pkt->dts <= m_lastVidDts)
+                    {
+                        m_logger->Log(WARN) << "Video dts " << pkt->dts << " of segment #" << m_currSegIdx << " is not larger than the previous dts "
+                                << m_lastVidDts << "!" << endl;
+                        pkt->dts = m_lastVidDts+1;
+                    }
+                    m_lastVidDts = pkt->dts;
+                }
+                return true;
+            }
+            avformat_close_input(&input.avfmtCtx);
+            m_currSegIdx++;
+        }
+        return false;
+    }
+
+    bool Mux_Internal(const string& outputUrl, const vector<Segment>& videoSegments, const string& audioPath)
+    {
+        int fferr;
+        if (!OpenSegmentInputs(videoSegments) || !CheckCodecParameters())
+            return false;
+        ReadFirstVideoPackets();
+        if (!audioPath.empty() && !OpenInput(audioPath, AVMEDIA_TYPE_AUDIO, m_audInput))
+            return false;
+
+        fferr = avformat_alloc_output_context2(&m_outAvfmtCtx, nullptr, nullptr, outputUrl.c_str());
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("avformat_alloc_output_context2", fferr);
+            return false;
+        }
+        if (!m_segInputs.empty())
+        {
+            m_vidOutStm = AddOutputStream(m_segInputs[0]);
+            if (!m_vidOutStm)
+                return false;
+        }
+        if (m_audInput.avfmtCtx)
+        {
+            m_audOutStm = AddOutputStream(m_audInput);
+            if (!m_audOutStm)
+                return false;
+        }
+        if ((m_outAvfmtCtx->oformat->flags&AVFMT_NOFILE) == 0)
+        {
+            fferr = avio_open(&m_outAvfmtCtx->pb, outputUrl.c_str(), AVIO_FLAG_WRITE);
+            if (fferr < 0)
+            {
+                m_errMsg = FFapiFailureMessage("avio_open", fferr);
+                return false;
+            }
+        }
+        fferr = avformat_write_header(m_outAvfmtCtx, nullptr);
+        if (fferr < 0)
+        {
+            m_errMsg = FFapiFailureMessage("avformat_write_header", fferr);
+            return false;
+        }
+        m_headerWritten = true;
+
+        // the output time base is decided by the muxer in 'avformat_write_header()'
+        int64_t totalDuration = 0;
+        for (size_t i = 0; i < m_segInputs.size(); i++)
+        {
+            auto& input = m_segInputs[i];
+            const auto& seg = videoSegments[i];
+            input.tsOffset = av_rescale_q(seg.startTime, MILLISEC_TIMEBASE, m_vidOutStm->time_base);
+            int64_t segDuration = input.avfmtCtx->duration > 0 ? av_rescale_q(input.avfmtCtx->duration, FF_AV_TIMEBASE, MILLISEC_TIMEBASE) : 0;
+            if (input.isCopyRange)
+            {
+                // the copied packets start from the range start in the source
+                input.tsOffset -= av_rescale_q(input.copyStartTs, input.avfmtCtx->streams[input.stmIdx]->time_base, m_vidOutStm->time_base);
+                segDuration = seg.copyEnd >= 0 ? seg.copyEnd-seg.copyStart : segDuration-seg.copyStart;
+            }
+            const int64_t segEnd = seg.startTime+segDuration;
+            if (totalDuration < segEnd)
+                totalDuration = segEnd;
+        }
+        vector<int64_t> dtsDelays(m_segInputs.size());
+        int64_t maxDtsDelay = 0;
+        for (size_t i = 0; i < m_segInputs.size(); i++)
+        {
+            const auto& input = m_segInputs[i];
+            dtsDelays[i] = av_rescale_q(input.dtsDelay, input.avfmtCtx->streams[input.stmIdx]->time_base, m_vidOutStm->time_base);
+            if (maxDtsDelay < dtsDelays[i])
+                maxDtsDelay = dtsDelays[i];
+        }
+        for (size_t i = 0; i < m_segInputs.size(); i++)
+            m_segInputs[i].dtsShift = maxDtsDelay-dtsDelays[i];
+        if (m_audInput.avfmtCtx && m_audInput.avfmtCtx->duration > 0)
+        {
+            const int64_t audDuration = av_rescale_q(m_audInput.avfmtCtx->duration, FF_AV_TIMEBASE, MILLISEC_TIMEBASE);
+            if (totalDuration < audDuration)
+                totalDuration = audDuration;
+        }
+
+        AVPacket* vidpkt = av_packet_alloc();
+        AVPacket* audpkt = av_packet_alloc();
+        bool vidEof = !m_vidOutStm, audEof = !m_audOutStm;
+        bool hasVidpkt = false, hasAudpkt = false;
+        bool success = true;
+        while (!m_cancel)
+        {
+            if (!hasVidpkt && !vidEof)
+            {
+                hasVidpkt = ReadVideoPacket(vidpkt);
+                vidEof = !hasVidpkt;
+            }
+            if (!hasAudpkt && !audEof)
+            {
+                hasAudpkt = ReadPacket(m_audInput, audpkt, m_audOutStm);
+                audEof = !hasAudpkt;
+            }
+            if (!hasVidpkt && !hasAudpkt)
+                break;
+
+            bool writeVideo = hasVidpkt;
+            if (hasVidpkt && hasAudpkt)
+                writeVideo = av_compare_ts(vidpkt->dts, m_vidOutStm->time_base, audpkt->dts, m_audOutStm->time_base) <= 0;
+            AVPacket* pkt = writeVideo ? vidpkt : audpkt;
+            const AVStream* outStm = writeVideo ? m_vidOutStm : m_audOutStm;
+            if (totalDuration > 0 && pkt->dts != AV_NOPTS_VALUE)
+            {
+                const float progress = (float)av_rescale_q(pkt->dts, outStm->time_base, MILLISEC_TIMEBASE)/totalDuration;
+                if (progress > m_progress)
+                    m_progress = progress < 1.f ? progress : 1.f;
+            }
+            fferr = av_interleaved_write_frame(m_outAvfmtCtx, pkt);
+            if (writeVideo)
+                hasVidpkt = false;
+            else
+                hasAudpkt = false;
+            if (fferr < 0)
+            {
+                m_errMsg = FFapiFailureMessage("av_interleaved_write_frame", fferr);
+                success = false;
+                break;
+            }
+        }
+        av_packet_free(&vidpkt);
+        av_packet_free(&audpkt);
+        if (m_cancel && success)
+        {
+            m_errMsg = "Muxing is cancelled.";
+            success = false;
+        }
+        return success;
+    }
+
+    void ReleaseResources()
+    {
+        if (m_outAvfmtCtx)
+        {
+            if (m_headerWritten)
+            {
+                int fferr = av_write_trailer(m_outAvfmtCtx);
+                if (fferr < 0)
+                    m_logger->Log(Error) << FFapiFailureMessage("av_write_trailer", fferr) << endl;
+            }
+            if ((m_outAvfmtCtx->oformat->flags&AVFMT_NOFILE) == 0)
+                avio_closep(&m_outAvfmtCtx->pb);
+            avformat_free_context(m_outAvfmtCtx);
+            m_outAvfmtCtx = nullptr;
+        }
+        m_headerWritten = false;
+        m_vidOutStm = m_audOutStm = nullptr;
+        for (auto& input : m_segInputs)
+        {
+            if (input.firstPkt)
+                av_packet_free(&input.firstPkt);
+            if (input.avfmtCtx)
+                avformat_close_input(&input.avfmtCtx);
+        }
+        m_segInputs.clear();
+        m_currSegIdx = 0;
+        m_lastVidDts = AV_NOPTS_VALUE;
+        if (m_audInput.avfmtCtx)
+            avformat_close_input(&m_audInput.avfmtCtx);
+        m_audInput = Input();
+    }
+
+private:
+    ALogger* m_logger;
+    string m_errMsg;
+    vector<Input> m_segInputs;
+    size_t m_currSegIdx{0};
+    int64_t m_lastVidDts{AV_NOPTS_VALUE};
+    Input m_audInput;
+    AVFormatContext* m_outAvfmtCtx{nullptr};
+    AVStream* m_vidOutStm{nullptr};
+    AVStream* m_audOutStm{nullptr};
+    bool m_headerWritten{false};
+    atomic_bool m_cancel{false};
+    atomic<float> m_progress{0};
+};
+
+static const auto SEGMENT_MUXER_HOLDER_DELETER = [] (SegmentMuxer* p) {
+    SegmentMuxer_Impl* ptr = dynamic_cast<SegmentMuxer_Impl*>(p);
+    delete ptr;
+};
+
+SegmentMuxer::Holder SegmentMuxer::CreateInstance()
+{
+    return SegmentMuxer::Holder(new SegmentMuxer_Impl(), SEGMENT_MUXER_HOLDER_DELETER);
+}
+
+ALogger* SegmentMuxer::GetLogger()
+{
+    return Logger::GetLogger("SegMuxer");
+}
+}
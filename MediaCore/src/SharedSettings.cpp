@@ -52,6 +52,11 @@ class SharedSettings_Impl : public SharedSettings
         return m_isVidsrcKeepOrgSize;
     }
 
+    bool IsVideoSrcUseProxy() const override
+    {
+        return m_isVidsrcUseProxy;
+    }
+
     uint32_t AudioOutChannels() const override
     {
         return m_audOutChannels;
@@ -77,6 +82,11 @@ class SharedSettings_Impl : public SharedSettings
         return m_audOutSmpfmtName;
     }
 
+    string AudioResampleCacheDir() const override
+    {
+        return m_audResmpCacheDir;
+    }
+
     // setters
     void SetVideoOutWidth(uint32_t width) override
     {
@@ -118,6 +128,11 @@ class SharedSettings_Impl : public SharedSettings
         m_isVidsrcKeepOrgSize = enable;
     }
 
+    void SetVideoSrcUseProxy(bool enable) override
+    {
+        m_isVidsrcUseProxy = enable;
+    }
+
     void SetAudioOutSampleRate(uint32_t sampleRate) override
     {
         m_audOutSampleRate = sampleRate;
@@ -139,6 +154,11 @@ class SharedSettings_Impl : public SharedSettings
         m_audOutSmpfmtName = pcSmpfmtName ? string(pcSmpfmtName) : "None";
     }
 
+    void SetAudioResampleCacheDir(const string& dirPath) override
+    {
+        m_audResmpCacheDir = dirPath;
+    }
+
     void SyncVideoSettingsFrom(const SharedSettings* pSettings) override
     {
         SetVideoOutWidth(pSettings->VideoOutWidth());
@@ -154,6 +174,7 @@ class SharedSettings_Impl : public SharedSettings
         SetAudioOutSampleRate(pSettings->AudioOutSampleRate());
         SetAudioOutDataType(pSettings->AudioOutDataType());
         SetAudioOutIsPlanar(pSettings->AudioOutIsPlanar());
+        SetAudioResampleCacheDir(pSettings->AudioResampleCacheDir());
     }
 
     bool SaveAsJson(imgui_json::value& jnSettings) const override
@@ -185,12 +206,14 @@ private:
     ImDataType m_vidOutDataType{IM_DT_FLOAT32};
     HwaccelManager::Holder m_hHwaMgr;
     bool m_isVidsrcKeepOrgSize{ false };
+    bool m_isVidsrcUseProxy{false};
     uint32_t m_audOutChannels{0};
     uint32_t m_audOutSampleRate{0};
     ImDataType m_audOutDataType{IM_DT_FLOAT32};
     bool m_audOutIsPlanar{false};
     AVSampleFormat m_audOutSmpfmt{AV_SAMPLE_FMT_NONE};
     string m_audOutSmpfmtName{"None"};
+    string m_audResmpCacheDir;
 };
 
 const function<void(SharedSettings*)> SharedSettings_Impl::SHARED_SETTINGS_DELETER = [] (SharedSettings* p) {
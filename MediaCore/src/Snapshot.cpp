@@ -21,6 +21,7 @@
 #include <sstream>
 #include <iomanip>
 #include <list>
+#include <map>
 #include <unordered_map>
 #include <atomic>
 #include <memory>
@@ -57,6 +58,12 @@ namespace MediaCore
 {
 namespace Snapshot
 {
+// the snapshot level cache keeps at most this many snapshots in all the levels, or this many times of the cache size of the window
+static const size_t SS_LEVEL_CACHE_MIN_SIZE = 256;
+static const size_t SS_LEVEL_CACHE_SIZE_FACTOR = 4;
+// a snapshot of a finer level can be reused if its offset is within this ratio of the snapshot interval
+static const double SS_FINE_LEVEL_REUSE_RATIO = 0.125;
+
 class Generator_Impl : public Snapshot::Generator
 {
 public:
@@ -149,6 +156,7 @@ public:
         m_vidFrmCnt = 0;
         m_vidMaxIndex = 0;
         m_maxCacheSize = 0;
+        ClearLevelCache();
 
         m_hSeekPoints = nullptr;
         m_prepared = false;
@@ -200,6 +208,57 @@ public:
             }
         }
 
+        // the snapshots decoded at the other zoom levels are the placeholders of the ones not ready yet
+        {
+            lock_guard<mutex> lk(m_ssLvlCacheLock);
+            unordered_map<int64_t, DisplayData::Holder> placeholders;
+            if (m_ssLvlCacheCount > 0)
+            {
+                const int loopCnt = snapshots.size();
+                for (int i = 0; i < loopCnt; i++)
+                {
+                    auto& img = snapshots[i];
+                    if (img.hDispData)
+                        continue;
+                    const int64_t targetPts = (int64_t)(m_ssIntvPts*(idx0+i));
+                    const ImGui::ImMat* pBestMat = nullptr;
+                    int64_t bestPts = 0;
+                    int64_t bestDiff = INT64_MAX;
+                    for (int32_t lvl = 0; lvl < (int32_t)m_ssLvlCache.size(); lvl++)
+                    {
+                        int64_t pts = 0;
+                        auto pMat = FindNearestInLevelCache(lvl, targetPts, pts);
+                        const int64_t diff = abs(pts-targetPts);
+                        if (pMat && diff < CalcLevelIntervalPts(lvl) && diff < bestDiff)
+                        {
+                            pBestMat = pMat;
+                            bestPts = pts;
+                            bestDiff = diff;
+                        }
+                    }
+                    if (!pBestMat)
+                        continue;
+                    auto& hDispData = placeholders[bestPts];
+                    if (!hDispData)
+                    {
+                        auto phIter = m_ssLvlPlaceholders.find(bestPts);
+                        if (phIter != m_ssLvlPlaceholders.end())
+                        {
+                            hDispData = phIter->second;
+                        }
+                        else
+                        {
+                            hDispData = DisplayData::Holder(new DisplayData());
+                            hDispData->mImgMat = *pBestMat;
+                            hDispData->mTimestampMs = (int64_t)(pBestMat->time_stamp*1000);
+                        }
+                    }
+                    img = { i+idx0, CalcSnapshotMts(i+idx0), hDispData };
+                }
+            }
+            m_ssLvlPlaceholders = std::move(placeholders);
+        }
+
         if (!m_isOvssComplete && m_hOverview)
         {
             vector<ImGui::ImMat> ovss;
@@ -495,6 +554,23 @@ public:
         return m_vidFrmCnt;
     }
 
+    bool EnableKeyFrameOnly(bool enable) override
+    {
+        lock_guard<recursive_mutex> lk(m_apiLock);
+        if (IsOpened())
+        {
+            m_errMsg = "Key-frame-only mode can only be changed before 'Open()'!";
+            return false;
+        }
+        m_keyFrameOnly = enable;
+        return true;
+    }
+
+    bool IsKeyFrameOnlyEnabled() const override
+    {
+        return m_keyFrameOnly;
+    }
+
     bool IsHwAccelEnabled() const override
     {
         return m_vidPreferUseHw;
@@ -545,6 +621,8 @@ private:
         if (m_ssIntvMts-m_ssMinIntvMts <= 0.5)
             m_ssIntvMts = m_ssMinIntvMts;
         m_ssIntvPts = m_ssIntvMts*m_pVidstm->timebase.den/(1000.*m_pVidstm->timebase.num); //av_rescale_q(m_ssIntvMts*1000, MICROSEC_TIMEBASE, m_vidStream->time_base);
+        m_ssLevel = m_ssMinIntvMts > 0 ? (int32_t)floor(log2(m_ssIntvMts/m_ssMinIntvMts)) : 0;
+        if (m_ssLevel < 0) m_ssLevel = 0;
         m_vidMaxIndex = (uint32_t)floor(((double)m_vidDurMts-m_vidfrmIntvMts)/m_ssIntvMts);
         m_maxCacheSize = (uint32_t)ceil((floor(m_wndFrmCnt)+2)*m_cacheFactor);
         uint32_t intWndFrmCnt = (uint32_t)floor(m_wndFrmCnt)+2;
@@ -658,6 +736,8 @@ private:
                 {
                     m_viddecCtx = res.decCtx;
                     m_viddecDevType = res.hwDevType;
+                    if (m_keyFrameOnly)
+                        m_viddecCtx->skip_frame = AVDISCARD_NONKEY;
                     if (m_viddecDevType != AV_HWDEVICE_TYPE_NONE)
                         m_viddecOpenOpts.hHwaMgr->IncreaseDecoderInstanceCount(av_hwdevice_get_type_name(m_viddecDevType));
 #if DONOT_CACHE_HWAVFRAME
@@ -792,10 +872,14 @@ private:
                             }
                             const int64_t seekPts0 = currTask->TaskRange().SeekPts().first;
                             m_logger->Log(DEBUG) << "--> Seek to pts=" << seekPts0 << endl;
-                            int fferr = avformat_seek_file(m_avfmtCtx, m_vidStmIdx, INT64_MIN, seekPts0, seekPts0, 0);
+                            int fferr;
+                            if (m_keyFrameOnly)
+                                fferr = av_seek_frame(m_avfmtCtx, m_vidStmIdx, seekPts0, AVSEEK_FLAG_BACKWARD);
+                            else
+                                fferr = avformat_seek_file(m_avfmtCtx, m_vidStmIdx, INT64_MIN, seekPts0, seekPts0, 0);
                             if (fferr < 0)
                             {
-                                m_logger->Log(Error) << "avformat_seek_file() FAILED for seeking to 'currTask->startPts'(" << seekPts0 << ")! fferr = " << fferr << "!" << endl;
+                                m_logger->Log(Error) << (m_keyFrameOnly ? "av_seek_frame()" : "avformat_seek_file()") << " FAILED for seeking to 'currTask->startPts'(" << seekPts0 << ")! fferr = " << fferr << "!" << endl;
                                 break;
                             }
                             demuxEof = false;
@@ -823,6 +907,7 @@ private:
                         {
                             if (fferr == AVERROR_EOF)
                             {
+                                currTask->demuxerComplete = true;
                                 currTask->demuxerEof = true;
                                 demuxEof = true;
                             }
@@ -833,32 +918,50 @@ private:
 
                     if (avpktLoaded)
                     {
-                        if (avpkt.stream_index == m_vidStmIdx)
+                        if (avpkt.stream_index == m_vidStmIdx && m_keyFrameOnly)
+                        {
+                            // only the key frame starting this GOP is decoded, it's used for all the SS in this GOP
+                            if (avpkt.pts >= currTask->TaskRange().SeekPts().second)
+                            {
+                                currTask->demuxerComplete = true;
+                                currTask->demuxerEof = true;
+                            }
+                            if (!currTask->demuxerEof && (avpkt.flags&AV_PKT_FLAG_KEY) != 0)
+                            {
+                                m_logger->Log(VERBOSE) << "--> Queuing key frame packet, pts=" << avpkt.pts << endl;
+                                AVPacket* enqpkt = av_packet_clone(&avpkt);
+                                if (!enqpkt)
+                                {
+                                    m_logger->Log(Error) << "FAILED to invoke [DEMUX]av_packet_clone()!" << endl;
+                                    break;
+                                }
+                                {
+                                    lock_guard<mutex> lk(currTask->avpktQLock);
+                                    currTask->avpktQ.push_back(enqpkt);
+                                }
+                                currTask->demuxerComplete = true;
+                                currTask->demuxerEof = true;
+                            }
+                            av_packet_unref(&avpkt);
+                            avpktLoaded = false;
+                            idleLoop = false;
+                        }
+                        else if (avpkt.stream_index == m_vidStmIdx)
                         {
                             if (avpkt.pts >= currTask->TaskRange().SeekPts().second || avpkt.pts > lastGopSsPts)
                             {
                                 bool canReadMore = avpkt.pts < currTask->TaskRange().SeekPts().second+CvtVidMtsToPts(200);
                                 if (!canReadMore)
+                                {
+                                    currTask->demuxerComplete = true;
                                     currTask->demuxerEof = true;
+                                }
                             }
 
                             if (!currTask->demuxerEof)
                             {
                                 uint32_t bias{0};
-                                int32_t ssIdx = CheckFrameSsBias(avpkt.pts, bias);
-                                // update SS candidates frame
-                                auto candIter = currTask->ssCandidates.find(ssIdx);
-                                if (candIter != currTask->ssCandidates.end())
-                                {
-                                    if (candIter->second.pts == INT64_MIN || candIter->second.bias > bias)
-                                        candIter->second = { avpkt.pts, bias, false };
-                                }
-                                else
-                                {
-                                    m_logger->Log(DEBUG) << ">> Extra SS candidate << SS candidate #" << ssIdx << ": pts=" << avpkt.pts << "(ts="
-                                            << MillisecToString(CvtVidPtsToMts(avpkt.pts)) << "), bias=" << bias << endl;
-                                    currTask->ssCandidates[ssIdx] = { avpkt.pts, bias, false };
-                                }
+                                int32_t ssIdx = UpdateSsCandidate(currTask, avpkt.pts, bias);
                                 if (ssIdx == currTask->m_range.SsIdx().second-1 && bias <= m_vidfrmIntvPtsHalf)
                                     lastGopSsPts = avpkt.pts;
 
@@ -1050,8 +1153,13 @@ private:
                     while (!m_quit)
                     {
                         int32_t ssIdx{-1};
+                        int32_t ssIdxEnd{-1};
                         uint32_t bias{UINT32_MAX};
-                        list<GopDecodeTaskHolder> ssGopTasks = FindFrameSsPosition(avfrm.pts, ssIdx, bias);
+                        list<GopDecodeTaskHolder> ssGopTasks;
+                        if (m_keyFrameOnly)
+                            ssGopTasks = FindKeyFrameGopTasks(avfrm.pts, ssIdx, ssIdxEnd, bias);
+                        if (ssGopTasks.empty())
+                            ssGopTasks = FindFrameSsPosition(avfrm.pts, ssIdx, bias);
                         if (ssGopTasks.empty())
                         {
                             m_logger->Log(VERBOSE) << "Drop video frame pts=" << avfrm.pts << ", ssIdx=" << ssIdx << ". No corresponding GopDecoderTask can be found." << endl;
@@ -1068,7 +1176,7 @@ private:
                                     << ") to _GopDecodeTask: ssIdxPair=[" << t->m_range.SsIdx().first << ", " << t->m_range.SsIdx().second
                                     << "), ptsPair=[" << t->m_range.SeekPts().first << ", " << t->m_range.SeekPts().second << ")." << endl;
                             }
-                            if (!EnqueueSnapshotAVFrame(ssGopTasks, &avfrm, ssIdx, bias))
+                            if (!EnqueueSnapshotAVFrame(ssGopTasks, &avfrm, ssIdx, bias, ssIdxEnd))
                                 m_logger->Log(WARN) << "FAILED to enqueue SS#" << ssIdx << ", pts=" << avfrm.pts << "(ts=" << MillisecToString(CvtVidPtsToMts(avfrm.pts)) << ")." << endl;
                             av_frame_unref(&avfrm);
                             avfrmLoaded = false;
@@ -1181,6 +1289,7 @@ private:
 
                         ss->frm = nullptr;
                         ss->img->mTimestampMs = CalcSnapshotMts(ss->index);
+                        AddToLevelCache(currTask->ssLevel, ss->pts, ss->img->mImgMat);
                         idleLoop = false;
                     }
                     if (!ss->img->mImgMat.empty())
@@ -1416,6 +1525,8 @@ private:
         const auto outClrfmt = m_frmCvt.GetOutColorFormat();
         const auto outDtype = m_frmCvt.GetOutDataType();
         const auto rszInterp = m_frmCvt.GetResizeInterpolateMode();
+        // one image at a time per context, the parallelism comes from the contexts themselves
+        hImgsqReader->SetImageDecodeParallelism(1, 0);
         if (!hImgsqReader->ConfigVideoReader(outW, outH, outClrfmt, outDtype, rszInterp, HwaccelManager::GetDefaultInstance()))
         {
             ostringstream oss; oss << "FAILED to configure image-sequence reader! Error is '" << hImgsqReader->GetError() << "'.";
@@ -1552,7 +1663,7 @@ private:
         };
 
         _GopDecodeTask(Generator_Impl* owner, const Range& range)
-            : m_owner(owner), m_range(range)
+            : m_owner(owner), m_range(range), ssLevel(owner->m_ssLevel)
         {
             int32_t idxBegin = range.SsIdx().first < 0 ? 0 : range.SsIdx().first;
             int32_t idxEnd = range.SsIdx().second > owner->m_vidMaxIndex+1 ? owner->m_vidMaxIndex+1 : range.SsIdx().second;
@@ -1574,6 +1685,7 @@ private:
 
         Generator_Impl* m_owner;
         Range m_range;
+        int32_t ssLevel;
         unordered_map<int32_t, _SnapshotCandidate> ssCandidates;
         bool isEndOfGop{true};
         list<_Picture::Holder> ssAvfrmList;
@@ -1584,6 +1696,7 @@ private:
         mutex avpktQLock;
         bool demuxing{false};
         bool demuxerEof{false};
+        bool demuxerComplete{false};  // all the packets of this GOP have been queued
         bool decoding{false};
         bool redoDecoding{false};
         bool allCandDecoded{false};
@@ -1659,6 +1772,33 @@ private:
         return std::move(tasks);
     }
 
+    // In key-frame-only mode, a key frame is used as the SS of all the indices in the GOP tasks starting from it.
+    list<GopDecodeTaskHolder> FindKeyFrameGopTasks(int64_t pts, int32_t& ssIdx, int32_t& ssIdxEnd, uint32_t& bias)
+    {
+        list<GopDecodeTaskHolder> tasks;
+        {
+            lock_guard<mutex> lk(m_goptskListReadLocks[0]);
+            for (auto& t : m_goptskList)
+            {
+                if (t->cancel || t->TaskRange().SeekPts().first != pts)
+                    continue;
+                const auto& idxPair = t->TaskRange().SsIdx();
+                if (tasks.empty() || idxPair.first < ssIdx)
+                    ssIdx = idxPair.first;
+                if (tasks.empty() || idxPair.second > ssIdxEnd)
+                    ssIdxEnd = idxPair.second;
+                tasks.push_back(t);
+            }
+        }
+        if (!tasks.empty())
+        {
+            if (ssIdx < 0) ssIdx = 0;
+            if (ssIdxEnd > m_vidMaxIndex+1) ssIdxEnd = m_vidMaxIndex+1;
+            bias = (uint32_t)floor(abs(m_ssIntvPts*ssIdx-pts));
+        }
+        return std::move(tasks);
+    }
+
     int32_t CheckFrameSsBias(int64_t pts, uint32_t& bias)
     {
         int32_t index = (int32_t)round((double)pts/m_ssIntvPts);
@@ -1666,6 +1806,163 @@ private:
         return index;
     }
 
+    int32_t UpdateSsCandidate(GopDecodeTaskHolder& hTask, int64_t pts, uint32_t& bias)
+    {
+        int32_t ssIdx = CheckFrameSsBias(pts, bias);
+        auto candIter = hTask->ssCandidates.find(ssIdx);
+        if (candIter != hTask->ssCandidates.end())
+        {
+            // a candidate already filled from the level cache must not be decoded again
+            if (!candIter->second.frmEnqueued && (candIter->second.pts == INT64_MIN || candIter->second.bias > bias))
+                candIter->second = { pts, bias, false };
+        }
+        else
+        {
+            m_logger->Log(DEBUG) << ">> Extra SS candidate << SS candidate #" << ssIdx << ": pts=" << pts << "(ts="
+                    << MillisecToString(CvtVidPtsToMts(pts)) << "), bias=" << bias << endl;
+            hTask->ssCandidates[ssIdx] = { pts, bias, false };
+        }
+        return ssIdx;
+    }
+
+    double CalcLevelIntervalPts(int32_t level) const
+    {
+        return ldexp(m_ssMinIntvMts, level)*m_pVidstm->timebase.den/(1000.*m_pVidstm->timebase.num);
+    }
+
+    // 'm_ssLvlCacheLock' must be held by the caller
+    const ImGui::ImMat* FindNearestInLevelCache(int32_t level, int64_t targetPts, int64_t& pts)
+    {
+        auto& lvlCache = m_ssLvlCache[level];
+        if (lvlCache.empty())
+            return nullptr;
+        auto iter = lvlCache.lower_bound(targetPts);
+        if (iter == lvlCache.end() || (iter != lvlCache.begin() && targetPts-prev(iter)->first < iter->first-targetPts))
+            iter--;
+        pts = iter->first;
+        return &iter->second;
+    }
+
+    void AddToLevelCache(int32_t level, int64_t pts, const ImGui::ImMat& img)
+    {
+        lock_guard<mutex> lk(m_ssLvlCacheLock);
+        if (m_ssLvlCache.size() <= (size_t)level)
+            m_ssLvlCache.resize(level+1);
+        auto res = m_ssLvlCache[level].emplace(pts, img);
+        if (res.second)
+            m_ssLvlCacheCount++;
+        else
+            res.first->second = img;
+        const size_t maxSize = max((size_t)m_maxCacheSize*SS_LEVEL_CACHE_SIZE_FACTOR, SS_LEVEL_CACHE_MIN_SIZE);
+        while (m_ssLvlCacheCount > maxSize)
+        {
+            // evict from the level farthest from the one being added, then the snapshot farthest from the newly added one
+            int32_t evictLevel = level;
+            for (int32_t lvl = 0; lvl < (int32_t)m_ssLvlCache.size(); lvl++)
+            {
+                if (!m_ssLvlCache[lvl].empty() && abs(lvl-level) > abs(evictLevel-level))
+                    evictLevel = lvl;
+            }
+            auto& lvlCache = m_ssLvlCache[evictLevel];
+            auto first = lvlCache.begin();
+            auto last = prev(lvlCache.end());
+            if (pts-first->first > last->first-pts)
+                lvlCache.erase(first);
+            else
+                lvlCache.erase(last);
+            m_ssLvlCacheCount--;
+        }
+    }
+
+    void ClearLevelCache()
+    {
+        lock_guard<mutex> lk(m_ssLvlCacheLock);
+        m_ssLvlCache.clear();
+        m_ssLvlCacheCount = 0;
+        m_ssLvlPlaceholders.clear();
+    }
+
+    // Fill the SS of a new task with the ones decoded before. The same frame from any level, or a close enough frame
+    // from a finer level, is reused without decoding.
+    void PrefillTaskFromLevelCache(GopDecodeTaskHolder& hTask)
+    {
+        const int64_t fineTolerance = max(m_vidfrmIntvPtsHalf, (int64_t)(m_ssIntvPts*SS_FINE_LEVEL_REUSE_RATIO));
+        bool allFilled = true;
+        lock_guard<mutex> lk(m_ssLvlCacheLock);
+        for (auto& elem : hTask->ssCandidates)
+        {
+            const int32_t ssIdx = elem.first;
+            const int64_t targetPts = (int64_t)(m_ssIntvPts*ssIdx);
+            const ImGui::ImMat* pBestMat = nullptr;
+            int64_t bestPts = INT64_MIN;
+            int64_t bestDiff = INT64_MAX;
+            for (int32_t lvl = 0; lvl < (int32_t)m_ssLvlCache.size(); lvl++)
+            {
+                int64_t pts = 0;
+                auto pMat = FindNearestInLevelCache(lvl, targetPts, pts);
+                const int64_t diff = abs(pts-targetPts);
+                const int64_t tolerance = lvl < hTask->ssLevel ? fineTolerance : m_vidfrmIntvPtsHalf;
+                if (pMat && diff <= tolerance && diff < bestDiff)
+                {
+                    pBestMat = pMat;
+                    bestPts = pts;
+                    bestDiff = diff;
+                }
+            }
+            if (!pBestMat)
+            {
+                allFilled = false;
+                continue;
+            }
+            const uint32_t bias = (uint32_t)bestDiff;
+            DisplayData::Holder hDispData(new DisplayData());
+            hDispData->mImgMat = *pBestMat;
+            hDispData->mTimestampMs = CalcSnapshotMts(ssIdx);
+            hTask->ssImgList.push_back(_Picture::Holder(new _Picture(this, ssIdx, hDispData, bestPts, bias)));
+            elem.second = { bestPts, bias, true };
+        }
+        if (allFilled && !hTask->ssCandidates.empty())
+        {
+            m_logger->Log(DEBUG) << "--> All the SS of task [" << hTask->TaskRange().SsIdx().first << ", " << hTask->TaskRange().SsIdx().second
+                    << ") are reused from the level cache." << endl;
+            hTask->allCandDecoded = true;
+            hTask->demuxing = hTask->demuxerEof = true;
+            hTask->decoding = hTask->decoderEof = true;
+        }
+    }
+
+    // The GOP of a task canceled by a zoom change is still valid, reuse its packets instead of demuxing them again.
+    void ReuseDemuxedPackets(GopDecodeTaskHolder& hTask, const list<GopDecodeTaskHolder>& prevTasks)
+    {
+        auto iter = find_if(prevTasks.begin(), prevTasks.end(), [&hTask] (const GopDecodeTaskHolder& t) {
+            return t->demuxerComplete && t->TaskRange().SeekPts() == hTask->TaskRange().SeekPts();
+        });
+        if (iter == prevTasks.end())
+            return;
+        auto& hPrevTask = *iter;
+        lock_guard<mutex> lk(hPrevTask->avpktQLock);
+        for (auto pPktQ : { &hPrevTask->avpktBkupQ, &hPrevTask->avpktQ })
+        {
+            for (AVPacket* avpkt : *pPktQ)
+            {
+                AVPacket* enqpkt = av_packet_clone(avpkt);
+                if (!enqpkt)
+                {
+                    m_logger->Log(Error) << "FAILED to invoke [REUSE]av_packet_clone()!" << endl;
+                    for (AVPacket* p : hTask->avpktQ)
+                        av_packet_free(&p);
+                    hTask->avpktQ.clear();
+                    return;
+                }
+                uint32_t bias;
+                UpdateSsCandidate(hTask, enqpkt->pts, bias);
+                hTask->avpktQ.push_back(enqpkt);
+            }
+        }
+        hTask->demuxing = true;
+        hTask->demuxerComplete = hTask->demuxerEof = true;
+    }
+
     int64_t CalcSnapshotMts(int32_t index)
     {
         if (m_ssIntvPts > 0)
@@ -1746,11 +2043,16 @@ private:
             viewers = m_viewers;
         }
 
+        list<GopDecodeTaskHolder> prevTasks;
         if (m_setSnapWindowSize != m_snapWindowSize || m_setWndFrmCnt != m_wndFrmCnt || m_refreshSnapshots)
         {
+            // the decoded snapshots stay in the level cache and the demuxed GOPs are handed over to the new tasks,
+            // so a zoom change doesn't throw away the work done
             for (auto& task : m_goptskPrepareList)
                 task->cancel = true;
-            m_goptskPrepareList.clear();
+            prevTasks.swap(m_goptskPrepareList);
+            if (m_refreshSnapshots)
+                ClearLevelCache();
 
             m_snapWindowSize = m_setSnapWindowSize;
             m_wndFrmCnt = m_setWndFrmCnt;
@@ -1827,6 +2129,9 @@ private:
         for (auto& range : totalTaskRanges)
         {
             GopDecodeTaskHolder hTask(new _GopDecodeTask(this, range));
+            PrefillTaskFromLevelCache(hTask);
+            if (!hTask->decoderEof)
+                ReuseDemuxedPackets(hTask, prevTasks);
             m_goptskPrepareList.push_back(hTask);
             updated = true;
         }
@@ -2188,7 +2493,7 @@ private:
         return hAvfrm;
     }
 
-    bool EnqueueSnapshotAVFrame(list<GopDecodeTaskHolder> ssGopTasks, AVFrame* avfrm, int32_t ssIdx, uint32_t bias)
+    bool EnqueueSnapshotAVFrame(list<GopDecodeTaskHolder> ssGopTasks, AVFrame* avfrm, int32_t ssIdx, uint32_t bias, int32_t ssIdxEnd = -1)
     {
         if (ssGopTasks.empty())
             return false;
@@ -2213,6 +2518,8 @@ private:
 
         DisplayData::Holder hDispData;
         auto ssIdxNxt = (int32_t)round((double)(frm->pts+m_vidfrmIntvPts)/m_ssIntvPts);
+        if (ssIdxNxt < ssIdxEnd)
+            ssIdxNxt = ssIdxEnd;
         do {
             _Picture::Holder ss;
             if (hDispData)
@@ -2465,6 +2772,7 @@ private:
     AVStream* m_vidStream{nullptr};
     AVCodecContext* m_viddecCtx{nullptr};
     bool m_vidPreferUseHw{true};
+    bool m_keyFrameOnly{false};
     AVHWDeviceType m_viddecDevType{AV_HWDEVICE_TYPE_NONE};
     FFUtils::OpenVideoDecoderOptions m_viddecOpenOpts;
     ConditionalMutex m_hwDecCtxLock;
@@ -2491,6 +2799,14 @@ private:
     int64_t m_vidfrmIntvPtsHalf{0};
     double m_ssIntvMts{0};
     double m_ssIntvPts{0};
+    int32_t m_ssLevel{0};
+    // decoded snapshots of each zoom level, one level per power-of-two multiple of the minimum snapshot interval
+    // only the images are cached, the textures are owned by the snapshots in use
+    vector<map<int64_t, ImGui::ImMat>> m_ssLvlCache;
+    size_t m_ssLvlCacheCount{0};
+    // placeholders taken from the level cache in the last 'GetSnapshots()' call, keep them to reuse their textures
+    unordered_map<int64_t, DisplayData::Holder> m_ssLvlPlaceholders;
+    mutex m_ssLvlCacheLock;
     double m_cacheFactor{10.0};
     Ratio m_ssFrameRate;
     double m_ssMinIntvMts{0};
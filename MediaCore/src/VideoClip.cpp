@@ -30,6 +30,9 @@ using namespace Logger;
 
 namespace MediaCore
 {
+// the image sequence of a clip is read continuously, keep a few more frames decoded ahead of the cache
+static const uint32_t IMGSQ_READAHEAD_FRAMES = 8;
+
 // Utility class 'FailedRead' is a helper class for counting and logging failed read
 struct FailedRead
 {
@@ -99,14 +102,8 @@ public:
         if (vidStm->isImage)
             throw invalid_argument("This video stream is an IMAGE, it should be instantiated with a 'VideoClip_ImageImpl' instance!");
         loggerNameOss.str(""); loggerNameOss << "VRdr-" << fileName.substr(0, 4) << "-" << idstr;
-        if (hParser->IsImageSequence())
-            m_hReader = MediaReader::CreateImageSequenceInstance(loggerNameOss.str());
-        else
-            m_hReader = MediaReader::CreateVideoInstance(loggerNameOss.str());
-        // m_hReader->SetLogLevel(DEBUG);
-        m_hReader->EnableHwAccel(VideoClip::USE_HWACCEL);
-        if (!m_hReader->Open(hParser))
-            throw runtime_error(m_hReader->GetError());
+        m_readerName = loggerNameOss.str();
+        m_hParser = hParser;
         uint32_t readerWidth, readerHeight;
         if (hSettings->IsVideoSrcKeepOriginalSize())
         {
@@ -135,13 +132,15 @@ public:
             interpMode = IM_INTERPOLATE_AREA;
         m_outClrfmt = hSettings->VideoOutColorFormat();
         m_outDtype = hSettings->VideoOutDataType();
-        if (!m_hReader->ConfigVideoReader(readerWidth, readerHeight, m_outClrfmt, m_outDtype, interpMode, hSettings->GetHwaccelManager()))
-            throw runtime_error(m_hReader->GetError());
+        // the reader output size is always derived from the original media, so a proxy is transparent to the filters
+        auto hProxyParser = hSettings->IsVideoSrcUseProxy() ? hParser->GetProxyParser() : nullptr;
+        m_hReader = OpenReader(hProxyParser ? hProxyParser : hParser, readerWidth, readerHeight, interpMode, hSettings->GetHwaccelManager());
+        m_isProxyRead = (bool)hProxyParser;
         const auto frameRate = hSettings->VideoOutFrameRate();
         if (frameRate.num <= 0 || frameRate.den <= 0)
             throw invalid_argument("Invalid argument value for 'frameRate'!");
         m_frameRate = frameRate;
-        m_srcDuration = static_cast<int64_t>(m_hReader->GetVideoStream()->duration*1000);
+        m_srcDuration = static_cast<int64_t>(vidStm->duration*1000);
         if (startOffset < 0)
             throw invalid_argument("Argument 'startOffset' can NOT be NEGATIVE!");
         if (endOffset < 0)
@@ -173,7 +172,7 @@ public:
 
     MediaParser::Holder GetMediaParser() const override
     {
-        return m_hReader->GetMediaParser();
+        return m_hParser;
     }
 
     int64_t Id() const override
@@ -465,7 +464,7 @@ public:
     {
         auto outWidth = hSettings->VideoOutWidth();
         auto outHeight = hSettings->VideoOutHeight();
-        auto vidStm = m_hReader->GetVideoStream();
+        auto vidStm = m_hParser->GetBestVideoStream();
         uint32_t readerWidth, readerHeight;
         if (outWidth*vidStm->height > outHeight*vidStm->width)
         {
@@ -482,7 +481,33 @@ public:
         ImInterpolateMode interpMode = IM_INTERPOLATE_BICUBIC;
         if (readerWidth*readerHeight < vidStm->width*vidStm->height)
             interpMode = IM_INTERPOLATE_AREA;
-        m_hReader->ChangeVideoOutputSize(readerWidth, readerHeight, interpMode);
+        auto hProxyParser = hSettings->IsVideoSrcUseProxy() ? m_hParser->GetProxyParser() : nullptr;
+        if ((bool)hProxyParser != m_isProxyRead)
+        {
+            // switch between the original media and its proxy, the owner re-seeks the clip after updating the settings
+            try
+            {
+                auto hNewReader = OpenReader(hProxyParser ? hProxyParser : m_hParser, readerWidth, readerHeight, interpMode, hSettings->GetHwaccelManager());
+                hNewReader->SetDirection(m_hReader->IsDirectionForward());
+                auto seekPos = m_startOffset;
+                if (seekPos >= m_srcDuration) seekPos = m_srcDuration;
+                if (!hNewReader->SeekTo(seekPos) || !hNewReader->Start(m_hReader->IsSuspended()))
+                    throw runtime_error(hNewReader->GetError());
+                m_hReader->Close();
+                m_hReader = hNewReader;
+                m_isProxyRead = (bool)hProxyParser;
+            }
+            catch (const exception& e)
+            {
+                m_logger->Log(Error) << "FAILED to switch the video reader to " << (hProxyParser ? "proxy" : "original") << " media! Error is '"
+                        << e.what() << "'." << endl;
+                m_hReader->ChangeVideoOutputSize(readerWidth, readerHeight, interpMode);
+            }
+        }
+        else
+        {
+            m_hReader->ChangeVideoOutputSize(readerWidth, readerHeight, interpMode);
+        }
         if (m_hFilter)
             m_hFilter = m_hFilter->Clone(hSettings);
         m_hWarpFilter = m_hWarpFilter->Clone(hSettings);
@@ -493,13 +518,35 @@ public:
         m_logger->SetShowLevels(l);
     }
 
+private:
+    MediaReader::Holder OpenReader(MediaParser::Holder hReadParser, uint32_t width, uint32_t height, ImInterpolateMode interpMode, HwaccelManager::Holder hHwaMgr)
+    {
+        MediaReader::Holder hReader;
+        if (hReadParser->IsImageSequence())
+            hReader = MediaReader::CreateImageSequenceInstance(m_readerName);
+        else
+            hReader = MediaReader::CreateVideoInstance(m_readerName);
+        // hReader->SetLogLevel(DEBUG);
+        hReader->EnableHwAccel(VideoClip::USE_HWACCEL);
+        if (!hReader->Open(hReadParser))
+            throw runtime_error(hReader->GetError());
+        if (hReadParser->IsImageSequence())
+            hReader->SetImageDecodeParallelism(0, IMGSQ_READAHEAD_FRAMES);
+        if (!hReader->ConfigVideoReader(width, height, m_outClrfmt, m_outDtype, interpMode, hHwaMgr))
+            throw runtime_error(hReader->GetError());
+        return hReader;
+    }
+
 private:
     ALogger* m_logger;
     int64_t m_id;
     int64_t m_trackId{-1};
     SharedSettings::Holder m_hSettings;
     MediaInfo::Holder m_hInfo;
+    MediaParser::Holder m_hParser;
     MediaReader::Holder m_hReader;
+    string m_readerName;
+    bool m_isProxyRead{false};
     int64_t m_srcDuration;
     int64_t m_start;
     int64_t m_startOffset;
@@ -532,7 +579,7 @@ VideoClip::Holder VideoClip::CreateVideoInstance(
 VideoClip::Holder VideoClip_VideoImpl::Clone(SharedSettings::Holder hSettings) const
 {
     VideoClip_VideoImpl* newInstance = new VideoClip_VideoImpl(
-        m_id, m_hReader->GetMediaParser(), hSettings, m_start, End(), m_startOffset, m_endOffset, 0, true);
+        m_id, m_hParser, hSettings, m_start, End(), m_startOffset, m_endOffset, 0, true);
     if (m_hFilter) newInstance->SetFilter(m_hFilter->Clone(hSettings));
     newInstance->m_hWarpFilter = m_hWarpFilter->Clone(hSettings);
     newInstance->m_hWarpFilter->ApplyTo(newInstance);
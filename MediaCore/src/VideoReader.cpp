@@ -643,6 +643,11 @@ public:
         return true;
     }
 
+    bool SetImageDecodeParallelism(uint32_t workerCount, uint32_t readaheadFrames) override
+    {
+        throw runtime_error("VideoReader does NOT SUPPORT method SetImageDecodeParallelism()!");
+    }
+
     pair<double, double> GetCacheDuration() const override
     {
         throw runtime_error("VideoReader does NOT SUPPORT method GetCacheDuration()!");
@@ -0,0 +1,152 @@
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include "DebugHelper.h"
+#include "Logger.h"
+#include "MediaParser.h"
+#include "AudioTrack.h"
+#include "MatUtils.h"
+
+using namespace std;
+using namespace Logger;
+using namespace MediaCore;
+
+// This test replaces the global allocation functions, so it is built as its own program rather than as a case of 'UnitTest'.
+// Heap allocation counter for the calling thread. Only allocations made while 't_countAllocs' is set are counted,
+// so the background demuxing/decoding threads of the media reader do not disturb the measurement.
+static thread_local bool t_countAllocs = false;
+static thread_local uint64_t t_allocCount = 0;
+static thread_local uint64_t t_allocBytes = 0;
+static thread_local uint64_t t_largeAllocCount = 0;
+static size_t g_largeAllocSize = SIZE_MAX;
+
+static inline void CountAlloc(size_t size)
+{
+    if (!t_countAllocs)
+        return;
+    t_allocCount++;
+    t_allocBytes += size;
+    if (size >= g_largeAllocSize)
+        t_largeAllocCount++;
+}
+
+void* operator new(size_t size)
+{
+    CountAlloc(size);
+    void* p = malloc(size > 0 ? size : 1);
+    if (!p)
+        throw bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+#if defined(__GLIBC__)
+// ImMat buffers are allocated with posix_memalign(), interpose it to count them as well
+extern "C" void* __libc_memalign(size_t alignment, size_t size);
+extern "C" int posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    CountAlloc(size);
+    void* p = __libc_memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+    *memptr = p;
+    return 0;
+}
+#endif
+
+// write a 16-bit PCM stereo wav file with a 1kHz sine as the synthetic source of the audio clip
+static void WriteSineWaveFile(const string& path, uint32_t sampleRate, uint16_t channels, uint32_t seconds)
+{
+    FILE* fp = fopen(path.c_str(), "wb");
+    if (!fp)
+        throw runtime_error("FAILED to create test file '"+path+"'!");
+    const uint32_t dataSize = sampleRate*seconds*channels*2;
+    auto writeU32 = [fp] (uint32_t v) { uint8_t b[4] = {(uint8_t)v, (uint8_t)(v>>8), (uint8_t)(v>>16), (uint8_t)(v>>24)}; fwrite(b, 1, 4, fp); };
+    auto writeU16 = [fp] (uint16_t v) { uint8_t b[2] = {(uint8_t)v, (uint8_t)(v>>8)}; fwrite(b, 1, 2, fp); };
+    fwrite("RIFF", 1, 4, fp); writeU32(36+dataSize); fwrite("WAVE", 1, 4, fp);
+    fwrite("fmt ", 1, 4, fp); writeU32(16); writeU16(1); writeU16(channels);
+    writeU32(sampleRate); writeU32(sampleRate*channels*2); writeU16(channels*2); writeU16(16);
+    fwrite("data", 1, 4, fp); writeU32(dataSize);
+    for (uint32_t i = 0; i < sampleRate*seconds; i++)
+    {
+        int16_t v = (int16_t)(8192*sin(2.*M_PI*1000.*i/sampleRate));
+        for (uint16_t ch = 0; ch < channels; ch++)
+            writeU16((uint16_t)v);
+    }
+    fclose(fp);
+}
+
+static void Unit_AudioTrackReadAllocCount()
+{
+    AutoSection _as("AudioTrackReadAllocCount");
+    const uint32_t sampleRate = 48000;
+    const string testFilePath = "UnitTest_AudioTrackRead.wav";
+    WriteSineWaveFile(testFilePath, sampleRate, 2, 30);
+    auto hParser = MediaParser::CreateInstance();
+    if (!hParser->Open(testFilePath))
+        throw runtime_error(hParser->GetError());
+
+    auto hSettings = SharedSettings::CreateInstance();
+    hSettings->SetAudioOutChannels(2);
+    hSettings->SetAudioOutSampleRate(sampleRate);
+    hSettings->SetAudioOutDataType(IM_DT_FLOAT32);
+    hSettings->SetAudioOutIsPlanar(true);
+    auto hTrack = AudioTrack::CreateInstance(1, hSettings);
+    hTrack->AddNewClip(1, hParser, 0, 30000, 0, 0);
+    auto pPool = MatUtils::AudioBlockPool::GetDefaultInstance();
+    const uint32_t readSamples = 1024;
+    for (int i = 0; i < 8; i++)
+        hTrack->ReadAudioSamples(readSamples);
+    auto stat0 = pPool->GetStatistics();
+    // any heap allocation as large as one channel of the read buffer is a sample buffer that bypasses the pool
+    g_largeAllocSize = readSamples*sizeof(float);
+    t_allocCount = t_allocBytes = t_largeAllocCount = 0;
+    const int loopCount = 1000;
+    t_countAllocs = true;
+    for (int i = 0; i < loopCount; i++)
+    {
+        auto amat = hTrack->ReadAudioSamples(readSamples);
+        if (amat.w != (int)readSamples)
+        {
+            t_countAllocs = false;
+            throw runtime_error("AudioTrack::ReadAudioSamples() returns WRONG sample count!");
+        }
+    }
+    t_countAllocs = false;
+    auto stat1 = pPool->GetStatistics();
+    Log(INFO) << "AudioTrack read: heapAllocCount " << stat0.heapAllocCount << " -> " << stat1.heapAllocCount
+            << ", reuseCount " << stat0.reuseCount << " -> " << stat1.reuseCount
+            << "; heap allocations per read " << (double)t_allocCount/loopCount << " (" << (double)t_allocBytes/loopCount << " bytes)"
+            << ", large allocations " << t_largeAllocCount << endl;
+    hTrack = nullptr;
+    hParser = nullptr;
+    remove(testFilePath.c_str());
+    if (stat1.heapAllocCount != stat0.heapAllocCount)
+        throw runtime_error("AudioTrack read path allocated audio buffers from heap in steady state!");
+    if (t_largeAllocCount > 0)
+        throw runtime_error("AudioTrack read path allocated sample buffers bypassing the pool in steady state!");
+    if (t_allocCount > 0)
+        throw runtime_error("AudioTrack read path made heap allocations in steady state!");
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        Unit_AudioTrackReadAllocCount();
+    }
+    catch (const exception& e)
+    {
+        Log(Error) << "TestCase 'AudioTrackReadAllocCount' FAILED! " << e.what() << endl;
+        return -1;
+    }
+    return 0;
+}
@@ -1,27 +1,90 @@
+#include <stdexcept>
 #include <string>
 #include <functional>
 #include <unordered_map>
+#include <cmath>
 #include "DebugHelper.h"
 #include "Logger.h"
+#include "MediaReader.h"
+#include "MatUtils.h"
+#include "LoudnessMeter.h"
 
 using namespace std;
 using namespace Logger;
 using namespace MediaCore;
 
-#include "MediaReader.h"
 static void Unit_CreateVideoReaderInstance()
 {
     AutoSection _as("CreateVideoInstance");
     auto hVideoReader = MediaReader::CreateVideoInstance();
 }
 
+static void Unit_AudioBlockPoolAllocCount()
+{
+    AutoSection _as("AudioBlockPoolAllocCount");
+    auto hPool = MatUtils::AudioBlockPool::CreateInstance();
+    const int channels = 2;
+    const int frameSamples = 1024;
+    // warm up the pool with the block sizes used below
+    {
+        ImGui::ImMat amat1, amat2;
+        amat1.create(frameSamples, 1, channels, (size_t)4, hPool.get());
+        amat2.create(frameSamples/3, 1, channels, (size_t)4, hPool.get());
+    }
+    auto stat0 = hPool->GetStatistics();
+    for (int i = 0; i < 1000; i++)
+    {
+        ImGui::ImMat amat1, amat2;
+        amat1.create(frameSamples, 1, channels, (size_t)4, hPool.get());
+        amat2.create(frameSamples/3, 1, channels, (size_t)4, hPool.get());
+        MatUtils::CopyAudioMatSamples(amat1, amat2, 0, 0);
+    }
+    auto stat1 = hPool->GetStatistics();
+    Log(INFO) << "AudioBlockPool: heapAllocCount=" << stat1.heapAllocCount << ", reuseCount=" << stat1.reuseCount
+            << ", inUse=" << stat1.inUseBlockCount << ", free=" << stat1.freeBlockCount << endl;
+    if (stat1.heapAllocCount != stat0.heapAllocCount)
+        throw runtime_error("AudioBlockPool allocated from heap in steady state!");
+    if (stat1.inUseBlockCount != 0)
+        throw runtime_error("AudioBlockPool has leaked blocks!");
+}
+
+static void Unit_LoudnessMeterSine()
+{
+    AutoSection _as("LoudnessMeterSine");
+    // EBU Tech 3341 case 1: stereo 1kHz sine at -23 dBFS must measure -23.0 +/- 0.1 LUFS
+    const uint32_t sampleRate = 48000;
+    const uint32_t frameSamples = 1024;
+    auto hMeter = LoudnessMeter::CreateInstance(2, sampleRate);
+    const double amplitude = pow(10., -23./20.);
+    ImGui::ImMat amat;
+    amat.create_type(frameSamples, 1, 2, IM_DT_FLOAT32);
+    amat.elempack = 2;
+    int64_t pos = 0;
+    while (pos < (int64_t)sampleRate*20)
+    {
+        float* data = (float*)amat.data;
+        for (uint32_t i = 0; i < frameSamples; i++, pos++)
+            data[i*2] = data[i*2+1] = (float)(amplitude*sin(2.*M_PI*1000.*pos/sampleRate));
+        hMeter->ProcessSamples(amat);
+    }
+    auto m = hMeter->GetMeasurement();
+    Log(INFO) << "LoudnessMeter: integrated=" << m.integrated << ", momentary=" << m.momentary << ", short-term=" << m.shortTerm
+            << ", true-peak=" << m.truePeak << endl;
+    if (fabs(m.integrated+23.) > 0.1 || fabs(m.momentary+23.) > 0.1 || fabs(m.shortTerm+23.) > 0.1)
+        throw runtime_error("LoudnessMeter measures WRONG loudness for a -23 dBFS sine!");
+    if (fabs(m.truePeak+23.) > 0.2)
+        throw runtime_error("LoudnessMeter measures WRONG true peak for a -23 dBFS sine!");
+}
+
 struct TestCase
 {
     function<void (void)> testProc;
 };
 
 static unordered_map<string, TestCase> g_TestUnits = {
-    {"CreateVideoReaderInstance", {Unit_CreateVideoReaderInstance}}
+    {"CreateVideoReaderInstance", {Unit_CreateVideoReaderInstance}},
+    {"AudioBlockPoolAllocCount", {Unit_AudioBlockPoolAllocCount}},
+    {"LoudnessMeterSine", {Unit_LoudnessMeterSine}},
 };
 
 int main(int argc, char* argv[])
@@ -51,7 +114,15 @@ int main(int argc, char* argv[])
     {
         auto hPa = PerformanceAnalyzer::GetThreadLocalInstance();
         hPa->Reset();
-        testCaseIter->second.testProc();
+        try
+        {
+            testCaseIter->second.testProc();
+        }
+        catch (const exception& e)
+        {
+            Log(Error) << "TestCase '" << testCaseName << "' FAILED! " << e.what() << endl;
+            return -1;
+        }
         hPa->End();
         hPa->LogAndClearStatistics(INFO);
     }
@@ -410,10 +410,12 @@ struct MediaEditorSettings
     int  MediaBankViewType {0};             // Media bank view type, 0 = Media bank, 1 = embedded browser
 
     bool HardwareCodec {true};              // try HW codec
+    int OverviewParallelism {0};            // concurrent media overview generations, 0 = auto
     bool isCustomVideoFrameSize {false};    // current frame size is custom
     int VideoWidth  {1920};                 // timeline Media Width
     int VideoHeight {1080};                 // timeline Media Height
     float PreviewScale {0.5};               // timeline Media Video Preview scale
+    bool UseProxyMedia {true};              // timeline preview reads the proxy media if generated
     bool isCustomVideoFrameRate {false};    // current frame rate is custom
     MediaCore::Ratio VideoFrameRate {25000, 1000};// timeline frame rate
     bool isCustomPixelAspectRatio {false};  // current pixel aspect ratio is custom
@@ -559,6 +561,7 @@ struct MediaEditorSettings
         VideoHeight = hMediaSettings->VideoOutHeight();
         VideoFrameRate = hMediaSettings->VideoOutFrameRate();
         PreviewScale = tl->mPreviewScale;
+        UseProxyMedia = tl->bUseProxyMedia;
 
         AudioChannels = hMediaSettings->AudioOutChannels();
         AudioSampleRate = hMediaSettings->AudioOutSampleRate();
@@ -1455,6 +1458,8 @@ static void ShowConfigure(MediaEditorSettings & config)
                 {
                     SetPreviewScale(config, preview_scale_index);
                 }
+                ImGui::Checkbox("Use Proxy Media for Preview", &config.UseProxyMedia);
+                ImGui::ShowTooltipOnHover("Preview reads the low resolution proxy of a video if it is generated, export always reads the original.");
                 if (ImGui::Combo("Pixel Aspect Ratio", &pixel_aspect_index, pixel_aspect_items, IM_ARRAYSIZE(pixel_aspect_items)))
                 {
                     SetPixelAspectRatio(config.PixelAspectRatio, pixel_aspect_index);
@@ -1509,6 +1514,8 @@ static void ShowConfigure(MediaEditorSettings & config)
                 ImGui::Combo("Color Space", &config.ColorSpaceIndex, color_getter, (void *)ColorSpace, IM_ARRAYSIZE(ColorSpace));
                 ImGui::Combo("Color Transfer", &config.ColorTransferIndex, color_getter, (void *)ColorTransfer, IM_ARRAYSIZE(ColorTransfer));
                 ImGui::Checkbox("HW codec if available", &config.HardwareCodec); ImGui::SameLine(); ImGui::TextUnformatted("(Restart Application required)");
+                ImGui::SliderInt("Overview Parallelism", &config.OverviewParallelism, 0, 16, config.OverviewParallelism > 0 ? "%d" : "Auto", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::ShowTooltipOnHover("Number of media whose snapshots and waveform are generated at the same time, Auto uses half of the CPU threads.");
                 ImGui::Combo("Video Precision", &config.VideoPrecision, VideoPrecision, IM_ARRAYSIZE(VideoPrecision));
                 ImGui::Separator();
                 ImGui::BulletText(ICON_MEDIA_AUDIO " Audio");
@@ -1711,6 +1718,7 @@ static void NewTimeline()
 
     // set global variables
     MediaCore::VideoClip::USE_HWACCEL = timeline->mHardwareCodec;
+    MediaCore::Overview::SetMaxConcurrentGenerations(g_media_editor_settings.OverviewParallelism);
 }
 
 static void CleanProject()
@@ -1853,6 +1861,7 @@ static void LoadProjectThread(std::string path, bool in_splash)
             item->Initialize();
             if (jnItem.contains("meta_data"))
                 item->mMetaData = jnItem["meta_data"];
+            item->UpdateProxy();
             timeline->media_items.push_back(item);
             g_project_loading_percentage += percentage;
         }
@@ -1967,7 +1976,7 @@ static inline std::string GetAudioChannelName(int channels)
     else return "Channels " + std::to_string(channels);
 }
 
-static bool InsertMedia(const std::string path)
+static bool InsertMedia(const std::string path, MediaCore::MediaParser::Holder hParser = nullptr)
 {
     auto file_suffix = ImGuiHelper::path_filename_suffix(path);
     auto name = ImGuiHelper::path_filename(path);
@@ -1984,6 +1993,8 @@ static bool InsertMedia(const std::string path)
         if (iter == timeline->media_items.end() && type != MEDIA_UNKNOWN)
         {
             MediaItem * item = new MediaItem(name, path, type, timeline);
+            // reuse the parser already opened by the batch prober
+            item->mhParser = hParser;
             item->Initialize();
             timeline->media_items.push_back(item);
             project_need_save = true;
@@ -2448,6 +2459,9 @@ static std::vector<MediaItem *>::iterator InsertMediaIcon(std::vector<MediaItem
         draw_list->AddRect(icon_pos + ImVec2(-1, -1), icon_pos + ImVec2(2, 2) + icon_size, IM_COL32(255, 255, 0, 255), 8, ImDrawFlags_RoundCornersAll);
     ImGui::SetCursorScreenPos(icon_pos);
     ImGui::InvisibleButton((*item)->mPath.c_str(), icon_size);
+    // generate the overviews of the media shown in the bank first
+    if ((*item)->mMediaOverview)
+        (*item)->mMediaOverview->SetPriority(ImGui::IsItemVisible() ? 1 : 0);
     
     if ((*item)->mValid)
     {
@@ -3127,8 +3141,16 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                     {
                         if (timeline)
                         {
+                            // the media files are probed in parallel by the batch prober, and added into the bank once they are ready
+                            std::vector<std::string> probe_urls;
                             for (auto path : import_url)
                             {
+                                auto type = EstimateMediaType(ImGuiHelper::path_filename_suffix(path));
+                                if (timeline->mhMediaBatchProber && type != MEDIA_UNKNOWN && !IS_TEXT(type) && !IS_IMAGESEQ(type))
+                                {
+                                    probe_urls.push_back(path);
+                                    continue;
+                                }
                                 auto ret = InsertMedia(path);
                                 if (!ret)
                                 {
@@ -3142,6 +3164,8 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                                 }
                             }
                             import_url.clear();
+                            if (!probe_urls.empty())
+                                timeline->mhMediaBatchProber->Submit(probe_urls);
                             if (!failed_items.empty())
                             {
                                 ImGui::OpenPopup("Failed loading media", ImGuiPopupFlags_AnyPopup);
@@ -3151,6 +3175,30 @@ static void ShowMediaBankWindow(ImDrawList *_draw_list, float media_icon_size)
                     ImGui::EndDragDropTarget();
                 }
 
+                // fill the bank with the media probed by the batch prober
+                if (timeline && timeline->mhMediaBatchProber)
+                {
+                    bool has_failed = false;
+                    MediaCore::MediaParser::BatchProber::Result probe_result;
+                    while (timeline->mhMediaBatchProber->PopResult(probe_result))
+                    {
+                        auto ret = probe_result.hParser ? InsertMedia(probe_result.url, probe_result.hParser) : false;
+                        if (!ret)
+                        {
+                            auto filename = ImGuiHelper::path_filename(probe_result.url);
+                            failed_items.push_back(filename);
+                            has_failed = true;
+                        }
+                        else
+                        {
+                            pfd::notify("Import File Succeed", probe_result.url, pfd::icon::info);
+                            changed = true;
+                        }
+                    }
+                    if (has_failed)
+                        ImGui::OpenPopup("Failed loading media", ImGuiPopupFlags_AnyPopup);
+                }
+
                 if (multiviewport)
                     ImGui::SetNextWindowViewport(viewport->ID);
                 if (ImGui::BeginPopupModal("Failed loading media", NULL, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoSavedSettings))
@@ -3795,6 +3843,22 @@ static void ShowFilterBankTreeWindow(ImDrawList *_draw_list)
  * Media Output window
  *
  ***************************************************************************************/
+static void MakeEncoderParams(TimeLine::VideoEncoderParams& vidEncParams, TimeLine::AudioEncoderParams& audEncParams)
+{
+    // the encoder settings are saved with the project, a headless export of the project encodes the same way
+    timeline->mVideoEncoder = g_currVidEncDescList[g_media_editor_settings.OutputVideoCodecTypeIndex].codecName;
+    timeline->mVideoBitrate = g_media_editor_settings.OutputVideoBitrate;
+    timeline->mOutputColorSpace = ColorSpace[g_media_editor_settings.OutputColorSpaceIndex].tag;
+    timeline->mOutputColorTransfer = ColorTransfer[g_media_editor_settings.OutputColorTransferIndex].tag;
+    timeline->mAudioEncoder = g_currAudEncDescList[g_media_editor_settings.OutputAudioCodecTypeIndex].codecName;
+    timeline->MakeEncoderParams(vidEncParams, audEncParams);
+    vidEncParams.width = g_media_editor_settings.OutputVideoResolutionWidth;
+    vidEncParams.height = g_media_editor_settings.OutputVideoResolutionHeight;
+    vidEncParams.frameRate = g_media_editor_settings.OutputVideoFrameRate;
+    audEncParams.channels = g_media_editor_settings.OutputAudioChannels;
+    audEncParams.sampleRate = g_media_editor_settings.OutputAudioSampleRate;
+}
+
 static void ShowMediaOutputWindow(ImDrawList *_draw_list)
 {
     ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -3834,11 +3898,15 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
             else
             {
                 ImGui::OpenPopup("Make Media##MakeVideoDlyKey", ImGuiPopupFlags_AnyPopup);
+                if (timeline->bExportAudio && timeline->bNormalizeLoudness)
+                    timeline->StartLoudnessAnalysis(g_media_editor_settings.OutputAudioChannels, g_media_editor_settings.OutputAudioSampleRate);
             }
         }
         if (msgbox_event.Draw() == 1)
         {
             ImGui::OpenPopup("Make Media##MakeVideoDlyKey", ImGuiPopupFlags_AnyPopup);
+            if (timeline->bExportAudio && timeline->bNormalizeLoudness)
+                timeline->StartLoudnessAnalysis(g_media_editor_settings.OutputAudioChannels, g_media_editor_settings.OutputAudioSampleRate);
         }
         ImGui::SetWindowFontScale(1.0);
 
@@ -4236,6 +4304,14 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
             }
             else
                 g_media_editor_settings.OutputVideoBFrames = 0;
+            ImGui::Checkbox("Segmented Parallel Encoding##export_video", &timeline->bSegmentedExport);
+            ImGui::BeginDisabled(!timeline->bSegmentedExport);
+            ImGui::SliderInt("Segments (0: auto)##export_video", &timeline->mExportSegmentCount, 0, 64);
+            ImGui::EndDisabled();
+            ImGui::Checkbox("Smart Render (copy untouched source)##export_video", &timeline->bSmartRender);
+            ImGui::Checkbox("Two-Pass Encoding##export_video", &timeline->bTwoPassExport);
+            ImGui::Checkbox("Resumable (keep finished segments)##export_video", &timeline->bResumableExport);
+            ImGui::ShowTooltipOnHover("A stopped or failed export restarts from the segments which are not finished yet.");
             ImGui::EndDisabled(); // disable if disable video
             ImGui::Separator();
 
@@ -4290,6 +4366,11 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                 SetAudioChannel(g_media_editor_settings.OutputAudioChannels, g_media_editor_settings.OutputAudioChannelsIndex);
             }
             ImGui::EndDisabled(); // disable if param as timline
+            ImGui::Checkbox("Normalize Loudness##export_audio", &timeline->bNormalizeLoudness);
+            ImGui::BeginDisabled(!timeline->bNormalizeLoudness);
+            ImGui::SliderFloat("Target Loudness (LUFS)##export_audio", &timeline->mLoudnessTarget, -36.f, -9.f, "%.1f");
+            ImGui::SliderFloat("True Peak Ceiling (dBTP)##export_audio", &timeline->mTruePeakCeiling, -9.f, 0.f, "%.1f");
+            ImGui::EndDisabled(); // disable if no loudness normalization
             ImGui::EndDisabled(); // disable if no audio
             ImGui::Separator();
         }
@@ -4374,6 +4455,25 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                 ImGui::SameLine();
                 ImGui::Text("%s", ImGuiHelper::MillisecToString(valid_duration, 2).c_str());
             }
+            auto hLoudnessTask = timeline->GetLoudnessTask();
+            if (timeline->bExportAudio && timeline->bNormalizeLoudness && hLoudnessTask)
+            {
+                const auto measurement = hLoudnessTask->GetMeasurement();
+                if (hLoudnessTask->IsDone())
+                    ImGui::Text("Loudness: %.1f LUFS, True Peak: %.1f dBTP, Gain: %+.1f dB", measurement.integrated, measurement.truePeak,
+                            MediaCore::LoudnessMeter::GetNormalizationGain(measurement, timeline->mLoudnessTarget, timeline->mTruePeakCeiling));
+                else if (hLoudnessTask->IsFailed())
+                    ImGui::TextColored({1., 0.5, 0.5, 1.}, "Loudness analysis FAILED! %s", hLoudnessTask->GetError().c_str());
+                else
+                    ImGui::Text("Analyzing loudness... %.1f%%, Short-term: %.1f LUFS", hLoudnessTask->GetProgress()*100.f, measurement.shortTerm);
+            }
+
+            if (timeline->bSmartRender)
+            {
+                std::lock_guard<std::mutex> lk(timeline->mEncodingMutex);
+                if (!timeline->mSmartRenderNote.empty())
+                    ImGui::TextColored({1., 0.75, 0.5, 1.}, "Smart render is NOT used, all the frames are re-encoded! %s", timeline->mSmartRenderNote.c_str());
+            }
 
             const ImVec2 btnPaddingSize { 30, 14 };
             std::string btnText;
@@ -4384,6 +4484,7 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
             if (ImGui::Button(btnText.c_str(), btnTxtSize + btnPaddingSize))
             {
                 timeline->StopEncoding();
+                timeline->StopLoudnessAnalysis();
                 ImGui::ImDestroyTexture(&timeline->mEncodingPreviewTexture);
                 timeline->mEncoder = nullptr;
                 timeline->mEncodingProgress = 0;
@@ -4394,7 +4495,11 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
 
             btnText = timeline->mIsEncoding ? "Stop encoding" : "Start encoding";
             btnTxtSize = ImGui::CalcTextSize(btnText.c_str());
-            if (encoder_stage != 2 && ImGui::Button(btnText.c_str(), btnTxtSize + btnPaddingSize))
+            // the render queue uses the same timeline readers, one export at a time
+            ImGui::BeginDisabled(!timeline->mIsEncoding && timeline->mIsRenderQueueRunning);
+            const bool encodingBtnClicked = encoder_stage != 2 && ImGui::Button(btnText.c_str(), btnTxtSize + btnPaddingSize);
+            ImGui::EndDisabled();
+            if (encodingBtnClicked)
             {
                 if (timeline->mIsEncoding)
                 {
@@ -4405,49 +4510,8 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                 {
                     // config encoders
                     TimeLine::VideoEncoderParams vidEncParams;
-                    vidEncParams.encodeVideo = timeline->bExportVideo;
-                    vidEncParams.codecName = g_currVidEncDescList[g_media_editor_settings.OutputVideoCodecTypeIndex].codecName;
-                    vidEncParams.width = g_media_editor_settings.OutputVideoResolutionWidth;
-                    vidEncParams.height = g_media_editor_settings.OutputVideoResolutionHeight;
-                    vidEncParams.frameRate = g_media_editor_settings.OutputVideoFrameRate;
-                    vidEncParams.bitRate = g_media_editor_settings.OutputVideoBitrate;
-                    auto outColorspaceValue = ColorSpace[g_media_editor_settings.OutputColorSpaceIndex].tag;
-                    switch (outColorspaceValue)
-                    {
-                    case AVCOL_SPC_BT709:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT709)});
-                        break;
-                    case AVCOL_SPC_FCC:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT470M)});
-                        break;
-                    case AVCOL_SPC_BT470BG:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT470BG)});
-                        break;
-                    case AVCOL_SPC_SMPTE170M:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_SMPTE170M)});
-                        break;
-                    case AVCOL_SPC_SMPTE240M:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_SMPTE240M)});
-                        break;
-                    case AVCOL_SPC_BT2020_NCL:
-                    case AVCOL_SPC_BT2020_CL:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT2020)});
-                        break;
-                    default:
-                        vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_UNSPECIFIED)});
-                    }
-                    if (vidEncParams.codecName.compare("prores_videotoolbox") == 0)
-                    {
-                        vidEncParams.extraOpts.push_back({"allow_sw", MediaCore::Value(1)});
-                    }
-                    vidEncParams.extraOpts.push_back({"colorspace", MediaCore::Value((int)outColorspaceValue)});
-                    vidEncParams.extraOpts.push_back({"color_trc", MediaCore::Value((int)(ColorTransfer[g_media_editor_settings.OutputColorTransferIndex].tag))});
                     TimeLine::AudioEncoderParams audEncParams;
-                    audEncParams.encodeAudio = timeline->bExportAudio;
-                    audEncParams.codecName = g_currAudEncDescList[g_media_editor_settings.OutputAudioCodecTypeIndex].codecName;
-                    audEncParams.channels = g_media_editor_settings.OutputAudioChannels;
-                    audEncParams.sampleRate = g_media_editor_settings.OutputAudioSampleRate;
-                    audEncParams.bitRate = 128000;
+                    MakeEncoderParams(vidEncParams, audEncParams);
                     if (timeline->ConfigEncoder(fullpath, vidEncParams, audEncParams, g_encoderConfigErrorMessage))
                     {
                         timeline->StartEncoding();
@@ -4478,6 +4542,70 @@ static void ShowMediaOutputWindow(ImDrawList *_draw_list)
                 ImGui::TextColored({1., 0.5, 0.5, 1.}, "%s", timeline->mEncodeProcErrMsg.c_str());
             }
 
+            // render queue, several outputs rendered from one decoding pass
+            ImGui::Separator();
+            ImGui::TextUnformatted("Render Queue:");
+            ImGui::SameLine();
+            ImGui::BeginDisabled(timeline->mIsEncoding || valid_duration <= 0);
+            if (ImGui::Button("Add current settings##render_queue"))
+            {
+                TimeLine::VideoEncoderParams vidEncParams;
+                TimeLine::AudioEncoderParams audEncParams;
+                MakeEncoderParams(vidEncParams, audEncParams);
+                timeline->AddExportJob(fullpath, vidEncParams, audEncParams, g_encoderConfigErrorMessage);
+            }
+            ImGui::EndDisabled();
+            ImGui::SameLine();
+            const bool renderQueueRunning = timeline->mIsRenderQueueRunning;
+            ImGui::BeginDisabled(timeline->mIsEncoding || timeline->mRenderQueue.empty());
+            if (ImGui::Button(renderQueueRunning ? "Stop queue##render_queue" : "Start queue##render_queue"))
+            {
+                if (renderQueueRunning)
+                    timeline->StopRenderQueue();
+                else
+                    timeline->StartRenderQueue();
+            }
+            ImGui::EndDisabled();
+            ImGui::BeginDisabled(renderQueueRunning);
+            ImGui::SetNextItemWidth(120);
+            ImGui::SliderInt("CPU cores (0: all)##render_queue", &timeline->mRenderQueueCpuBudget, 0, (int)std::thread::hardware_concurrency());
+            ImGui::SameLine();
+            ImGui::SetNextItemWidth(120);
+            ImGui::SliderInt("Memory (MB)##render_queue", &timeline->mRenderQueueMemBudgetMB, 512, 32768);
+            ImGui::EndDisabled();
+            static const char* jobStateNames[] = { "Pending", "Rendering", "Done", "Failed", "Cancelled" };
+            std::list<TimeLine::ExportJob::Holder> renderQueue;
+            {
+                std::lock_guard<std::mutex> lk(timeline->mRenderQueueLock);
+                renderQueue = timeline->mRenderQueue;
+            }
+            int jobIdx = 0;
+            for (auto& hJob : renderQueue)
+            {
+                ImGui::PushID(jobIdx++);
+                const int jobState = hJob->state;
+                ImGui::ProgressBar("##job_progress", hJob->progress, 0.f, 1.f, "%1.1f%%", ImVec2(160, 16),
+                                    ImVec4(1.f, 1.f, 1.f, 1.f), ImVec4(0.f, 0.f, 0.f, 1.f), ImVec4(1.f, 1.f, 1.f, 1.f));
+                ImGui::SameLine();
+                ImGui::Text("[%s] %s", jobStateNames[jobState], ImGuiHelper::path_filename(hJob->outputPath).c_str());
+                if (jobState == TimeLine::ExportJob::FAILED)
+                {
+                    std::string errMsg;
+                    {
+                        std::lock_guard<std::mutex> lk(timeline->mRenderQueueLock);
+                        errMsg = hJob->errMsg;
+                    }
+                    ImGui::SameLine();
+                    ImGui::TextColored({1., 0.5, 0.5, 1.}, "%s", errMsg.c_str());
+                }
+                ImGui::SameLine();
+                ImGui::BeginDisabled(jobState == TimeLine::ExportJob::RUNNING);
+                if (ImGui::Button(ICON_DELETE "##remove_job"))
+                    timeline->RemoveExportJob(hJob);
+                ImGui::EndDisabled();
+                ImGui::PopID();
+            }
+
             if (!timeline->mIsEncoding && encoder_start > 0)
             {
                 encoder_end = encoder_start = -1;
@@ -8238,10 +8366,8 @@ static void ShowAudioMixingWindow(ImDrawList *draw_list, ImRect title_rect)
         auto str_offset = str_size.x < 48 ? (48 - str_size.x) / 2 : 0;
         ImGui::SetCursorScreenPos(current_pos + ImVec2(sub_window_size.x - 76 + str_offset, 0));
         ImGui::TextColored({ 0.9, 0.3, 0.3, 1.0 }, "Master");
-        timeline->mAudioAttribute.audio_mutex.lock();
         int l_level = timeline->GetAudioLevel(0);
         int r_level = timeline->GetAudioLevel(1);
-        timeline->mAudioAttribute.audio_mutex.unlock();
         auto AudioMeterPos = current_pos + ImVec2(sub_window_size.x - 30, 16);
         ImGui::SetCursorScreenPos(current_pos + ImVec2(sub_window_size.x - 60, 16));
         ImGui::UvMeter("##luv", ImVec2(meter_size.x / 2, meter_size.y), &l_level, 0, 96, meter_size.y / 4, &timeline->mAudioAttribute.left_stack, &timeline->mAudioAttribute.left_count, 0.2, audio_bar_seg);
@@ -8280,10 +8406,8 @@ static void ShowAudioMixingWindow(ImDrawList *draw_list, ImRect title_rect)
                 ImGui::SetCursorScreenPos(current_pos + ImVec2(count * 48 + 12, 16));
                 auto channel_meter_pos = current_pos + ImVec2(count * 48 + 12, 16);
                 ImGui::SetCursorScreenPos(channel_meter_pos);
-                track->mAudioTrackAttribute.audio_mutex.lock();
                 int tl_level = track->GetAudioLevel(0);
                 int tr_level = track->GetAudioLevel(1);
-                track->mAudioTrackAttribute.audio_mutex.unlock();
                 ImGui::UvMeter("##tluv", ImVec2(meter_size.x / 2, meter_size.y), &tl_level, 0, 96, meter_size.y / 4, &track->mAudioTrackAttribute.left_stack, &track->mAudioTrackAttribute.left_count, 0.2, audio_bar_seg);
                 ImGui::SetCursorScreenPos(channel_meter_pos + ImVec2(14, 0));
                 ImGui::UvMeter("##truv", ImVec2(meter_size.x / 2, meter_size.y), &tr_level, 0, 96, meter_size.y / 4, &track->mAudioTrackAttribute.right_stack, &track->mAudioTrackAttribute.right_count, 0.2, audio_bar_seg);
@@ -10551,7 +10675,6 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
         case 4:
         {
             // wave view
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##audio_wave_view", size);
             if (ImGui::IsItemHovered())
@@ -10636,14 +10759,12 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             if (wave_texture) draw_list->AddImage(wave_texture, pos, pos + size, ImVec2(0, 0), ImVec2(1, 1));
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         case 5:
         {
             char mark[32] = {0};
             // audio vector
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##audio_vector_view", size);
             if (ImGui::IsItemHovered())
@@ -10731,13 +10852,11 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             ImGui::SetWindowFontScale(1.0);
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         case 6:
         {
             // fft view
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##audio_fft_view", size);
             if (ImGui::IsItemHovered())
@@ -10814,13 +10933,11 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             if (fft_texture) draw_list->AddImage(fft_texture, pos, pos + size, ImVec2(0, 0), ImVec2(1, 1));
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         case 7:
         {
             // db view
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##audio_db_view", size);
             if (ImGui::IsItemHovered())
@@ -10899,13 +11016,11 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             if (db_texture) draw_list->AddImage(db_texture, pos, pos + size, ImVec2(0, 0), ImVec2(1, 1));
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         case 8:
         {
             // db level view
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             draw_list->AddRect(scrop_rect.Min, scrop_rect.Max, COL_SLIDER_HANDLE, 8);
             draw_list->PushClipRect(scrop_rect.Min, scrop_rect.Max);
@@ -10929,13 +11044,11 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             ImGui::PopStyleColor(2);
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         case 9:
         {
             // spectrogram view
-            timeline->mAudioAttribute.audio_mutex.lock();
             ImGui::BeginGroup();
             ImGui::InvisibleButton("##audio_spectrogram_view", size);
             if (ImGui::IsItemHovered())
@@ -11059,7 +11172,6 @@ static void ShowMediaScopeView(int index, ImVec2 pos, ImVec2 size)
             ImGui::PopStyleVar();
             draw_list->PopClipRect();
             ImGui::EndGroup();
-            timeline->mAudioAttribute.audio_mutex.unlock();
         }
         break;
         default: break;
@@ -11350,6 +11462,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         else if (sscanf(line, "ControlPanelWidth=%f", &val_float) == 1) { setting->ControlPanelWidth = val_float; }
         else if (sscanf(line, "MainViewWidth=%f", &val_float) == 1) { setting->MainViewWidth = val_float; }
         else if (sscanf(line, "HWCodec=%d", &val_int) == 1) { setting->HardwareCodec = val_int == 1; }
+        else if (sscanf(line, "OverviewParallelism=%d", &val_int) == 1) { setting->OverviewParallelism = val_int; }
         else if (sscanf(line, "CustomVideoFrameSize=%d", &val_int) == 1) { setting->isCustomVideoFrameSize = val_int == 1; }
         else if (sscanf(line, "VideoWidth=%d", &val_int) == 1) { setting->VideoWidth = val_int; }
         else if (sscanf(line, "VideoHeight=%d", &val_int) == 1) { setting->VideoHeight = val_int; }
@@ -11483,6 +11596,7 @@ static void MediaEditor_SetupContext(ImGuiContext* ctx, void* handle, bool in_sp
         out_buf->appendf("ControlPanelWidth=%f\n", g_media_editor_settings.ControlPanelWidth);
         out_buf->appendf("MainViewWidth=%f\n", g_media_editor_settings.MainViewWidth);
         out_buf->appendf("HWCodec=%d\n", g_media_editor_settings.HardwareCodec ? 1 : 0);
+        out_buf->appendf("OverviewParallelism=%d\n", g_media_editor_settings.OverviewParallelism);
         out_buf->appendf("CustomVideoFrameSize=%d\n", g_media_editor_settings.isCustomVideoFrameSize ? 1 : 0);
         out_buf->appendf("VideoWidth=%d\n", g_media_editor_settings.VideoWidth);
         out_buf->appendf("VideoHeight=%d\n", g_media_editor_settings.VideoHeight);
@@ -11885,6 +11999,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
     {
         ImGui::UpdateData();
     }
+    if (timeline) timeline->UpdateAudioScopeData();
     ImGui::Begin("Main Editor", nullptr, flags);
 #ifdef DEBUG_IMGUI
     if (show_debug) ImGui::ShowMetricsWindow(&show_debug);
@@ -11985,6 +12100,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
                     MediaCore::VideoClip::USE_HWACCEL = g_media_editor_settings.HardwareCodec;
                     needReloadProject = true;
                 }
+                MediaCore::Overview::SetMaxConcurrentGenerations(g_media_editor_settings.OverviewParallelism);
                 timeline->mMaxCachedVideoFrame = g_media_editor_settings.VideoFrameCacheSize > 0 ? g_media_editor_settings.VideoFrameCacheSize : MAX_VIDEO_CACHE_FRAMES;
                 timeline->mShowHelpTooltips = g_media_editor_settings.ShowHelpTooltips;
                 timeline->mFontName = g_media_editor_settings.FontName;
@@ -12009,6 +12125,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
                 {
                     timeline->mhMediaSettings->SyncVideoSettingsFrom(hNewSettings.get());
                     timeline->mPreviewScale = g_media_editor_settings.PreviewScale;
+                    timeline->bUseProxyMedia = g_media_editor_settings.UseProxyMedia;
                     timeline->mhMediaSettings->SyncAudioSettingsFrom(hNewSettings.get());
                     timeline->mAudioRenderFormat = pcmFormat;
                 }
@@ -12016,6 +12133,7 @@ static bool MediaEditor_Frame(void * handle, bool app_will_quit)
                 {
                     timeline->UpdateVideoSettings(hNewSettings, g_media_editor_settings.PreviewScale);
                     timeline->UpdateAudioSettings(hNewSettings, pcmFormat);
+                    timeline->SetUseProxyMedia(g_media_editor_settings.UseProxyMedia);
                 }
             }
             ImGui::CloseCurrentPopup(); 
@@ -23,16 +23,22 @@
 #include <implot.h>
 #include <cmath>
 #include <sstream>
+#include <fstream>
 #include <iomanip>
 #include <vector>
 #include <utility>
 #include <ThreadUtils.h>
+#include <MathUtils.h>
 #include <MatUtilsImVecHelper.h>
 #include "EventStackFilter.h"
 #include "TextureManager.h"
 #include "MatUtils.h"
 #include "Logger.h"
 #include "DebugHelper.h"
+extern "C"
+{
+    #include "libavutil/pixfmt.h"
+}
 
 const MediaTimeline::audio_band_config DEFAULT_BAND_CFG[10] = {
     { 32,       32,         0 },        { 64,       64,         0 },
@@ -131,6 +137,58 @@ static bool waveFrameResample(float * wave, int samples, int size, int start_off
     return min_max;
 }
 
+// Same as 'waveFrameResample()' but read the waveform pyramid level matching the pixel width, so the cost only
+// depends on the pixel count. Return false if the zoom is too fine for the pyramid and 'pcm' should be used.
+static bool waveFramePyramidResample(const MediaCore::Overview::Waveform::Holder& waveform, int channel, int start_offset, int samples, int size, ImGui::ImMat& plot_frame_max, ImGui::ImMat& plot_frame_min)
+{
+    const double pixel_duration = samples * waveform->aggregateDuration;
+    if (pixel_duration <= 0)
+        return false;
+    int level_index = waveform->SelectLevel(1.0 / pixel_duration);
+    if (level_index < 0)
+        return false;
+    auto& level = waveform->levels[level_index];
+    if (channel >= level.maxPcm.size())
+        return false;
+    const float * level_max = level.maxPcm[channel].data();
+    const float * level_min = level.minPcm[channel].data();
+    const int64_t valid_count = level.validSampleCount;
+    const double start_time = start_offset * waveform->aggregateDuration;
+    plot_frame_max.create_type(size, 1, 1, IM_DT_FLOAT32);
+    plot_frame_min.create_type(size, 1, 1, IM_DT_FLOAT32);
+    float * out_channel_data_max = (float *)plot_frame_max.data;
+    float * out_channel_data_min = (float *)plot_frame_min.data;
+    for (int i = 0; i < size; i++)
+    {
+        int64_t first = (int64_t)((start_time + i * pixel_duration) / level.aggregateDuration);
+        int64_t last = (int64_t)((start_time + (i + 1) * pixel_duration) / level.aggregateDuration);
+        if (last <= first) last = first + 1;
+        if (last > valid_count) last = valid_count;
+        float max_val = -FLT_MAX;
+        float min_val = FLT_MAX;
+        for (int64_t n = first; n < last; n++)
+        {
+            if (max_val < level_max[n]) max_val = level_max[n];
+            if (min_val > level_min[n]) min_val = level_min[n];
+        }
+        if (first >= last)
+        {
+            max_val = min_val = 0;
+        }
+        else if (max_val < 0 && min_val < 0)
+        {
+            max_val = min_val;
+        }
+        else if (max_val > 0 && min_val > 0)
+        {
+            min_val = max_val;
+        }
+        out_channel_data_max[i] = ImMin(max_val, 1.f);
+        out_channel_data_min[i] = ImMax(min_val, -1.f);
+    }
+    return true;
+}
+
 static void waveformToMat(const MediaCore::Overview::Waveform::Holder wavefrom, ImGui::ImMat& mat, ImVec2 wave_size)
 {
     int channels = wavefrom->pcm.size();
@@ -229,6 +287,7 @@ bool MediaItem::Initialize()
         if (!mhParser)
         {
             mhParser = MediaCore::MediaParser::CreateInstance();
+            mhParser->SetAnalysisCache(timeline->mhMediaAnalysisCache);
             if (IS_IMAGESEQ(mMediaType))
                 mhParser->OpenImageSequence({25000, 1000}, mPath, ".+[_\\-]([[:digit:]]{1,})\\.(png|jpg|tiff|webp|jpeg|bmp)", false, true);
             else
@@ -237,8 +296,17 @@ bool MediaItem::Initialize()
                 return false;
         }
 
+        // the headless timeline doesn't show any snapshot or waveform
+        if (timeline->mHeadless)
+        {
+            mSrcLength = mhParser->GetMediaInfo()->duration * 1000;
+            mValid = true;
+            return true;
+        }
         mMediaOverview = MediaCore::Overview::CreateInstance();
         mMediaOverview->EnableHwAccel(timeline->mHardwareCodec);
+        // bank thumbnails only need the nearest key frames
+        mMediaOverview->EnableKeyFrameOnly(true);
         RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
         if (mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
             mMediaOverview->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
@@ -285,6 +353,37 @@ void MediaItem::UpdateThumbnail()
         }
     }
 }
+
+bool MediaItem::UpdateProxy()
+{
+    if (!mhParser || !IS_VIDEO(mMediaType) || IS_IMAGE(mMediaType))
+        return false;
+    auto hProxyParser = mhParser->GetProxyParser();
+    imgui_json::value jnProxy;
+    if (!FindMetaData("ProxyMedia", jnProxy) || !jnProxy.contains("proxy_url") || !jnProxy["proxy_url"].is_string())
+    {
+        if (!hProxyParser)
+            return false;
+        mhParser->SetProxyParser(nullptr);
+        return true;
+    }
+    const auto strProxyUrl = jnProxy["proxy_url"].get<imgui_json::string>();
+    if (hProxyParser && hProxyParser->GetUrl() == strProxyUrl)
+        return false;
+    if (!SysUtils::IsFile(strProxyUrl))
+    {
+        Logger::Log(Logger::WARN) << "Proxy media '" << strProxyUrl << "' of '" << mPath << "' does NOT exist!" << std::endl;
+        return false;
+    }
+    hProxyParser = MediaCore::MediaParser::CreateInstance();
+    if (!hProxyParser->Open(strProxyUrl) || !hProxyParser->HasVideo())
+    {
+        Logger::Log(Logger::WARN) << "FAILED to open proxy media '" << strProxyUrl << "' of '" << mPath << "'! Error is '" << hProxyParser->GetError() << "'." << std::endl;
+        return false;
+    }
+    mhParser->SetProxyParser(hProxyParser);
+    return true;
+}
 } //namespace MediaTimeline
 
 namespace MediaTimeline
@@ -2049,10 +2148,10 @@ bool VideoClip::UpdateClip(MediaItem* pMediaItem)
             return false;
         }
         TimeLine* pOwner = (TimeLine*)mHandle;
-        auto hSsGen = pOwner->GetSnapshotGenerator(pMediaItem->mID);
+        auto hSsGen = pOwner->mHeadless ? nullptr : pOwner->GetSnapshotGenerator(pMediaItem->mID);
         if (hSsGen)
             hSsViewer = hSsGen->CreateViewer();
-        else
+        else if (!pOwner->mHeadless)
         {
             Logger::Log(Logger::WARN) << "FAILED to retrieve 'Snapshot::Generator' for 'VideoClip' built on '" << mPath << "'! Then no 'Snapshot::Viewer' is available." << std::endl;
             return false;
@@ -2463,7 +2562,7 @@ bool AudioClip::UpdateClip(MediaItem* pMediaItem)
     mMediaParser = pMediaItem->mhParser;
     mhOverview = pMediaItem->mMediaOverview;
     mPath = mMediaParser->GetUrl();
-    mWaveform = mhOverview->GetWaveform();
+    mWaveform = mhOverview ? mhOverview->GetWaveform() : nullptr;
     mAudioChannels = pAudstm->channels;
     mAudioChannels = pAudstm->sampleRate;
     return true;
@@ -2620,7 +2719,9 @@ void AudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const I
                 ImGui::ImMat plot_mat;
                 start_offset = start_offset / sample_stride * sample_stride; // align start_offset
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                auto filled = waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                bool filled = true;
+                if (!waveFramePyramidResample(mWaveform, 0, start_offset, sample_stride, draw_size.x, plot_frame_max, plot_frame_min))
+                    filled = waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
                 ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.4f, 0.4f, 1.0f, 1.0f));
                 ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.3f, 0.3f, 0.8f, 0.5f));
                 if (filled)
@@ -2648,7 +2749,8 @@ void AudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop, const I
                 std::string plot_max_id = id_string + "_line_max";
                 std::string plot_min_id = id_string + "_line_min";
                 ImGui::ImMat plot_frame_max, plot_frame_min;
-                waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+                if (!waveFramePyramidResample(mWaveform, 0, start_offset, sample_stride, draw_size.x, plot_frame_max, plot_frame_min))
+                    waveFrameResample(&mWaveform->pcm[0][0], sample_stride, draw_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
                 ImGui::SetCursorScreenPos(customViewStart);
                 ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, draw_size, sizeof(float), false, true);
                 ImGui::SetCursorScreenPos(customViewStart);
@@ -3272,33 +3374,12 @@ EditingVideoClip::EditingVideoClip(VideoClip* vidclip)
     }
     else
     {
-        mSsGen = MediaCore::Snapshot::Generator::CreateInstance();
-        MediaItem* mi = timeline->FindMediaItemByID(vidclip->mMediaID);
-        if (mi && mi->mMediaOverview)
-            mSsGen->SetOverview(mi->mMediaOverview);
+        mSsGen = timeline->GetEditingSnapshotGenerator(vidclip->mMediaID, vidclip->mhSsViewer->GetMediaParser());
         if (!mSsGen)
         {
             Logger::Log(Logger::Error) << "Create Editing Video Clip FAILED!" << std::endl;
             return;
         }
-        if (timeline) mSsGen->EnableHwAccel(timeline->mHardwareCodec);
-        if (!mSsGen->Open(vidclip->mhSsViewer->GetMediaParser(), timeline->mhMediaSettings->VideoOutFrameRate()))
-        {
-            Logger::Log(Logger::Error) << mSsGen->GetError() << std::endl;
-            return;
-        }
-
-        mSsGen->SetCacheFactor(1);
-        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-        if (timeline->mTxMgr->GetTexturePoolAttributes(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
-        {
-            mSsGen->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
-        }
-        else
-        {
-            float snapshot_scale = mHeight > 0 ? 50.f / (float)mHeight : 0.05;
-            mSsGen->SetSnapshotResizeFactor(snapshot_scale, snapshot_scale);
-        }
         mSsViewer = mSsGen->CreateViewer((double)mStartOffset / 1000);
     }
 
@@ -3602,7 +3683,9 @@ void EditingVideoClip::CalcDisplayParams(int64_t viewWndDur)
     {
         double snapWndSize = (double)viewWndDur / 1000;
         double snapCntInView = (double)mViewWndSize.x / mSnapSize.x;
-        mSsGen->ConfigSnapWindow(snapWndSize, snapCntInView);
+        TimeLine* timeline = (TimeLine*)mHandle;
+        if (timeline && mSsGen)
+            timeline->ConfigEditingSnapWindow(mMediaID, mSsGen, mSsViewer, snapWndSize, snapCntInView);
     }
 }
 
@@ -3756,7 +3839,9 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
             ImGui::ImMat plot_mat;
             start_offset = start_offset / sample_stride * sample_stride; // align start_offset
             ImGui::ImMat plot_frame_max, plot_frame_min;
-            auto filled = waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+            bool filled = true;
+            if (!waveFramePyramidResample(mWaveform, i, start_offset, sample_stride, window_size.x, plot_frame_max, plot_frame_min))
+                filled = waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
             ImGui::PushStyleColor(ImGuiCol_PlotLines, ImVec4(0.4f, 0.8f, 0.4f, 1.0f));
             ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.3f, 0.8f, 0.3f, 0.5f));
             if (filled)
@@ -3787,7 +3872,8 @@ void EditingAudioClip::DrawContent(ImDrawList* drawList, const ImVec2& leftTop,
             std::string plot_max_id = id_string + "_line_max";
             std::string plot_min_id = id_string + "_line_min";
             ImGui::ImMat plot_frame_max, plot_frame_min;
-            waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
+            if (!waveFramePyramidResample(mWaveform, i, start_offset, sample_stride, window_size.x, plot_frame_max, plot_frame_min))
+                waveFrameResample(&mWaveform->pcm[i][0], sample_stride, window_size.x, start_offset, sampleSize, zoom, plot_frame_max, plot_frame_min);
             ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * window_size.y));
             ImGui::PlotLinesEx(plot_max_id.c_str(), (float *)plot_frame_max.data, plot_frame_max.w, 0, nullptr, -wave_range, wave_range, window_size, sizeof(float), false, true);
             ImGui::SetCursorScreenPos(leftTop + ImVec2(0, i * window_size.y));
@@ -4088,25 +4174,9 @@ EditingVideoOverlap::EditingVideoOverlap(int64_t id, void* handle)
         }
         else
         {
-            mSsGen1 = MediaCore::Snapshot::Generator::CreateInstance();
-            MediaItem* mi = timeline->FindMediaItemByID(vidclip1->mMediaID);
-            if (mi && mi->mMediaOverview)
-                mSsGen1->SetOverview(mi->mMediaOverview);
-            if (timeline) mSsGen1->EnableHwAccel(timeline->mHardwareCodec);
-            if (!mSsGen1->Open(vidclip1->mhSsViewer->GetMediaParser(), timeline->mhMediaSettings->VideoOutFrameRate()))
+            mSsGen1 = timeline->GetEditingSnapshotGenerator(vidclip1->mMediaID, vidclip1->mhSsViewer->GetMediaParser());
+            if (!mSsGen1)
                 throw std::runtime_error("FAILED to open the snapshot generator for the 1st video clip!");
-            mSsGen1->SetCacheFactor(1.0);
-            RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-            if (timeline->mTxMgr->GetTexturePoolAttributes(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
-            {
-                mSsGen1->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
-            }
-            else
-            {
-                auto video1_info = vidclip1->mhSsViewer->GetMediaParser()->GetBestVideoStream();
-                float snapshot_scale1 = video1_info->height > 0 ? 50.f / (float)video1_info->height : 0.05;
-                mSsGen1->SetSnapshotResizeFactor(snapshot_scale1, snapshot_scale1);
-            }
             m_StartOffset.first = vidclip1->StartOffset() + ovlp->mStart - vidclip1->Start();
             mViewer1 = mSsGen1->CreateViewer(m_StartOffset.first);
         }
@@ -4118,25 +4188,9 @@ EditingVideoOverlap::EditingVideoOverlap(int64_t id, void* handle)
         }
         else
         {
-            mSsGen2 = MediaCore::Snapshot::Generator::CreateInstance();
-            MediaItem* mi = timeline->FindMediaItemByID(vidclip2->mMediaID);
-            if (mi && mi->mMediaOverview)
-                mSsGen2->SetOverview(mi->mMediaOverview);
-            if (timeline) mSsGen2->EnableHwAccel(timeline->mHardwareCodec);
-            if (!mSsGen2->Open(vidclip2->mhSsViewer->GetMediaParser(), timeline->mhMediaSettings->VideoOutFrameRate()))
+            mSsGen2 = timeline->GetEditingSnapshotGenerator(vidclip2->mMediaID, vidclip2->mhSsViewer->GetMediaParser());
+            if (!mSsGen2)
                 throw std::runtime_error("FAILED to open the snapshot generator for the 2nd video clip!");
-            mSsGen2->SetCacheFactor(1.0);
-            RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-            if (timeline->mTxMgr->GetTexturePoolAttributes(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
-            {
-                mSsGen2->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
-            }
-            else
-            {
-                auto video2_info = vidclip2->mhSsViewer->GetMediaParser()->GetBestVideoStream();
-                float snapshot_scale2 = video2_info->height > 0 ? 50.f / (float)video2_info->height : 0.05;
-                mSsGen2->SetSnapshotResizeFactor(snapshot_scale2, snapshot_scale2);
-            }
             m_StartOffset.second = vidclip2->StartOffset() + ovlp->mStart - vidclip2->Start();
             mViewer2 = mSsGen2->CreateViewer(m_StartOffset.second);
         }
@@ -4381,8 +4435,11 @@ void EditingVideoOverlap::CalcDisplayParams()
 {
     double snapWndSize = (double)mDuration / 1000;
     double snapCntInView = (double)mViewWndSize.x / mSnapSize.x;
-    if (mSsGen1) mSsGen1->ConfigSnapWindow(snapWndSize, snapCntInView);
-    if (mSsGen2) mSsGen2->ConfigSnapWindow(snapWndSize, snapCntInView);
+    TimeLine* timeline = (TimeLine*)mHandle;
+    if (!timeline)
+        return;
+    if (mSsGen1) timeline->ConfigEditingSnapWindow(mClip1->mMediaID, mSsGen1, mViewer1, snapWndSize, snapCntInView);
+    if (mSsGen2) timeline->ConfigEditingSnapWindow(mClip2->mMediaID, mSsGen2, mViewer2, snapWndSize, snapCntInView);
 }
 
 void EditingVideoOverlap::Seek(int64_t pos, bool enterSeekingState)
@@ -5273,43 +5330,6 @@ void MediaTrack::SelectEditingOverlap(Overlap * overlap)
     }
 }
 
-void MediaTrack::CalculateAudioScopeData(ImGui::ImMat& mat_in)
-{
-    ImGui::ImMat mat;
-    if (mat_in.empty() || mat_in.w < 64)
-        return;
-    int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
-    if (mat_in.elempack > 1)
-    {
-        mat.create_type(fft_size, 1, mat_in.c, mat_in.type);
-        float * data = (float *)mat_in.data;
-        for (int x = 0; x < mat.w; x++)
-        {
-            for (int i = 0; i < mat.c; i++)
-            {
-                mat.at<float>(x, 0, i) = data[x * mat.c + i];
-            }
-        }
-    }
-    else
-    {
-        //mat = mat_in;
-        mat.create_type(fft_size, 1, mat_in.c, mat_in.data, mat_in.type);
-    }
-    for (int i = 0; i < mat.c; i++)
-    {
-        if (i < mAudioChannels)
-        {
-            // we only calculate decibel for now
-            auto & channel_data = mAudioTrackAttribute.channel_data[i];
-            channel_data.m_wave.clone_from(mat.channel(i));
-            channel_data.m_fft.clone_from(mat.channel(i));
-            ImGui::ImRFFT((float *)channel_data.m_fft.data, channel_data.m_fft.w, true);
-            channel_data.m_decibel = ImGui::ImDoDecibel((float*)channel_data.m_fft.data, mat.w);
-        }
-    }
-}
-
 float MediaTrack::GetAudioLevel(int channel)
 {
     if (IS_AUDIO(mType))
@@ -5900,33 +5920,37 @@ int TimeLine::OnBluePrintChange(int type, std::string name, void* handle)
     return ret;
 }
 
-TimeLine::TimeLine()
-    : mStart(0), mEnd(0), mPcmStream(this)
+TimeLine::TimeLine(bool bHeadless)
+    : mHeadless(bHeadless), mStart(0), mEnd(0), mPcmStream(this)
 {
     std::srand(std::time(0)); // init std::rand
 
-    mTxMgr = RenderUtils::TextureManager::GetDefaultInstance();
-    if (!mTxMgr->CreateTexturePool(PREVIEW_TEXTURE_POOL_NAME, {1920, 1080}, IM_DT_INT8, 0))
-        Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << PREVIEW_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    if (!mTxMgr->CreateTexturePool(ARBITRARY_SIZE_TEXTURE_POOL_NAME, {0, 0}, IM_DT_INT8, 0))
-        Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << ARBITRARY_SIZE_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    MatUtils::Size2i snapshotGridTextureSize;
-    snapshotGridTextureSize = {64*16/9, 64};
-    if (!mTxMgr->CreateGridTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    else
-    {
-        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-        mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
-        tTxPoolAttrs.bKeepAspectRatio = true;
-        mTxMgr->SetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+    // the headless timeline is only used for exporting, it doesn't need any texture
+    if (!mHeadless)
+    {
+        mTxMgr = RenderUtils::TextureManager::GetDefaultInstance();
+        if (!mTxMgr->CreateTexturePool(PREVIEW_TEXTURE_POOL_NAME, {1920, 1080}, IM_DT_INT8, 0))
+            Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << PREVIEW_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        if (!mTxMgr->CreateTexturePool(ARBITRARY_SIZE_TEXTURE_POOL_NAME, {0, 0}, IM_DT_INT8, 0))
+            Logger::Log(Logger::WARN) << "FAILED to create texture pool '" << ARBITRARY_SIZE_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        MatUtils::Size2i snapshotGridTextureSize;
+        snapshotGridTextureSize = {64*16/9, 64};
+        if (!mTxMgr->CreateGridTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        else
+        {
+            RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+            mTxMgr->GetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+            tTxPoolAttrs.bKeepAspectRatio = true;
+            mTxMgr->SetTexturePoolAttributes(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        }
+        snapshotGridTextureSize = {DEFAULT_VIDEO_TRACK_HEIGHT*16/9, DEFAULT_VIDEO_TRACK_HEIGHT};
+        if (!mTxMgr->CreateGridTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
+        snapshotGridTextureSize = {50*16/9, 50};
+        if (!mTxMgr->CreateGridTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
+            Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
     }
-    snapshotGridTextureSize = {DEFAULT_VIDEO_TRACK_HEIGHT*16/9, DEFAULT_VIDEO_TRACK_HEIGHT};
-    if (!mTxMgr->CreateGridTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
-    snapshotGridTextureSize = {50*16/9, 50};
-    if (!mTxMgr->CreateGridTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, snapshotGridTextureSize, IM_DT_INT8, {8, 8}, 1))
-        Logger::Log(Logger::WARN) << "FAILED to create grid texture pool '" << EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME << "'! Error is '" << mTxMgr->GetError() << "'." << std::endl;
 
     mhMediaSettings = MediaCore::SharedSettings::CreateInstance();
     mhMediaSettings->SetHwaccelManager(MediaCore::HwaccelManager::GetDefaultInstance());
@@ -5944,18 +5968,34 @@ TimeLine::TimeLine()
         throw std::runtime_error("UNSUPPORTED audio render format!");
     mhMediaSettings->SetAudioOutDataType(pcmDataType);
     mhMediaSettings->SetAudioOutIsPlanar(false);
+    // cache the resampled pcm of the audio clips whose sample rate differs from the timeline
+    const auto strMecCacheDir = MEC::Project::GetCacheDir();
+    if (!strMecCacheDir.empty())
+    {
+        mhMediaSettings->SetAudioResampleCacheDir(SysUtils::JoinPath(strMecCacheDir, "audio_resample"));
+        // reuse the analysis results of the media files instead of decoding them again at every import
+        mhMediaAnalysisCache = MediaCore::MediaAnalysisCache::CreateInstance(SysUtils::JoinPath(strMecCacheDir, "media_analysis"));
+    }
+
+    // probe the media dropped into the media bank in parallel, and fill the bank as the results are ready
+    mhMediaBatchProber = MediaCore::MediaParser::CreateBatchProber();
+    mhMediaBatchProber->SetAnalysisCache(mhMediaAnalysisCache);
 
     // preview use the same settings of timeline as default
     mhPreviewSettings = mhMediaSettings->Clone();
 
-    mAudioRender = MediaCore::AudioRender::CreateInstance();
-    if (!mAudioRender)
-        throw std::runtime_error("FAILED to create AudioRender instance!");
-    if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
-        throw std::runtime_error("FAILED to open audio render device!");
+    mhAudioScope = MEC::AudioScopeAnalyzer::CreateInstance();
+    if (!mHeadless)
+    {
+        mAudioRender = MediaCore::AudioRender::CreateInstance();
+        if (!mAudioRender)
+            throw std::runtime_error("FAILED to create AudioRender instance!");
+        if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
+            throw std::runtime_error("FAILED to open audio render device!");
 
-    auto exec_path = ImGuiHelper::exec_path();
-    m_BP_UI.Initialize();
+        auto exec_path = ImGuiHelper::exec_path();
+        m_BP_UI.Initialize();
+    }
 
     ConfigureDataLayer();
 
@@ -5963,18 +6003,25 @@ TimeLine::TimeLine()
     mAudioAttribute.channel_data.resize(mhMediaSettings->AudioOutChannels());
     memcpy(&mAudioAttribute.mBandCfg, &DEFAULT_BAND_CFG, sizeof(mAudioAttribute.mBandCfg));
 
-    mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
     mRecordIter = mHistoryRecords.begin();
-    mMediaPlayer = new MEC::MediaPlayer(mTxMgr);
+    if (!mHeadless)
+    {
+        mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
+        mMediaPlayer = new MEC::MediaPlayer(mTxMgr);
+    }
 }
 
 TimeLine::~TimeLine()
 {    
+    StopRenderQueue();
+    if (mhMediaBatchProber)
+        mhMediaBatchProber->Cancel();
     ImGui::ImDestroyTexture(&mEncodingPreviewTexture);
     mAudioAttribute.channel_data.clear();
     ImGui::ImDestroyTexture(&mAudioAttribute.m_audio_vector_texture);
     
-    m_BP_UI.Finalize();
+    if (!mHeadless)
+        m_BP_UI.Finalize();
 
     for (auto item : mEditingItems) delete item;
     for (auto track : m_Tracks) delete track;
@@ -5991,16 +6038,21 @@ TimeLine::~TimeLine()
         MediaCore::AudioRender::ReleaseInstance(&mAudioRender);
         mAudioRender = nullptr;
     }
+    mhAudioScope = nullptr;
 
     if (mEncodingThread.joinable())
     {
         StopEncoding();
     }
     mEncoder = nullptr;
+    StopLoudnessAnalysis();
 
-    mTxMgr->ReleaseTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME);
-    mTxMgr->ReleaseTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
-    mTxMgr->ReleaseTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+    if (mTxMgr)
+    {
+        mTxMgr->ReleaseTexturePool(VIDEOITEM_OVERVIEW_GRID_TEXTURE_POOL_NAME);
+        mTxMgr->ReleaseTexturePool(VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+        mTxMgr->ReleaseTexturePool(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME);
+    }
     mMtvReader = nullptr;
     mMtaReader = nullptr;
 
@@ -6050,7 +6102,12 @@ bool TimeLine::UpdateMediaItemMetaData(const std::string& fileUrl, const std::st
     });
     if (iter == media_items.end())
         return false;
-    return (*iter)->AddMetaData(metaName, metaValue, true);
+    if (!(*iter)->AddMetaData(metaName, metaValue, true))
+        return false;
+    // this is called from the background task threads, the proxy is attached in the ui thread
+    if (metaName == "ProxyMedia")
+        mProxyMediaUpdated = true;
+    return true;
 }
 
 const imgui_json::value& TimeLine::CheckMediaItemMetaData(const std::string& fileUrl, const std::string& metaName)
@@ -6957,6 +7014,77 @@ void TimeLine::SetAudioLevel(int channel, float level)
         mAudioAttribute.channel_data[channel].m_decibel = level;
 }
 
+// Copy scope data out of a published frame. The analyzer reuses the frame buffers once the slot is recycled, so the
+// ui must not keep shares of them; the ui owned buffer is reused as long as the shape doesn't change.
+static void CopyAudioScopeMat(const ImGui::ImMat& src, ImGui::ImMat& dst)
+{
+    if (src.empty())
+    {
+        dst.release();
+        return;
+    }
+    if (dst.empty() || dst.data == src.data || dst.w != src.w || dst.h != src.h || dst.c != src.c
+        || dst.type != src.type || dst.elempack != src.elempack || dst.cstep != src.cstep)
+    {
+        dst = src.clone();
+        return;
+    }
+    memcpy(dst.data, src.data, src.total()*src.elemsize);
+    dst.copy_attribute(src);
+}
+
+void TimeLine::UpdateAudioScopeData()
+{
+    if (!mhAudioScope)
+        return;
+    mhAudioScope->SetVectorParams(mAudioAttribute.mAudioVectorScale, mAudioAttribute.mAudioVectorMode);
+    mhAudioScope->SetSpectrogramParams(mAudioAttribute.mAudioSpectrogramOffset, mAudioAttribute.mAudioSpectrogramLight);
+    auto pFrame = mhAudioScope->AcquireLatestFrame();
+    // levels are reset when the preview stops, don't let a late frame bring them back. Acquiring the frame still
+    // recycles its slot, and nothing of it is kept since the scope data is copied out below.
+    if (!pFrame || !mIsPreviewPlaying)
+        return;
+
+    for (int i = 0; i < mAudioAttribute.channel_data.size(); i++)
+    {
+        auto& channel_data = mAudioAttribute.channel_data[i];
+        if (i < pFrame->channels.size())
+        {
+            const auto& scope = pFrame->channels[i];
+            CopyAudioScopeMat(scope.wave, channel_data.m_wave);
+            CopyAudioScopeMat(scope.fft, channel_data.m_fft);
+            CopyAudioScopeMat(scope.db, channel_data.m_db);
+            CopyAudioScopeMat(scope.dbShort, channel_data.m_DBShort);
+            CopyAudioScopeMat(scope.dbLong, channel_data.m_DBLong);
+            CopyAudioScopeMat(scope.spectrogram, channel_data.m_Spectrogram);
+            channel_data.m_decibel = scope.decibel;
+            channel_data.m_DBMaxIndex = scope.dbMaxIndex;
+        }
+        else
+        {
+            channel_data.m_wave.release();
+            channel_data.m_fft.release();
+            channel_data.m_db.release();
+            channel_data.m_DBShort.release();
+            channel_data.m_DBLong.release();
+            channel_data.m_Spectrogram.release();
+        }
+    }
+    if (mAudioAttribute.channel_data.size() >= 2)
+        CopyAudioScopeMat(pFrame->audioVector, mAudioAttribute.m_audio_vector);
+    else
+        mAudioAttribute.m_audio_vector.release();
+
+    for (auto& levels : pFrame->trackLevels)
+    {
+        auto track = FindTrackByID(levels.trackId);
+        if (!track || !IS_AUDIO(track->mType))
+            continue;
+        for (int i = 0; i < levels.channels && i < track->mAudioChannels; i++)
+            track->SetAudioLevel(i, levels.decibel[i]);
+    }
+}
+
 int TimeLine::GetSelectedClipCount()
 {
     int count = 0;
@@ -7996,6 +8124,42 @@ int TimeLine::Load(const imgui_json::value& value)
         if (val.is_string()) mAudioCodec = val.get<imgui_json::string>();
     }
 
+    if (value.contains("OutputVideoEncoder"))
+    {
+        auto& val = value["OutputVideoEncoder"];
+        if (val.is_string()) mVideoEncoder = val.get<imgui_json::string>();
+    }
+
+    if (value.contains("OutputVideoBitrate"))
+    {
+        auto& val = value["OutputVideoBitrate"];
+        if (val.is_number()) mVideoBitrate = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputColorSpace"))
+    {
+        auto& val = value["OutputColorSpace"];
+        if (val.is_number()) mOutputColorSpace = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputColorTransfer"))
+    {
+        auto& val = value["OutputColorTransfer"];
+        if (val.is_number()) mOutputColorTransfer = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputAudioEncoder"))
+    {
+        auto& val = value["OutputAudioEncoder"];
+        if (val.is_string()) mAudioEncoder = val.get<imgui_json::string>();
+    }
+
+    if (value.contains("OutputAudioBitrate"))
+    {
+        auto& val = value["OutputAudioBitrate"];
+        if (val.is_number()) mAudioBitrate = val.get<imgui_json::number>();
+    }
+
     if (value.contains("OutputVideo"))
     {
         auto& val = value["OutputVideo"];
@@ -8008,6 +8172,58 @@ int TimeLine::Load(const imgui_json::value& value)
         if (val.is_boolean()) bExportAudio = val.get<imgui_json::boolean>();
     }
 
+    if (value.contains("OutputNormalizeLoudness"))
+    {
+        auto& val = value["OutputNormalizeLoudness"];
+        if (val.is_boolean()) bNormalizeLoudness = val.get<imgui_json::boolean>();
+    }
+
+    if (value.contains("OutputLoudnessTarget"))
+    {
+        auto& val = value["OutputLoudnessTarget"];
+        if (val.is_number()) mLoudnessTarget = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputTruePeakCeiling"))
+    {
+        auto& val = value["OutputTruePeakCeiling"];
+        if (val.is_number()) mTruePeakCeiling = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputSegmentedExport"))
+    {
+        auto& val = value["OutputSegmentedExport"];
+        if (val.is_boolean()) bSegmentedExport = val.get<imgui_json::boolean>();
+    }
+
+    if (value.contains("OutputSegmentCount"))
+    {
+        auto& val = value["OutputSegmentCount"];
+        if (val.is_number()) mExportSegmentCount = val.get<imgui_json::number>();
+    }
+
+    if (value.contains("OutputSmartRender"))
+    {
+        auto& val = value["OutputSmartRender"];
+        if (val.is_boolean()) bSmartRender = val.get<imgui_json::boolean>();
+    }
+
+    if (value.contains("OutputTwoPass"))
+    {
+        auto& val = value["OutputTwoPass"];
+        if (val.is_boolean()) bTwoPassExport = val.get<imgui_json::boolean>();
+    }
+    if (value.contains("OutputResumable"))
+    {
+        auto& val = value["OutputResumable"];
+        if (val.is_boolean()) bResumableExport = val.get<imgui_json::boolean>();
+    }
+    if (value.contains("UseProxyMedia"))
+    {
+        auto& val = value["UseProxyMedia"];
+        if (val.is_boolean()) bUseProxyMedia = val.get<imgui_json::boolean>();
+    }
+
     if (value.contains("SortMethod"))
     {
         auto& val = value["SortMethod"];
@@ -8025,15 +8241,18 @@ int TimeLine::Load(const imgui_json::value& value)
     mhPreviewSettings->SetVideoOutWidth(previewSize.x);
     mhPreviewSettings->SetVideoOutHeight(previewSize.y);
     mhPreviewSettings->SyncAudioSettingsFrom(mhMediaSettings.get());
-    RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
-    mTxMgr->GetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
-    tTxPoolAttrs.tTxSize = previewSize;
-    mTxMgr->SetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
-    mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
-    mAudioRender->CloseDevice();
-    mPcmStream.Flush();
-    if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
-        throw std::runtime_error("FAILED to open audio render device!");
+    if (!mHeadless)
+    {
+        RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+        mTxMgr->GetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        tTxPoolAttrs.tTxSize = previewSize;
+        mTxMgr->SetTexturePoolAttributes(PREVIEW_TEXTURE_POOL_NAME, tTxPoolAttrs);
+        mhPreviewTx = mTxMgr->GetTextureFromPool(PREVIEW_TEXTURE_POOL_NAME);
+        mAudioRender->CloseDevice();
+        mPcmStream.Flush();
+        if (!mAudioRender->OpenDevice(mhPreviewSettings->AudioOutSampleRate(), mhPreviewSettings->AudioOutChannels(), mAudioRenderFormat, &mPcmStream))
+            throw std::runtime_error("FAILED to open audio render device!");
+    }
     mAudioAttribute.channel_data.clear();
     mAudioAttribute.channel_data.resize(mhMediaSettings->AudioOutChannels());
 
@@ -8540,8 +8759,23 @@ void TimeLine::Save(imgui_json::value& value)
     value["OutputPath"] = mOutputPath;
     value["OutputVideoCode"] = mVideoCodec;
     value["OutputAudioCode"] = mAudioCodec;
+    value["OutputVideoEncoder"] = mVideoEncoder;
+    value["OutputVideoBitrate"] = imgui_json::number(mVideoBitrate);
+    value["OutputColorSpace"] = imgui_json::number(mOutputColorSpace);
+    value["OutputColorTransfer"] = imgui_json::number(mOutputColorTransfer);
+    value["OutputAudioEncoder"] = mAudioEncoder;
+    value["OutputAudioBitrate"] = imgui_json::number(mAudioBitrate);
     value["OutputVideo"] = imgui_json::boolean(bExportVideo);
     value["OutputAudio"] = imgui_json::boolean(bExportAudio);
+    value["OutputNormalizeLoudness"] = imgui_json::boolean(bNormalizeLoudness);
+    value["OutputLoudnessTarget"] = imgui_json::number(mLoudnessTarget);
+    value["OutputTruePeakCeiling"] = imgui_json::number(mTruePeakCeiling);
+    value["OutputSegmentedExport"] = imgui_json::boolean(bSegmentedExport);
+    value["OutputSegmentCount"] = imgui_json::number(mExportSegmentCount);
+    value["OutputSmartRender"] = imgui_json::boolean(bSmartRender);
+    value["OutputTwoPass"] = imgui_json::boolean(bTwoPassExport);
+    value["OutputResumable"] = imgui_json::boolean(bResumableExport);
+    value["UseProxyMedia"] = imgui_json::boolean(bUseProxyMedia);
     value["SortMethod"] = imgui_json::number(mSortMethod);
 }
 
@@ -8580,6 +8814,8 @@ void TimeLine::PerformUiActions()
 #if UI_PERFORMANCE_ANALYSIS
     MediaCore::AutoSection _as("PerfUiActs");
 #endif
+    if (mProxyMediaUpdated.exchange(false))
+        ApplyProxyMediaUpdate();
     if (mUiActions.empty())
         return;
 
@@ -9143,6 +9379,7 @@ int TimeLine::OnAudioEventStackFilterBpChanged(int type, std::string name, void*
 
 void TimeLine::ConfigureDataLayer()
 {
+    mhPreviewSettings->SetVideoSrcUseProxy(bUseProxyMedia);
     mMtvReader = MediaCore::MultiTrackVideoReader::CreateInstance();
     mMtvReader->Configure(mhPreviewSettings);
     mMtvReader->Start();
@@ -9154,6 +9391,7 @@ void TimeLine::ConfigureDataLayer()
 
 void TimeLine::SyncDataLayer(bool forceRefresh)
 {
+    mEditRevision++;
     // video overlap
     int syncedOverlapCount = 0;
     bool needUpdatePreview = false;
@@ -9303,6 +9541,112 @@ MediaCore::Snapshot::Generator::Holder TimeLine::GetSnapshotGenerator(int64_t me
     return hSsGen;
 }
 
+std::string TimeLine::GetEditingSnapshotGeneratorKey(MediaCore::MediaParser::Holder hParser, double windowSize, double frameCount)
+{
+    RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+    std::ostringstream oss;
+    oss << hParser->GetUrl() << "|";
+    if (mTxMgr->GetTexturePoolAttributes(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs))
+        oss << tTxPoolAttrs.tTxSize.x << "x" << tTxPoolAttrs.tTxSize.y;
+    else
+        oss << "scaled";
+    // the snap window is a generator wide setting, only the editing items using the same window can share a generator
+    oss << "|" << std::fixed << std::setprecision(3) << windowSize << "/" << frameCount;
+    return oss.str();
+}
+
+MediaCore::Snapshot::Generator::Holder TimeLine::GetEditingSnapshotGenerator(int64_t mediaItemId, MediaCore::MediaParser::Holder hParser, double windowSize, double frameCount)
+{
+    if (!hParser)
+        return nullptr;
+    // editing clips/overlaps built on the same source share one generator, each of them only owns a viewer on it,
+    // so the GOPs are decoded once. The generator is released along with the last editing item using it.
+    RenderUtils::TextureManager::TexturePoolAttributes tTxPoolAttrs;
+    const bool hasTxPool = mTxMgr->GetTexturePoolAttributes(EDITING_VIDEOCLIP_SNAPSHOT_GRID_TEXTURE_POOL_NAME, tTxPoolAttrs);
+    const auto key = GetEditingSnapshotGeneratorKey(hParser, windowSize, frameCount);
+    auto iter = m_EditingSsGenTable.begin();
+    while (iter != m_EditingSsGenTable.end())
+    {
+        if (iter->second.expired())
+            iter = m_EditingSsGenTable.erase(iter);
+        else
+            iter++;
+    }
+    iter = m_EditingSsGenTable.find(key);
+    if (iter != m_EditingSsGenTable.end())
+        return iter->second.lock();
+
+    MediaCore::Snapshot::Generator::Holder hSsGen = MediaCore::Snapshot::Generator::CreateInstance();
+    if (!hSsGen)
+        return nullptr;
+    MediaItem* mi = FindMediaItemByID(mediaItemId);
+    if (mi && mi->mMediaOverview)
+        hSsGen->SetOverview(mi->mMediaOverview);
+    hSsGen->EnableHwAccel(mHardwareCodec);
+    if (!hSsGen->Open(hParser, mhMediaSettings->VideoOutFrameRate()))
+    {
+        Logger::Log(Logger::Error) << hSsGen->GetError() << std::endl;
+        return nullptr;
+    }
+    hSsGen->SetCacheFactor(1.0);
+    if (hasTxPool)
+    {
+        hSsGen->SetSnapshotSize(tTxPoolAttrs.tTxSize.x, tTxPoolAttrs.tTxSize.y);
+    }
+    else
+    {
+        auto video_info = hParser->GetBestVideoStream();
+        float snapshot_scale = video_info && video_info->height > 0 ? 50.f / (float)video_info->height : 0.05;
+        hSsGen->SetSnapshotResizeFactor(snapshot_scale, snapshot_scale);
+    }
+    if (windowSize > 0 && frameCount >= 1 && !hSsGen->ConfigSnapWindow(windowSize, frameCount))
+    {
+        Logger::Log(Logger::Error) << hSsGen->GetError() << std::endl;
+        return nullptr;
+    }
+    m_EditingSsGenTable[key] = hSsGen;
+    return hSsGen;
+}
+
+bool TimeLine::ConfigEditingSnapWindow(int64_t mediaItemId, MediaCore::Snapshot::Generator::Holder& hSsGen, MediaCore::Snapshot::Viewer::Holder& hViewer, double windowSize, double frameCount)
+{
+    if (!hSsGen || !hViewer)
+        return false;
+    std::string currKey;
+    for (auto& elem : m_EditingSsGenTable)
+    {
+        if (elem.second.lock() == hSsGen)
+        {
+            currKey = elem.first;
+            break;
+        }
+    }
+    const auto newKey = GetEditingSnapshotGeneratorKey(hSsGen->GetMediaParser(), windowSize, frameCount);
+    if (newKey == currKey)
+        return true;
+
+    auto iter = m_EditingSsGenTable.find(newKey);
+    MediaCore::Snapshot::Generator::Holder hNewSsGen = iter != m_EditingSsGenTable.end() ? iter->second.lock() : nullptr;
+    if (!hNewSsGen && hSsGen.use_count() == 1)
+    {
+        // no other editing item is using this generator, re-configure its window in place
+        if (!currKey.empty())
+            m_EditingSsGenTable.erase(currKey);
+        m_EditingSsGenTable[newKey] = hSsGen;
+        return hSsGen->ConfigSnapWindow(windowSize, frameCount);
+    }
+    // the generator is shared, move this viewer to a generator with the requested window, never change the window of the others
+    if (!hNewSsGen)
+        hNewSsGen = GetEditingSnapshotGenerator(mediaItemId, hSsGen->GetMediaParser(), windowSize, frameCount);
+    if (!hNewSsGen)
+        return false;
+    auto hNewViewer = hNewSsGen->CreateViewer(hViewer->GetCurrWindowPos());
+    hViewer->Release();
+    hViewer = hNewViewer;
+    hSsGen = hNewSsGen;
+    return true;
+}
+
 void TimeLine::ReflashSnapshotWindow(bool forceRefresh)
 {
     for (auto& elem : m_VidSsGenTable)
@@ -9355,6 +9699,7 @@ void TimeLine::UpdateVideoSettings(MediaCore::SharedSettings::Holder hSettings,
     auto previewSize = CalcPreviewSize({(int32_t)hSettings->VideoOutWidth(), (int32_t)hSettings->VideoOutHeight()}, previewScale);
     hNewPreviewSettings->SetVideoOutWidth(previewSize.x);
     hNewPreviewSettings->SetVideoOutHeight(previewSize.y);
+    hNewPreviewSettings->SetVideoSrcUseProxy(bUseProxyMedia);
     if (!mMtvReader->UpdateSettings(hNewPreviewSettings))
     {
         std::ostringstream oss; oss << "Update video settings FAILED! Error is '" << mMtvReader->GetError() << "'.";
@@ -9375,22 +9720,54 @@ void TimeLine::UpdateVideoSettings(MediaCore::SharedSettings::Holder hSettings,
         pUiClip->SyncStateFromDataLayer();
 }
 
-void TimeLine::UpdateAudioSettings(MediaCore::SharedSettings::Holder hSettings, MediaCore::AudioRender::PcmFormat pcmFormat)
+void TimeLine::SetUseProxyMedia(bool enable)
 {
-    mAudioRender->CloseDevice();
-    mPcmStream.Flush();
-    if (!mAudioRender->OpenDevice(hSettings->AudioOutSampleRate(), hSettings->AudioOutChannels(), pcmFormat, &mPcmStream))
-        throw std::runtime_error("FAILED to open audio render device!");
-    mAudioRenderFormat = pcmFormat;
-    if (!mMtaReader->UpdateSettings(hSettings))
-        Logger::Log(Logger::Error) << "FAILED to update audio settings!" << std::endl;
-    mhMediaSettings->SyncAudioSettingsFrom(mhPreviewSettings.get());
-    mAudioAttribute.channel_data.clear();
-    mAudioAttribute.channel_data.resize(hSettings->AudioOutChannels());
-    if (mIsPreviewPlaying)
-        mAudioRender->Resume();
-}
-
+    if (bUseProxyMedia == enable)
+        return;
+    auto hNewPreviewSettings = mhPreviewSettings->Clone();
+    hNewPreviewSettings->SetVideoSrcUseProxy(enable);
+    if (!mMtvReader->UpdateSettings(hNewPreviewSettings))
+    {
+        Logger::Log(Logger::Error) << "FAILED to switch proxy media " << (enable ? "on" : "off") << "! Error is '" << mMtvReader->GetError() << "'." << std::endl;
+        return;
+    }
+    mhPreviewSettings = hNewPreviewSettings;
+    bUseProxyMedia = enable;
+    RefreshPreview(false);
+}
+
+void TimeLine::ApplyProxyMediaUpdate()
+{
+    bool bProxyChanged = false;
+    for (auto pMediaItem : media_items)
+    {
+        if (pMediaItem->UpdateProxy())
+            bProxyChanged = true;
+    }
+    if (!bProxyChanged || !bUseProxyMedia)
+        return;
+    // let the clips which are already on the timeline switch to the new proxies
+    if (!mMtvReader->UpdateSettings(mMtvReader->GetSharedSettings()))
+        Logger::Log(Logger::Error) << "FAILED to apply the updated proxy media! Error is '" << mMtvReader->GetError() << "'." << std::endl;
+    RefreshPreview(false);
+}
+
+void TimeLine::UpdateAudioSettings(MediaCore::SharedSettings::Holder hSettings, MediaCore::AudioRender::PcmFormat pcmFormat)
+{
+    mAudioRender->CloseDevice();
+    mPcmStream.Flush();
+    if (!mAudioRender->OpenDevice(hSettings->AudioOutSampleRate(), hSettings->AudioOutChannels(), pcmFormat, &mPcmStream))
+        throw std::runtime_error("FAILED to open audio render device!");
+    mAudioRenderFormat = pcmFormat;
+    if (!mMtaReader->UpdateSettings(hSettings))
+        Logger::Log(Logger::Error) << "FAILED to update audio settings!" << std::endl;
+    mhMediaSettings->SyncAudioSettingsFrom(mhPreviewSettings.get());
+    mAudioAttribute.channel_data.clear();
+    mAudioAttribute.channel_data.resize(hSettings->AudioOutChannels());
+    if (mIsPreviewPlaying)
+        mAudioRender->Resume();
+}
+
 uint32_t TimeLine::SimplePcmStream::Read(uint8_t* buff, uint32_t buffSize, bool blocking)
 {
     if (!m_areader)
@@ -9419,27 +9796,9 @@ uint32_t TimeLine::SimplePcmStream::Read(uint8_t* buff, uint32_t buffSize, bool
             m_amat = amats[0].frame;
             // if (!m_amat.empty())
             //     Logger::Log(Logger::INFO) << "=======> m_amat.timestamp=" << m_amat.time_stamp << std::endl;
-            if (m_owner->mAudioAttribute.audio_mutex.try_lock())
-            {
-                m_owner->CalculateAudioScopeData(m_amat);
-                m_owner->mAudioAttribute.audio_mutex.unlock();
-            }
-            // channel audio
-            for (auto amat : amats)
-            {
-                if (amat.phase == MediaCore::CorrelativeFrame::PHASE_AFTER_TRANSITION)
-                {
-                    auto track = m_owner->FindTrackByID(amat.trackId);
-                    if (track && IS_AUDIO(track->mType))
-                    {
-                        if (track->mAudioTrackAttribute.audio_mutex.try_lock())
-                        {
-                            track->CalculateAudioScopeData(amat.frame);
-                            track->mAudioTrackAttribute.audio_mutex.unlock();
-                        }
-                    }
-                }
-            }
+            // scope analysis runs on its own thread, never block the audio render here
+            if (m_owner->mhAudioScope)
+                m_owner->mhAudioScope->PushFrames(amats);
             m_readPosInAmat = 0;
         }
     }
@@ -9459,407 +9818,1689 @@ void TimeLine::SimplePcmStream::Flush()
     m_tsValid = false;
 }
 
-void TimeLine::CalculateAudioScopeData(ImGui::ImMat& mat_in)
+void TimeLine::MakeEncoderParams(VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams) const
 {
-    if (mat_in.empty() || mat_in.w < 64)
-        return;
-    const int fft_size = mat_in.w  > 256 ? 256 : mat_in.w > 128 ? 128 : 64;
-    const int ch = mat_in.c;
-    ImGui::ImMat mat;
-    mat.create_type(fft_size, 1, ch, IM_DT_FLOAT32);
-    // copy fft_size samples from input mat, and convert them into float type
+    vidEncParams.encodeVideo = bExportVideo;
+    vidEncParams.codecName = mVideoEncoder;
+    vidEncParams.bitRate = mVideoBitrate;
+    vidEncParams.extraOpts.clear();
+    if (mOutputColorSpace >= 0)
     {
-        float** ppDstPtrs = new float*[ch];
-        for (int i = 0; i < ch; i++)
-            ppDstPtrs[i] = (float*)mat.data+mat.w*i;
-        if (mat_in.elempack > 1)
-        {
-            if (mat_in.type == IM_DT_FLOAT32)
-            {
-                const float* pSrcPtr = (const float*)mat_in.data;
-                for (int i = 0; i < fft_size; i++)
-                {
-                    for (int j = 0; j < ch; j++)
-                    {
-                        auto& pDstPtr = ppDstPtrs[j];
-                        *pDstPtr++ = *pSrcPtr++;
-                    }
-                }
-            }
-            else if (mat_in.type == IM_DT_INT16)
-            {
-                const int16_t* pSrcPtr = (const int16_t*)mat_in.data;
-                for (int i = 0; i < fft_size; i++)
-                {
-                    for (int j = 0; j < ch; j++)
-                    {
-                        auto& pDstPtr = ppDstPtrs[j];
-                        *pDstPtr++ = (float)(*pSrcPtr++)/INT16_MAX;
-                    }
-                }
-            }
-            else
-                throw std::runtime_error("This PCM format is NOT SUPPORTED yet!");
-        }
-        else
+        switch (mOutputColorSpace)
         {
-            if (mat_in.type == IM_DT_FLOAT32)
-            {
-                const float** ppSrcPtrs = new const float*[ch];
-                for (int i = 0; i < ch; i++)
-                    ppSrcPtrs[i] = (const float*)mat_in.data+mat_in.w*i;
-                for (int i = 0; i < ch; i++)
-                    memcpy(ppDstPtrs[i], ppSrcPtrs[i], fft_size*sizeof(float));
-                delete [] ppSrcPtrs;
-            }
-            else if (mat_in.type == IM_DT_INT16)
-            {
-                const int16_t** ppSrcPtrs = new const int16_t*[ch];
-                for (int i = 0; i < ch; i++)
-                    ppSrcPtrs[i] = (const int16_t*)mat_in.data+mat_in.w*i;
-                for (int i = 0; i < ch; i++)
-                {
-                    auto& pDstPtr = ppDstPtrs[i];
-                    auto& pSrcPtr = ppSrcPtrs[i];
-                    for (int j = 0; j < fft_size; j++)
-                        *pDstPtr++ = (float)(*pSrcPtr++)/INT16_MAX;
-                }
-                delete [] ppSrcPtrs;
-            }
-            else
-                throw std::runtime_error("This PCM format is NOT SUPPORTED yet!");
+        case AVCOL_SPC_BT709:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT709)});
+            break;
+        case AVCOL_SPC_FCC:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT470M)});
+            break;
+        case AVCOL_SPC_BT470BG:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT470BG)});
+            break;
+        case AVCOL_SPC_SMPTE170M:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_SMPTE170M)});
+            break;
+        case AVCOL_SPC_SMPTE240M:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_SMPTE240M)});
+            break;
+        case AVCOL_SPC_BT2020_NCL:
+        case AVCOL_SPC_BT2020_CL:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_BT2020)});
+            break;
+        default:
+            vidEncParams.extraOpts.push_back({"color_primaries", MediaCore::Value((int)AVCOL_PRI_UNSPECIFIED)});
         }
-        delete [] ppDstPtrs;
     }
+    if (vidEncParams.codecName.compare("prores_videotoolbox") == 0)
+        vidEncParams.extraOpts.push_back({"allow_sw", MediaCore::Value(1)});
+    if (mOutputColorSpace >= 0)
+        vidEncParams.extraOpts.push_back({"colorspace", MediaCore::Value(mOutputColorSpace)});
+    if (mOutputColorTransfer >= 0)
+        vidEncParams.extraOpts.push_back({"color_trc", MediaCore::Value(mOutputColorTransfer)});
+    audEncParams.encodeAudio = bExportAudio;
+    audEncParams.codecName = mAudioEncoder;
+    audEncParams.bitRate = mAudioBitrate;
+}
 
-    for (int i = 0; i < mat.c; i++)
+bool TimeLine::ConfigEncoder(const std::string& outputPath, VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams, std::string& errMsg)
+{
+    if (!vidEncParams.encodeVideo && !audEncParams.encodeAudio)
     {
-        if (i >= (int)mhMediaSettings->AudioOutChannels())
-            break;
-        auto & channel_data = mAudioAttribute.channel_data[i];
-        channel_data.m_wave.clone_from(mat.channel(i));
-        channel_data.m_fft.clone_from(mat.channel(i));
-        ImGui::ImRFFT((float *)channel_data.m_fft.data, channel_data.m_fft.w, true);
-        channel_data.m_db.create_type((mat.w >> 1) + 1, IM_DT_FLOAT32);
-        channel_data.m_DBMaxIndex = ImGui::ImReComposeDB((float*)channel_data.m_fft.data, (float *)channel_data.m_db.data, mat.w, false);
-        channel_data.m_DBShort.create_type(20, IM_DT_FLOAT32);
-        ImGui::ImReComposeDBShort((float*)channel_data.m_fft.data, (float*)channel_data.m_DBShort.data, mat.w);
-        channel_data.m_DBLong.create_type(76, IM_DT_FLOAT32);
-        ImGui::ImReComposeDBLong((float*)channel_data.m_fft.data, (float*)channel_data.m_DBLong.data, mat.w);
-        channel_data.m_decibel = ImGui::ImDoDecibel((float*)channel_data.m_fft.data, mat.w);
-        if (channel_data.m_Spectrogram.w != (mat.w >> 1) + 1)
+        errMsg = "At least one video or audio stream is going to be encoded!";
+        return false;
+    }
+    mEncOutputPath = outputPath;
+    mEncVidParams = vidEncParams;
+    mEncAudParams = audEncParams;
+    mEncoder = nullptr;
+    if (vidEncParams.encodeVideo && IsSegmentedExport())
+    {
+        // the segments are encoded by their own encoders, which report the invalid settings, and the output file is
+        // written by the segment muxer. Opening 'mEncoder' here would only leave an empty output file behind.
+        mEncMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+        if (audEncParams.encodeAudio)
+            mEncMtaReader = mMtaReader->CloneAndConfigure(audEncParams.channels, audEncParams.sampleRate, audEncParams.sampleFormat, audEncParams.samplesPerFrame);
+        if (!mEncMtvReader || (audEncParams.encodeAudio && !mEncMtaReader))
         {
-            channel_data.m_Spectrogram.create_type((mat.w >> 1) + 1, 256, 4, IM_DT_INT8);
+            errMsg = "FAILED to clone the readers for encoding!";
+            return false;
         }
-        if (!channel_data.m_Spectrogram.empty())
+        return true;
+    }
+    mEncoder = MediaCore::MediaEncoder::CreateInstance();
+    if (!mEncoder->Open(outputPath))
+    {
+        errMsg = mEncoder->GetError();
+        return false;
+    }
+
+    if (vidEncParams.encodeVideo)
+    {
+        // Video
+        if (!mEncoder->ConfigureVideoStream(
+            vidEncParams.codecName, vidEncParams.imageFormat, vidEncParams.width, vidEncParams.height,
+            vidEncParams.frameRate, vidEncParams.bitRate, &vidEncParams.extraOpts))
         {
-            auto w = channel_data.m_Spectrogram.w;
-            auto c = channel_data.m_Spectrogram.c;
-            memmove(channel_data.m_Spectrogram.data, (char *)channel_data.m_Spectrogram.data + w * c, channel_data.m_Spectrogram.total() - w * c);
-            uint32_t * last_line = (uint32_t *)channel_data.m_Spectrogram.row_c<uint8_t>(255);
-            for (int n = 0; n < w; n++)
-            {
-                float value = channel_data.m_db.at<float>(n) * M_SQRT2 + 64 + mAudioAttribute.mAudioSpectrogramOffset;
-                value = ImClamp(value, -64.f, 63.f);
-                float light = (value + 64) / 127.f;
-                value = (int)((value + 64) + 170) % 255; 
-                auto hue = value / 255.f;
-                auto color = ImColor::HSV(hue, 1.0, light * mAudioAttribute.mAudioSpectrogramLight);
-                last_line[n] = color;
-            }
-            channel_data.m_Spectrogram.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
+            errMsg = mEncoder->GetError();
+            return false;
         }
+        mEncMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
     }
-    if (mat.c >= 2)
+
+    if (audEncParams.encodeAudio)
     {
-        if (mAudioAttribute.m_audio_vector.empty())
+        // Audio
+        if (!mEncoder->ConfigureAudioStream(
+            audEncParams.codecName, audEncParams.sampleFormat, audEncParams.channels,
+            audEncParams.sampleRate, audEncParams.bitRate))
         {
-            mAudioAttribute.m_audio_vector.create_type(256, 256, 4, IM_DT_INT8);
-            mAudioAttribute.m_audio_vector.fill((int8_t)0);
-            mAudioAttribute.m_audio_vector.elempack = 4;
+            errMsg = mEncoder->GetError();
+            return false;
         }
-        if (!mAudioAttribute.m_audio_vector.empty())
-        {
-            float zoom = mAudioAttribute.mAudioVectorScale;
-            float hw = mAudioAttribute.m_audio_vector.w / 2;
-            float hh = mAudioAttribute.m_audio_vector.h / 2;
-            int samples = mat.w;
-            mAudioAttribute.m_audio_vector -= 64;
-            for (int n = 0; n < samples; n++)
-            {
-                float s1 = mAudioAttribute.channel_data[0].m_wave.at<float>(n, 0);
-                float s2 = mAudioAttribute.channel_data[1].m_wave.at<float>(n, 0);
-                int x = hw;
-                int y = hh;
+        mEncMtaReader = mMtaReader->CloneAndConfigure(audEncParams.channels, audEncParams.sampleRate, audEncParams.sampleFormat, audEncParams.samplesPerFrame);
+    }
+    return true;
+}
 
-                if (mAudioAttribute.mAudioVectorMode == LISSAJOUS)
-                {
-                    x = ((s2 - s1) * zoom / 2 + 1) * hw;
-                    y = (1.0 - (s1 + s2) * zoom / 2) * hh;
-                }
-                else if (mAudioAttribute.mAudioVectorMode == LISSAJOUS_XY)
-                {
-                    x = (s2 * zoom + 1) * hw;
-                    y = (s1 * zoom + 1) * hh;
-                }
-                else
-                {
-                    float sx, sy, cx, cy;
-                    sx = s2 * zoom;
-                    sy = s1 * zoom;
-                    cx = sx * sqrtf(1 - 0.5 * sy * sy);
-                    cy = sy * sqrtf(1 - 0.5 * sx * sx);
-                    x = hw + hw * ImSign(cx + cy) * (cx - cy) * .7;
-                    y = mAudioAttribute.m_audio_vector.h - mAudioAttribute.m_audio_vector.h * fabsf(cx + cy) * .7;
-                }
-                x = ImClamp(x, 0, mAudioAttribute.m_audio_vector.w - 1);
-                y = ImClamp(y, 0, mAudioAttribute.m_audio_vector.h - 1);
-                uint8_t r = ImClamp(mAudioAttribute.m_audio_vector.at<uint8_t>(x, y, 0) + 30, 0, 255);
-                uint8_t g = ImClamp(mAudioAttribute.m_audio_vector.at<uint8_t>(x, y, 1) + 50, 0, 255);
-                uint8_t b = ImClamp(mAudioAttribute.m_audio_vector.at<uint8_t>(x, y, 2) + 30, 0, 255);
-                mAudioAttribute.m_audio_vector.set_pixel(x, y, ImPixel(r / 255.0, g / 255.0, b / 255.0, 1.f));
-            }
-            mAudioAttribute.m_audio_vector.flags |= IM_MAT_FLAGS_CUSTOM_UPDATED;
-        }
+void TimeLine::StartEncoding()
+{
+    if (mEncodingThread.joinable())
+    {
+        mQuitEncoding = true;
+        mEncodingThread.join();
+        //return;
+    }
+    mEncodeProcErrMsg.clear();
+    {
+        std::lock_guard<std::mutex> lk(mEncodingMutex);
+        mSmartRenderNote.clear();
+    }
+    mEncodingProgress = 0;
+    mEncodingDuration = (double)ValidDuration()/1000.f;
+    mQuitEncoding = false;
+    mIsEncoding = true;
+    if (mEncMtvReader && IsSegmentedExport())
+    {
+        _SnapshotEncodingClips();
+        mEncodingThread = std::thread(&TimeLine::_EncodeSegmentedProc, this);
     }
+    else
+        mEncodingThread = std::thread(&TimeLine::_EncodeProc, this);
+    SysUtils::SetThreadName(mEncodingThread, "TL-EncProc");
 }
 
-bool TimeLine::ConfigEncoder(const std::string& outputPath, VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams, std::string& errMsg)
+void TimeLine::StopEncoding()
 {
-    if (!vidEncParams.encodeVideo && !audEncParams.encodeAudio)
+    mQuitEncoding = true;
     {
-        errMsg = "At least one video or audio stream is going to be encoded!";
-        return false;
+        std::lock_guard<std::mutex> lk(mEncodingMutex);
+        if (mSegmentMuxer)
+            mSegmentMuxer->Cancel();
     }
-    mEncoder = MediaCore::MediaEncoder::CreateInstance();
-    if (!mEncoder->Open(outputPath))
+    if (mEncodingThread.joinable())
     {
-        errMsg = mEncoder->GetError();
-        return false;
+        mEncodingThread.join();
+        mEncodingThread = std::thread();
+    }
+    mIsEncoding = false;
+    mEncoder = nullptr;
+    mEncMtvReader = nullptr;
+    mEncMtaReader = nullptr;
+}
+
+void TimeLine::StartLoudnessAnalysis(uint32_t channels, uint32_t sampleRate)
+{
+    StopLoudnessAnalysis();
+    if (!mMtaReader)
+        return;
+    ValidDuration();
+    // measure with the layout of the export, the gain is applied to its mix, not to the preview downmix
+    auto hTask = MediaCore::LoudnessMeter::CreateAnalysisTask(mMtaReader, mEncodingStart, mEncodingEnd, channels, sampleRate);
+    if (hTask)
+        SysUtils::ThreadPoolExecutor::GetDefaultInstance()->EnqueueTask(hTask);
+    std::lock_guard<std::mutex> lk(mLoudnessTaskLock);
+    mhLoudnessTask = hTask;
+}
+
+void TimeLine::StopLoudnessAnalysis()
+{
+    MediaCore::LoudnessMeter::AnalysisTask::Holder hTask;
+    {
+        std::lock_guard<std::mutex> lk(mLoudnessTaskLock);
+        hTask = mhLoudnessTask;
+        mhLoudnessTask = nullptr;
+    }
+    if (hTask)
+        hTask->Cancel();
+}
+
+MediaCore::LoudnessMeter::AnalysisTask::Holder TimeLine::GetLoudnessTask() const
+{
+    std::lock_guard<std::mutex> lk(mLoudnessTaskLock);
+    return mhLoudnessTask;
+}
+
+void TimeLine::_ApplyLoudnessNormalization()
+{
+    // the measurement normally runs while the export dialog is open, so here we only wait for its tail
+    auto hTask = GetLoudnessTask();
+    bool ownTask = false;
+    if (!hTask || hTask->IsFailed() || hTask->IsCancelled() || hTask->GetStartPos() != mEncodingStart || hTask->GetEndPos() != mEncodingEnd
+        || hTask->GetChannels() != mEncAudParams.channels || hTask->GetSampleRate() != mEncAudParams.sampleRate)
+    {
+        // measure the export reader itself, this task is owned by the encoding thread and cancelled with it
+        hTask = MediaCore::LoudnessMeter::CreateAnalysisTask(mEncMtaReader, mEncodingStart, mEncodingEnd, mEncAudParams.channels, mEncAudParams.sampleRate);
+        ownTask = true;
+        if (hTask)
+            SysUtils::ThreadPoolExecutor::GetDefaultInstance()->EnqueueTask(hTask);
+    }
+    while (hTask && !hTask->IsStopped() && !mQuitEncoding)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    if (hTask && ownTask && !hTask->IsStopped())
+        hTask->Cancel();
+    if (hTask && hTask->IsDone())
+    {
+        const auto measurement = hTask->GetMeasurement();
+        const double gainDb = MediaCore::LoudnessMeter::GetNormalizationGain(measurement, mLoudnessTarget, mTruePeakCeiling);
+        auto hAeFilter = mEncMtaReader->GetAudioEffectFilter();
+        auto volParams = hAeFilter->GetVolumeParams();
+        volParams.volume *= (float)pow(10., gainDb/20.);
+        hAeFilter->SetVolumeParams(&volParams);
+        Logger::Log(Logger::DEBUG) << "Loudness normalization: integrated=" << measurement.integrated << " LUFS, true-peak=" << measurement.truePeak
+                << " dBTP, apply gain " << gainDb << " dB." << std::endl;
+    }
+}
+
+void TimeLine::_EncodeProc()
+{
+    Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter encoding proc >>>>>>>>>>>>" << std::endl;
+    mEncoder->Start();
+    bool vidInputEof = false;
+    bool audInputEof = false;
+    int nextLoopEncodeType = 0;  // 0: no hint, 1: video, 2: audio
+    int64_t audpos = 0, vidpos = 0;
+    double maxEncodeDuration = 0;
+    MediaCore::Ratio outFrameRate = mEncoder->GetVideoFrameRate();
+    ImGui::ImMat vmat, amat;
+    uint32_t pcmbufSize = 8192;
+    uint8_t* pcmbuf = new uint8_t[pcmbufSize];
+    auto dur = ValidDuration();
+    int64_t encpos = 0;
+    int64_t vidFrameCount = 0;
+    int64_t startTimeOffset = 0;
+    if (mEncMtvReader) {
+        mEncMtvReader->SeekTo(mEncodingStart);
+        vidFrameCount = mEncMtvReader->MillsecToFrameIndex(mEncodingStart);
+        startTimeOffset = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
+        mEncMtvReader->SetCacheFrameNum(8);
+    }
+    else
+        vidInputEof = true;
+    if (mEncMtaReader && bNormalizeLoudness)
+        _ApplyLoudnessNormalization();
+    if (mEncMtaReader)
+        mEncMtaReader->SeekTo(mEncodingStart);
+    else
+        audInputEof = true;
+    while (!mQuitEncoding && (!vidInputEof || !audInputEof))
+    {
+        bool idleLoop = true;
+        if (!vidInputEof && (nextLoopEncodeType == 1 || audInputEof || (nextLoopEncodeType == 0 && vidpos <= audpos)))
+        {
+            vidpos = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
+            bool eof = vidpos >= mEncodingEnd;
+            if (!eof)
+            {
+                if (vmat.empty())
+                {
+                    if (!mEncMtvReader->ReadVideoFrameByIdx(vidFrameCount, vmat))
+                    {
+                        std::ostringstream oss;
+                        oss << "[video] '" << mEncMtvReader->GetError() << "'.";
+                        mEncodeProcErrMsg = oss.str();
+                        break;
+                    }
+                    if (!vmat.empty())
+                    {
+                        vmat.time_stamp = (double)(vidpos-startTimeOffset)/1000.;
+                        vidFrameCount++;
+                    }
+                }
+                if (!vmat.empty())
+                {
+                    {
+                        std::lock_guard<std::mutex> lk(mEncodingMutex);
+                        mEncodingVFrame = vmat;
+                    }
+                    bool consumed = false;
+                    if (!mEncoder->EncodeVideoFrame(vmat, consumed, false))
+                    {
+                        std::ostringstream oss;
+                        oss << "[video] '" << mEncoder->GetError() << "'.";
+                        mEncodeProcErrMsg = oss.str();
+                        break;
+                    }
+                    if (consumed)
+                    {
+                        vmat.release();
+                        nextLoopEncodeType = 0;
+                    }
+                    else
+                        nextLoopEncodeType = 2;
+                    if (vidpos > encpos)
+                    {
+                        encpos = vidpos;
+                        mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
+                    }
+                }
+            }
+            else
+            {
+                vmat.release();
+                bool consumed = false;
+                if (!mEncoder->EncodeVideoFrame(vmat, consumed))
+                {
+                    std::ostringstream oss;
+                    oss << "[video] '" << mEncoder->GetError() << "'.";
+                    mEncodeProcErrMsg = oss.str();
+                    break;
+                }
+                vidInputEof = true;
+            }
+        }
+        else
+        {
+            bool eof;
+            uint32_t readSize = pcmbufSize;
+            if (amat.empty() && !mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
+            {
+                std::ostringstream oss;
+                oss << "[audio] '" << mEncMtaReader->GetError() << "'.";
+                mEncodeProcErrMsg = oss.str();
+                break;
+            }
+            if (audpos > mEncodingEnd) eof = true;
+            if (!eof && !amat.empty())
+            {
+                audpos = amat.time_stamp * 1000;
+                amat.time_stamp = (double)(audpos-startTimeOffset)/1000.;
+                bool consumed = false;
+                if (!mEncoder->EncodeAudioSamples(amat, consumed, false))
+                {
+                    std::ostringstream oss;
+                    oss << "[audio] '" << mEncoder->GetError() << "'.";
+                    mEncodeProcErrMsg = oss.str();
+                    break;
+                }
+                if (consumed)
+                {
+                    amat.release();
+                    nextLoopEncodeType = 0;
+                }
+                else
+                    nextLoopEncodeType = 1;
+                if (audpos > encpos)
+                {
+                    encpos = audpos;
+                    mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
+                }
+            }
+            else
+            {
+                amat.release();
+                // {
+                //     std::lock_guard<std::mutex> lk(mEncodingMutex);
+                //     mEncodingAFrame = amat;
+                // }
+                bool consumed = false;
+                if (!mEncoder->EncodeAudioSamples(amat, consumed))
+                {
+                    std::ostringstream oss;
+                    oss << "[audio] '" << mEncoder->GetError() << "'.";
+                    mEncodeProcErrMsg = oss.str();
+                    break;
+                }
+                audInputEof = true;
+            }
+        }
+    }
+    if (!mQuitEncoding && mEncodeProcErrMsg.empty())
+    {
+        mEncodingProgress = 1;
+    }
+    mEncoder->FinishEncoding();
+    mEncoder->Close();
+    mIsEncoding = false;
+    Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit encoding proc <<<<<<<<<<<<<<<<" << std::endl;
+}
+
+bool TimeLine::IsSegmentedExport() const
+{
+    return (bSegmentedExport && GetExportSegmentCount() > 1) || bSmartRender || bTwoPassExport || bResumableExport;
+}
+
+int TimeLine::GetExportSegmentCount() const
+{
+    if (mExportSegmentCount > 0)
+        return mExportSegmentCount;
+    // every segment encoder is multi-threaded by itself, so don't start one segment per core
+    const int coreCount = (int)std::thread::hardware_concurrency();
+    return coreCount >= 8 ? coreCount/4 : 1;
+}
+
+// libavcodec doesn't apply the fast first pass of x264 and x265, which turns off the analysis only needed by the
+// final encoding. Set it explicitly, and give both passes the same preset so the statistics match the second pass.
+static void SetTwoPassOptions(const std::string& encoderName, int pass, std::vector<MediaCore::MediaEncoder::Option>& extraOpts)
+{
+    auto findOption = [&extraOpts] (const std::string& name) {
+        return std::find_if(extraOpts.begin(), extraOpts.end(), [&name] (const MediaCore::MediaEncoder::Option& opt) { return opt.name == name; });
+    };
+    auto appendParams = [&] (const std::string& name, const std::string& params) {
+        auto iter = findOption(name);
+        if (iter == extraOpts.end())
+            extraOpts.push_back({name, MediaCore::Value(params)});
+        else
+            iter->value = MediaCore::Value(iter->value.strval + ":" + params);
+    };
+    std::string paramsName, firstPassParams;
+    if (encoderName == "libx264" || encoderName == "libx264rgb")
+    {
+        paramsName = "x264-params";
+        firstPassParams = "ref=1:subme=2:me=dia:partitions=none:trellis=0:8x8dct=0";
+    }
+    else if (encoderName == "libx265")
+    {
+        paramsName = "x265-params";
+        firstPassParams = "slow-firstpass=0";
+    }
+    else
+        return;
+    if (findOption("preset") == extraOpts.end())
+        extraOpts.push_back({"preset", MediaCore::Value("medium")});
+    if (pass == 1)
+        appendParams(paramsName, firstPassParams);
+}
+
+bool TimeLine::_EncodeVideoSegment(MediaCore::MultiTrackVideoReader::Holder hReader, const std::string& segPath, int64_t startFrame, int64_t endFrame,
+        std::atomic<int64_t>& encodedFrames, std::atomic_bool& abort, std::string& errMsg, int pass, const std::string& statsPath)
+{
+    auto hEncoder = MediaCore::MediaEncoder::CreateInstance();
+    std::string imageFormat = mEncVidParams.imageFormat;
+    std::vector<MediaCore::MediaEncoder::Option> extraOpts = mEncVidParams.extraOpts;
+    if (pass > 0)
+        SetTwoPassOptions(mEncVidParams.codecName, pass, extraOpts);
+    if (!hEncoder->Open(segPath) ||
+        (pass > 0 && !hEncoder->SetVideoEncodingPass(pass, statsPath)) ||
+        !hEncoder->ConfigureVideoStream(mEncVidParams.codecName, imageFormat, mEncVidParams.width, mEncVidParams.height,
+            mEncVidParams.frameRate, mEncVidParams.bitRate, &extraOpts) ||
+        !hEncoder->Start())
+    {
+        errMsg = "[video] '" + hEncoder->GetError() + "'.";
+        return false;
+    }
+    // time stamps start from 0 in every segment, they are shifted to the segment position when muxing
+    const int64_t segStartTime = hReader->FrameIndexToMillsec(startFrame);
+    hReader->SeekTo(segStartTime);
+    hReader->SetCacheFrameNum(8);
+    ImGui::ImMat vmat;
+    bool success = true;
+    int64_t frameIdx = startFrame;
+    for (; frameIdx < endFrame && !mQuitEncoding && !abort; frameIdx++)
+    {
+        if (!hReader->ReadVideoFrameByIdx(frameIdx, vmat))
+        {
+            errMsg = "[video] '" + hReader->GetError() + "'.";
+            success = false;
+            break;
+        }
+        if (vmat.empty())
+            continue;
+        vmat.time_stamp = (double)(hReader->FrameIndexToMillsec(frameIdx)-segStartTime)/1000.;
+        {
+            std::lock_guard<std::mutex> lk(mEncodingMutex);
+            mEncodingVFrame = vmat;
+        }
+        bool consumed = false;
+        if (!hEncoder->EncodeVideoFrame(vmat, consumed))
+        {
+            errMsg = "[video] '" + hEncoder->GetError() + "'.";
+            success = false;
+            break;
+        }
+        vmat.release();
+        encodedFrames++;
+    }
+    // an interrupted segment is incomplete, it fails without an error message
+    if (success && frameIdx < endFrame)
+        success = false;
+    if (success)
+    {
+        bool consumed = false;
+        vmat.release();
+        if (!hEncoder->EncodeVideoFrame(vmat, consumed))
+        {
+            errMsg = "[video] '" + hEncoder->GetError() + "'.";
+            success = false;
+        }
+    }
+    if (!hEncoder->FinishEncoding() && success)
+    {
+        errMsg = "[video] '" + hEncoder->GetError() + "'.";
+        success = false;
+    }
+    hEncoder->Close();
+    return success;
+}
+
+void TimeLine::_SnapshotEncodingClips()
+{
+    mEncClipSnapshots.clear();
+    int trackIdx = 0;
+    for (auto track : m_Tracks)
+    {
+        if ((!IS_VIDEO(track->mType) && !IS_TEXT(track->mType)) || !track->mView)
+            continue;
+        for (auto clip : track->m_Clips)
+        {
+            auto jnClip = clip->SaveAsJson();
+            jnClip.erase("Start");
+            jnClip.erase("End");
+            std::ostringstream oss;
+            oss << trackIdx << "|" << jnClip.dump();
+            mEncClipSnapshots.push_back({clip->Start(), clip->End(), IS_TEXT(track->mType), oss.str()});
+        }
+        trackIdx++;
+    }
+    mEncOverlapSnapshots.clear();
+    for (auto ovlp : m_Overlaps)
+    {
+        if (IS_VIDEO(ovlp->mType))
+            mEncOverlapSnapshots.push_back(SnapshotEncodingOverlap(ovlp));
+    }
+}
+
+TimeLine::EncodingOverlapSnapshot TimeLine::SnapshotEncodingOverlap(Overlap* ovlp)
+{
+    imgui_json::value jnOvlp;
+    ovlp->Save(jnOvlp);
+    jnOvlp.erase("ID");
+    jnOvlp.erase("Start");
+    jnOvlp.erase("End");
+    jnOvlp.erase("Current");
+    return { ovlp->mStart, ovlp->mEnd, jnOvlp.dump() };
+}
+
+std::string TimeLine::ComposeSegmentFingerprint(const std::string& encSettings, int64_t segStart, int64_t segEnd,
+        const std::vector<EncodingClipSnapshot>& clips, const std::vector<EncodingOverlapSnapshot>& overlaps)
+{
+    std::ostringstream oss;
+    oss << encSettings;
+    for (auto& clip : clips)
+    {
+        if (clip.end > segStart && clip.start < segEnd)
+            oss << "|" << clip.start-segStart << "," << clip.end-segStart << "|" << clip.content;
+    }
+    for (auto& ovlp : overlaps)
+    {
+        if (ovlp.end > segStart && ovlp.start < segEnd)
+            oss << "|O" << ovlp.start-segStart << "," << ovlp.end-segStart << "|" << ovlp.content;
+    }
+    std::ostringstream ossName;
+    ossName << std::hex << std::setw(16) << std::setfill('0') << MathUtils::Fnv1aHash64(oss.str());
+    return ossName.str();
+}
+
+std::string TimeLine::_GetSegmentFingerprint(int64_t startFrame, int64_t endFrame)
+{
+    // the encoded segment depends on the encoder settings and on the content of the segment. The clips and the
+    // overlap transitions are keyed by their positions relative to the segment, so a segment keeps its fingerprint
+    // when the timeline before it is edited and the clips are moved along.
+    const int64_t segStart = mEncMtvReader->FrameIndexToMillsec(startFrame);
+    const int64_t segEnd = mEncMtvReader->FrameIndexToMillsec(endFrame);
+    std::ostringstream oss;
+    oss << mEncVidParams.codecName << "|" << mEncVidParams.imageFormat << "|" << mEncVidParams.width << "x" << mEncVidParams.height
+        << "|" << mEncVidParams.frameRate.num << "/" << mEncVidParams.frameRate.den << "|" << mEncVidParams.bitRate << "|" << endFrame-startFrame;
+    for (auto& opt : mEncVidParams.extraOpts)
+        oss << "|" << opt.name << "=" << opt.value;
+    return ComposeSegmentFingerprint(oss.str(), segStart, segEnd, mEncClipSnapshots, mEncOverlapSnapshots);
+}
+
+std::string TimeLine::_GetTwoPassStatsPath(int64_t startFrame, int64_t endFrame)
+{
+    // a segment with the same fingerprint as in the last export skips the first pass. The fingerprint covers the
+    // overlap transitions since 'tp2', the stats named by the older fingerprints are never reused and get trimmed.
+    const auto fileName = "tp2-" + _GetSegmentFingerprint(startFrame, endFrame) + ".log";
+    if (!IsProjectDirReady())
+        return mEncOutputPath + "." + fileName;
+    const auto statsDir = SysUtils::JoinPath(mhProject->GetProjectDir(), "twopass");
+    if (!SysUtils::Exists(statsDir))
+        SysUtils::CreateDirectoryAt(statsDir, true);
+    return SysUtils::JoinPath(statsDir, fileName);
+}
+
+bool TimeLine::_EncodeAudioOnly(MediaCore::MediaEncoder::Holder hEncoder, int64_t startTimeOffset, std::string& errMsg)
+{
+    mEncMtaReader->SeekTo(mEncodingStart);
+    ImGui::ImMat amat;
+    int64_t audpos = 0;
+    while (!mQuitEncoding)
+    {
+        bool eof = false;
+        if (!mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
+        {
+            errMsg = "[audio] '" + mEncMtaReader->GetError() + "'.";
+            return false;
+        }
+        if (audpos > mEncodingEnd || eof || amat.empty())
+            break;
+        audpos = amat.time_stamp * 1000;
+        amat.time_stamp = (double)(audpos-startTimeOffset)/1000.;
+        bool consumed = false;
+        if (!hEncoder->EncodeAudioSamples(amat, consumed))
+        {
+            errMsg = "[audio] '" + hEncoder->GetError() + "'.";
+            return false;
+        }
+        amat.release();
+    }
+    amat.release();
+    bool consumed = false;
+    if (!hEncoder->EncodeAudioSamples(amat, consumed))
+    {
+        errMsg = "[audio] '" + hEncoder->GetError() + "'.";
+        return false;
+    }
+    return true;
+}
+
+// The transform filter doesn't change the source image if it has the default settings and no key frame
+static bool IsIdentityTransform(MediaCore::VideoTransformFilter::Holder hTransFilter)
+{
+    if (!hTransFilter)
+        return true;
+    if (hTransFilter->IsKeyFramesEnabledOnPosOffset() || hTransFilter->IsKeyFramesEnabledOnCrop() || hTransFilter->IsKeyFramesEnabledOnScale() ||
+        hTransFilter->IsKeyFramesEnabledOnRotation() || hTransFilter->IsKeyFramesEnabledOnOpacity())
+        return false;
+    if (hTransFilter->GetPosOffsetX() != 0 || hTransFilter->GetPosOffsetY() != 0)
+        return false;
+    if (hTransFilter->GetCropL() != 0 || hTransFilter->GetCropT() != 0 || hTransFilter->GetCropR() != 0 || hTransFilter->GetCropB() != 0)
+        return false;
+    if (fabs(hTransFilter->GetScaleX()-1.f) > 1e-4f || fabs(hTransFilter->GetScaleY()-1.f) > 1e-4f)
+        return false;
+    if (fabs(fmod(hTransFilter->GetRotation(), 360.f)) > 1e-3f)
+        return false;
+    if (hTransFilter->GetOpacity() < 1.f || hTransFilter->GetOpacityMaskCount() > 0)
+        return false;
+    return true;
+}
+
+// Set the profile and level of a source media to the encoder options, so the re-encoded segments have the same codec
+// parameters as the ranges copied from the source. The profile names of the parser are like 'High 4:2:2', the encoders
+// take them as 'high422'.
+static void SetSourceCodecOptions(const MediaCore::SegmentMuxer::VideoCodecInfo& srcCodecInfo, const std::string& encoderName,
+        std::vector<MediaCore::MediaEncoder::Option>& extraOpts)
+{
+    std::vector<MediaCore::MediaEncoder::Description> encDescList;
+    if (!MediaCore::MediaEncoder::FindEncoder(srcCodecInfo.codecName, encDescList))
+        return;
+    auto encIter = std::find_if(encDescList.begin(), encDescList.end(), [&encoderName] (const MediaCore::MediaEncoder::Description& encDesc) {
+        return encDesc.codecName == encoderName;
+    });
+    if (encIter == encDescList.end())
+        return;
+    auto setOption = [&] (const std::string& name, const std::string& value) {
+        auto& optDescList = encIter->optDescList;
+        if (std::none_of(optDescList.begin(), optDescList.end(), [&name] (const MediaCore::MediaEncoder::Option::Description& optDesc) { return optDesc.name == name; }))
+            return;
+        auto optIter = std::find_if(extraOpts.begin(), extraOpts.end(), [&name] (const MediaCore::MediaEncoder::Option& opt) { return opt.name == name; });
+        if (optIter != extraOpts.end())
+            optIter->value = MediaCore::Value(value);
+        else
+            extraOpts.push_back({name, MediaCore::Value(value)});
+    };
+    if (!srcCodecInfo.profileName.empty())
+    {
+        std::string profile;
+        for (auto c : srcCodecInfo.profileName)
+        {
+            if (std::isalnum((unsigned char)c))
+                profile.push_back((char)std::tolower((unsigned char)c));
+        }
+        // the constrained profiles are produced by the encoders with the base profile names
+        if (profile.compare(0, 11, "constrained") == 0)
+            profile = profile.substr(11);
+        auto pos = profile.find("predictive");
+        if (pos != std::string::npos)
+            profile.erase(pos);
+        setOption("profile", profile);
+    }
+    if (srcCodecInfo.codecName == "h264" && srcCodecInfo.level > 0)
+    {
+        std::ostringstream oss;
+        oss << srcCodecInfo.level/10 << "." << srcCodecInfo.level%10;
+        setOption("level", oss.str());
+    }
+}
+
+std::vector<TimeLine::StreamCopyRange> TimeLine::_FindStreamCopyRanges(int64_t startFrame, int64_t endFrame)
+{
+    std::vector<StreamCopyRange> copyRanges;
+    const int64_t exportStart = mEncMtvReader->FrameIndexToMillsec(startFrame);
+    const int64_t exportEnd = mEncMtvReader->FrameIndexToMillsec(endFrame);
+    // a copied range must be long enough to cover the cost of the extra segment
+    const int64_t minCopyFrames = 25;
+    // finding a closed GOP opens the source once for every key frame, give up after a few open ones
+    const int maxGopChecks = 4;
+    auto hMuxer = MediaCore::SegmentMuxer::CreateInstance();
+    // the re-encoded segments can only be joined with the sources of the same codec as the export encoder
+    std::map<std::string, bool> codecMatched;
+    std::map<std::string, MediaCore::SegmentMuxer::VideoCodecInfo> codecInfos;
+    auto isCodecMatched = [&] (const std::string& url) {
+        auto iter = codecMatched.find(url);
+        if (iter != codecMatched.end())
+            return iter->second;
+        bool matched = false;
+        MediaCore::SegmentMuxer::VideoCodecInfo codecInfo;
+        std::vector<MediaCore::MediaEncoder::Description> encDescList;
+        if (hMuxer->GetVideoCodecInfo(url, codecInfo) && MediaCore::MediaEncoder::FindEncoder(codecInfo.codecName, encDescList))
+        {
+            matched = std::any_of(encDescList.begin(), encDescList.end(), [this] (const MediaCore::MediaEncoder::Description& encDesc) {
+                return encDesc.codecName == mEncVidParams.codecName;
+            });
+        }
+        if (!matched)
+            Logger::Log(Logger::DEBUG) << "Source '" << url << "' (" << codecInfo.codecName << ") is not copied, it isn't encoded by '" << mEncVidParams.codecName << "'." << std::endl;
+        codecMatched[url] = matched;
+        codecInfos[url] = codecInfo;
+        return matched;
+    };
+
+    // every time range which has visible content
+    std::vector<MediaCore::VideoClip::Holder> visibleClips;
+    std::vector<std::pair<int64_t, int64_t>> occupiedRanges;
+    for (auto trackIter = mEncMtvReader->TrackListBegin(); trackIter != mEncMtvReader->TrackListEnd(); trackIter++)
+    {
+        auto& hTrack = *trackIter;
+        if (!hTrack->IsVisible())
+            continue;
+        for (auto& hClip : hTrack->GetClipList())
+        {
+            visibleClips.push_back(hClip);
+            occupiedRanges.push_back({hClip->Start(), hClip->End()});
+        }
+    }
+    for (auto& clip : mEncClipSnapshots)
+    {
+        if (clip.isText)
+            occupiedRanges.push_back({clip.start, clip.end});
+    }
+
+    for (size_t i = 0; i < visibleClips.size(); i++)
+    {
+        auto& hClip = visibleClips[i];
+        // only the clips showing the source image as it is can be copied
+        if (hClip->IsImage() || hClip->SrcWidth() != mEncVidParams.width || hClip->SrcHeight() != mEncVidParams.height)
+            continue;
+        auto hParser = hClip->GetMediaParser();
+        const MediaCore::VideoStream* vidStream = hParser ? hParser->GetBestVideoStream() : nullptr;
+        if (!vidStream || vidStream->displayRotation != 0 || vidStream->timebase.den <= 0 ||
+            (int64_t)vidStream->avgFrameRate.num*mEncVidParams.frameRate.den != (int64_t)mEncVidParams.frameRate.num*vidStream->avgFrameRate.den)
+            continue;
+        auto hFilter = hClip->GetFilter();
+        auto pEventStack = dynamic_cast<MEC::VideoEventStackFilter*>(hFilter.get());
+        if ((hFilter && !pEventStack) || (pEventStack && !pEventStack->GetEventList().empty()))
+            continue;
+        if (!IsIdentityTransform(hClip->GetTransformFilter()))
+            continue;
+
+        // the ranges where this clip is the only visible content
+        std::vector<std::pair<int64_t, int64_t>> exclusiveRanges;
+        exclusiveRanges.push_back({std::max(hClip->Start(), exportStart), std::min(hClip->End(), exportEnd)});
+        for (size_t j = 0; j < occupiedRanges.size(); j++)
+        {
+            if (j == i)
+                continue;
+            const auto& occupied = occupiedRanges[j];
+            std::vector<std::pair<int64_t, int64_t>> remainRanges;
+            for (auto& range : exclusiveRanges)
+            {
+                if (occupied.first > range.first)
+                    remainRanges.push_back({range.first, std::min(range.second, occupied.first)});
+                if (occupied.second < range.second)
+                    remainRanges.push_back({std::max(range.first, occupied.second), range.second});
+            }
+            exclusiveRanges.clear();
+            for (auto& range : remainRanges)
+            {
+                if (range.second > range.first)
+                    exclusiveRanges.push_back(range);
+            }
+        }
+        if (exclusiveRanges.empty())
+            continue;
+
+        // copying starts and stops at key frames, the frames around them are re-encoded
+        hParser->EnableParseInfo(MediaCore::MediaParser::VIDEO_SEEK_POINTS);
+        auto hSeekPoints = hParser->GetVideoSeekPoints();
+        if (!hSeekPoints || hSeekPoints->empty() || !isCodecMatched(hParser->GetUrl()))
+            continue;
+        std::vector<int64_t> keyFrameTimes;
+        keyFrameTimes.reserve(hSeekPoints->size());
+        for (auto pts : *hSeekPoints)
+        {
+            if (pts >= vidStream->startPts)
+                keyFrameTimes.push_back((pts-vidStream->startPts)*1000*vidStream->timebase.num/vidStream->timebase.den);
+        }
+        const int64_t clipOffset = hClip->StartOffset()-hClip->Start();
+        for (auto& range : exclusiveRanges)
+        {
+            const int64_t srcRangeStart = range.first+clipOffset;
+            const int64_t srcRangeEnd = range.second+clipOffset;
+            // the packets are cut by the presentation time, so the range must start and stop at closed GOPs,
+            // otherwise the leading frames of an open GOP are lost
+            auto iter = std::lower_bound(keyFrameTimes.begin(), keyFrameTimes.end(), srcRangeStart);
+            for (int n = 0; iter != keyFrameTimes.end() && *iter < srcRangeEnd && !hMuxer->IsClosedGopAt(hParser->GetUrl(), *iter); n++)
+                iter = n+1 < maxGopChecks ? iter+1 : keyFrameTimes.end();
+            if (iter == keyFrameTimes.end() || *iter >= srcRangeEnd)
+                continue;
+            const int64_t srcStart = *iter;
+            // copy to the media end if the clip is not trimmed at the tail, otherwise stop at the last key frame
+            int64_t srcEnd = -1;
+            int64_t tlEnd = range.second;
+            if (range.second != hClip->End() || hClip->EndOffset() != 0)
+            {
+                auto endIter = std::upper_bound(keyFrameTimes.begin(), keyFrameTimes.end(), srcRangeEnd);
+                for (int n = 0; endIter != keyFrameTimes.begin() && *(endIter-1) > srcStart && !hMuxer->IsClosedGopAt(hParser->GetUrl(), *(endIter-1)); n++)
+                    endIter = n+1 < maxGopChecks ? endIter-1 : keyFrameTimes.begin();
+                if (endIter == keyFrameTimes.begin() || *(endIter-1) <= srcStart)
+                    continue;
+                srcEnd = *(endIter-1);
+                tlEnd = srcEnd-clipOffset;
+            }
+            StreamCopyRange copyRange;
+            copyRange.startFrame = std::max(mEncMtvReader->MillsecToFrameIndex(srcStart-clipOffset, 1), startFrame);
+            copyRange.endFrame = std::min(mEncMtvReader->MillsecToFrameIndex(tlEnd, 1), endFrame);
+            if (copyRange.endFrame-copyRange.startFrame < minCopyFrames)
+                continue;
+            copyRange.url = hParser->GetUrl();
+            copyRange.srcStart = srcStart;
+            copyRange.srcEnd = srcEnd;
+            copyRange.codecInfo = codecInfos[copyRange.url];
+            copyRanges.push_back(copyRange);
+        }
+    }
+    std::sort(copyRanges.begin(), copyRanges.end(), [] (const StreamCopyRange& a, const StreamCopyRange& b) {
+        return a.startFrame < b.startFrame;
+    });
+    return copyRanges;
+}
+
+void TimeLine::_EncodeSegmentedProc()
+{
+    Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter segmented encoding proc >>>>>>>>>>>>" << std::endl;
+
+    const int64_t startFrame = mEncMtvReader->MillsecToFrameIndex(mEncodingStart);
+    const int64_t startTimeOffset = mEncMtvReader->FrameIndexToMillsec(startFrame);
+    int64_t endFrame = mEncMtvReader->MillsecToFrameIndex(mEncodingEnd);
+    while (endFrame > startFrame && mEncMtvReader->FrameIndexToMillsec(endFrame-1) >= mEncodingEnd)
+        endFrame--;
+    while (mEncMtvReader->FrameIndexToMillsec(endFrame) < mEncodingEnd)
+        endFrame++;
+    const int64_t totalFrames = endFrame-startFrame;
+
+    // every segment is encoded by a new encoder, so it starts with a key frame and no GOP crosses the boundaries
+    const int64_t minSegmentFrames = 50;
+    const int64_t maxWorkers = bSegmentedExport ? GetExportSegmentCount() : 1;
+    int64_t segCount = maxWorkers;
+    if (segCount > totalFrames/minSegmentFrames)
+        segCount = totalFrames/minSegmentFrames > 0 ? totalFrames/minSegmentFrames : 1;
+    int64_t segFrames = (totalFrames+segCount-1)/segCount;
+    const std::string extName = SysUtils::ExtractFileExtName(mEncOutputPath);
+
+    // resumable export keeps the finished segments in a directory next to the output file. They are listed in
+    // a manifest by their fingerprints, so an export restarted with the same settings and content skips them.
+    const bool resumable = bResumableExport;
+    const std::string chunkDir = mEncOutputPath + ".chunks";
+    const std::string manifestPath = SysUtils::JoinPath(chunkDir, "manifest.json");
+    imgui_json::value jnChunks {imgui_json::type_t::object};
+    std::mutex manifestLock;
+    if (resumable)
+    {
+        // the segments lie on a fixed grid of the timeline frames, neither the export range nor its length moves the
+        // boundaries, so an export of another range reuses the chunks it has in common with the previous one
+        segFrames = std::max(mEncMtvReader->MillsecToFrameIndex(30000), minSegmentFrames);
+        if (!SysUtils::Exists(chunkDir))
+            SysUtils::CreateDirectoryAt(chunkDir, true);
+        auto res = imgui_json::value::load(manifestPath);
+        if (res.second && res.first.contains("chunks") && res.first["chunks"].is_object())
+            jnChunks = res.first["chunks"];
+    }
+    auto saveManifest = [&] () {
+        // write a new file then replace the old one, a crash while saving loses at most the manifest, not the chunks
+        imgui_json::value jnManifest;
+        jnManifest["output"] = imgui_json::string(mEncOutputPath);
+        jnManifest["chunks"] = jnChunks;
+        const auto tmpPath = manifestPath + ".tmp";
+        if (!jnManifest.save(tmpPath))
+        {
+            Logger::Log(Logger::WARN) << "FAILED to save the export manifest '" << tmpPath << "'!" << std::endl;
+            return;
+        }
+        SysUtils::DeleteFileAt(manifestPath);
+        SysUtils::RenameFile(tmpPath, manifestPath);
+    };
+
+    std::vector<MediaCore::SegmentMuxer::Segment> segments;
+    std::vector<int64_t> segStartFrames, segEndFrames;
+    std::vector<std::string> segKeys;
+    auto getSegmentPath = [&] (size_t segIdx) {
+        if (resumable)
+            return SysUtils::JoinPath(chunkDir, segKeys[segIdx] + extName);
+        std::ostringstream oss;
+        oss << mEncOutputPath << ".seg" << segIdx << extName;
+        return oss.str();
+    };
+    auto addEncodedSegments = [&] (int64_t fromFrame, int64_t toFrame) {
+        int64_t f = fromFrame;
+        while (f < toFrame)
+        {
+            int64_t segEnd = resumable ? (f/segFrames+1)*segFrames : f+segFrames;
+            if (segEnd > toFrame)
+                segEnd = toFrame;
+            segStartFrames.push_back(f);
+            segEndFrames.push_back(segEnd);
+            segKeys.push_back(resumable ? _GetSegmentFingerprint(f, segEnd) : std::string());
+            segments.push_back({getSegmentPath(segments.size()), mEncMtvReader->FrameIndexToMillsec(f)-startTimeOffset});
+            f = segEnd;
+        }
+    };
+    // smart render, the untouched source ranges are copied from the source files
+    std::vector<StreamCopyRange> copyRanges;
+    if (bSmartRender)
+        copyRanges = _FindStreamCopyRanges(startFrame, endFrame);
+    // all the segments are joined into one stream, the sources with other profiles or pixel formats than the first one are re-encoded
+    const std::vector<MediaCore::MediaEncoder::Option> userExtraOpts = mEncVidParams.extraOpts;
+    if (!copyRanges.empty())
+    {
+        const auto refCodecInfo = copyRanges[0].codecInfo;
+        copyRanges.erase(std::remove_if(copyRanges.begin(), copyRanges.end(), [&refCodecInfo] (const StreamCopyRange& range) {
+            return range.codecInfo.profileName != refCodecInfo.profileName || range.codecInfo.level != refCodecInfo.level ||
+                range.codecInfo.pixelFormat != refCodecInfo.pixelFormat;
+        }), copyRanges.end());
+        SetSourceCodecOptions(refCodecInfo, mEncVidParams.codecName, mEncVidParams.extraOpts);
+    }
+    int64_t nextFrame = startFrame;
+    for (auto& range : copyRanges)
+    {
+        addEncodedSegments(nextFrame, range.startFrame);
+        MediaCore::SegmentMuxer::Segment seg {range.url, mEncMtvReader->FrameIndexToMillsec(range.startFrame)-startTimeOffset, range.srcStart, range.srcEnd};
+        segments.push_back(seg);
+        segStartFrames.push_back(range.startFrame);
+        segEndFrames.push_back(range.endFrame);
+        segKeys.push_back(resumable ? _GetSegmentFingerprint(range.startFrame, range.endFrame) : std::string());
+        nextFrame = range.endFrame;
+    }
+    addEncodedSegments(nextFrame, endFrame);
+    Logger::Log(Logger::DEBUG) << "Segmented export: " << totalFrames << " frames in " << segments.size() << " segments, "
+            << copyRanges.size() << " of them are copied from the source." << std::endl;
+
+    auto hMuxer = MediaCore::SegmentMuxer::CreateInstance();
+    {
+        std::lock_guard<std::mutex> lk(mEncodingMutex);
+        mSegmentMuxer = hMuxer;
+    }
+    std::vector<size_t> encodeJobs, copiedSegs;
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (segments[i].copyStart >= 0)
+            copiedSegs.push_back(i);
+        else
+            encodeJobs.push_back(i);
+    }
+    auto reencodeCopiedSegments = [&] () {
+        for (auto i : copiedSegs)
+        {
+            segments[i] = {getSegmentPath(i), segments[i].startTime};
+            encodeJobs.push_back(i);
+        }
+        copiedSegs.clear();
+    };
+    // check the copied ranges together with a few frames encoded by the segment settings before encoding the whole
+    // export, the sources which can't be joined with the re-encoded segments are not worth trying
+    if (!copiedSegs.empty())
+    {
+        std::vector<MediaCore::SegmentMuxer::Segment> checkSegments;
+        std::string probePath;
+        bool compatible = true;
+        if (!encodeJobs.empty())
+        {
+            const size_t i = encodeJobs[0];
+            probePath = mEncOutputPath + ".probe" + extName;
+            std::atomic<int64_t> probeFrames {0};
+            std::atomic_bool probeAbort {false};
+            std::string probeErrMsg;
+            if (_EncodeVideoSegment(mEncMtvReader, probePath, segStartFrames[i], std::min(segStartFrames[i]+2, segEndFrames[i]), probeFrames, probeAbort, probeErrMsg))
+                checkSegments.push_back({probePath, 0});
+            else if (!mQuitEncoding)
+            {
+                Logger::Log(Logger::WARN) << "Smart render is disabled: FAILED to encode with the codec options of the source! " << probeErrMsg << std::endl;
+                std::lock_guard<std::mutex> lk(mEncodingMutex);
+                mSmartRenderNote = "FAILED to encode with the codec options of the source. " + probeErrMsg;
+                compatible = false;
+            }
+        }
+        for (auto i : copiedSegs)
+            checkSegments.push_back(segments[i]);
+        if (compatible && checkSegments.size() > 1 && !hMuxer->IsStreamCopyCompatible(checkSegments))
+        {
+            Logger::Log(Logger::WARN) << "Smart render is disabled: " << hMuxer->GetError() << std::endl;
+            std::lock_guard<std::mutex> lk(mEncodingMutex);
+            mSmartRenderNote = hMuxer->GetError();
+            compatible = false;
+        }
+        if (!probePath.empty())
+            SysUtils::DeleteFileAt(probePath);
+        if (!compatible)
+        {
+            // the fingerprints depend on the encoder options
+            mEncVidParams.extraOpts = userExtraOpts;
+            for (size_t i = 0; resumable && i < segments.size(); i++)
+            {
+                segKeys[i] = _GetSegmentFingerprint(segStartFrames[i], segEndFrames[i]);
+                if (segments[i].copyStart < 0)
+                    segments[i].path = getSegmentPath(i);
+            }
+            reencodeCopiedSegments();
+        }
+    }
+
+    // a chunk is reused only if it's the file recorded in the manifest and it has the expected duration
+    std::vector<bool> chunkDone(segments.size(), false);
+    auto isChunkValid = [&] (size_t i) {
+        if (!jnChunks.contains(segKeys[i]))
+            return false;
+        auto& jnChunk = jnChunks[segKeys[i]];
+        if (!jnChunk.contains("size") || !jnChunk["size"].is_number() || !jnChunk.contains("frames") || !jnChunk["frames"].is_number())
+            return false;
+        std::ifstream ifs(segments[i].path, std::ios::binary|std::ios::ate);
+        if (!ifs.is_open() || (int64_t)ifs.tellg() != (int64_t)jnChunk["size"].get<imgui_json::number>() ||
+            (int64_t)jnChunk["frames"].get<imgui_json::number>() != segEndFrames[i]-segStartFrames[i])
+            return false;
+        auto hParser = MediaCore::MediaParser::CreateInstance();
+        if (!hParser->Open(segments[i].path))
+            return false;
+        const auto vidStream = hParser->GetBestVideoStream();
+        if (!vidStream)
+            return false;
+        const int64_t expectedDur = mEncMtvReader->FrameIndexToMillsec(segEndFrames[i])-mEncMtvReader->FrameIndexToMillsec(segStartFrames[i]);
+        const int64_t tolerance = mEncMtvReader->FrameIndexToMillsec(segStartFrames[i]+2)-mEncMtvReader->FrameIndexToMillsec(segStartFrames[i]);
+        return std::abs((int64_t)(vidStream->duration*1000)-expectedDur) <= tolerance;
+    };
+    auto recordChunk = [&] (size_t i) {
+        std::ifstream ifs(segments[i].path, std::ios::binary|std::ios::ate);
+        if (!ifs.is_open())
+            return;
+        imgui_json::value jnChunk;
+        jnChunk["size"] = imgui_json::number((int64_t)ifs.tellg());
+        jnChunk["frames"] = imgui_json::number(segEndFrames[i]-segStartFrames[i]);
+        std::lock_guard<std::mutex> lk(manifestLock);
+        chunkDone[i] = true;
+        jnChunks[segKeys[i]] = jnChunk;
+        saveManifest();
+    };
+    if (resumable)
+    {
+        // drop the chunks which are not part of this export any more, such as the ones of the edited clips
+        imgui_json::value jnValidChunks {imgui_json::type_t::object};
+        std::vector<size_t> remainJobs;
+        for (auto i : encodeJobs)
+        {
+            if (isChunkValid(i))
+            {
+                chunkDone[i] = true;
+                jnValidChunks[segKeys[i]] = jnChunks[segKeys[i]];
+            }
+            else
+                remainJobs.push_back(i);
+        }
+        for (auto& item : jnChunks.get<imgui_json::object>())
+        {
+            if (!jnValidChunks.contains(item.first))
+                SysUtils::DeleteFileAt(SysUtils::JoinPath(chunkDir, item.first + extName));
+        }
+        jnChunks = jnValidChunks;
+        saveManifest();
+        Logger::Log(Logger::DEBUG) << "Resumable export: " << encodeJobs.size()-remainJobs.size() << " of " << encodeJobs.size()
+                << " segments are reused from '" << chunkDir << "'." << std::endl;
+        encodeJobs = remainJobs;
+    }
+
+    std::atomic<int64_t> encodedFrames {0};
+    int64_t framesToEncode = 0;
+    std::atomic_bool abort {false};
+    std::vector<std::string> errMsgs(segments.size());
+
+    // audio is cheap to encode, it's done once along with the video segments
+    std::string audioPath, audioErrMsg;
+    std::thread audioThread;
+    if (mEncMtaReader)
+    {
+        audioPath = mEncOutputPath + ".audio" + extName;
+        audioThread = std::thread([this, startTimeOffset, &audioPath, &abort, &audioErrMsg] () {
+            if (bNormalizeLoudness)
+                _ApplyLoudnessNormalization();
+            auto hAudEncoder = MediaCore::MediaEncoder::CreateInstance();
+            std::string sampleFormat = mEncAudParams.sampleFormat;
+            if (!hAudEncoder->Open(audioPath) ||
+                !hAudEncoder->ConfigureAudioStream(mEncAudParams.codecName, sampleFormat, mEncAudParams.channels, mEncAudParams.sampleRate, mEncAudParams.bitRate) ||
+                !hAudEncoder->Start())
+                audioErrMsg = "[audio] '" + hAudEncoder->GetError() + "'.";
+            else
+            {
+                _EncodeAudioOnly(hAudEncoder, startTimeOffset, audioErrMsg);
+                if (!hAudEncoder->FinishEncoding() && audioErrMsg.empty())
+                    audioErrMsg = "[audio] '" + hAudEncoder->GetError() + "'.";
+            }
+            hAudEncoder->Close();
+            if (!audioErrMsg.empty())
+                abort = true;
+        });
+        SysUtils::SetThreadName(audioThread, "TL-EncSegAud");
+    }
+
+    // the segments are encoded by at most 'maxWorkers' threads, each one with its own video reader
+    std::vector<std::string> statsPaths(segments.size());
+    std::vector<std::string> tempStatsPaths;
+    auto runEncodeJobs = [&] () {
+        if (encodeJobs.empty())
+            return;
+        for (auto i : encodeJobs)
+        {
+            framesToEncode += segEndFrames[i]-segStartFrames[i];
+            if (!bTwoPassExport)
+                continue;
+            statsPaths[i] = _GetTwoPassStatsPath(segStartFrames[i], segEndFrames[i]);
+            if (!IsProjectDirReady())
+                tempStatsPaths.push_back(statsPaths[i]);
+            if (!SysUtils::Exists(statsPaths[i]))
+                framesToEncode += segEndFrames[i]-segStartFrames[i];
+        }
+        std::atomic<size_t> nextJob {0};
+        std::atomic<int> finishedWorkers {0};
+        std::vector<std::thread> workers;
+        const size_t workerCount = (size_t)maxWorkers < encodeJobs.size() ? (size_t)maxWorkers : encodeJobs.size();
+        for (size_t w = 0; w < workerCount; w++)
+        {
+            // clone from the reader taken when the export started, the preview reader follows the later edits
+            auto hReader = w == 0 ? mEncMtvReader : mEncMtvReader->CloneAndConfigure(mEncVidParams.width, mEncVidParams.height, mEncVidParams.frameRate);
+            workers.push_back(std::thread([&, hReader] () {
+                size_t jobIdx;
+                while (!abort && !mQuitEncoding && (jobIdx = nextJob++) < encodeJobs.size())
+                {
+                    const size_t i = encodeJobs[jobIdx];
+                    if (!hReader)
+                        errMsgs[i] = "[video] FAILED to clone the video reader!";
+                    if (!hReader)
+                        abort = true;
+                    else if (statsPaths[i].empty())
+                    {
+                        if (!_EncodeVideoSegment(hReader, segments[i].path, segStartFrames[i], segEndFrames[i], encodedFrames, abort, errMsgs[i]))
+                            abort = true;
+                        else if (resumable)
+                            recordChunk(i);
+                    }
+                    else
+                    {
+                        // the first pass only produces the statistics, its video packets are discarded by the encoder
+                        bool passOk = true;
+                        if (!SysUtils::Exists(statsPaths[i]))
+                        {
+                            passOk = _EncodeVideoSegment(hReader, segments[i].path, segStartFrames[i], segEndFrames[i], encodedFrames, abort, errMsgs[i], 1, statsPaths[i]);
+                            if (!passOk || abort || mQuitEncoding)
+                            {
+                                SysUtils::DeleteFileAt(statsPaths[i]);
+                                SysUtils::DeleteFileAt(statsPaths[i] + ".mbtree");
+                            }
+                        }
+                        if (!passOk || abort || mQuitEncoding ||
+                            !_EncodeVideoSegment(hReader, segments[i].path, segStartFrames[i], segEndFrames[i], encodedFrames, abort, errMsgs[i], 2, statsPaths[i]))
+                            abort = true;
+                        else if (resumable)
+                            recordChunk(i);
+                    }
+                }
+                finishedWorkers++;
+            }));
+            SysUtils::SetThreadName(workers.back(), "TL-EncSeg" + std::to_string(w));
+        }
+        // encoding takes 90% of the progress and muxing the last 10%
+        while (finishedWorkers < (int)workers.size())
+        {
+            mEncodingProgress = framesToEncode > 0 ? 0.9f*(float)encodedFrames/framesToEncode : 0.f;
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        for (auto& t : workers)
+            t.join();
+        encodeJobs.clear();
+    };
+    auto collectError = [&] () {
+        for (auto& errMsg : errMsgs)
+        {
+            if (!errMsg.empty())
+            {
+                mEncodeProcErrMsg = errMsg;
+                return;
+            }
+        }
+    };
+
+    runEncodeJobs();
+    collectError();
+    // the re-encoded segments must have the same codec parameters as the copied ones
+    if (!mQuitEncoding && mEncodeProcErrMsg.empty() && !copiedSegs.empty() && segments.size() > 1 && !hMuxer->IsStreamCopyCompatible(segments))
+    {
+        Logger::Log(Logger::WARN) << "Smart render falls back to re-encoding: " << hMuxer->GetError() << std::endl;
+        {
+            std::lock_guard<std::mutex> lk(mEncodingMutex);
+            mSmartRenderNote = hMuxer->GetError();
+        }
+        reencodeCopiedSegments();
+        runEncodeJobs();
+        collectError();
+    }
+    if (audioThread.joinable())
+        audioThread.join();
+    if (mEncodeProcErrMsg.empty())
+        mEncodeProcErrMsg = audioErrMsg;
+
+    if (!mQuitEncoding && mEncodeProcErrMsg.empty())
+    {
+        std::atomic_bool muxDone {false};
+        bool muxOk = false;
+        std::thread muxThread([&] () {
+            muxOk = hMuxer->Mux(mEncOutputPath, segments, audioPath);
+            muxDone = true;
+        });
+        while (!muxDone)
+        {
+            mEncodingProgress = 0.9f+0.1f*hMuxer->GetProgress();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+        muxThread.join();
+        if (!muxOk && !mQuitEncoding)
+            mEncodeProcErrMsg = "[mux] '" + hMuxer->GetError() + "'.";
+    }
+    {
+        std::lock_guard<std::mutex> lk(mEncodingMutex);
+        mSegmentMuxer = nullptr;
+    }
+
+    // the copied segments refer to the source files, only remove the temporary ones. The finished chunks of
+    // a resumable export are kept until the output is written.
+    const bool exportDone = !mQuitEncoding && mEncodeProcErrMsg.empty();
+    if (resumable && exportDone)
+        SysUtils::DeleteDirectoryAt(chunkDir);
+    for (size_t i = 0; i < segments.size(); i++)
+    {
+        if (segments[i].copyStart < 0 && !(resumable && (exportDone || chunkDone[i])))
+            SysUtils::DeleteFileAt(segments[i].path);
+    }
+    if (!audioPath.empty())
+        SysUtils::DeleteFileAt(audioPath);
+    // without a project directory the statistics can't be reused
+    for (auto& statsPath : tempStatsPaths)
+    {
+        SysUtils::DeleteFileAt(statsPath);
+        SysUtils::DeleteFileAt(statsPath + ".mbtree");
+    }
+    // the statistics kept in the project are reused by the next exports, only the least recently written ones are removed
+    if (bTwoPassExport && IsProjectDirReady())
+    {
+        const uint64_t maxStatsDirSize = 512*1024*1024;
+        std::vector<std::string> keepPaths;
+        for (auto& statsPath : statsPaths)
+        {
+            if (statsPath.empty())
+                continue;
+            keepPaths.push_back(statsPath);
+            keepPaths.push_back(statsPath + ".mbtree");
+            SysUtils::TouchFile(statsPath);
+            SysUtils::TouchFile(statsPath + ".mbtree");
+        }
+        SysUtils::TrimDirectory(SysUtils::JoinPath(mhProject->GetProjectDir(), "twopass"), maxStatsDirSize, "", keepPaths);
+    }
+    if (!mQuitEncoding && mEncodeProcErrMsg.empty())
+        mEncodingProgress = 1;
+    mIsEncoding = false;
+    Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit segmented encoding proc <<<<<<<<<<<<<<<<" << std::endl;
+}
+
+bool TimeLine::AddExportJob(const std::string& outputPath, const VideoEncoderParams& vidEncParams, const AudioEncoderParams& audEncParams, std::string& errMsg)
+{
+    if (!vidEncParams.encodeVideo && !audEncParams.encodeAudio)
+    {
+        errMsg = "At least one video or audio stream is going to be encoded!";
+        return false;
+    }
+    auto hJob = std::make_shared<ExportJob>();
+    hJob->outputPath = outputPath;
+    hJob->vidParams = vidEncParams;
+    hJob->audParams = audEncParams;
+    ValidDuration();
+    hJob->startTime = mEncodingStart;
+    hJob->endTime = mEncodingEnd;
+    // rough estimation: a software encoder takes about 2 cores for 1080p30, it holds about 40 yuv420 frames
+    // for the lookahead and the references, and 8 rgba frames are queued in front of it
+    if (vidEncParams.encodeVideo)
+    {
+        const double frameRate = vidEncParams.frameRate.den > 0 ? (double)vidEncParams.frameRate.num/vidEncParams.frameRate.den : 25.;
+        const double pixelRate = (double)vidEncParams.width*vidEncParams.height*frameRate;
+        hJob->cpuCost = (int)ceil(pixelRate/(1920.*1080.*30.)*2.);
+        const int64_t pixels = (int64_t)vidEncParams.width*vidEncParams.height;
+        hJob->memCostMB = (pixels*3/2*40+pixels*4*8)/(1024*1024);
+    }
+    if (audEncParams.encodeAudio)
+    {
+        if (!vidEncParams.encodeVideo)
+            hJob->cpuCost = 1;
+        hJob->memCostMB += 16;
+    }
+
+    // the preview readers are edited by the ui thread, the render queue only reads the snapshot taken here
+    std::lock_guard<std::mutex> lk(mRenderQueueLock);
+    auto lastIter = std::find_if(mRenderQueue.rbegin(), mRenderQueue.rend(), [] (const ExportJob::Holder& hJob) {
+        return hJob->state == ExportJob::PENDING && hJob->hSnapshot;
+    });
+    ExportSnapshot::Holder hSnapshot = lastIter != mRenderQueue.rend() ? (*lastIter)->hSnapshot : nullptr;
+    if (hSnapshot && (hSnapshot->editRevision != mEditRevision || (vidEncParams.encodeVideo && !hSnapshot->hVidReader) ||
+        (audEncParams.encodeAudio && !hSnapshot->hAudReader)))
+        hSnapshot = nullptr;
+    if (!hSnapshot)
+    {
+        hSnapshot = std::make_shared<ExportSnapshot>();
+        hSnapshot->editRevision = mEditRevision;
+        if (vidEncParams.encodeVideo)
+        {
+            hSnapshot->hVidReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+            if (!hSnapshot->hVidReader)
+            {
+                errMsg = "FAILED to clone the video reader! Error is '" + mMtvReader->GetError() + "'.";
+                return false;
+            }
+        }
+        if (audEncParams.encodeAudio)
+        {
+            hSnapshot->hAudReader = mMtaReader->CloneAndConfigure(audEncParams.channels, audEncParams.sampleRate, audEncParams.sampleFormat, audEncParams.samplesPerFrame);
+            if (!hSnapshot->hAudReader)
+            {
+                errMsg = "FAILED to clone the audio reader! Error is '" + mMtaReader->GetError() + "'.";
+                return false;
+            }
+        }
+    }
+    hJob->hSnapshot = hSnapshot;
+    mRenderQueue.push_back(hJob);
+    mRenderQueueAddCount++;
+    mRenderQueueCv.notify_all();
+    return true;
+}
+
+void TimeLine::RemoveExportJob(ExportJob::Holder hJob)
+{
+    std::lock_guard<std::mutex> lk(mRenderQueueLock);
+    if (hJob->state == ExportJob::RUNNING)
+        return;
+    mRenderQueue.remove(hJob);
+}
+
+void TimeLine::StartRenderQueue()
+{
+    StopRenderQueue();
+    mQuitRenderQueue = false;
+    mIsRenderQueueRunning = true;
+    mRenderQueueThread = std::thread(&TimeLine::_RenderQueueProc, this);
+    SysUtils::SetThreadName(mRenderQueueThread, "TL-RenderQueue");
+}
+
+void TimeLine::StopRenderQueue()
+{
+    {
+        std::lock_guard<std::mutex> lk(mRenderQueueLock);
+        mQuitRenderQueue = true;
+    }
+    mRenderQueueCv.notify_all();
+    if (mRenderQueueThread.joinable())
+    {
+        mRenderQueueThread.join();
+        mRenderQueueThread = std::thread();
+    }
+    mIsRenderQueueRunning = false;
+}
+
+void TimeLine::_RenderQueueProc()
+{
+    Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter render queue proc >>>>>>>>>>>>" << std::endl;
+    const int cpuBudget = mRenderQueueCpuBudget > 0 ? mRenderQueueCpuBudget : std::max((int)std::thread::hardware_concurrency(), 1);
+    const int64_t memBudgetMB = mRenderQueueMemBudgetMB;
+    int usedCpu = 0;
+    int64_t usedMemMB = 0;
+    int runningGroups = 0;
+    std::list<std::thread> groupThreads;
+    std::unique_lock<std::mutex> lk(mRenderQueueLock);
+    while (!mQuitRenderQueue)
+    {
+        // pick the pending jobs in queue order while they fit in the budgets, a job larger than the budgets
+        // runs alone. Stop at the first one which doesn't fit, so a large job won't be starved by smaller ones.
+        std::vector<ExportJob::Holder> pickedJobs;
+        bool hasPending = false;
+        for (auto& hJob : mRenderQueue)
+        {
+            if (hJob->state != ExportJob::PENDING)
+                continue;
+            const bool isIdle = runningGroups == 0 && pickedJobs.empty();
+            if (!isIdle && (usedCpu+hJob->cpuCost > cpuBudget || usedMemMB+hJob->memCostMB > memBudgetMB))
+            {
+                hasPending = true;
+                break;
+            }
+            usedCpu += hJob->cpuCost;
+            usedMemMB += hJob->memCostMB;
+            hJob->state = ExportJob::RUNNING;
+            pickedJobs.push_back(hJob);
+        }
+        if (pickedJobs.empty() && !hasPending && runningGroups == 0)
+            break;
+
+        // group the jobs which can share one decoding pass, audio only jobs join any group with the same range
+        std::vector<std::vector<ExportJob::Holder>> groups;
+        for (auto& hJob : pickedJobs)
+        {
+            auto iter = std::find_if(groups.begin(), groups.end(), [&hJob] (const std::vector<ExportJob::Holder>& group) {
+                if (group[0]->hSnapshot != hJob->hSnapshot || group[0]->startTime != hJob->startTime || group[0]->endTime != hJob->endTime)
+                    return false;
+                if (!hJob->vidParams.encodeVideo)
+                    return true;
+                // the shared frames are scaled to every output size, so the outputs must have the same aspect ratio
+                for (auto& hMember : group)
+                {
+                    if (!hMember->vidParams.encodeVideo)
+                        continue;
+                    if (hMember->vidParams.frameRate.num != hJob->vidParams.frameRate.num || hMember->vidParams.frameRate.den != hJob->vidParams.frameRate.den)
+                        return false;
+                    if ((int64_t)hMember->vidParams.width*hJob->vidParams.height != (int64_t)hJob->vidParams.width*hMember->vidParams.height)
+                        return false;
+                }
+                return true;
+            });
+            if (iter != groups.end())
+                iter->push_back(hJob);
+            else
+                groups.push_back({hJob});
+        }
+        for (auto& group : groups)
+        {
+            runningGroups++;
+            groupThreads.push_back(std::thread([this, group, &usedCpu, &usedMemMB, &runningGroups] () {
+                _RenderExportJobGroup(group);
+                std::lock_guard<std::mutex> lk(mRenderQueueLock);
+                for (auto& hJob : group)
+                {
+                    usedCpu -= hJob->cpuCost;
+                    usedMemMB -= hJob->memCostMB;
+                    hJob->hSnapshot = nullptr;
+                }
+                runningGroups--;
+                mRenderQueueCv.notify_all();
+            }));
+            SysUtils::SetThreadName(groupThreads.back(), "TL-RenderJob");
+        }
+        // wait for a group to finish, the budgets it held can start the next jobs, or for a new job
+        const int prevRunningGroups = runningGroups;
+        const uint64_t prevAddCount = mRenderQueueAddCount;
+        mRenderQueueCv.wait(lk, [&] { return mQuitRenderQueue || runningGroups < prevRunningGroups || mRenderQueueAddCount != prevAddCount; });
     }
+    lk.unlock();
+    for (auto& t : groupThreads)
+        t.join();
+    mIsRenderQueueRunning = false;
+    Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit render queue proc <<<<<<<<<<<<<<<<" << std::endl;
+}
 
-    if (vidEncParams.encodeVideo)
+void TimeLine::_RenderExportJobGroup(std::vector<ExportJob::Holder> jobs)
+{
+    struct JobOutput
     {
-        // Video
-        if (!mEncoder->ConfigureVideoStream(
-            vidEncParams.codecName, vidEncParams.imageFormat, vidEncParams.width, vidEncParams.height,
-            vidEncParams.frameRate, vidEncParams.bitRate, &vidEncParams.extraOpts))
-        {
-            errMsg = mEncoder->GetError();
-            return false;
-        }
-        mEncMtvReader = mMtvReader->CloneAndConfigure(vidEncParams.width, vidEncParams.height, vidEncParams.frameRate);
+        ExportJob::Holder hJob;
+        MediaCore::MediaEncoder::Holder hEncoder;
+        int audReaderIdx {-1};
+        bool failed {false};
+    };
+    struct AudioInput
+    {
+        MediaCore::MultiTrackAudioReader::Holder hReader;
+        std::string sampleFormat;
+        uint32_t channels;
+        uint32_t sampleRate;
+        uint32_t samplesPerFrame;
+        int64_t audpos {0};
+        bool eof {false};
+    };
+    std::vector<JobOutput> outputs;
+    std::vector<AudioInput> audInputs;
+    // all the jobs of a group share one snapshot, the group readers are cloned from it instead of the preview readers
+    ExportSnapshot::Holder hSnapshot;
+    {
+        std::lock_guard<std::mutex> lk(mRenderQueueLock);
+        hSnapshot = jobs[0]->hSnapshot;
     }
+    uint32_t maxWidth = 0, maxHeight = 0;
+    MediaCore::Ratio frameRate;
+    auto failJob = [this] (JobOutput& output, const std::string& errMsg) {
+        output.failed = true;
+        std::lock_guard<std::mutex> lk(mRenderQueueLock);
+        output.hJob->errMsg = errMsg;
+        output.hJob->state = ExportJob::FAILED;
+    };
 
-    if (audEncParams.encodeAudio)
+    // every job has its own encoder, the encoder converts the shared frames to its own size and format
+    for (auto& hJob : jobs)
     {
-        // Audio
-        if (!mEncoder->ConfigureAudioStream(
-            audEncParams.codecName, audEncParams.sampleFormat, audEncParams.channels,
-            audEncParams.sampleRate, audEncParams.bitRate))
+        JobOutput output {hJob, MediaCore::MediaEncoder::CreateInstance()};
+        auto& vidParams = hJob->vidParams;
+        auto& audParams = hJob->audParams;
+        if (!output.hEncoder->Open(hJob->outputPath) ||
+            (vidParams.encodeVideo && !output.hEncoder->ConfigureVideoStream(vidParams.codecName, vidParams.imageFormat, vidParams.width, vidParams.height,
+                vidParams.frameRate, vidParams.bitRate, &vidParams.extraOpts)) ||
+            (audParams.encodeAudio && !output.hEncoder->ConfigureAudioStream(audParams.codecName, audParams.sampleFormat, audParams.channels,
+                audParams.sampleRate, audParams.bitRate)))
         {
-            errMsg = mEncoder->GetError();
-            return false;
+            failJob(output, output.hEncoder->GetError());
+            output.hEncoder->Close();
+            continue;
         }
-        mEncMtaReader = mMtaReader->CloneAndConfigure(audEncParams.channels, audEncParams.sampleRate, audEncParams.sampleFormat, audEncParams.samplesPerFrame);
+        if (vidParams.encodeVideo)
+        {
+            if (vidParams.width > maxWidth) maxWidth = vidParams.width;
+            if (vidParams.height > maxHeight) maxHeight = vidParams.height;
+            frameRate = vidParams.frameRate;
+        }
+        if (audParams.encodeAudio)
+        {
+            // the jobs with the same pcm format share one audio reader
+            auto iter = std::find_if(audInputs.begin(), audInputs.end(), [&audParams] (const AudioInput& input) {
+                return input.sampleFormat == audParams.sampleFormat && input.channels == audParams.channels &&
+                        input.sampleRate == audParams.sampleRate && input.samplesPerFrame == audParams.samplesPerFrame;
+            });
+            if (iter == audInputs.end())
+            {
+                AudioInput input;
+                input.sampleFormat = audParams.sampleFormat;
+                input.channels = audParams.channels;
+                input.sampleRate = audParams.sampleRate;
+                input.samplesPerFrame = audParams.samplesPerFrame;
+                if (hSnapshot && hSnapshot->hAudReader)
+                    input.hReader = hSnapshot->hAudReader->CloneAndConfigure(input.channels, input.sampleRate, input.sampleFormat, input.samplesPerFrame);
+                input.eof = !input.hReader;
+                audInputs.push_back(input);
+                iter = audInputs.end()-1;
+            }
+            output.audReaderIdx = (int)(iter-audInputs.begin());
+        }
+        outputs.push_back(output);
     }
-    return true;
-}
 
-void TimeLine::StartEncoding()
-{
-    if (mEncodingThread.joinable())
+    const int64_t startTime = jobs[0]->startTime;
+    const int64_t endTime = jobs[0]->endTime;
+    MediaCore::MultiTrackVideoReader::Holder hVidReader;
+    if (maxWidth > 0 && maxHeight > 0 && hSnapshot && hSnapshot->hVidReader)
+        hVidReader = hSnapshot->hVidReader->CloneAndConfigure(maxWidth, maxHeight, frameRate);
+    bool vidInputEof = !hVidReader;
+    int64_t vidFrameIdx = 0, vidpos = 0, startTimeOffset = startTime;
+    if (hVidReader)
     {
-        mQuitEncoding = true;
-        mEncodingThread.join();
-        //return;
+        hVidReader->SeekTo(startTime);
+        hVidReader->SetCacheFrameNum(8);
+        vidFrameIdx = hVidReader->MillsecToFrameIndex(startTime);
+        startTimeOffset = hVidReader->FrameIndexToMillsec(vidFrameIdx);
     }
-    mEncodeProcErrMsg.clear();
-    mEncodingProgress = 0;
-    mEncodingDuration = (double)ValidDuration()/1000.f;
-    mQuitEncoding = false;
-    mIsEncoding = true;
-    mEncodingThread = std::thread(&TimeLine::_EncodeProc, this);
-    SysUtils::SetThreadName(mEncodingThread, "TL-EncProc");
-}
-
-void TimeLine::StopEncoding()
-{
-    mQuitEncoding = true;
-    if (mEncodingThread.joinable())
+    for (auto& input : audInputs)
     {
-        mEncodingThread.join();
-        mEncodingThread = std::thread();
+        if (input.hReader)
+            input.hReader->SeekTo(startTime);
+    }
+    for (auto& output : outputs)
+    {
+        if (!output.failed && !output.hEncoder->Start())
+            failJob(output, output.hEncoder->GetError());
     }
-    mIsEncoding = false;
-    mEncoder = nullptr;
-    mEncMtvReader = nullptr;
-    mEncMtaReader = nullptr;
-}
 
-void TimeLine::_EncodeProc()
-{
-    Logger::Log(Logger::DEBUG) << ">>>>>>>>>>> Enter encoding proc >>>>>>>>>>>>" << std::endl;
-    mEncoder->Start();
-    bool vidInputEof = false;
-    bool audInputEof = false;
-    int nextLoopEncodeType = 0;  // 0: no hint, 1: video, 2: audio
-    int64_t audpos = 0, vidpos = 0;
-    double maxEncodeDuration = 0;
-    MediaCore::Ratio outFrameRate = mEncoder->GetVideoFrameRate();
+    // feed the stream which is behind, so the muxers of the encoders get the packets in order
+    const double duration = endTime > startTimeOffset ? (double)(endTime-startTimeOffset) : 1.;
     ImGui::ImMat vmat, amat;
-    uint32_t pcmbufSize = 8192;
-    uint8_t* pcmbuf = new uint8_t[pcmbufSize];
-    auto dur = ValidDuration();
-    int64_t encpos = 0;
-    int64_t vidFrameCount = 0;
-    int64_t startTimeOffset = 0;
-    if (mEncMtvReader) {
-        mEncMtvReader->SeekTo(mEncodingStart);
-        vidFrameCount = mEncMtvReader->MillsecToFrameIndex(mEncodingStart);
-        startTimeOffset = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
-        mEncMtvReader->SetCacheFrameNum(8);
-    }
-    else
-        vidInputEof = true;
-    if (mEncMtaReader)
-        mEncMtaReader->SeekTo(mEncodingStart);
-    else
-        audInputEof = true;
-    while (!mQuitEncoding && (!vidInputEof || !audInputEof))
+    while (!mQuitRenderQueue)
     {
-        bool idleLoop = true;
-        if (!vidInputEof && (nextLoopEncodeType == 1 || audInputEof || (nextLoopEncodeType == 0 && vidpos <= audpos)))
+        AudioInput* pAudInput = nullptr;
+        for (auto& input : audInputs)
         {
-            vidpos = mEncMtvReader->FrameIndexToMillsec(vidFrameCount);
-            bool eof = vidpos >= mEncodingEnd;
-            if (!eof)
+            if (!input.eof && (!pAudInput || input.audpos < pAudInput->audpos))
+                pAudInput = &input;
+        }
+        if (vidInputEof && !pAudInput)
+            break;
+        if (!vidInputEof && (!pAudInput || vidpos <= pAudInput->audpos))
+        {
+            vidpos = hVidReader->FrameIndexToMillsec(vidFrameIdx);
+            vmat.release();
+            if (vidpos >= endTime)
+                vidInputEof = true;
+            else if (!hVidReader->ReadVideoFrameByIdx(vidFrameIdx++, vmat))
             {
-                if (vmat.empty())
-                {
-                    if (!mEncMtvReader->ReadVideoFrameByIdx(vidFrameCount, vmat))
-                    {
-                        std::ostringstream oss;
-                        oss << "[video] '" << mEncMtvReader->GetError() << "'.";
-                        mEncodeProcErrMsg = oss.str();
-                        break;
-                    }
-                    if (!vmat.empty())
-                    {
-                        vmat.time_stamp = (double)(vidpos-startTimeOffset)/1000.;
-                        vidFrameCount++;
-                    }
-                }
-                if (!vmat.empty())
+                for (auto& output : outputs)
                 {
-                    {
-                        std::lock_guard<std::mutex> lk(mEncodingMutex);
-                        mEncodingVFrame = vmat;
-                    }
-                    bool consumed = false;
-                    if (!mEncoder->EncodeVideoFrame(vmat, consumed, false))
-                    {
-                        std::ostringstream oss;
-                        oss << "[video] '" << mEncoder->GetError() << "'.";
-                        mEncodeProcErrMsg = oss.str();
-                        break;
-                    }
-                    if (consumed)
-                    {
-                        vmat.release();
-                        nextLoopEncodeType = 0;
-                    }
-                    else
-                        nextLoopEncodeType = 2;
-                    if (vidpos > encpos)
-                    {
-                        encpos = vidpos;
-                        mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
-                    }
+                    if (!output.failed && output.hJob->vidParams.encodeVideo)
+                        failJob(output, "[video] '" + hVidReader->GetError() + "'.");
                 }
+                vidInputEof = true;
+                continue;
             }
-            else
+            if (!vidInputEof && vmat.empty())
+                continue;
+            vmat.time_stamp = (double)(vidpos-startTimeOffset)/1000.;
+            for (auto& output : outputs)
             {
-                vmat.release();
                 bool consumed = false;
-                if (!mEncoder->EncodeVideoFrame(vmat, consumed))
-                {
-                    std::ostringstream oss;
-                    oss << "[video] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                vidInputEof = true;
+                if (!output.failed && output.hJob->vidParams.encodeVideo && !output.hEncoder->EncodeVideoFrame(vmat, consumed))
+                    failJob(output, "[video] '" + output.hEncoder->GetError() + "'.");
             }
         }
         else
         {
-            bool eof;
-            uint32_t readSize = pcmbufSize;
-            if (amat.empty() && !mEncMtaReader->ReadAudioSamples(amat, eof) && !eof)
-            {
-                std::ostringstream oss;
-                oss << "[audio] '" << mEncMtaReader->GetError() << "'.";
-                mEncodeProcErrMsg = oss.str();
-                break;
-            }
-            if (audpos > mEncodingEnd) eof = true;
-            if (!eof && !amat.empty())
+            bool eof = false;
+            amat.release();
+            if (!pAudInput->hReader->ReadAudioSamples(amat, eof) && !eof)
             {
-                audpos = amat.time_stamp * 1000;
-                amat.time_stamp = (double)(audpos-startTimeOffset)/1000.;
-                bool consumed = false;
-                if (!mEncoder->EncodeAudioSamples(amat, consumed, false))
-                {
-                    std::ostringstream oss;
-                    oss << "[audio] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                if (consumed)
-                {
-                    amat.release();
-                    nextLoopEncodeType = 0;
-                }
-                else
-                    nextLoopEncodeType = 1;
-                if (audpos > encpos)
+                for (auto& output : outputs)
                 {
-                    encpos = audpos;
-                    mEncodingProgress = (float)((double)(encpos - startTimeOffset) / dur);
+                    if (!output.failed && output.audReaderIdx == (int)(pAudInput-audInputs.data()))
+                        failJob(output, "[audio] '" + pAudInput->hReader->GetError() + "'.");
                 }
+                pAudInput->eof = true;
+                continue;
             }
-            else
+            if (eof || amat.empty() || pAudInput->audpos > endTime)
             {
                 amat.release();
-                // {
-                //     std::lock_guard<std::mutex> lk(mEncodingMutex);
-                //     mEncodingAFrame = amat;
-                // }
+                pAudInput->eof = true;
+            }
+            else
+            {
+                pAudInput->audpos = amat.time_stamp*1000;
+                amat.time_stamp = (double)(pAudInput->audpos-startTimeOffset)/1000.;
+            }
+            for (auto& output : outputs)
+            {
                 bool consumed = false;
-                if (!mEncoder->EncodeAudioSamples(amat, consumed))
-                {
-                    std::ostringstream oss;
-                    oss << "[audio] '" << mEncoder->GetError() << "'.";
-                    mEncodeProcErrMsg = oss.str();
-                    break;
-                }
-                audInputEof = true;
+                if (!output.failed && output.audReaderIdx == (int)(pAudInput-audInputs.data()) && !output.hEncoder->EncodeAudioSamples(amat, consumed))
+                    failJob(output, "[audio] '" + output.hEncoder->GetError() + "'.");
             }
         }
+        int64_t encpos = vidInputEof ? endTime : vidpos;
+        for (auto& input : audInputs)
+        {
+            if (!input.eof && input.audpos < encpos)
+                encpos = input.audpos;
+        }
+        for (auto& output : outputs)
+        {
+            if (!output.failed)
+                output.hJob->progress = (float)((double)(encpos-startTimeOffset)/duration);
+        }
     }
-    if (!mQuitEncoding && mEncodeProcErrMsg.empty())
+    for (auto& output : outputs)
     {
-        mEncodingProgress = 1;
+        if (!output.failed && !mQuitRenderQueue && !output.hEncoder->FinishEncoding())
+            failJob(output, output.hEncoder->GetError());
+        output.hEncoder->Close();
+        if (output.failed)
+            continue;
+        if (mQuitRenderQueue)
+            output.hJob->state = ExportJob::CANCELLED;
+        else
+        {
+            output.hJob->progress = 1.f;
+            output.hJob->state = ExportJob::DONE;
+        }
+    }
+    for (auto& hJob : jobs)
+    {
+        if (hJob->state == ExportJob::RUNNING)
+            hJob->state = ExportJob::FAILED;
     }
-    mEncoder->FinishEncoding();
-    mEncoder->Close();
-    mIsEncoding = false;
-    Logger::Log(Logger::DEBUG) << "<<<<<<<<<<<<< Quit encoding proc <<<<<<<<<<<<<<<<" << std::endl;
 }
 
 void TimeLine::AddNewRecord(imgui_json::value& record)
 {
+    mEditRevision++;
     // truncate the history record list if needed
     if (mRecordIter != mHistoryRecords.end())
         mHistoryRecords.erase(mRecordIter, mHistoryRecords.end());
@@ -10863,6 +12504,57 @@ bool DrawTimeLine(TimeLine *timeline, bool *expanded, bool& need_save, bool edit
                 return hTask;
             },
         },
+        {
+            "Generate Proxy", "ProxyGen",
+            [timeline] (Clip* pClip) {
+                if (!(timeline && timeline->IsProjectDirReady()))
+                    return false;
+                const auto clipType = pClip->mType;
+                return IS_VIDEO(clipType)&&!IS_IMAGE(clipType)&&!IS_IMAGESEQ(clipType);
+            },
+            [timeline] (Clip* pClip, bool& bCloseDlg) {
+                auto hParser = pClip->mMediaParser;
+                ImColor tTagColor(KNOWNIMGUICOLOR_LIGHTGRAY);
+                ImColor tTextColor(KNOWNIMGUICOLOR_LIGHTGREEN);
+                ImGui::TextColored(tTagColor, "Source File: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", SysUtils::ExtractFileName(hParser->GetUrl()).c_str());
+                ImGui::ShowTooltipOnHover("Path: '%s'", hParser->GetUrl().c_str());
+                ImGui::TextColored(tTagColor, "Work Dir: ");
+                ImGui::SameLine(); ImGui::TextColored(tTextColor, "%s", timeline->mhProject->GetProjectDir().c_str());
+
+                static int m_proxyParam_iCodec = 0;
+                static const char* s_proxyParam_aCodecs[] = { "MJPEG", "DNxHR LB" };
+                static const char* s_proxyParam_aCodecNames[] = { "mjpeg", "dnxhr_lb" };
+                static int m_proxyParam_iHeight = 1;
+                static const char* s_proxyParam_aHeights[] = { "360p", "540p", "720p" };
+                static const int s_proxyParam_aHeightValues[] = { 360, 540, 720 };
+                ImGui::Spacing(); ImGui::Spacing();
+                ImGui::PushItemWidth(140);
+                ImGui::Combo("Codec##ProxyGenParamCodec", &m_proxyParam_iCodec, s_proxyParam_aCodecs, IM_ARRAYSIZE(s_proxyParam_aCodecs));
+                ImGui::Combo("Height##ProxyGenParamHeight", &m_proxyParam_iHeight, s_proxyParam_aHeights, IM_ARRAYSIZE(s_proxyParam_aHeights));
+                ImGui::PopItemWidth();
+
+                bCloseDlg = false;
+                MEC::BackgroundTask::Holder hTask;
+                if (ImGui::Button("   OK   "))
+                {
+                    imgui_json::value jnTask;
+                    jnTask["type"] = "ProxyGen";
+                    jnTask["project_dir"] = timeline->mhProject->GetProjectDir();
+                    jnTask["source_url"] = hParser->GetUrl();
+                    jnTask["is_image_seq"] = IS_IMAGESEQ(pClip->mType);
+                    jnTask["media_item_id"] = imgui_json::number(pClip->mMediaID);
+                    jnTask["proxy_codec"] = s_proxyParam_aCodecNames[m_proxyParam_iCodec];
+                    jnTask["proxy_height"] = imgui_json::number(s_proxyParam_aHeightValues[m_proxyParam_iHeight]);
+                    auto hSettings = timeline->mhMediaSettings->Clone();
+                    hTask = MEC::BackgroundTask::CreateBackgroundTask(jnTask, hSettings, timeline->mTxMgr);
+                    bCloseDlg = true;
+                } ImGui::SameLine(0, 10);
+                if (ImGui::Button(" Cancel "))
+                    bCloseDlg = true;
+                return hTask;
+            },
+        },
     };
 
     static size_t s_szBgtaskSelIdx;
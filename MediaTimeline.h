@@ -21,12 +21,15 @@
 #include <imgui_extra_widget.h>
 #include <ImMaskCreator.h>
 #include "Overview.h"
+#include "MediaAnalysisCache.h"
 #include "Snapshot.h"
 #include "MediaReader.h"
 #include "MultiTrackVideoReader.h"
 #include "MultiTrackAudioReader.h"
+#include "LoudnessMeter.h"
 #include "VideoTransformFilter.h"
 #include "MediaEncoder.h"
+#include "SegmentMuxer.h"
 #include "AudioRender.h"
 #include "SubtitleTrack.h"
 #include "UI.h"
@@ -35,12 +38,15 @@
 #include "EventStackFilter.h"
 #include "VideoTransformFilterUiCtrl.h"
 #include "MediaPlayer.h"
+#include "AudioScopeAnalyzer.h"
 #include <thread>
 #include <string>
 #include <vector>
 #include <list>
 #include <unordered_set>
 #include <chrono>
+#include <atomic>
+#include <condition_variable>
 
 #define PLOT_IMPLOT   0
 #define PLOT_TEXTURE  1
@@ -376,14 +382,6 @@ static inline uint32_t EstimateMediaType(std::string file_suffix)
     return type;
 }
 
-enum AudioVectorScopeMode  : int
-{
-    LISSAJOUS,
-    LISSAJOUS_XY,
-    POLAR,
-    MODE_NB,
-};
-
 struct IDGenerator
 {
     int64_t GenerateID();
@@ -418,6 +416,7 @@ struct MediaItem
     bool ChangeSource(const std::string& name, const std::string& path);
     void ReleaseItem();
     void UpdateThumbnail();
+    bool UpdateProxy();                     // attach the proxy recorded in 'ProxyMedia' meta data to the parser, return true if changed
 
     imgui_json::value mMetaData;
 
@@ -1075,7 +1074,6 @@ struct audio_band_config
 
 struct AudioAttribute
 {
-    std::mutex audio_mutex;
     // meters
     int left_stack {0};                         // audio left meter stack
     int left_count {0};                         // audio left meter count
@@ -1171,7 +1169,6 @@ struct MediaTrack
     void CreateOverlap(int64_t start, int64_t start_clip_id, int64_t end, int64_t end_clip_id, uint32_t type);
     Overlap * FindExistOverlap(int64_t start_clip_id, int64_t end_clip_id);
     
-    void CalculateAudioScopeData(ImGui::ImMat& mat_in);
     float GetAudioLevel(int channel);
     void SetAudioLevel(int channel, float level);
 
@@ -1223,8 +1220,9 @@ typedef struct TimeLineCallbackFunctions
 struct TimeLine
 {
 #define MAX_VIDEO_CACHE_FRAMES  3
-    TimeLine();
+    TimeLine(bool bHeadless = false);
     ~TimeLine();
+    const bool mHeadless;                   // no texture, snapshot or audio device is created, for the command line exporter
     IDGenerator m_IDGenerator;              // Timeline ID generator
     std::vector<MediaItem *> media_items;   // Media Bank, project saved
     std::vector<MediaTrack *> m_Tracks;     // timeline tracks, project saved
@@ -1232,6 +1230,7 @@ struct TimeLine
     std::vector<ClipGroup> m_Groups;        // timeline clip groups, project saved
     std::vector<Overlap *> m_Overlaps;      // timeline clip overlap, project saved
     std::unordered_map<int64_t, MediaCore::Snapshot::Generator::Holder> m_VidSsGenTable;  // Snapshot generator for video media item, provide snapshots for VideoClip
+    std::unordered_map<std::string, std::weak_ptr<MediaCore::Snapshot::Generator>> m_EditingSsGenTable;  // Snapshot generators shared by the editing clips/overlaps, keyed by source, snapshot size and snap window
     int64_t mStart   {0};                   // whole timeline start in ms, project saved
     int64_t mEnd     {0};                   // whole timeline end in ms, project saved
     bool m_in_threads {false};
@@ -1245,6 +1244,8 @@ struct TimeLine
 
     MediaCore::SharedSettings::Holder mhMediaSettings;
     MediaCore::SharedSettings::Holder mhPreviewSettings;
+    MediaCore::MediaAnalysisCache::Holder mhMediaAnalysisCache;   // media info, snapshots and waveform of the imported media, shared across sessions
+    MediaCore::MediaParser::BatchProber::Holder mhMediaBatchProber;  // probe the media imported in batch with shared threads
     MediaCore::AudioRender::PcmFormat mAudioRenderFormat {MediaCore::AudioRender::PcmFormat::FLOAT32}; // timeline audio format, project saved, configured
     AudioAttribute mAudioAttribute;         // timeline audio attribute, need save
 
@@ -1271,8 +1272,24 @@ struct TimeLine
     std::string mOutputPath {""};
     std::string mVideoCodec {"h264"};
     std::string mAudioCodec {"aac"};
+    std::string mVideoEncoder;              // encoder name of the last export, e.g. 'libx264', empty to pick one of 'mVideoCodec', project saved
+    int64_t mVideoBitrate {-1};             // -1 if the encoder has no bit rate setting, project saved
+    int mOutputColorSpace {-1};             // 'AVColorSpace' of the exported video, -1 if not set, project saved
+    int mOutputColorTransfer {-1};          // 'AVColorTransferCharacteristic' of the exported video, -1 if not set, project saved
+    std::string mAudioEncoder;              // encoder name of the last export, e.g. 'aac', project saved
+    int64_t mAudioBitrate {128000};         // project saved
     bool bExportVideo {true};
     bool bExportAudio {true};
+    bool bNormalizeLoudness {false};        // apply a master gain when exporting to reach the target loudness, project saved
+    float mLoudnessTarget {-23.f};          // target integrated loudness in LUFS, project saved
+    float mTruePeakCeiling {-1.f};          // max true peak in dBTP after normalization, project saved
+    bool bSegmentedExport {false};          // encode video segments in parallel then join them without re-encoding, project saved
+    int mExportSegmentCount {0};            // parallel segment count, 0 means decided by the cpu core count, project saved
+    bool bSmartRender {false};              // copy the packets of untouched source ranges instead of re-encoding them, project saved
+    bool bTwoPassExport {false};            // two-pass video encoding, the first pass statistics are kept per segment in the project, project saved
+    bool bResumableExport {false};          // keep the finished segments with a manifest next to the output, a restarted export skips them, project saved
+    bool bUseProxyMedia {true};             // preview reads the proxy of the video media if there is one, export always reads the original, project saved
+    std::atomic<bool> mProxyMediaUpdated {false};   // set by background tasks when a proxy is generated, applied in the ui thread
     MediaCore::MediaEncoder::Holder mEncoder;
 
     struct VideoEncoderParams
@@ -1302,10 +1319,59 @@ struct TimeLine
     MediaCore::MultiTrackVideoReader::Holder mEncMtvReader;
     MediaCore::MultiTrackAudioReader::Holder mEncMtaReader;
 
+    // The encoders, bit rates and color options from the project saved export settings. The output size, frame rate and
+    // audio format are left to the caller.
+    void MakeEncoderParams(VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams) const;
     bool ConfigEncoder(const std::string& outputPath, VideoEncoderParams& vidEncParams, AudioEncoderParams& audEncParams, std::string& errMsg);
     void StartEncoding();
     void StopEncoding();
     void _EncodeProc();
+    // segmented export
+    std::string mEncOutputPath;
+    VideoEncoderParams mEncVidParams;
+    AudioEncoderParams mEncAudParams;
+    MediaCore::SegmentMuxer::Holder mSegmentMuxer;
+    bool IsSegmentedExport() const;         // the video is encoded in segments, which are joined by 'mSegmentMuxer'
+    int GetExportSegmentCount() const;
+    void _EncodeSegmentedProc();
+    bool _EncodeVideoSegment(MediaCore::MultiTrackVideoReader::Holder hReader, const std::string& segPath, int64_t startFrame, int64_t endFrame, std::atomic<int64_t>& encodedFrames, std::atomic_bool& abort, std::string& errMsg,
+            int pass = 0, const std::string& statsPath = "");
+    // the visible clips are copied on the ui thread when the export starts, the encoding threads only read the copy
+    struct EncodingClipSnapshot
+    {
+        int64_t start;
+        int64_t end;
+        bool isText;
+        std::string content;    // track order and clip json, without the timeline position
+    };
+    std::vector<EncodingClipSnapshot> mEncClipSnapshots;
+    // the transitions are saved with the overlaps instead of the clips, they are part of the segment content too
+    struct EncodingOverlapSnapshot
+    {
+        int64_t start;
+        int64_t end;
+        std::string content;    // overlap json with the transition blueprint, without the timeline position
+    };
+    std::vector<EncodingOverlapSnapshot> mEncOverlapSnapshots;
+    static EncodingOverlapSnapshot SnapshotEncodingOverlap(Overlap* ovlp);
+    static std::string ComposeSegmentFingerprint(const std::string& encSettings, int64_t segStart, int64_t segEnd,
+            const std::vector<EncodingClipSnapshot>& clips, const std::vector<EncodingOverlapSnapshot>& overlaps);
+    void _SnapshotEncodingClips();
+    std::string _GetSegmentFingerprint(int64_t startFrame, int64_t endFrame);
+    std::string _GetTwoPassStatsPath(int64_t startFrame, int64_t endFrame);
+    bool _EncodeAudioOnly(MediaCore::MediaEncoder::Holder hEncoder, int64_t startTimeOffset, std::string& errMsg);
+    void _ApplyLoudnessNormalization();
+    // smart render
+    struct StreamCopyRange
+    {
+        int64_t startFrame;     // output frame range [startFrame, endFrame)
+        int64_t endFrame;
+        std::string url;        // source media
+        int64_t srcStart;       // millisecond in the source, a key frame position
+        int64_t srcEnd;         // millisecond in the source, the position of the next key frame to copy or the media end
+        MediaCore::SegmentMuxer::VideoCodecInfo codecInfo;  // the re-encoded segments follow the codec parameters of the source
+    };
+    std::vector<StreamCopyRange> _FindStreamCopyRanges(int64_t startFrame, int64_t endFrame);
     // encoding 
     std::thread mEncodingThread;
     bool mIsEncoding {false};
@@ -1314,6 +1380,7 @@ struct TimeLine
     int64_t mEncodingStart {0};
     int64_t mEncodingEnd {0};
     std::string mEncodeProcErrMsg;
+    std::string mSmartRenderNote;           // why the untouched ranges are re-encoded by smart render, guarded by 'mEncodingMutex'
     float mEncodingProgress {0};
     float mEncodingDuration {0};
     std::mutex mEncodingMutex;
@@ -1321,7 +1388,70 @@ struct TimeLine
     ImGui::ImMat mEncodingAFrame;
     ImTextureID mEncodingPreviewTexture {nullptr};  // encoding preview texture
 
-    void CalculateAudioScopeData(ImGui::ImMat& mat);
+    // export render queue, the queued jobs are rendered concurrently within the cpu and memory budgets.
+    // Jobs started together with the same export range and frame rate share one decoding pass, the frames
+    // are fanned out to the encoders of all these jobs.
+    // the readers cloned from the preview readers on the ui thread when a job is queued, so a job renders the
+    // timeline as it was when it was queued. Jobs queued without an edit in between share one snapshot.
+    struct ExportSnapshot
+    {
+        using Holder = std::shared_ptr<ExportSnapshot>;
+        uint64_t editRevision {0};
+        MediaCore::MultiTrackVideoReader::Holder hVidReader;
+        MediaCore::MultiTrackAudioReader::Holder hAudReader;
+    };
+    uint64_t mEditRevision {0};             // increased on every edit synced to the data layer
+    struct ExportJob
+    {
+        using Holder = std::shared_ptr<ExportJob>;
+        enum State
+        {
+            PENDING = 0,
+            RUNNING,
+            DONE,
+            FAILED,
+            CANCELLED,
+        };
+        std::string outputPath;
+        VideoEncoderParams vidParams;
+        AudioEncoderParams audParams;
+        int64_t startTime {0};                  // export range in millisecond
+        int64_t endTime {0};
+        int cpuCost {1};                        // estimated cpu cores and memory used by this job
+        int64_t memCostMB {0};
+        std::atomic<int> state {PENDING};
+        std::atomic<float> progress {0.f};
+        std::string errMsg;                     // valid when 'state' is FAILED, guarded by 'mRenderQueueLock'
+        ExportSnapshot::Holder hSnapshot;       // released when the job is finished, guarded by 'mRenderQueueLock'
+    };
+    std::list<ExportJob::Holder> mRenderQueue;
+    uint64_t mRenderQueueAddCount {0};      // wakes up the running queue to pick the new jobs
+    std::mutex mRenderQueueLock;
+    std::condition_variable mRenderQueueCv;
+    std::thread mRenderQueueThread;
+    std::atomic_bool mIsRenderQueueRunning {false};
+    std::atomic_bool mQuitRenderQueue {false};
+    int mRenderQueueCpuBudget {0};          // cpu cores, 0 means all the cores
+    int mRenderQueueMemBudgetMB {4096};
+    bool AddExportJob(const std::string& outputPath, const VideoEncoderParams& vidEncParams, const AudioEncoderParams& audEncParams, std::string& errMsg);
+    void RemoveExportJob(ExportJob::Holder hJob);
+    void StartRenderQueue();
+    void StopRenderQueue();
+    void _RenderQueueProc();
+    void _RenderExportJobGroup(std::vector<ExportJob::Holder> jobs);
+
+    // loudness analysis of the export range, run in background while the export dialog is open. It's only set
+    // by the ui thread, the encoding threads take a copy under 'mLoudnessTaskLock' and never write it back.
+    MediaCore::LoudnessMeter::AnalysisTask::Holder mhLoudnessTask;
+    mutable std::mutex mLoudnessTaskLock;
+    void StartLoudnessAnalysis(uint32_t channels, uint32_t sampleRate);
+    void StopLoudnessAnalysis();
+    MediaCore::LoudnessMeter::AnalysisTask::Holder GetLoudnessTask() const;
+
+    // audio scope data is computed by 'mhAudioScope' on its own thread, and pulled into 'mAudioAttribute'
+    // and the tracks' 'mAudioTrackAttribute' by the ui thread
+    MEC::AudioScopeAnalyzer::Holder mhAudioScope;
+    void UpdateAudioScopeData();
 
     int64_t attract_docking_pixels {20};    // clip attract docking sucking in pixels range
     int disattract_docking_rate {5};        // pulling range is 1/5
@@ -1496,7 +1626,7 @@ struct TimeLine
     void SortMediaItemByName();
     void SortMediaItemByType();
     void FilterMediaItemByType(uint32_t mediaType);     // Media Bank, filter
-    MEC::MediaPlayer * mMediaPlayer;                    // Media Player
+    MEC::MediaPlayer * mMediaPlayer {nullptr};          // Media Player
     // Add By Jimmy: End
 
     MediaItem* mOpenCtxMenuMediaItem {nullptr};         // save the pointer to the MediaItem which its context menu is opened
@@ -1523,10 +1653,15 @@ struct TimeLine
     void ConfigureDataLayer();
     void SyncDataLayer(bool forceRefresh = false);
     MediaCore::Snapshot::Generator::Holder GetSnapshotGenerator(int64_t mediaItemId);
+    std::string GetEditingSnapshotGeneratorKey(MediaCore::MediaParser::Holder hParser, double windowSize, double frameCount);
+    MediaCore::Snapshot::Generator::Holder GetEditingSnapshotGenerator(int64_t mediaItemId, MediaCore::MediaParser::Holder hParser, double windowSize = 0, double frameCount = 0);
+    bool ConfigEditingSnapWindow(int64_t mediaItemId, MediaCore::Snapshot::Generator::Holder& hSsGen, MediaCore::Snapshot::Viewer::Holder& hViewer, double windowSize, double frameCount);
     void ConfigSnapshotWindow(int64_t viewWndDur);
     void ReflashSnapshotWindow(bool forceRefresh = false);
     MatUtils::Size2i CalcPreviewSize(const MatUtils::Size2i& videoSize, float previewScale);
     void UpdateVideoSettings(MediaCore::SharedSettings::Holder hSettings, float previewScale);
+    void SetUseProxyMedia(bool enable);
+    void ApplyProxyMediaUpdate();
     void UpdateAudioSettings(MediaCore::SharedSettings::Holder hSettings, MediaCore::AudioRender::PcmFormat pcmFormat);
 
     std::list<imgui_json::value> mHistoryRecords;
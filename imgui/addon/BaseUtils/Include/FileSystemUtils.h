@@ -39,6 +39,12 @@ BASEUTILS_API bool DeleteDirectoryAt(const std::string& path, bool recursiveDele
 BASEUTILS_API bool RenameFile(const std::string& fromPath, const std::string& toPath);
 BASEUTILS_API bool DeleteFileAt(const std::string& path);
 BASEUTILS_API bool CheckEquivalent(const std::string& path1, const std::string& path2);
+// Set the modification time of the file to now, so 'TrimDirectory()' treats it as recently used.
+BASEUTILS_API bool TouchFile(const std::string& path);
+// Delete the least recently modified regular files directly under 'dirPath', until the total size of the remaining
+// files is not larger than 'maxTotalSize'. If 'extName' is not empty, only the files with this extension name are
+// counted and deleted. Files listed in 'keepPaths' are counted but never deleted. Return the remaining total size.
+BASEUTILS_API uint64_t TrimDirectory(const std::string& dirPath, uint64_t maxTotalSize, const std::string& extName = "", const std::vector<std::string>& keepPaths = {});
 
 struct FileIterator
 {
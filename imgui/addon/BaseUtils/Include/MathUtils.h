@@ -1,6 +1,8 @@
 #pragma once
 #include <cstdint>
+#include <cstddef>
 #include <cmath>
+#include <string>
 
 namespace MathUtils
 {
@@ -185,4 +187,22 @@ template<> struct ColDepPackU16<float>
     typedef uint16_t stype2;
     stype2 operator()(const stype1& a) const { return (stype2)(a>=1.f ? 65535 : a<=0 ? 0 : std::round(a*65535.f)); }
 };
+
+// 64-bit FNV-1a hash. Unlike std::hash, its value does not depend on the platform, the standard library or the
+// process, so it can be used in file names and persisted keys. Pass a previous hash value as 'h' to chain the data.
+inline uint64_t Fnv1aHash64(const void* data, size_t size, uint64_t h = 0xcbf29ce484222325ULL)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+inline uint64_t Fnv1aHash64(const std::string& str, uint64_t h = 0xcbf29ce484222325ULL)
+{
+    return Fnv1aHash64(str.data(), str.size(), h);
+}
 } // ~namespace MatUtils
@@ -23,6 +23,9 @@
 #include <atomic>
 #include <thread>
 #include <chrono>
+#include <mutex>
+#include <algorithm>
+#include <unordered_map>
 #if (defined(__cplusplus) && __cplusplus >= 201703L) || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
 #define USE_CPP_FS
 #include <filesystem>
@@ -38,6 +41,7 @@ namespace fs = std::filesystem;
 #include <fcntl.h>
 #include <unistd.h>
 #include <ftw.h>
+#include <sys/time.h>
 #endif
 
 #include "FileSystemUtils.h"
@@ -458,6 +462,114 @@ bool CheckEquivalent(const string& path1, const string& path2)
 #endif
 }
 
+static int64_t GetModifyTime(const string& path)
+{
+#ifdef USE_CPP_FS
+    error_code ec;
+    auto t = fs::last_write_time(fs::path(path), ec);
+    if (ec)
+        return -1;
+    return (int64_t)t.time_since_epoch().count();
+#elif defined(_WIN32) && !defined(__MINGW64__)
+    throw runtime_error("Unimplemented!");
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0)
+        return -1;
+    return (int64_t)st.st_mtime;
+#endif
+}
+
+bool TouchFile(const string& path)
+{
+#ifdef USE_CPP_FS
+    error_code ec;
+    fs::last_write_time(fs::path(path), fs::file_time_type::clock::now(), ec);
+    return !ec;
+#elif defined(_WIN32) && !defined(__MINGW64__)
+    throw runtime_error("Unimplemented!");
+#else
+    return utimes(path.c_str(), nullptr) == 0;
+#endif
+}
+
+uint64_t TrimDirectory(const string& dirPath, uint64_t maxTotalSize, const string& extName, const vector<string>& keepPaths)
+{
+    struct FileEntry
+    {
+        string path;
+        uint64_t size;
+        int64_t mtime;
+    };
+    vector<FileEntry> files;
+    uint64_t totalSize = 0;
+    auto isKept = [&keepPaths] (const string& path) {
+        return find(keepPaths.begin(), keepPaths.end(), path) != keepPaths.end();
+    };
+#ifdef USE_CPP_FS
+    error_code ec;
+    for (const auto& entry : fs::directory_iterator(fs::path(dirPath), ec))
+    {
+        if (!entry.is_regular_file(ec))
+            continue;
+        const auto path = entry.path().string();
+        if (!extName.empty() && (path.size() < extName.size() || path.compare(path.size()-extName.size(), extName.size(), extName) != 0))
+            continue;
+        const auto size = (uint64_t)entry.file_size(ec);
+        if (ec)
+            continue;
+        totalSize += size;
+        if (!isKept(path))
+            files.push_back({path, size, (int64_t)entry.last_write_time(ec).time_since_epoch().count()});
+    }
+#elif defined(_WIN32) && !defined(__MINGW64__)
+    throw runtime_error("Unimplemented!");
+#else
+    DIR* pDir = opendir(dirPath.c_str());
+    if (!pDir)
+        return 0;
+    struct dirent* pEntry;
+    while ((pEntry = readdir(pDir)) != nullptr)
+    {
+        const string fileName(pEntry->d_name);
+        if (!extName.empty() && (fileName.size() < extName.size() || fileName.compare(fileName.size()-extName.size(), extName.size(), extName) != 0))
+            continue;
+        const auto path = JoinPath(dirPath, fileName);
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        totalSize += (uint64_t)st.st_size;
+        if (!isKept(path))
+            files.push_back({path, (uint64_t)st.st_size, (int64_t)st.st_mtime});
+    }
+    closedir(pDir);
+#endif
+    if (totalSize <= maxTotalSize)
+        return totalSize;
+    sort(files.begin(), files.end(), [] (const FileEntry& a, const FileEntry& b) {
+        return a.mtime < b.mtime;
+    });
+    for (const auto& file : files)
+    {
+        if (totalSize <= maxTotalSize)
+            break;
+        if (DeleteFileAt(file.path))
+            totalSize -= file.size;
+    }
+    return totalSize;
+}
+
+// The parsed file lists are cached by the directory and the filter settings, so opening the same image sequence again
+// doesn't enumerate and match the whole directory. An entry is valid as long as none of the parsed directories is modified.
+struct FileListCacheEntry
+{
+    vector<pair<string, int64_t>> dirMtimes;
+    shared_ptr<const vector<string>> paths;
+};
+static const uint32_t MAX_FILE_LIST_CACHE_ENTRIES = 64;
+static mutex g_fileListCacheLock;
+static unordered_map<string, FileListCacheEntry> g_fileListCache;
+
 class FileIterator_Impl : public FileIterator
 {
 public:
@@ -493,7 +605,7 @@ public:
         if (m_isParsed && !m_parseFailed)
         {
             FileIterator_Impl* pFileIter = dynamic_cast<FileIterator_Impl*>(hNewIns.get());
-            pFileIter->m_paths = m_paths;
+            pFileIter->m_hPaths = m_hPaths;
             pFileIter->m_isParsed = true;
         }
         else
@@ -564,12 +676,12 @@ public:
             while (!m_isParsed)
                 this_thread::sleep_for(chrono::milliseconds(5));
         }
-        if (m_fileIndex >= m_paths.size())
+        if (m_fileIndex >= m_hPaths->size())
         {
             m_errMsg = "End of path list.";
             return "";
         }
-        return m_paths[m_fileIndex];
+        return (*m_hPaths)[m_fileIndex];
     }
 
     string GetNextFilePath() override
@@ -580,13 +692,13 @@ public:
             while (!m_isParsed)
                 this_thread::sleep_for(chrono::milliseconds(5));
         }
-        if (m_fileIndex+1 >= m_paths.size())
+        if (m_fileIndex+1 >= m_hPaths->size())
         {
             m_errMsg = "End of path list.";
             return "";
         }
         m_fileIndex++;
-        return m_paths[m_fileIndex];
+        return (*m_hPaths)[m_fileIndex];
     }
 
     uint32_t GetCurrFileIndex() const override
@@ -602,7 +714,7 @@ public:
             while (!m_isParsed)
                 this_thread::sleep_for(chrono::milliseconds(5));
         }
-        return vector<string>(m_paths);
+        return vector<string>(*m_hPaths);
     }
 
     uint32_t GetValidFileCount(bool refresh) override
@@ -613,7 +725,7 @@ public:
             while (!m_isParsed)
                 this_thread::sleep_for(chrono::milliseconds(5));
         }
-        return m_paths.size();
+        return m_hPaths->size();
     }
 
     bool SeekToValidFile(uint32_t index) override
@@ -624,7 +736,7 @@ public:
             while (!m_isParsed)
                 this_thread::sleep_for(chrono::milliseconds(5));
         }
-        if (index >= m_paths.size())
+        if (index >= m_hPaths->size())
         {
             m_errMsg = "Arugment 'index' is out of valid range!";
             return false;
@@ -723,16 +835,31 @@ public:
     }
 #endif
 
-    bool IsMatchPattern(const string& path)
+    bool IsMatchPattern(const string& path, int64_t* pFrameNumber = nullptr, size_t* pNumTailLen = nullptr)
     {
-        return IsMatchPattern(path.c_str());
+        return IsMatchPattern(path.c_str(), pFrameNumber, pNumTailLen);
     }
 
-    bool IsMatchPattern(const char* pPath)
+    // If the 1st capture group of a regex pattern is a number, it's taken as the frame number of this file.
+    // 'pNumTailLen' receives the length from the start of the number to the end of the path.
+    bool IsMatchPattern(const char* pPath, int64_t* pFrameNumber = nullptr, size_t* pNumTailLen = nullptr)
     {
         if (m_isRegexPattern)
         {
-            return regex_match(pPath, m_filterRegex);
+            cmatch m;
+            if (!regex_match(pPath, m, m_filterRegex))
+                return false;
+            if (pFrameNumber && m.size() > 1 && m[1].matched && m[1].length() > 0 && m[1].length() <= 18)
+            {
+                const auto numStr = m[1].str();
+                if (all_of(numStr.begin(), numStr.end(), [] (char c) { return c >= '0' && c <= '9'; }))
+                {
+                    *pFrameNumber = stoll(numStr);
+                    if (pNumTailLen)
+                        *pNumTailLen = (size_t)(m.suffix().second-m[1].first);
+                }
+            }
+            return true;
         }
         else
         {
@@ -752,29 +879,128 @@ public:
         m_parseThread = thread(&FileIterator_Impl::ParseProc, this);
     }
 
+    string GetFileListCacheKey() const
+    {
+        ostringstream oss;
+        oss << m_baseDirPath << '|' << m_doFileFilter << m_isRegexPattern << m_caseSensitive << m_isRecursive << '|' << m_filterPattern;
+        return oss.str();
+    }
+
+    bool LoadFromFileListCache(const string& cacheKey)
+    {
+        FileListCacheEntry cacheEntry;
+        {
+            lock_guard<mutex> lk(g_fileListCacheLock);
+            auto iter = g_fileListCache.find(cacheKey);
+            if (iter == g_fileListCache.end())
+                return false;
+            cacheEntry = iter->second;
+        }
+        for (const auto& dirMtime : cacheEntry.dirMtimes)
+        {
+            if (GetModifyTime(dirMtime.first) != dirMtime.second)
+            {
+                lock_guard<mutex> lk(g_fileListCacheLock);
+                g_fileListCache.erase(cacheKey);
+                return false;
+            }
+        }
+        m_hPaths = cacheEntry.paths;
+        if (!m_hPaths->empty())
+        {
+            m_quickSample = m_hPaths->front();
+            m_isQuickSampleReady = true;
+        }
+        return true;
+    }
+
+    void SaveToFileListCache(const string& cacheKey, vector<pair<string, int64_t>>& dirMtimes)
+    {
+        lock_guard<mutex> lk(g_fileListCacheLock);
+        if (g_fileListCache.size() >= MAX_FILE_LIST_CACHE_ENTRIES && g_fileListCache.find(cacheKey) == g_fileListCache.end())
+            g_fileListCache.erase(g_fileListCache.begin());
+        auto& cacheEntry = g_fileListCache[cacheKey];
+        cacheEntry.dirMtimes = std::move(dirMtimes);
+        cacheEntry.paths = m_hPaths;
+    }
+
     void ParseProc()
     {
-        list<string> pathList;
-        if (!ParseOneDir("", pathList))
+        const string cacheKey = GetFileListCacheKey();
+        if (LoadFromFileListCache(cacheKey))
+        {
+            m_isParsed = true;
+            return;
+        }
+
+        list<PathEntry> pathList;
+        vector<pair<string, int64_t>> dirMtimes;
+        if (!ParseOneDir("", pathList, dirMtimes))
         {
             m_isParsed = true;
             m_parseFailed = true;
             return;
         }
-        pathList.sort();
-        m_paths.clear();
-        m_paths.reserve(pathList.size());
+        // files with frame numbers are ordered numerically in each directory, so 'img_10' follows 'img_9',
+        // and the name before the number is compared first to keep 'left_0001' and 'right_0001' in separate runs
+        pathList.sort([] (const PathEntry& a, const PathEntry& b) {
+            const int dirCmp = a.path.compare(0, a.dirLen, b.path, 0, b.dirLen);
+            if (dirCmp != 0)
+                return dirCmp < 0;
+            const bool aHasNum = a.frameNumber >= 0, bHasNum = b.frameNumber >= 0;
+            if (aHasNum != bHasNum)
+                return aHasNum;
+            if (aHasNum)
+            {
+                const int prefixCmp = a.path.compare(a.dirLen, a.numPos-a.dirLen, b.path, b.dirLen, b.numPos-b.dirLen);
+                if (prefixCmp != 0)
+                    return prefixCmp < 0;
+                if (a.frameNumber != b.frameNumber)
+                    return a.frameNumber < b.frameNumber;
+            }
+            return a.path < b.path;
+        });
+        auto hPaths = make_shared<vector<string>>();
+        hPaths->reserve(pathList.size());
         while (!pathList.empty())
         {
-            m_paths.push_back(std::move(pathList.front()));
+            hPaths->push_back(std::move(pathList.front().path));
             pathList.pop_front();
         }
+        m_hPaths = hPaths;
+        if (!m_quitThread)
+            SaveToFileListCache(cacheKey, dirMtimes);
         m_isParsed = true;
     }
 
-    bool ParseOneDir(const string& subDirPath, list<string>& pathList)
+    struct PathEntry
+    {
+        string path;
+        size_t dirLen;
+        size_t numPos;
+        int64_t frameNumber;
+    };
+
+    void AddPathEntry(list<PathEntry>& pathList, const string& relativePath, int64_t frameNumber, size_t numTailLen)
+    {
+        if (pathList.empty())
+        {
+            m_quickSample = relativePath;
+            m_isQuickSampleReady = true;
+        }
+        const auto sepPos = relativePath.find_last_of(_PATH_SEPARATOR);
+        const size_t dirLen = sepPos == string::npos ? 0 : sepPos+1;
+        // the matched path ends with the file name, so the number position is located from the end
+        const size_t numPos = numTailLen < relativePath.size()-dirLen ? relativePath.size()-numTailLen : dirLen;
+        pathList.push_back({relativePath, dirLen, numPos, frameNumber});
+    }
+
+    bool ParseOneDir(const string& subDirPath, list<PathEntry>& pathList, vector<pair<string, int64_t>>& dirMtimes)
     {
         bool ret = true;
+        // record the modification time before enumerating, so a change during the parsing invalidates the cached list
+        const string dirFullPathStr = JoinBaseDirPath(subDirPath);
+        dirMtimes.push_back({dirFullPathStr, GetModifyTime(dirFullPathStr)});
 #ifdef USE_CPP_FS
         fs::path dirFullPath = fs::path(m_baseDirPath)/fs::path(subDirPath);
         fs::directory_iterator dirIter(dirFullPath);
@@ -785,27 +1011,26 @@ public:
             if (m_isRecursive && IsSubDirectory(dirEntry))
             {
                 const fs::path subDirPath2 = fs::path(subDirPath)/dirEntry.path().filename();
-                if (!ParseOneDir(subDirPath2.string(), pathList))
+                if (!ParseOneDir(subDirPath2.string(), pathList, dirMtimes))
                 {
                     ret = false;
                     break;
                 }
             }
-            else if (IsCorrectFileType(dirEntry) && (!m_doFileFilter || IsMatchPattern(dirEntry.path().string())))
+            else if (IsCorrectFileType(dirEntry))
             {
+                int64_t frameNumber = -1;
+                size_t numTailLen = 0;
+                if (m_doFileFilter && !IsMatchPattern(dirEntry.path().string(), &frameNumber, &numTailLen))
+                    continue;
                 const fs::path filePath = fs::path(subDirPath)/dirEntry.path().filename();
-                if (pathList.empty())
-                {
-                    m_quickSample = filePath.string();
-                    m_isQuickSampleReady = true;
-                }
-                pathList.push_back(filePath.string());
+                AddPathEntry(pathList, filePath.string(), frameNumber, numTailLen);
             }
         }
 #elif defined(_WIN32) && !defined(__MINGW64__)
         throw runtime_error("Unimplemented!");
 #else
-        string dirFullPath = JoinBaseDirPath(subDirPath);
+        const string& dirFullPath = dirFullPathStr;
         DIR* pSubDir = opendir(dirFullPath.c_str());
         if (!pSubDir)
         {
@@ -828,20 +1053,19 @@ public:
             const string relativePath = pathOss.str();
             if (m_isRecursive && IsSubDirectory(ent, relativePath))
             {
-                if (!ParseOneDir(relativePath, pathList))
+                if (!ParseOneDir(relativePath, pathList, dirMtimes))
                 {
                     ret = false;
                     break;
                 }
             }
-            else if (IsCorrectFileType(ent, relativePath) && (!m_doFileFilter || IsMatchPattern(ent->d_name)))
+            else if (IsCorrectFileType(ent, relativePath))
             {
-                if (pathList.empty())
-                {
-                    m_quickSample = relativePath;
-                    m_isQuickSampleReady = true;
-                }
-                pathList.push_back(relativePath);
+                int64_t frameNumber = -1;
+                size_t numTailLen = 0;
+                if (m_doFileFilter && !IsMatchPattern(ent->d_name, &frameNumber, &numTailLen))
+                    continue;
+                AddPathEntry(pathList, relativePath, frameNumber, numTailLen);
             }
         }
         closedir(pSubDir);
@@ -856,7 +1080,7 @@ private:
     bool m_quitThread{false};
     atomic_bool m_parsingStarted{false};
     thread m_parseThread;
-    vector<string> m_paths;
+    shared_ptr<const vector<string>> m_hPaths{new vector<string>()};
     string m_quickSample;
     bool m_isQuickSampleReady{false};
     bool m_isRecursive{false};
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include "MediaTimeline.h"
+
+using namespace MediaTimeline;
+
+// The segment fingerprint is the key of the resumable export chunks and of the two-pass stats files, it must change
+// when anything rendered in the segment changes, including the transitions saved with the overlaps.
+static bool CheckTransitionChangesKey()
+{
+    const std::string encSettings = "libx264|1920x1080|25/1|8000000|250";
+    std::vector<TimeLine::EncodingClipSnapshot> clips = {
+        { 0, 6000, false, "0|{\"ID\":1}" },
+        { 4000, 10000, false, "0|{\"ID\":2}" },
+    };
+    Overlap ovlp(4000, 6000, 1, 2, MEDIA_VIDEO, nullptr);
+    imgui_json::value jnBp;
+    jnBp["Transition"] = imgui_json::string("Dissolve");
+    ovlp.mTransitionBP = jnBp;
+    std::vector<TimeLine::EncodingOverlapSnapshot> overlaps = { TimeLine::SnapshotEncodingOverlap(&ovlp) };
+    const auto key0 = TimeLine::ComposeSegmentFingerprint(encSettings, 0, 10000, clips, overlaps);
+
+    jnBp["Transition"] = imgui_json::string("Wipe");
+    ovlp.mTransitionBP = jnBp;
+    overlaps = { TimeLine::SnapshotEncodingOverlap(&ovlp) };
+    const auto key1 = TimeLine::ComposeSegmentFingerprint(encSettings, 0, 10000, clips, overlaps);
+    if (key1 == key0)
+    {
+        std::cerr << "Segment key is NOT changed after editing the transition!" << std::endl;
+        return false;
+    }
+
+    overlaps.clear();
+    const auto key2 = TimeLine::ComposeSegmentFingerprint(encSettings, 0, 10000, clips, overlaps);
+    if (key2 == key0 || key2 == key1)
+    {
+        std::cerr << "Segment key is NOT changed after removing the transition!" << std::endl;
+        return false;
+    }
+
+    // a transition outside of the segment doesn't affect it
+    Overlap ovlp2(20000, 22000, 3, 4, MEDIA_VIDEO, nullptr);
+    overlaps = { TimeLine::SnapshotEncodingOverlap(&ovlp2) };
+    const auto key3 = TimeLine::ComposeSegmentFingerprint(encSettings, 0, 10000, clips, overlaps);
+    if (key3 != key2)
+    {
+        std::cerr << "Segment key is changed by a transition outside of the segment!" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    if (!CheckTransitionChangesKey())
+        return -1;
+    std::cout << "SegmentFingerprintTest PASSED." << std::endl;
+    return 0;
+}